@@ -0,0 +1,171 @@
+//
+// Created by yuwenyong on 17-12-9.
+//
+
+#include "net4cxx/net4cxx.h"
+#include <atomic>
+#include <new>
+#include <unistd.h>
+
+
+using namespace net4cxx;
+
+
+/// Every heap allocation of the process goes through here, asio's completion operations included.
+std::atomic<uint64> gAllocations{0};
+
+void* operator new(size_t size) {
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    void *pointer = malloc(size ? size : 1);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete(void *pointer, size_t size) noexcept {
+    free(pointer);
+}
+
+void operator delete[](void *pointer, size_t size) noexcept {
+    free(pointer);
+}
+
+
+class EchoProtocol: public Protocol {
+public:
+    void dataReceived(Byte *data, size_t length) override {
+        write(data, length);
+    }
+};
+
+
+class EchoFactory: public Factory {
+public:
+    ProtocolPtr buildProtocol(const Address &address) override {
+        return std::make_shared<EchoProtocol>();
+    }
+};
+
+
+struct AllocStats {
+    std::string message;
+    int warmup{0};
+    int messages{0};
+    int roundTrips{0};
+    uint64 allocations{0};
+    bool finished{false};
+};
+
+
+/// Sends one message at a time and counts the allocations of both ends between the warm-up and the last echo.
+class PingProtocol: public Protocol {
+public:
+    explicit PingProtocol(AllocStats *stats)
+            : _stats(stats) {
+
+    }
+
+    void connectionMade() override {
+        write(_stats->message);
+    }
+
+    void dataReceived(Byte *data, size_t length) override {
+        _received += length;
+        if (_received < _stats->message.size()) {
+            return;
+        }
+        _received = 0;
+        ++_stats->roundTrips;
+        if (_stats->roundTrips == _stats->warmup) {
+            _stats->allocations = gAllocations.load(std::memory_order_relaxed);
+        } else if (_stats->roundTrips == _stats->warmup + _stats->messages) {
+            _stats->allocations = gAllocations.load(std::memory_order_relaxed) - _stats->allocations;
+            _stats->finished = true;
+            reactor()->stop();
+            return;
+        }
+        write(_stats->message);
+    }
+protected:
+    AllocStats *_stats;
+    size_t _received{0};
+};
+
+
+class PingFactory: public ClientFactory {
+public:
+    explicit PingFactory(AllocStats *stats)
+            : _stats(stats) {
+
+    }
+
+    ProtocolPtr buildProtocol(const Address &address) override {
+        return std::make_shared<PingProtocol>(_stats);
+    }
+
+    void clientConnectionFailed(ConnectorPtr connector, std::exception_ptr reason) override {
+        connector->reactor()->stop();
+    }
+protected:
+    AllocStats *_stats;
+};
+
+
+int main(int argc, char **argv) {
+    NET4CXX_Options->addArgument<std::string>("transport", "Transport to measure: tcp, unix", std::string("tcp"), {},
+                                              "allocbench");
+    NET4CXX_Options->addArgument<int>("messages", "Round trips measured after the warm-up", 100000, {}, "allocbench");
+    NET4CXX_Options->addArgument<int>("warmup", "Round trips before counting starts", 1000, {}, "allocbench");
+    NET4CXX_Options->addArgument<int>("message_size", "Bytes of each message", 64, {}, "allocbench");
+    NET4CXX_PARSE_COMMAND_LINE(argc, argv);
+
+    AllocStats stats;
+    stats.message.assign((size_t)std::max(NET4CXX_Options->get<int>("message_size"), 1), 'x');
+    stats.warmup = std::max(NET4CXX_Options->get<int>("warmup"), 1);
+    stats.messages = std::max(NET4CXX_Options->get<int>("messages"), 1);
+    std::string transport = NET4CXX_Options->get<std::string>("transport");
+
+    Reactor reactor;
+    ListenerPtr listener;
+    if (transport == "tcp") {
+        auto tcpListener = std::static_pointer_cast<TCPListener>(
+                reactor.listenTCP("0", std::make_unique<EchoFactory>(), "127.0.0.1"));
+        listener = tcpListener;
+        reactor.connectTCP("127.0.0.1", std::to_string(tcpListener->getLocalPort()),
+                           std::make_unique<PingFactory>(&stats));
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    } else if (transport == "unix") {
+        std::string path = StrUtil::format("/tmp/net4cxx-allocbench-%d.sock", (int)getpid());
+        ::unlink(path.c_str());
+        listener = reactor.listenUNIX(path, std::make_unique<EchoFactory>());
+        reactor.connectUNIX(path, std::make_unique<PingFactory>(&stats));
+#endif
+    } else {
+        std::cerr << "Unknown transport: " << transport << std::endl;
+        return 1;
+    }
+    reactor.run(false);
+    listener->stopListening();
+
+    if (!stats.finished) {
+        std::cerr << "Stopped after " << stats.roundTrips << " round trips" << std::endl;
+        return 1;
+    }
+    std::cout << transport << ": " << stats.allocations << " allocations over " << stats.messages
+              << " round trips of " << stats.message.size() << " bytes, "
+              << (double)stats.allocations / stats.messages << " per message" << std::endl;
+    return stats.allocations == 0 ? 0 : 1;
+}
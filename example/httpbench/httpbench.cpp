@@ -0,0 +1,233 @@
+//
+// Created by yuwenyong on 17-12-7.
+//
+
+#include "net4cxx/net4cxx.h"
+#include <iomanip>
+#include <thread>
+#include <sys/resource.h>
+
+
+using namespace net4cxx;
+
+
+double getCpuSeconds() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000.0 + usage.ru_stime.tv_sec +
+           usage.ru_stime.tv_usec / 1000000.0;
+}
+
+
+class HelloProtocol: public HTTPServerProtocol {
+public:
+    explicit HelloProtocol(const std::string *body)
+            : _body(body) {
+
+    }
+
+    void connectionMade() override {
+        _transport->setNoDelay(true);
+    }
+
+    void handleRequest(const HTTPRequestParser &request) override {
+        if (request.getTarget() != "/") {
+            sendResponse(404, "");
+            return;
+        }
+        sendResponse(200, *_body, {{"Content-Type", "text/plain"}, {"Server", "net4cxx"}});
+    }
+protected:
+    const std::string *_body;
+};
+
+
+class HelloFactory: public Factory {
+public:
+    explicit HelloFactory(std::string body)
+            : _body(std::move(body)) {
+
+    }
+
+    ProtocolPtr buildProtocol(const Address &address) override {
+        return std::make_shared<HelloProtocol>(&_body);
+    }
+protected:
+    std::string _body;
+};
+
+
+struct BenchStats {
+    std::string request;
+    int pipeline{1};
+    bool running{true};
+    uint64 requests{0};
+    uint64 bytes{0};
+    int errors{0};
+    Histogram latency;
+};
+
+
+/// Keeps pipeline requests in flight over one keep-alive connection, timing each from its write to the end of its
+/// response, as wrk does.
+class BenchClientProtocol: public Protocol {
+public:
+    explicit BenchClientProtocol(BenchStats *stats)
+            : _stats(stats) {
+
+    }
+
+    void connectionMade() override {
+        _transport->setNoDelay(true);
+        for (int i = 0; i != _stats->pipeline; ++i) {
+            send();
+        }
+    }
+
+    void dataReceived(Byte *data, size_t length) override {
+        _stats->bytes += length;
+        _buffer.append((const char *)data, length);
+        size_t offset = 0;
+        for (;;) {
+            size_t headerEnd = _buffer.find("\r\n\r\n", offset);
+            if (headerEnd == std::string::npos) {
+                break;
+            }
+            size_t contentLength = 0;
+            size_t field = _buffer.find("Content-Length: ", offset);
+            if (field != std::string::npos && field < headerEnd) {
+                contentLength = (size_t)strtoul(_buffer.c_str() + field + 16, nullptr, 10);
+            }
+            size_t end = headerEnd + 4 + contentLength;
+            if (end > _buffer.size()) {
+                break;
+            }
+            if (_buffer.compare(offset, 12, "HTTP/1.1 200") != 0) {
+                ++_stats->errors;
+            }
+            offset = end;
+            std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - _sent.front();
+            _sent.pop_front();
+            if (_stats->running) {
+                _stats->latency.record((uint64)elapsed.count());
+                ++_stats->requests;
+                send();
+            }
+        }
+        _buffer.erase(0, offset);
+    }
+protected:
+    void send() {
+        _sent.push_back(std::chrono::steady_clock::now());
+        write(_stats->request);
+    }
+
+    BenchStats *_stats;
+    std::string _buffer;
+    std::deque<std::chrono::steady_clock::time_point> _sent;
+};
+
+
+class BenchClientFactory: public ClientFactory {
+public:
+    explicit BenchClientFactory(BenchStats *stats)
+            : _stats(stats) {
+
+    }
+
+    ProtocolPtr buildProtocol(const Address &address) override {
+        return std::make_shared<BenchClientProtocol>(_stats);
+    }
+
+    void clientConnectionFailed(ConnectorPtr connector, std::exception_ptr reason) override {
+        ++_stats->errors;
+    }
+protected:
+    BenchStats *_stats;
+};
+
+
+/// A GET as a load generator sends it, or with header_set browser as a browser does, headers and cookies included.
+std::string buildRequest(const std::string &headerSet, const std::string &port) {
+    std::string request = "GET / HTTP/1.1\r\nHost: 127.0.0.1:" + port + "\r\n";
+    if (headerSet == "browser") {
+        request += "Connection: keep-alive\r\n"
+                   "Cache-Control: max-age=0\r\n"
+                   "sec-ch-ua: \"Chromium\";v=\"118\", \"Not=A?Brand\";v=\"99\"\r\n"
+                   "sec-ch-ua-mobile: ?0\r\n"
+                   "sec-ch-ua-platform: \"Linux\"\r\n"
+                   "Upgrade-Insecure-Requests: 1\r\n"
+                   "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) "
+                   "Chrome/118.0.0.0 Safari/537.36\r\n"
+                   "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,"
+                   "image/apng,*/*;q=0.8,application/signed-exchange;v=b3;q=0.7\r\n"
+                   "Sec-Fetch-Site: none\r\n"
+                   "Sec-Fetch-Mode: navigate\r\n"
+                   "Sec-Fetch-User: ?1\r\n"
+                   "Sec-Fetch-Dest: document\r\n"
+                   "Accept-Encoding: gzip, deflate, br\r\n"
+                   "Accept-Language: en-US,en;q=0.9\r\n"
+                   "Cookie: session=8f2a6c1e9b7d4f30a5e2c8b1d6f4a9e3; theme=dark; "
+                   "_ga=GA1.1.1234567890.1697000000\r\n";
+    }
+    return request + "\r\n";
+}
+
+
+int main(int argc, char **argv) {
+    NET4CXX_Options->addArgument<int>("connections", "Number of keep-alive connections", 64, {}, "httpbench");
+    NET4CXX_Options->addArgument<double>("duration", "Seconds to send requests for", 5.0, {}, "httpbench");
+    NET4CXX_Options->addArgument<int>("pipeline", "Requests in flight per connection", 1, {}, "httpbench");
+    NET4CXX_Options->addArgument<int>("body_size", "Bytes of each response body", 13, {}, "httpbench");
+    NET4CXX_Options->addArgument<std::string>("header_set", "Request headers: minimal, browser",
+                                              std::string("minimal"), {}, "httpbench");
+    NET4CXX_PARSE_COMMAND_LINE(argc, argv);
+    int connections = NET4CXX_Options->get<int>("connections");
+    double duration = NET4CXX_Options->get<double>("duration");
+
+    // The server has a reactor thread of its own, so that with more than one core it does not share one with the
+    // clients.
+    Reactor server, reactor;
+    std::string body((size_t)NET4CXX_Options->get<int>("body_size"), 'x');
+    auto listener = std::static_pointer_cast<TCPListener>(
+            server.listenTCP("0", std::make_unique<HelloFactory>(std::move(body)), "127.0.0.1"));
+    std::string port = std::to_string(listener->getLocalPort());
+    std::thread serverThread([&server]() {
+        server.run(false);
+    });
+
+    BenchStats stats;
+    stats.request = buildRequest(NET4CXX_Options->get<std::string>("header_set"), port);
+    stats.pipeline = std::max(NET4CXX_Options->get<int>("pipeline"), 1);
+    for (int i = 0; i != connections; ++i) {
+        reactor.connectTCP("127.0.0.1", port, std::make_unique<BenchClientFactory>(&stats));
+    }
+    auto start = std::chrono::steady_clock::now();
+    double cpuSeconds = getCpuSeconds();
+    reactor.callLater(duration, [&reactor, &stats]() {
+        stats.running = false;
+        reactor.stop();
+    });
+    reactor.run(false);
+    cpuSeconds = getCpuSeconds() - cpuSeconds;
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "connections  pipeline  requests/s  MB/s      p50 us    p90 us    p99 us    max us    "
+                 "cpu us/request" << std::endl;
+    std::cout << std::left << std::setw(13) << connections << std::setw(10) << stats.pipeline << std::setw(12)
+              << (long)(stats.requests / elapsed) << std::setw(10) << stats.bytes / elapsed / 1048576.0
+              << std::setw(10) << stats.latency.getValueAtPercentile(50.0) / 1000.0 << std::setw(10)
+              << stats.latency.getValueAtPercentile(90.0) / 1000.0 << std::setw(10)
+              << stats.latency.getValueAtPercentile(99.0) / 1000.0 << std::setw(10)
+              << stats.latency.getMax() / 1000.0 << cpuSeconds * 1000000.0 / std::max<uint64>(stats.requests, 1);
+    if (stats.errors) {
+        std::cout << " (" << stats.errors << " errors)";
+    }
+    std::cout << std::endl;
+    server.callFromThread([&server, listener]() {
+        listener->stopListening();
+        server.stop();
+    });
+    serverThread.join();
+    return 0;
+}
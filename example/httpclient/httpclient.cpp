@@ -0,0 +1,219 @@
+//
+// Created by yuwenyong on 17-12-8.
+//
+
+#include "net4cxx/net4cxx.h"
+#include <iomanip>
+
+
+using namespace net4cxx;
+
+
+/// Stand-in for the servers HTTPClient talks to: plain, gzip, chunked, close-delimited and slow responses.
+class TestServerProtocol: public HTTPServerProtocol {
+public:
+    explicit TestServerProtocol(const std::string *gzipBody)
+            : _gzipBody(gzipBody) {
+
+    }
+
+    void connectionLost(const DisconnectReason &reason) override {
+        if (!_timer.cancelled()) {
+            _timer.cancel();
+        }
+    }
+
+    void handleRequest(const HTTPRequestParser &request) override {
+        if (request.getTarget() == "/hello") {
+            sendResponse(200, "Hello, world!", {{"Content-Type", "text/plain"}});
+        } else if (request.getTarget() == "/gzip") {
+            sendResponse(200, *_gzipBody, {{"Content-Type", "text/plain"}, {"Content-Encoding", "gzip"}});
+        } else if (request.getTarget() == "/stream") {
+            write("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nConnection: close\r\n\r\n");
+            sendChunk(0);
+        } else if (request.getTarget() == "/eof") {
+            write("HTTP/1.0 200 OK\r\nContent-Type: text/plain\r\n\r\nUntil the connection closes");
+            loseConnection();
+        } else if (request.getTarget() == "/slow") {
+            _timer = reactor()->callLater(0.5, [this]() {
+                sendResponse(200, "Too late");
+            });
+        } else {
+            sendResponse(404, "");
+        }
+    }
+protected:
+    void sendChunk(int index) {
+        if (index == 5) {
+            write("0\r\n\r\n");
+            loseConnection();
+            return;
+        }
+        write(StrUtil::format("%x\r\n%s\r\n", 1024, std::string(1024, (char)('a' + index))));
+        _timer = reactor()->callLater(0.01, [this, index]() {
+            sendChunk(index + 1);
+        });
+    }
+
+    const std::string *_gzipBody;
+    DelayedCall _timer;
+};
+
+
+class TestServerFactory: public Factory {
+public:
+    TestServerFactory() {
+        CompressObj compressor(Zlib::zDefaultCompression, Zlib::deflated, 16 + Zlib::maxWBits);
+        std::string text;
+        for (int i = 0; i != 2048; ++i) {
+            text += "The quick brown fox jumps over the lazy dog.\n";
+        }
+        _gzipBody = compressor.compressToString(text);
+        _gzipBody += compressor.flushToString();
+    }
+
+    ProtocolPtr buildProtocol(const Address &address) override {
+        return std::make_shared<TestServerProtocol>(&_gzipBody);
+    }
+protected:
+    std::string _gzipBody;
+};
+
+
+struct Check {
+    const char *name;
+    HTTPRequestPtr request;
+    std::function<bool (const HTTPResponse &)> verify;
+};
+
+
+class ClientRunner {
+public:
+    ClientRunner(Reactor *reactor, const std::string &port)
+            : _reactor(reactor)
+            , _client(reactor) {
+        std::string origin = "http://127.0.0.1:" + port;
+        _origin = origin;
+        _checks.push_back({"plain", std::make_shared<HTTPRequest>(origin + "/hello"), [](const HTTPResponse &r) {
+            return r.getCode() == 200 && r.getBody() == "Hello, world!";
+        }});
+        _checks.push_back({"gzip", std::make_shared<HTTPRequest>(origin + "/gzip"), [](const HTTPResponse &r) {
+            return r.getCode() == 200 && r.getBody().size() == 2048 * 45;
+        }});
+        auto stream = std::make_shared<HTTPRequest>(origin + "/stream");
+        stream->setStreamingCallback([this](const Byte *data, size_t length) {
+            _streamed += length;
+        });
+        _checks.push_back({"chunked stream", stream, [this](const HTTPResponse &r) {
+            return r.getCode() == 200 && r.getBody().empty() && _streamed == 5 * 1024;
+        }});
+        _checks.push_back({"close-delimited", std::make_shared<HTTPRequest>(origin + "/eof"),
+                           [](const HTTPResponse &r) {
+            return r.getCode() == 200 && r.getBody() == "Until the connection closes";
+        }});
+        auto slow = std::make_shared<HTTPRequest>(origin + "/slow");
+        slow->setReadTimeout(0.2);
+        _checks.push_back({"read timeout", slow, nullptr});
+        _checks.push_back({"refused", std::make_shared<HTTPRequest>("http://127.0.0.1:1/"), nullptr});
+    }
+
+    /// Runs the checks one after another, then the load test.
+    void run(size_t index=0) {
+        if (index == _checks.size()) {
+            runLoad();
+            return;
+        }
+        const Check &check = _checks[index];
+        _client.fetch(check.request).addCallbacks([this, index, &check](HTTPResponsePtr &response) {
+            report(check.name, check.verify && check.verify(*response),
+                   StrUtil::format("%d, %u bytes", response->getCode(), (unsigned)response->getBody().size()));
+            run(index + 1);
+        }, [this, index, &check](std::exception_ptr error) {
+            std::string message;
+            try {
+                std::rethrow_exception(error);
+            } catch (std::exception &e) {
+                message = e.what();
+            }
+            report(check.name, !check.verify, message);
+            run(index + 1);
+        });
+    }
+
+    int getFailures() const {
+        return _failures;
+    }
+protected:
+    void report(const char *name, bool passed, const std::string &detail) {
+        std::cout << std::left << std::setw(18) << name << (passed ? "ok      " : "FAILED  ") << detail << std::endl;
+        if (!passed) {
+            ++_failures;
+        }
+    }
+
+    void runLoad() {
+        _client.setMaxConnectionsPerOrigin((size_t)std::max(NET4CXX_Options->get<int>("connections"), 1));
+        _client.setPipelineDepth((size_t)std::max(NET4CXX_Options->get<int>("pipeline"), 1));
+        int requests = NET4CXX_Options->get<int>("requests");
+        _remaining = requests;
+        _start = std::chrono::steady_clock::now();
+        for (int i = 0; i != requests; ++i) {
+            _client.fetch(_origin + "/hello").addCallbacks([this](HTTPResponsePtr &response) {
+                _reused += response->isReusedConnection() ? 1 : 0;
+                _latency.record((uint64)(response->getRequestTime() * 1e9));
+                finishLoad(response->getCode() != 200);
+            }, [this](std::exception_ptr error) {
+                finishLoad(true);
+            });
+        }
+    }
+
+    void finishLoad(bool failed) {
+        _loadErrors += failed ? 1 : 0;
+        if (--_remaining != 0) {
+            return;
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+        int requests = NET4CXX_Options->get<int>("requests");
+        report("pooled load", _loadErrors == 0,
+               StrUtil::format("%d requests, %.0f/s, %d on reused connections, p50 %.0f us, p99 %.0f us", requests,
+                               requests / elapsed, _reused, _latency.getValueAtPercentile(50.0) / 1000.0,
+                               _latency.getValueAtPercentile(99.0) / 1000.0));
+        _client.close();
+        // The server only notices the slow request was given up on once it answers, which it has by then.
+        _reactor->callLater(0.5, [this]() {
+            _reactor->stop();
+        });
+    }
+
+    Reactor *_reactor;
+    HTTPClient _client;
+    std::string _origin;
+    std::vector<Check> _checks;
+    size_t _streamed{0};
+    int _failures{0};
+    int _remaining{0};
+    int _reused{0};
+    int _loadErrors{0};
+    Histogram _latency;
+    std::chrono::steady_clock::time_point _start;
+};
+
+
+int main(int argc, char **argv) {
+    NET4CXX_Options->addArgument<int>("requests", "Requests issued at once in the load test", 10000, {},
+                                      "httpclient");
+    NET4CXX_Options->addArgument<int>("connections", "Connections per origin in the load test", 8, {}, "httpclient");
+    NET4CXX_Options->addArgument<int>("pipeline", "Requests in flight per connection in the load test", 1, {},
+                                      "httpclient");
+    NET4CXX_PARSE_COMMAND_LINE(argc, argv);
+
+    Reactor reactor;
+    auto listener = std::static_pointer_cast<TCPListener>(
+            reactor.listenTCP("0", std::make_unique<TestServerFactory>(), "127.0.0.1"));
+    ClientRunner runner(&reactor, std::to_string(listener->getLocalPort()));
+    runner.run();
+    reactor.run(false);
+    listener->stopListening();
+    return runner.getFailures() ? 1 : 0;
+}
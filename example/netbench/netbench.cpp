@@ -0,0 +1,1033 @@
+//
+// Created by yuwenyong on 17-11-23.
+//
+
+#include "net4cxx/net4cxx.h"
+#include <iomanip>
+#include <thread>
+#include <sys/resource.h>
+#include <unistd.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+
+using namespace net4cxx;
+
+
+#if defined(__SANITIZE_ADDRESS__)
+extern "C" size_t __sanitizer_get_current_allocated_bytes();
+#endif
+
+
+size_t getHeapUsage() {
+#if defined(__SANITIZE_ADDRESS__)
+    return __sanitizer_get_current_allocated_bytes();
+#elif defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    return mallinfo2().uordblks;
+#elif defined(__GLIBC__)
+    return (size_t)mallinfo().uordblks;
+#else
+    return 0;
+#endif
+}
+
+
+struct IdleStats {
+    int connections{0};
+    int answered{0};
+    std::vector<std::weak_ptr<Protocol>> protocols;
+    std::function<void ()> onAllAnswered;
+};
+
+
+class IdleServerProtocol: public Protocol, public std::enable_shared_from_this<IdleServerProtocol> {
+public:
+    explicit IdleServerProtocol(IdleStats *stats)
+            : _stats(stats) {
+
+    }
+
+    void connectionMade() override {
+        _stats->protocols.emplace_back(shared_from_this());
+    }
+
+    void dataReceived(Byte *data, size_t length) override {
+        write(data, length);
+        if (++_stats->answered == _stats->connections) {
+            _stats->onAllAnswered();
+        }
+    }
+protected:
+    IdleStats *_stats;
+};
+
+
+class IdleServerFactory: public Factory {
+public:
+    explicit IdleServerFactory(IdleStats *stats)
+            : _stats(stats) {
+
+    }
+
+    ProtocolPtr buildProtocol(const Address &address) override {
+        return std::make_shared<IdleServerProtocol>(_stats);
+    }
+protected:
+    IdleStats *_stats;
+};
+
+
+int runIdle(Reactor &reactor) {
+    IdleStats stats;
+    stats.connections = NET4CXX_Options->get<int>("connections");
+    double quietPeriod = NET4CXX_Options->get<double>("idle_trim_timeout");
+    reactor.setIdleTrimTimeout(quietPeriod);
+    stats.protocols.reserve((size_t)stats.connections);
+    auto listener = std::static_pointer_cast<TCPListener>(
+            reactor.listenTCP("0", std::make_unique<IdleServerFactory>(&stats), "127.0.0.1"));
+    size_t heapBefore = getHeapUsage();
+    // Clients are plain blocking sockets living outside the reactor, so the heap delta is the server side alone.
+    boost::asio::io_service clientService;
+    boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address::from_string("127.0.0.1"),
+                                            listener->getLocalPort());
+    std::vector<std::unique_ptr<boost::asio::ip::tcp::socket>> clients;
+    for (int i = 0; i != stats.connections; ++i) {
+        clients.emplace_back(std::make_unique<boost::asio::ip::tcp::socket>(clientService));
+        clients.back()->connect(endpoint);
+        boost::asio::write(*clients.back(), boost::asio::buffer("ping", 4));
+    }
+    size_t clientBytes = getHeapUsage() - heapBefore;
+    stats.onAllAnswered = [&]() {
+        reactor.callLater(quietPeriod * 2 + 0.1, [&]() {
+            size_t heapUsage = getHeapUsage() - heapBefore - clientBytes;
+            size_t bufferBytes = 0;
+            for (auto &protocol: stats.protocols) {
+                auto p = protocol.lock();
+                if (p) {
+                    bufferBytes += p->getMemoryUsage();
+                }
+            }
+            size_t connections = std::max<size_t>(stats.protocols.size(), 1);
+            std::cout << "idle connections:                 " << stats.protocols.size() << std::endl;
+            std::cout << "heap bytes per idle connection:   " << heapUsage / connections << std::endl;
+            std::cout << "buffer bytes per idle connection: " << bufferBytes / connections << std::endl;
+            reactor.stop();
+        });
+    };
+    reactor.run(false);
+    return 0;
+}
+
+
+struct ChurnStats {
+    int connections{0};
+    int concurrency{0};
+    int started{0};
+    int closed{0};
+    int clean{0};
+    std::string port;
+    std::function<void ()> connectOne;
+};
+
+
+class ChurnServerProtocol: public Protocol {
+public:
+    void dataReceived(Byte *data, size_t length) override {
+
+    }
+};
+
+
+class ChurnServerFactory: public Factory {
+public:
+    ProtocolPtr buildProtocol(const Address &address) override {
+        return std::make_shared<ChurnServerProtocol>();
+    }
+};
+
+
+class ChurnClientProtocol: public Protocol {
+public:
+    void connectionMade() override {
+        loseConnection();
+    }
+
+    void dataReceived(Byte *data, size_t length) override {
+
+    }
+};
+
+
+class ChurnClientFactory: public ClientFactory {
+public:
+    explicit ChurnClientFactory(ChurnStats *stats)
+            : _stats(stats) {
+
+    }
+
+    ProtocolPtr buildProtocol(const Address &address) override {
+        return std::make_shared<ChurnClientProtocol>();
+    }
+
+    void clientConnectionLost(ConnectorPtr connector, const DisconnectReason &reason) override {
+        ++_stats->closed;
+        if (reason.isClean()) {
+            ++_stats->clean;
+        }
+        if (_stats->started < _stats->connections) {
+            _stats->connectOne();
+        } else if (_stats->closed == _stats->connections) {
+            connector->reactor()->stop();
+        }
+    }
+protected:
+    ChurnStats *_stats;
+};
+
+
+int runChurn(Reactor &reactor) {
+    ChurnStats stats;
+    stats.connections = NET4CXX_Options->get<int>("connections");
+    stats.concurrency = std::min(NET4CXX_Options->get<int>("concurrency"), stats.connections);
+    auto listener = std::static_pointer_cast<TCPListener>(
+            reactor.listenTCP("0", std::make_unique<ChurnServerFactory>(), "127.0.0.1"));
+    stats.port = std::to_string(listener->getLocalPort());
+    stats.connectOne = [&]() {
+        ++stats.started;
+        reactor.connectTCP("127.0.0.1", stats.port, std::make_unique<ChurnClientFactory>(&stats));
+    };
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i != stats.concurrency; ++i) {
+        stats.connectOne();
+    }
+    reactor.run(false);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "connections:            " << stats.closed << " (" << stats.clean << " clean)" << std::endl;
+    std::cout << "elapsed seconds:        " << elapsed.count() << std::endl;
+    std::cout << "connections per second: " << stats.closed / elapsed.count() << std::endl;
+    return 0;
+}
+
+
+struct IpcStats {
+    std::string transport;
+    size_t messageSize{0};
+    int messages{0};
+    int completed{0};
+    std::chrono::steady_clock::time_point start;
+    std::function<void ()> onFinished;
+};
+
+
+class IpcServerProtocol: public Protocol {
+public:
+    void dataReceived(Byte *data, size_t length) override {
+        write(data, length);
+    }
+};
+
+
+class IpcServerFactory: public Factory {
+public:
+    ProtocolPtr buildProtocol(const Address &address) override {
+        return std::make_shared<IpcServerProtocol>();
+    }
+};
+
+
+class IpcClientProtocol: public Protocol {
+public:
+    explicit IpcClientProtocol(IpcStats *stats)
+            : _stats(stats)
+            , _message(stats->messageSize, 'x') {
+
+    }
+
+    void connectionMade() override {
+        _stats->start = std::chrono::steady_clock::now();
+        write(_message);
+    }
+
+    void dataReceived(Byte *data, size_t length) override {
+        _received += length;
+        if (_received < _stats->messageSize) {
+            return;
+        }
+        _received -= _stats->messageSize;
+        if (++_stats->completed < _stats->messages) {
+            write(_message);
+        } else {
+            loseConnection();
+        }
+    }
+protected:
+    IpcStats *_stats;
+    std::string _message;
+    size_t _received{0};
+};
+
+
+class IpcClientFactory: public ClientFactory {
+public:
+    explicit IpcClientFactory(IpcStats *stats)
+            : _stats(stats) {
+
+    }
+
+    ProtocolPtr buildProtocol(const Address &address) override {
+        return std::make_shared<IpcClientProtocol>(_stats);
+    }
+
+    void clientConnectionLost(ConnectorPtr connector, const DisconnectReason &reason) override {
+        _stats->onFinished();
+    }
+
+    void clientConnectionFailed(ConnectorPtr connector, std::exception_ptr reason) override {
+        _stats->onFinished();
+    }
+protected:
+    IpcStats *_stats;
+};
+
+
+int runIpc(Reactor &reactor) {
+    int messages = NET4CXX_Options->get<int>("messages");
+    int busyPoll = NET4CXX_Options->get<int>("busy_poll");
+    std::string path = "/tmp/netbench-" + std::to_string(::getpid()) + ".sock";
+    std::vector<IpcStats> cases;
+    for (size_t messageSize = 64; messageSize <= 65536; messageSize *= 4) {
+        for (const char *transport: {"memory", "unix", "shm"}) {
+            IpcStats stats;
+            stats.transport = transport;
+            stats.messageSize = messageSize;
+            stats.messages = messages;
+            cases.emplace_back(std::move(stats));
+        }
+    }
+    std::cout << "transport  message bytes  round trips/s  MB/s" << std::endl;
+    ListenerPtr listener;
+    size_t current = 0;
+    std::function<void ()> runNext = [&]() {
+        if (listener) {
+            listener->stopListening();
+            listener.reset();
+        }
+        if (current != 0) {
+            IpcStats &stats = cases[current - 1];
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - stats.start;
+            double rate = stats.completed / elapsed.count();
+            std::cout << std::left << std::setw(11) << stats.transport << std::setw(15) << stats.messageSize
+                      << std::setw(15) << (long)rate << rate * stats.messageSize * 2 / 1048576.0 << std::endl;
+        }
+        if (current == cases.size()) {
+            reactor.stop();
+            return;
+        }
+        IpcStats &stats = cases[current++];
+        stats.onFinished = [&]() {
+            reactor.addCallback(runNext);
+        };
+        std::string server = stats.transport + ":" + path;
+        std::string client = stats.transport + ":" + path;
+        if (stats.transport == "shm") {
+            server += ":busyPoll=" + std::to_string(busyPoll);
+            client += ":busyPoll=" + std::to_string(busyPoll);
+        }
+        listener = serverFromString(&reactor, server)->listen(std::make_unique<IpcServerFactory>());
+        clientFromString(&reactor, client)->connect(std::make_unique<IpcClientFactory>(&stats));
+    };
+    reactor.addCallback(runNext);
+    reactor.run(false);
+    ::unlink(path.c_str());
+    return 0;
+}
+
+
+Reactor::Backend parseBackend(const std::string &name) {
+    if (name == "epoll") {
+        return Reactor::Backend::kEpoll;
+    } else if (name == "uring") {
+        return Reactor::Backend::kURing;
+    }
+    NET4CXX_THROW_EXCEPTION(ValueError, "Unknown backend: " + name);
+}
+
+
+double getSystemSeconds() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1000000.0;
+}
+
+
+size_t getRingEnters(Reactor &reactor) {
+#ifdef NET4CXX_HAS_URING
+    if (reactor.getURing()) {
+        return reactor.getURing()->getStats().enters;
+    }
+#endif
+    return 0;
+}
+
+
+/// Echo round trips over TCP and UNIX sockets on each backend with concurrency connections in flight. Kernel time
+/// per round trip stands in for the syscall cost of the epoll path; the uring rows also count io_uring_enter calls.
+/// Run under strace -c -f for exact syscall counts.
+int runBackends() {
+    int messages = NET4CXX_Options->get<int>("messages");
+    int concurrency = NET4CXX_Options->get<int>("concurrency");
+    std::string path = "/tmp/netbench-" + std::to_string(::getpid()) + ".sock";
+    std::string port = std::to_string(20000 + ::getpid() % 10000);
+    std::cout << "backend  transport  message bytes  round trips/s  MB/s        sys us/rt  enters/rt" << std::endl;
+    for (const char *backend: {"epoll", "uring"}) {
+        Reactor reactor(parseBackend(backend));
+        if (reactor.getBackend() != parseBackend(backend)) {
+            std::cout << backend << " backend unavailable" << std::endl;
+            continue;
+        }
+        for (const char *transport: {"tcp", "unix"}) {
+            for (size_t messageSize = 64; messageSize <= 16384; messageSize *= 16) {
+                IpcStats stats;
+                stats.transport = transport;
+                stats.messageSize = messageSize;
+                stats.messages = messages;
+                int finished = 0;
+                stats.onFinished = [&]() {
+                    if (++finished == concurrency) {
+                        reactor.stop();
+                    }
+                };
+                std::string server, client;
+                if (stats.transport == "tcp") {
+                    server = "tcp:" + port + ":interface=127.0.0.1";
+                    client = "tcp:127.0.0.1:" + port;
+                } else {
+                    server = client = "unix:" + path;
+                }
+                auto listener = serverFromString(&reactor, server)->listen(std::make_unique<IpcServerFactory>());
+                for (int i = 0; i != concurrency; ++i) {
+                    clientFromString(&reactor, client)->connect(std::make_unique<IpcClientFactory>(&stats));
+                }
+                size_t enters = getRingEnters(reactor);
+                double systemSeconds = getSystemSeconds();
+                auto start = std::chrono::steady_clock::now();
+                reactor.run(false);
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                systemSeconds = getSystemSeconds() - systemSeconds;
+                enters = getRingEnters(reactor) - enters;
+                listener->stopListening();
+                double rate = stats.completed / elapsed.count();
+                std::cout << std::left << std::setw(9) << backend << std::setw(11) << stats.transport
+                          << std::setw(15) << stats.messageSize << std::setw(15) << (long)rate << std::setw(12)
+                          << rate * stats.messageSize * 2 / 1048576.0 << std::setw(11)
+                          << systemSeconds * 1000000.0 / stats.completed << (double)enters / stats.completed
+                          << std::endl;
+            }
+        }
+    }
+    ::unlink(path.c_str());
+    return 0;
+}
+
+
+struct ThreadsStats {
+    std::string method;
+    int producers{0};
+    int callbacks{0};
+    int completed{0};
+    std::chrono::steady_clock::time_point start;
+};
+
+
+int runThreads(Reactor &reactor) {
+    int callbacks = NET4CXX_Options->get<int>("callbacks");
+    std::vector<ThreadsStats> cases;
+    for (const char *method: {"addCallback", "callFromThread"}) {
+        for (int producers = 1; producers <= 32; producers *= 2) {
+            ThreadsStats stats;
+            stats.method = method;
+            stats.producers = producers;
+            stats.callbacks = callbacks / producers * producers;
+            cases.emplace_back(std::move(stats));
+        }
+    }
+    std::cout << "method          producers  callbacks/s" << std::endl;
+    std::vector<std::thread> threads;
+    size_t current = 0;
+    std::function<void ()> runNext = [&]() {
+        for (auto &thread: threads) {
+            thread.join();
+        }
+        threads.clear();
+        if (current != 0) {
+            ThreadsStats &stats = cases[current - 1];
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - stats.start;
+            std::cout << std::left << std::setw(16) << stats.method << std::setw(11) << stats.producers
+                      << (long)(stats.completed / elapsed.count()) << std::endl;
+        }
+        if (current == cases.size()) {
+            reactor.stop();
+            return;
+        }
+        ThreadsStats &stats = cases[current++];
+        auto callback = [&stats, &reactor, &runNext]() {
+            if (++stats.completed == stats.callbacks) {
+                reactor.addCallback(runNext);
+            }
+        };
+        stats.start = std::chrono::steady_clock::now();
+        for (int i = 0; i != stats.producers; ++i) {
+            threads.emplace_back([&stats, &reactor, callback]() {
+                int count = stats.callbacks / stats.producers;
+                if (stats.method == "addCallback") {
+                    for (int j = 0; j != count; ++j) {
+                        reactor.addCallback(callback);
+                    }
+                } else {
+                    for (int j = 0; j != count; ++j) {
+                        reactor.callFromThread(callback);
+                    }
+                }
+            });
+        }
+    };
+    reactor.addCallback(runNext);
+    reactor.run(false);
+    return 0;
+}
+
+
+struct TlsStats {
+    int connections{0};
+    int attempts{0};
+    int completed{0};
+    std::chrono::steady_clock::time_point start;
+    Histogram latency;
+};
+
+
+class TlsClientProtocol: public Protocol {
+public:
+    explicit TlsClientProtocol(TlsStats *stats)
+            : _stats(stats) {
+
+    }
+
+    void connectionMade() override {
+        write("x");
+    }
+
+    void dataReceived(Byte *data, size_t length) override {
+        std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - _stats->start;
+        _stats->latency.record((uint64)elapsed.count());
+        ++_stats->completed;
+        loseConnection();
+    }
+protected:
+    TlsStats *_stats;
+};
+
+
+class TlsClientFactory: public ClientFactory {
+public:
+    explicit TlsClientFactory(TlsStats *stats)
+            : _stats(stats) {
+
+    }
+
+    ProtocolPtr buildProtocol(const Address &address) override {
+        return std::make_shared<TlsClientProtocol>(_stats);
+    }
+
+    void clientConnectionLost(ConnectorPtr connector, const DisconnectReason &reason) override {
+        if (++_stats->attempts < _stats->connections) {
+            // Reconnect through the same connector, as ReconnectingClientFactory does.
+            _stats->start = std::chrono::steady_clock::now();
+            connector->startConnecting();
+        } else {
+            connector->reactor()->stop();
+        }
+    }
+
+    void clientConnectionFailed(ConnectorPtr connector, std::exception_ptr reason) override {
+        connector->reactor()->stop();
+    }
+protected:
+    TlsStats *_stats;
+};
+
+
+double getCpuSeconds() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000.0 + usage.ru_stime.tv_sec +
+           usage.ru_stime.tv_usec / 1000000.0;
+}
+
+
+/// Sequential TLS connections over loopback, each one connecting, handshaking and echoing a byte, with client
+/// session reuse off and then on. Latency runs from the connect to the echo; CPU covers both ends of the handshake.
+int runTls(Reactor &reactor) {
+    SSLParams serverParams(true);
+    serverParams.setCertFile(NET4CXX_Options->get<std::string>("cert_file"));
+    serverParams.setKeyFile(NET4CXX_Options->get<std::string>("key_file"));
+    auto listener = std::static_pointer_cast<SSLListener>(
+            reactor.listenSSL("0", std::make_unique<IpcServerFactory>(), SSLOption::create(serverParams),
+                              "127.0.0.1"));
+    std::string port = std::to_string(listener->getLocalPort());
+    std::cout << "session reuse  handshakes/s  mean us    p50 us     p99 us     cpu us/handshake  resumed" << std::endl;
+    for (bool reuse: {false, true}) {
+        SSLParams clientParams;
+        if (!reuse) {
+            clientParams.setSessionCacheSize(0);
+        }
+        auto clientOption = SSLOption::create(clientParams);
+        TlsStats stats;
+        stats.connections = NET4CXX_Options->get<int>("connections");
+        double cpuSeconds = getCpuSeconds();
+        auto start = std::chrono::steady_clock::now();
+        stats.start = start;
+        reactor.connectSSL("127.0.0.1", port, std::make_unique<TlsClientFactory>(&stats), clientOption);
+        reactor.run(false);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        cpuSeconds = getCpuSeconds() - cpuSeconds;
+        SSLStats sslStats = clientOption->getStats();
+        std::cout << std::left << std::setw(15) << (reuse ? "on" : "off") << std::setw(14)
+                  << (long)(stats.completed / elapsed.count()) << std::setw(11) << stats.latency.getMean() / 1000.0
+                  << std::setw(11) << stats.latency.getValueAtPercentile(50.0) / 1000.0 << std::setw(11)
+                  << stats.latency.getValueAtPercentile(99.0) / 1000.0 << std::setw(18)
+                  << cpuSeconds * 1000000.0 / stats.completed << sslStats.resumptions << "/" << sslStats.handshakes
+                  << std::endl;
+    }
+    listener->stopListening();
+    return 0;
+}
+
+
+struct TlsFloodStats {
+    Reactor *server{nullptr};
+    std::string port;
+    int established{0};
+    int pingers{0};
+    std::atomic<bool> flooding{false};
+    Histogram latency;
+    int connections{0};
+    int concurrency{0};
+    int started{0};
+    int closed{0};
+    SSLOptionPtr floodOption;
+    std::function<void ()> startFlood;
+};
+
+
+class TlsPingProtocol: public Protocol {
+public:
+    explicit TlsPingProtocol(TlsFloodStats *stats)
+            : _stats(stats)
+            , _message(64, 'x') {
+
+    }
+
+    void connectionMade() override {
+        ping();
+    }
+
+    void dataReceived(Byte *data, size_t length) override {
+        _received += length;
+        if (_received < _message.size()) {
+            return;
+        }
+        _received -= _message.size();
+        if (_established && _stats->flooding) {
+            std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - _start;
+            _stats->latency.record((uint64)elapsed.count());
+        } else if (!_established) {
+            _established = true;
+            if (++_stats->established == _stats->pingers) {
+                _stats->server->callFromThread(_stats->startFlood);
+            }
+        }
+        ping();
+    }
+protected:
+    void ping() {
+        _start = std::chrono::steady_clock::now();
+        write(_message);
+    }
+
+    TlsFloodStats *_stats;
+    std::string _message;
+    size_t _received{0};
+    bool _established{false};
+    std::chrono::steady_clock::time_point _start;
+};
+
+
+class TlsPingFactory: public ClientFactory {
+public:
+    explicit TlsPingFactory(TlsFloodStats *stats)
+            : _stats(stats) {
+
+    }
+
+    ProtocolPtr buildProtocol(const Address &address) override {
+        return std::make_shared<TlsPingProtocol>(_stats);
+    }
+protected:
+    TlsFloodStats *_stats;
+};
+
+
+class TlsFloodFactory: public ClientFactory {
+public:
+    explicit TlsFloodFactory(TlsFloodStats *stats)
+            : _stats(stats) {
+
+    }
+
+    ProtocolPtr buildProtocol(const Address &address) override {
+        return std::make_shared<TlsClientProtocol>(&_tlsStats);
+    }
+
+    void clientConnectionLost(ConnectorPtr connector, const DisconnectReason &reason) override {
+        connectNext(connector->reactor());
+    }
+
+    void clientConnectionFailed(ConnectorPtr connector, std::exception_ptr reason) override {
+        connectNext(connector->reactor());
+    }
+
+    void connectNext(Reactor *reactor) {
+        if (_stats->started < _stats->connections) {
+            ++_stats->started;
+            reactor->connectSSL("127.0.0.1", _stats->port, std::make_unique<TlsFloodFactory>(_stats),
+                                _stats->floodOption);
+        } else if (++_stats->closed == _stats->concurrency) {
+            Reactor *server = _stats->server;
+            server->callFromThread([server]() {
+                server->stop();
+            });
+        }
+    }
+protected:
+    TlsFloodStats *_stats;
+    TlsStats _tlsStats;
+};
+
+
+/// Latency of established TLS connections while a flood of full handshakes hits the same server reactor, with the
+/// handshakes on the reactor thread and then on handshake_threads workers. The pinging and the flooding clients each
+/// have a reactor thread of their own, so that only the server side is measured.
+int runTlsFlood(Reactor &reactor) {
+    std::cout << "handshake threads  handshakes/s  ping p50 us  ping p99 us  ping max us" << std::endl;
+    for (int handshakeThreads: {0, NET4CXX_Options->get<int>("handshake_threads")}) {
+        SSLParams serverParams(true);
+        serverParams.setCertFile(NET4CXX_Options->get<std::string>("cert_file"));
+        serverParams.setKeyFile(NET4CXX_Options->get<std::string>("key_file"));
+        serverParams.setHandshakeThreads((size_t)handshakeThreads);
+        auto listener = std::static_pointer_cast<SSLListener>(
+                reactor.listenSSL("0", std::make_unique<IpcServerFactory>(), SSLOption::create(serverParams),
+                                  "127.0.0.1"));
+        TlsFloodStats stats;
+        stats.server = &reactor;
+        stats.port = std::to_string(listener->getLocalPort());
+        stats.pingers = 8;
+        stats.connections = NET4CXX_Options->get<int>("connections");
+        stats.concurrency = std::min(NET4CXX_Options->get<int>("concurrency"), stats.connections);
+        SSLParams floodParams;
+        floodParams.setSessionCacheSize(0);
+        stats.floodOption = SSLOption::create(floodParams);
+        Reactor pingReactor, floodReactor;
+        std::thread floodThread;
+        std::chrono::steady_clock::time_point floodStart;
+        stats.startFlood = [&]() {
+            stats.flooding = true;
+            floodStart = std::chrono::steady_clock::now();
+            floodThread = std::thread([&]() {
+                TlsFloodFactory starter(&stats);
+                for (int i = 0; i != stats.concurrency; ++i) {
+                    starter.connectNext(&floodReactor);
+                }
+                floodReactor.run(false);
+            });
+        };
+        std::thread pingThread([&]() {
+            auto pingOption = SSLOption::create(SSLParams());
+            for (int i = 0; i != stats.pingers; ++i) {
+                pingReactor.connectSSL("127.0.0.1", stats.port, std::make_unique<TlsPingFactory>(&stats),
+                                       pingOption);
+            }
+            pingReactor.run(false);
+        });
+        reactor.run(false);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - floodStart;
+        stats.flooding = false;
+        for (Reactor *client: {&pingReactor, &floodReactor}) {
+            client->callFromThread([client]() {
+                client->stop();
+            });
+        }
+        pingThread.join();
+        floodThread.join();
+        listener->stopListening();
+        std::cout << std::left << std::setw(19) << handshakeThreads << std::setw(14)
+                  << (long)(stats.connections / elapsed.count()) << std::setw(13)
+                  << stats.latency.getValueAtPercentile(50.0) / 1000.0 << std::setw(13)
+                  << stats.latency.getValueAtPercentile(99.0) / 1000.0 << stats.latency.getMax() / 1000.0
+                  << std::endl;
+    }
+    return 0;
+}
+
+
+
+struct TlsRecordStats {
+    int requests{0};
+    int completed{0};
+    size_t responseSize{0};
+    size_t writeSize{0};
+    double thinkTime{0.0};
+    bool counting{false};
+    uint64 records{0};
+    uint64 wireBytes{0};
+    Histogram firstByte;
+};
+
+
+class TlsRecordServerProtocol: public Protocol {
+public:
+    explicit TlsRecordServerProtocol(TlsRecordStats *stats)
+            : _stats(stats)
+            , _chunk(stats->writeSize, 'x') {
+
+    }
+
+    void connectionMade() override {
+        _stats->counting = true;
+        _transport->setNoDelay(true);
+    }
+
+    void dataReceived(Byte *data, size_t length) override {
+        // Responses go out in small pieces, the way a serializer writes them.
+        for (size_t i = 0; i != length; ++i) {
+            for (size_t sent = 0; sent < _stats->responseSize; sent += _chunk.size()) {
+                write((const Byte *)_chunk.data(), std::min(_chunk.size(), _stats->responseSize - sent));
+            }
+        }
+    }
+protected:
+    TlsRecordStats *_stats;
+    std::string _chunk;
+};
+
+
+class TlsRecordServerFactory: public Factory {
+public:
+    explicit TlsRecordServerFactory(TlsRecordStats *stats)
+            : _stats(stats) {
+
+    }
+
+    ProtocolPtr buildProtocol(const Address &address) override {
+        return std::make_shared<TlsRecordServerProtocol>(_stats);
+    }
+
+    static void cbMessage(int writing, int version, int contentType, const void *buf, size_t length, SSL *ssl,
+                          void *arg) {
+        auto stats = static_cast<TlsRecordStats *>(arg);
+        auto header = static_cast<const Byte *>(buf);
+        if (stats->counting && writing && contentType == SSL3_RT_HEADER && length >= SSL3_RT_HEADER_LENGTH &&
+            header[0] == SSL3_RT_APPLICATION_DATA) {
+            ++stats->records;
+            stats->wireBytes += SSL3_RT_HEADER_LENGTH + ((size_t)header[3] << 8 | header[4]);
+        }
+    }
+protected:
+    TlsRecordStats *_stats;
+};
+
+
+class TlsRecordClientProtocol: public Protocol, public std::enable_shared_from_this<TlsRecordClientProtocol> {
+public:
+    explicit TlsRecordClientProtocol(TlsRecordStats *stats)
+            : _stats(stats) {
+
+    }
+
+    void connectionMade() override {
+        _transport->setNoDelay(true);
+        request();
+    }
+
+    void dataReceived(Byte *data, size_t length) override {
+        if (!_received) {
+            std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - _sent;
+            _stats->firstByte.record((uint64)elapsed.count());
+        }
+        _received += length;
+        if (_received < _stats->responseSize) {
+            return;
+        }
+        _received = 0;
+        if (++_stats->completed == _stats->requests) {
+            loseConnection();
+        } else if (_stats->thinkTime > 0.0) {
+            reactor()->callLater(_stats->thinkTime, [self = shared_from_this()]() {
+                self->request();
+            });
+        } else {
+            request();
+        }
+    }
+protected:
+    void request() {
+        _sent = std::chrono::steady_clock::now();
+        write("x");
+    }
+
+    TlsRecordStats *_stats;
+    size_t _received{0};
+    std::chrono::steady_clock::time_point _sent;
+};
+
+
+class TlsRecordClientFactory: public ClientFactory {
+public:
+    explicit TlsRecordClientFactory(TlsRecordStats *stats)
+            : _stats(stats) {
+
+    }
+
+    ProtocolPtr buildProtocol(const Address &address) override {
+        return std::make_shared<TlsRecordClientProtocol>(_stats);
+    }
+
+    void clientConnectionLost(ConnectorPtr connector, const DisconnectReason &reason) override {
+        connector->reactor()->stop();
+    }
+
+    void clientConnectionFailed(ConnectorPtr connector, std::exception_ptr reason) override {
+        connector->reactor()->stop();
+    }
+protected:
+    TlsRecordStats *_stats;
+};
+
+
+/// Responses of response_size bytes, written write_size bytes at a time, over one TLS connection, with full 16KB
+/// records, records kept at one segment and dynamic record sizing. Bulk runs requests back to back; interactive
+/// waits 20ms between 50 requests, with records starting small again after 10ms idle. Wire bytes count the
+/// application data records the server sends, headers and tags included.
+int runTlsRecord(Reactor &reactor) {
+    struct Mode {
+        const char *name;
+        size_t initialRecordSize;
+        double recordSizeIdle;
+    };
+    std::cout << "pattern      record sizes   records  mean record B  wire overhead %  cpu us/MB  MB/s     "
+                 "first byte p50 us  p99 us" << std::endl;
+    for (bool interactive: {false, true}) {
+        for (const Mode &mode: {Mode{"full", 0, 1.0}, Mode{"segment", 1360, 0.0},
+                                Mode{"dynamic", 1360, interactive ? 0.01 : 1.0}}) {
+            TlsRecordStats stats;
+            stats.requests = interactive ? 50 : NET4CXX_Options->get<int>("requests");
+            stats.responseSize = (size_t)NET4CXX_Options->get<int>("response_size");
+            stats.writeSize = (size_t)NET4CXX_Options->get<int>("write_size");
+            stats.thinkTime = interactive ? 0.02 : 0.0;
+            SSLParams serverParams(true);
+            serverParams.setCertFile(NET4CXX_Options->get<std::string>("cert_file"));
+            serverParams.setKeyFile(NET4CXX_Options->get<std::string>("key_file"));
+            serverParams.setInitialRecordSize(mode.initialRecordSize);
+            serverParams.setRecordSizeIdle(mode.recordSizeIdle);
+            auto serverOption = SSLOption::create(serverParams);
+            SSL_CTX_set_msg_callback(serverOption->context().native_handle(), &TlsRecordServerFactory::cbMessage);
+            SSL_CTX_set_msg_callback_arg(serverOption->context().native_handle(), &stats);
+            auto listener = std::static_pointer_cast<SSLListener>(
+                    reactor.listenSSL("0", std::make_unique<TlsRecordServerFactory>(&stats), serverOption,
+                                      "127.0.0.1"));
+            double cpuSeconds = getCpuSeconds();
+            auto start = std::chrono::steady_clock::now();
+            reactor.connectSSL("127.0.0.1", std::to_string(listener->getLocalPort()),
+                               std::make_unique<TlsRecordClientFactory>(&stats), SSLOption::create(SSLParams()));
+            reactor.run(false);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            cpuSeconds = getCpuSeconds() - cpuSeconds;
+            listener->stopListening();
+            double payload = (double)stats.completed * (double)stats.responseSize;
+            double megabytes = payload / (1024.0 * 1024.0);
+            std::cout << std::left << std::setw(13) << (interactive ? "interactive" : "bulk") << std::setw(15)
+                      << mode.name << std::setw(9) << stats.records << std::setw(15)
+                      << (stats.records ? payload / (double)stats.records : 0.0) << std::setw(17)
+                      << ((double)stats.wireBytes - payload) * 100.0 / payload << std::setw(11)
+                      << cpuSeconds * 1000000.0 / megabytes << std::setw(9) << megabytes / elapsed.count()
+                      << std::setw(19) << stats.firstByte.getValueAtPercentile(50.0) / 1000.0
+                      << stats.firstByte.getValueAtPercentile(99.0) / 1000.0 << std::endl;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    NET4CXX_Options->addArgument<std::string>("scenario",
+                                              "Benchmark scenario: idle, churn, ipc, threads, backends, tls, tlsflood, "
+                                              "tlsrecord", std::string("idle"), {}, "netbench");
+    NET4CXX_Options->addArgument<int>("connections", "Number of connections", 1000, {}, "netbench");
+    NET4CXX_Options->addArgument<int>("concurrency", "Number of connections in flight", 16, {}, "netbench");
+    NET4CXX_Options->addArgument<double>("idle_trim_timeout", "Quiet period before idle buffers are released", 1.0,
+                                         {}, "netbench");
+    NET4CXX_Options->addArgument<int>("messages", "Round trips per message size", 20000, {}, "netbench");
+    NET4CXX_Options->addArgument<int>("busy_poll", "Microseconds shm connections spin before sleeping", 0, {},
+                                      "netbench");
+    NET4CXX_Options->addArgument<int>("callbacks", "Callbacks posted per producer count", 1000000, {}, "netbench");
+    NET4CXX_Options->addArgument<int>("reactor_busy_poll", "Microseconds the reactor spins idle before blocking", 0,
+                                      {}, "netbench");
+    NET4CXX_Options->addArgument<std::string>("backend", "Reactor backend: epoll, uring", std::string("epoll"), {},
+                                              "netbench");
+    NET4CXX_Options->addArgument<std::string>("cert_file", "Certificate of the tls scenario's server",
+                                              std::string("test.crt"), {}, "netbench");
+    NET4CXX_Options->addArgument<std::string>("key_file", "Private key of the tls scenario's server",
+                                              std::string("test.key"), {}, "netbench");
+    NET4CXX_Options->addArgument<int>("handshake_threads", "Handshake threads of the tlsflood scenario's server", 2,
+                                      {}, "netbench");
+    NET4CXX_Options->addArgument<int>("requests", "Requests of the tlsrecord scenario's bulk pattern", 2000, {},
+                                      "netbench");
+    NET4CXX_Options->addArgument<int>("response_size", "Bytes of a tlsrecord response", 65536, {}, "netbench");
+    NET4CXX_Options->addArgument<int>("write_size", "Bytes of each write a tlsrecord response is made of", 256, {},
+                                      "netbench");
+    NET4CXX_PARSE_COMMAND_LINE(argc, argv);
+    Reactor reactor(parseBackend(NET4CXX_Options->get<std::string>("backend")));
+    reactor.setBusyPoll(std::chrono::microseconds(NET4CXX_Options->get<int>("reactor_busy_poll")));
+    const std::string &scenario = NET4CXX_Options->get<std::string>("scenario");
+    int result;
+    if (scenario == "idle") {
+        result = runIdle(reactor);
+    } else if (scenario == "churn") {
+        result = runChurn(reactor);
+    } else if (scenario == "ipc") {
+        result = runIpc(reactor);
+    } else if (scenario == "threads") {
+        result = runThreads(reactor);
+    } else if (scenario == "backends") {
+        result = runBackends();
+    } else if (scenario == "tls") {
+        result = runTls(reactor);
+    } else if (scenario == "tlsflood") {
+        result = runTlsFlood(reactor);
+    } else if (scenario == "tlsrecord") {
+        result = runTlsRecord(reactor);
+    } else {
+        std::cerr << "Unknown scenario: " << scenario << std::endl;
+        return 1;
+    }
+    const Reactor::LoopStats &stats = reactor.getLoopStats();
+    std::cout << "loop iterations: " << stats.iterations << ", idle spins: " << stats.idleSpins
+              << ", blocking waits: " << stats.blockingWaits << std::endl;
+    if (stats.wakeUps) {
+        using Micros = std::chrono::duration<double, std::micro>;
+        std::cout << "wake-ups: " << stats.wakeUps << ", mean latency: "
+                  << Micros(stats.totalWakeLatency).count() / stats.wakeUps << "us, max latency: "
+                  << Micros(stats.maxWakeLatency).count() << "us" << std::endl;
+    }
+    return result;
+}
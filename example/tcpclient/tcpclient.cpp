@@ -21,7 +21,7 @@ public:
         _timeoutId = reactor()->callLater(3.0f, std::bind(&MyProtocol::sendHello, shared_from_this()));
     }
 
-    void connectionLost(std::exception_ptr reason) override {
+    void connectionLost(const DisconnectReason &reason) override {
         NET4CXX_INFO(gAppLog, "Connection lost");
     }
 
@@ -21,7 +21,7 @@ public:
         write(data, length);
     }
 
-    void connectionLost(std::exception_ptr reason) override {
+    void connectionLost(const DisconnectReason &reason) override {
         NET4CXX_INFO(gAppLog, "Connection lost");
     }
 };
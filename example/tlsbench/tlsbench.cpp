@@ -0,0 +1,364 @@
+//
+// Created by yuwenyong on 17-12-6.
+//
+
+#include "net4cxx/net4cxx.h"
+#include <iomanip>
+#include <thread>
+#include <boost/filesystem.hpp>
+#include <openssl/pem.h>
+#include <openssl/x509v3.h>
+#include <sys/resource.h>
+
+
+using namespace net4cxx;
+
+
+EVP_PKEY* generateKey(const std::string &keyType) {
+    bool rsa = keyType == "rsa";
+    EVP_PKEY_CTX *context = EVP_PKEY_CTX_new_id(rsa ? EVP_PKEY_RSA : EVP_PKEY_EC, nullptr);
+    EVP_PKEY *key = nullptr;
+    if (context && EVP_PKEY_keygen_init(context) > 0 &&
+        (rsa ? EVP_PKEY_CTX_set_rsa_keygen_bits(context, 2048) :
+         EVP_PKEY_CTX_set_ec_paramgen_curve_nid(context, NID_X9_62_prime256v1)) > 0) {
+        EVP_PKEY_keygen(context, &key);
+    }
+    EVP_PKEY_CTX_free(context);
+    return key;
+}
+
+
+/// Writes a self-signed certificate for localhost and 127.0.0.1 with a fresh key of keyType, rsa or ec, so that the
+/// benchmark needs neither files nor network.
+void generateCertificate(const std::string &keyType, const std::string &certFile, const std::string &keyFile) {
+    EVP_PKEY *key = generateKey(keyType);
+    X509 *certificate = X509_new();
+    bool success = key && certificate;
+    if (success) {
+        X509_set_version(certificate, 2);
+        ASN1_INTEGER_set(X509_get_serialNumber(certificate), (long)time(nullptr));
+        X509_gmtime_adj(X509_get_notBefore(certificate), -3600);
+        X509_gmtime_adj(X509_get_notAfter(certificate), 86400);
+        X509_set_pubkey(certificate, key);
+        X509_NAME *name = X509_get_subject_name(certificate);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *)"localhost", -1, -1, 0);
+        X509_set_issuer_name(certificate, name);
+        X509V3_CTX extensionContext;
+        X509V3_set_ctx_nodb(&extensionContext);
+        X509V3_set_ctx(&extensionContext, certificate, certificate, nullptr, nullptr, 0);
+        X509_EXTENSION *extension = X509V3_EXT_conf_nid(nullptr, &extensionContext, NID_subject_alt_name,
+                                                        const_cast<char *>("DNS:localhost,IP:127.0.0.1"));
+        success = extension && X509_add_ext(certificate, extension, -1) && X509_sign(certificate, key, EVP_sha256());
+        X509_EXTENSION_free(extension);
+    }
+    if (success) {
+        FILE *file = fopen(certFile.c_str(), "w");
+        success = file && PEM_write_X509(file, certificate);
+        if (file) {
+            fclose(file);
+        }
+        file = fopen(keyFile.c_str(), "w");
+        success = success && file && PEM_write_PrivateKey(file, key, nullptr, nullptr, 0, nullptr, nullptr);
+        if (file) {
+            fclose(file);
+        }
+    }
+    X509_free(certificate);
+    EVP_PKEY_free(key);
+    if (!success) {
+        NET4CXX_THROW_EXCEPTION(IOError, "Generating self-signed certificate failed");
+    }
+}
+
+
+double getCpuSeconds() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000.0 + usage.ru_stime.tv_sec +
+           usage.ru_stime.tv_usec / 1000000.0;
+}
+
+
+class EchoProtocol: public Protocol {
+public:
+    void connectionMade() override {
+        _transport->setNoDelay(true);
+    }
+
+    void dataReceived(Byte *data, size_t length) override {
+        write(data, length);
+    }
+};
+
+
+class EchoFactory: public Factory {
+public:
+    ProtocolPtr buildProtocol(const Address &address) override {
+        return std::make_shared<EchoProtocol>();
+    }
+};
+
+
+struct BenchStats {
+    std::string port;
+    SSLOptionPtr option;
+    int connections{0};
+    int concurrency{0};
+    int started{0};
+    int closed{0};
+    int completed{0};
+    int failed{0};
+    size_t bulkSize{0};
+    size_t window{0};
+    uint64 bytes{0};
+    Histogram latency;
+};
+
+
+/// Sends a byte once connected, which goes out right after the handshake, and hangs up on its echo; with a bulk
+/// size it keeps a window of data in flight instead, until that much has come back.
+class BenchClientProtocol: public Protocol {
+public:
+    BenchClientProtocol(BenchStats *stats, const std::chrono::steady_clock::time_point &start)
+            : _stats(stats)
+            , _start(start) {
+
+    }
+
+    void connectionMade() override {
+        _transport->setNoDelay(true);
+        if (!_stats->bulkSize) {
+            write("x");
+            return;
+        }
+        _chunk.resize(16384, 'x');
+        send(std::min(_stats->window, _stats->bulkSize));
+    }
+
+    void dataReceived(Byte *data, size_t length) override {
+        if (!_stats->bulkSize) {
+            std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - _start;
+            _stats->latency.record((uint64)elapsed.count());
+            ++_stats->completed;
+            loseConnection();
+            return;
+        }
+        _received += length;
+        _stats->bytes += length;
+        if (_received == _stats->bulkSize) {
+            ++_stats->completed;
+            loseConnection();
+            return;
+        }
+        send(std::min(length, _stats->bulkSize - _sent));
+    }
+protected:
+    void send(size_t length) {
+        _sent += length;
+        while (length) {
+            size_t chunkSize = std::min(length, _chunk.size());
+            write((const Byte *)_chunk.data(), chunkSize);
+            length -= chunkSize;
+        }
+    }
+
+    BenchStats *_stats;
+    std::chrono::steady_clock::time_point _start;
+    std::string _chunk;
+    size_t _sent{0};
+    size_t _received{0};
+};
+
+
+class BenchClientFactory: public ClientFactory {
+public:
+    explicit BenchClientFactory(BenchStats *stats)
+            : _stats(stats)
+            , _start(std::chrono::steady_clock::now()) {
+
+    }
+
+    ProtocolPtr buildProtocol(const Address &address) override {
+        return std::make_shared<BenchClientProtocol>(_stats, _start);
+    }
+
+    void clientConnectionLost(ConnectorPtr connector, const DisconnectReason &reason) override {
+        connectNext(connector->reactor(), _stats);
+    }
+
+    void clientConnectionFailed(ConnectorPtr connector, std::exception_ptr reason) override {
+        ++_stats->failed;
+        connectNext(connector->reactor(), _stats);
+    }
+
+    static void connectNext(Reactor *reactor, BenchStats *stats) {
+        if (stats->started < stats->connections) {
+            ++stats->started;
+            reactor->connectSSL("127.0.0.1", stats->port, std::make_unique<BenchClientFactory>(stats), stats->option);
+        } else if (++stats->closed == stats->concurrency) {
+            reactor->stop();
+        }
+    }
+protected:
+    BenchStats *_stats;
+    std::chrono::steady_clock::time_point _start;
+};
+
+
+/// Runs connections through concurrency clients at a time and returns the seconds it took.
+double runClients(Reactor &reactor, BenchStats &stats, int connections, int concurrency) {
+    stats.connections = connections;
+    stats.concurrency = std::min(concurrency, connections);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i != stats.concurrency; ++i) {
+        BenchClientFactory::connectNext(&reactor, &stats);
+    }
+    reactor.run(false);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+SSLOptionPtr createClientOption(const std::string &certFile, const std::string &cipherSuite, int version,
+                                bool resume) {
+    SSLParams clientParams;
+    clientParams.setVerifyMode(SSLVerifyMode::CERT_REQUIRED);
+    clientParams.setVerifyFile(certFile);
+    clientParams.setCheckHost("localhost");
+    if (!resume) {
+        clientParams.setSessionCacheSize(0);
+    }
+    auto option = SSLOption::create(clientParams);
+    SSL_CTX *context = option->context().native_handle();
+    SSL_CTX_set_min_proto_version(context, version);
+    SSL_CTX_set_max_proto_version(context, version);
+    if (!cipherSuite.empty()) {
+        if (version == TLS1_3_VERSION) {
+            SSL_CTX_set_ciphersuites(context, cipherSuite.c_str());
+        } else {
+            SSL_CTX_set_cipher_list(context, cipherSuite.c_str());
+        }
+    }
+    return option;
+}
+
+
+/// Full and resumed handshakes under TLS 1.2 and 1.3, counted from the connect to the echo of the first byte. Each
+/// resumed run starts from one connection that fills the client's session cache.
+void runHandshakes(Reactor &reactor, const std::string &port, const std::string &certFile) {
+    int connections = NET4CXX_Options->get<int>("connections");
+    int concurrency = NET4CXX_Options->get<int>("concurrency");
+    std::cout << "protocol  handshake  handshakes/s  p50 us     p90 us     p99 us     max us     cpu us/handshake  "
+                 "resumed" << std::endl;
+    for (int version: {TLS1_2_VERSION, TLS1_3_VERSION}) {
+        for (bool resume: {false, true}) {
+            auto option = createClientOption(certFile, "", version, resume);
+            if (resume) {
+                BenchStats warmUp;
+                warmUp.port = port;
+                warmUp.option = option;
+                runClients(reactor, warmUp, 1, 1);
+            }
+            SSLStats before = option->getStats();
+            BenchStats stats;
+            stats.port = port;
+            stats.option = option;
+            double cpuSeconds = getCpuSeconds();
+            double elapsed = runClients(reactor, stats, connections, concurrency);
+            cpuSeconds = getCpuSeconds() - cpuSeconds;
+            SSLStats after = option->getStats();
+            std::cout << std::left << std::setw(10) << (version == TLS1_3_VERSION ? "TLSv1.3" : "TLSv1.2")
+                      << std::setw(11) << (resume ? "resumed" : "full") << std::setw(14)
+                      << (long)(stats.completed / elapsed) << std::setw(11)
+                      << stats.latency.getValueAtPercentile(50.0) / 1000.0 << std::setw(11)
+                      << stats.latency.getValueAtPercentile(90.0) / 1000.0 << std::setw(11)
+                      << stats.latency.getValueAtPercentile(99.0) / 1000.0 << std::setw(11)
+                      << stats.latency.getMax() / 1000.0 << std::setw(18)
+                      << cpuSeconds * 1000000.0 / std::max(stats.completed, 1)
+                      << after.resumptions - before.resumptions << "/" << after.handshakes - before.handshakes;
+            if (stats.failed) {
+                std::cout << " (" << stats.failed << " failed)";
+            }
+            std::cout << std::endl;
+        }
+    }
+}
+
+
+/// Echo throughput of each cipher suite, with concurrency connections each sending bulk_size bytes and keeping a
+/// window of 256KB in flight. Names starting with TLS_ are TLS 1.3 suites.
+void runBulk(Reactor &reactor, const std::string &port, const std::string &certFile, const std::string &keyType) {
+    std::vector<std::string> cipherSuites;
+    std::string names = NET4CXX_Options->get<std::string>("cipher_suites");
+    if (names.empty()) {
+        std::string auth = keyType == "rsa" ? "ECDHE-RSA-" : "ECDHE-ECDSA-";
+        cipherSuites = {"TLS_AES_128_GCM_SHA256", "TLS_AES_256_GCM_SHA384", "TLS_CHACHA20_POLY1305_SHA256",
+                        auth + "AES128-GCM-SHA256", auth + "AES256-GCM-SHA384", auth + "CHACHA20-POLY1305"};
+    } else {
+        boost::split(cipherSuites, names, boost::is_any_of(","), boost::token_compress_on);
+    }
+    int concurrency = NET4CXX_Options->get<int>("concurrency");
+    std::cout << "cipher suite                   MB/s        cpu us/MB" << std::endl;
+    for (auto &cipherSuite: cipherSuites) {
+        int version = boost::starts_with(cipherSuite, "TLS_") ? TLS1_3_VERSION : TLS1_2_VERSION;
+        BenchStats stats;
+        stats.port = port;
+        stats.option = createClientOption(certFile, cipherSuite, version, true);
+        stats.bulkSize = (size_t)NET4CXX_Options->get<int>("bulk_size");
+        stats.window = 256 * 1024;
+        double cpuSeconds = getCpuSeconds();
+        double elapsed = runClients(reactor, stats, concurrency, concurrency);
+        cpuSeconds = getCpuSeconds() - cpuSeconds;
+        double megabytes = stats.bytes / 1048576.0;
+        std::cout << std::left << std::setw(31) << cipherSuite;
+        if (stats.completed != concurrency) {
+            std::cout << "failed" << std::endl;
+            continue;
+        }
+        std::cout << std::setw(12) << megabytes / elapsed << cpuSeconds * 1000000.0 / megabytes << std::endl;
+    }
+}
+
+
+int main(int argc, char **argv) {
+    NET4CXX_Options->addArgument<std::string>("key_type", "Key of the generated certificate: ec, rsa",
+                                              std::string("ec"), {}, "tlsbench");
+    NET4CXX_Options->addArgument<int>("connections", "Handshakes per run", 2000, {}, "tlsbench");
+    NET4CXX_Options->addArgument<int>("concurrency", "Number of clients connecting at once", 16, {}, "tlsbench");
+    NET4CXX_Options->addArgument<int>("bulk_size", "Bytes each client echoes per cipher suite", 16 * 1048576, {},
+                                      "tlsbench");
+    NET4CXX_Options->addArgument<std::string>("cipher_suites", "Comma separated cipher suites of the bulk runs, "
+                                              "all AEAD suites of both versions if empty", std::string(), {},
+                                              "tlsbench");
+    NET4CXX_Options->addArgument<int>("handshake_threads", "Handshake threads of the server", 0, {}, "tlsbench");
+    NET4CXX_PARSE_COMMAND_LINE(argc, argv);
+    const std::string &keyType = NET4CXX_Options->get<std::string>("key_type");
+    boost::filesystem::path directory = boost::filesystem::temp_directory_path() /
+                                        boost::filesystem::unique_path("tlsbench-%%%%%%%%");
+    boost::filesystem::create_directories(directory);
+    std::string certFile = (directory / "server.crt").string();
+    std::string keyFile = (directory / "server.key").string();
+    generateCertificate(keyType, certFile, keyFile);
+
+    // The server has a reactor thread of its own, so that with more than one core it does not share one with the
+    // clients.
+    Reactor server, reactor;
+    SSLParams serverParams(true);
+    serverParams.setCertFile(certFile);
+    serverParams.setKeyFile(keyFile);
+    serverParams.setHandshakeThreads((size_t)NET4CXX_Options->get<int>("handshake_threads"));
+    auto listener = std::static_pointer_cast<SSLListener>(
+            server.listenSSL("0", std::make_unique<EchoFactory>(), SSLOption::create(serverParams), "127.0.0.1"));
+    std::string port = std::to_string(listener->getLocalPort());
+    std::thread serverThread([&server]() {
+        server.run(false);
+    });
+    runHandshakes(reactor, port, certFile);
+    runBulk(reactor, port, certFile, keyType);
+    server.callFromThread([&server, listener]() {
+        listener->stopListening();
+        server.stop();
+    });
+    serverThread.join();
+    boost::filesystem::remove_all(directory);
+    return 0;
+}
@@ -141,6 +141,62 @@ void GlobalInit::setupWatcherHook() {
     NET4CXX_Watcher->addDecCallback(NET4CXX_UNIXConnector_COUNT, [](int oldValue, int decrement, int value) {
         NET4CXX_TRACE(gGenLog, "Destroy UNIXConnector, current count:%d", value);
     });
+
+    NET4CXX_Watcher->addIncCallback(NET4CXX_SHMServerConnection_COUNT, [](int oldValue, int increment, int value) {
+        NET4CXX_TRACE(gGenLog, "Create SHMServerConnection, current count:%d", value);
+    });
+    NET4CXX_Watcher->addDecCallback(NET4CXX_SHMServerConnection_COUNT, [](int oldValue, int decrement, int value) {
+        NET4CXX_TRACE(gGenLog, "Destroy SHMServerConnection, current count:%d", value);
+    });
+
+    NET4CXX_Watcher->addIncCallback(NET4CXX_SHMListener_COUNT, [](int oldValue, int increment, int value) {
+        NET4CXX_TRACE(gGenLog, "Create SHMListener, current count:%d", value);
+    });
+    NET4CXX_Watcher->addDecCallback(NET4CXX_SHMListener_COUNT, [](int oldValue, int decrement, int value) {
+        NET4CXX_TRACE(gGenLog, "Destroy SHMListener, current count:%d", value);
+    });
+
+    NET4CXX_Watcher->addIncCallback(NET4CXX_SHMClientConnection_COUNT, [](int oldValue, int increment, int value) {
+        NET4CXX_TRACE(gGenLog, "Create SHMClientConnection, current count:%d", value);
+    });
+    NET4CXX_Watcher->addDecCallback(NET4CXX_SHMClientConnection_COUNT, [](int oldValue, int decrement, int value) {
+        NET4CXX_TRACE(gGenLog, "Destroy SHMClientConnection, current count:%d", value);
+    });
+
+    NET4CXX_Watcher->addIncCallback(NET4CXX_SHMConnector_COUNT, [](int oldValue, int increment, int value) {
+        NET4CXX_TRACE(gGenLog, "Create SHMConnector, current count:%d", value);
+    });
+    NET4CXX_Watcher->addDecCallback(NET4CXX_SHMConnector_COUNT, [](int oldValue, int decrement, int value) {
+        NET4CXX_TRACE(gGenLog, "Destroy SHMConnector, current count:%d", value);
+    });
+
+    NET4CXX_Watcher->addIncCallback(NET4CXX_LoopbackServerConnection_COUNT, [](int oldValue, int increment, int value) {
+        NET4CXX_TRACE(gGenLog, "Create LoopbackServerConnection, current count:%d", value);
+    });
+    NET4CXX_Watcher->addDecCallback(NET4CXX_LoopbackServerConnection_COUNT, [](int oldValue, int decrement, int value) {
+        NET4CXX_TRACE(gGenLog, "Destroy LoopbackServerConnection, current count:%d", value);
+    });
+
+    NET4CXX_Watcher->addIncCallback(NET4CXX_LoopbackListener_COUNT, [](int oldValue, int increment, int value) {
+        NET4CXX_TRACE(gGenLog, "Create LoopbackListener, current count:%d", value);
+    });
+    NET4CXX_Watcher->addDecCallback(NET4CXX_LoopbackListener_COUNT, [](int oldValue, int decrement, int value) {
+        NET4CXX_TRACE(gGenLog, "Destroy LoopbackListener, current count:%d", value);
+    });
+
+    NET4CXX_Watcher->addIncCallback(NET4CXX_LoopbackClientConnection_COUNT, [](int oldValue, int increment, int value) {
+        NET4CXX_TRACE(gGenLog, "Create LoopbackClientConnection, current count:%d", value);
+    });
+    NET4CXX_Watcher->addDecCallback(NET4CXX_LoopbackClientConnection_COUNT, [](int oldValue, int decrement, int value) {
+        NET4CXX_TRACE(gGenLog, "Destroy LoopbackClientConnection, current count:%d", value);
+    });
+
+    NET4CXX_Watcher->addIncCallback(NET4CXX_LoopbackConnector_COUNT, [](int oldValue, int increment, int value) {
+        NET4CXX_TRACE(gGenLog, "Create LoopbackConnector, current count:%d", value);
+    });
+    NET4CXX_Watcher->addDecCallback(NET4CXX_LoopbackConnector_COUNT, [](int oldValue, int decrement, int value) {
+        NET4CXX_TRACE(gGenLog, "Destroy LoopbackConnector, current count:%d", value);
+    });
 #endif
 }
 
@@ -43,4 +43,14 @@ NS_END
 #define NET4CXX_UNIXClientConnection_COUNT   "net4cxx.UNIXClientConnection.count"
 #define NET4CXX_UNIXConnector_COUNT          "net4cxx.UNIXConnector.count"
 
+#define NET4CXX_SHMServerConnection_COUNT   "net4cxx.SHMServerConnection.count"
+#define NET4CXX_SHMListener_COUNT           "net4cxx.SHMListener.count"
+#define NET4CXX_SHMClientConnection_COUNT   "net4cxx.SHMClientConnection.count"
+#define NET4CXX_SHMConnector_COUNT          "net4cxx.SHMConnector.count"
+
+#define NET4CXX_LoopbackServerConnection_COUNT  "net4cxx.LoopbackServerConnection.count"
+#define NET4CXX_LoopbackListener_COUNT          "net4cxx.LoopbackListener.count"
+#define NET4CXX_LoopbackClientConnection_COUNT  "net4cxx.LoopbackClientConnection.count"
+#define NET4CXX_LoopbackConnector_COUNT         "net4cxx.LoopbackConnector.count"
+
 #endif //NET4CXX_COMMON_GLOBAL_LOGGERS_H
@@ -45,6 +45,7 @@ const std::map<int, std::string> gHTTPResponses = {
         {415, "Unsupported Media Type"},
         {416, "Requested Range Not Satisfiable"},
         {417, "Expectation Failed"},
+        {431, "Request Header Fields Too Large"},
 
         {500, "Internal Server Error"},
         {501, "Not Implemented"},
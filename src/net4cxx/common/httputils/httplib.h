@@ -62,6 +62,7 @@ enum class HTTPStatusCode {
     LOCKED = 423,
     FAILED_DEPENDENCY = 424,
     UPGRADE_REQUIRED = 426,
+    REQUEST_HEADER_FIELDS_TOO_LARGE = 431,
 
     // server error
             INTERNAL_SERVER_ERROR = 500,
@@ -0,0 +1,473 @@
+//
+// Created by yuwenyong on 17-12-7.
+//
+
+#include "net4cxx/common/httputils/httpparser.h"
+#include "net4cxx/common/httputils/httpscan.h"
+
+
+NS_BEGIN
+
+namespace {
+
+size_t findLineEnd(const Byte *data, size_t offset, size_t length) {
+    auto found = (const Byte *)memchr(data + offset, '\n', length - offset);
+    return found ? (size_t)(found - data) : length;
+}
+
+char toLower(char c) {
+    return c >= 'A' && c <= 'Z' ? (char)(c | 0x20) : c;
+}
+
+bool equalsIgnoreCase(boost::string_view lhs, boost::string_view rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (size_t i = 0; i != lhs.size(); ++i) {
+        if (toLower(lhs[i]) != toLower(rhs[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+boost::string_view trim(boost::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+}
+
+
+HTTPMessageParser::Status HTTPMessageParser::parse(Byte *data, size_t length) {
+    if (_streaming && isAwaitingBody()) {
+        // The caller dropped the bytes the last call went through.
+        _scanned = _scanned > _offset ? _scanned - _offset : 0;
+        _sectionStart = _sectionStart > _offset ? _sectionStart - _offset : 0;
+        _offset = 0;
+        _body.clear();
+    }
+    for (;;) {
+        switch (_state) {
+            case kStartLine:
+            case kHeader:
+            case kChunkSize:
+            case kChunkEnd:
+            case kTrailer: {
+                size_t lineEnd = findLineEnd(data, std::max(_offset, _scanned), length);
+                if (lineEnd == length) {
+                    _scanned = length;
+                    return checkPartialLine(length);
+                }
+                size_t lineStart = _offset;
+                size_t lineLength = lineEnd - lineStart;
+                if (lineLength && data[lineEnd - 1] == '\r') {
+                    --lineLength;
+                }
+                _offset = _scanned = lineEnd + 1;
+                bool success = true;
+                if (_state == kStartLine) {
+                    if (!lineLength) {
+                        // Empty lines ahead of a request are skipped, up to the length of a request line.
+                        if (_offset > _limits.maxRequestLine) {
+                            return fail(400);
+                        }
+                        _sectionStart = _offset;
+                        continue;
+                    }
+                    success = parseStartLine(data, lineStart, lineLength);
+                    _state = kHeader;
+                } else if (_state == kHeader) {
+                    success = lineLength ? parseHeader(data, lineStart, lineLength) : finishHeaders();
+                    if (success && !lineLength && _streaming) {
+                        resolveHeaders(data);
+                        if (_state != kDone) {
+                            return kHeaders;
+                        }
+                    }
+                } else if (_state == kChunkSize) {
+                    if (isFramingOverLimit(_offset)) {
+                        return fail(413);
+                    }
+                    success = parseChunkSize(data, lineStart, lineLength);
+                } else if (_state == kChunkEnd) {
+                    if (lineLength) {
+                        return fail(400);
+                    }
+                    _state = kChunkSize;
+                } else if (!lineLength) {
+                    _state = kDone;
+                } else if (_offset - _sectionStart > _limits.maxHeaderBytes) {
+                    return fail(431);
+                } else if (isFramingOverLimit(_offset)) {
+                    return fail(413);
+                }
+                if (!success) {
+                    _state = kFailed;
+                    return kError;
+                }
+                if (_state == kDone) {
+                    return complete(data);
+                }
+                break;
+            }
+            case kBody: {
+                if (_streaming) {
+                    return parseStreamingBody(data, length);
+                }
+                if (length - _offset < _contentLength) {
+                    return kIncomplete;
+                }
+                _bodyOffset = _offset;
+                _bodyEnd = _offset + (size_t)_contentLength;
+                _offset = _bodyEnd;
+                return complete(data);
+            }
+            case kChunkData: {
+                if (_streaming) {
+                    return parseStreamingBody(data, length);
+                }
+                size_t end = _offset + (size_t)_chunkSize;
+                if (length <= end || (data[end] == '\r' && length <= end + 1)) {
+                    return kIncomplete;
+                }
+                size_t lineBreak = data[end] == '\r' ? 2 : 1;
+                if (data[end + lineBreak - 1] != '\n') {
+                    return fail(400);
+                }
+                memmove(data + _bodyEnd, data + _offset, (size_t)_chunkSize);
+                _bodyEnd += (size_t)_chunkSize;
+                _offset = _scanned = end + lineBreak;
+                _state = kChunkSize;
+                break;
+            }
+            case kBodyUntilClose: {
+                if (_streaming) {
+                    return parseStreamingBody(data, length);
+                }
+                if (length - _bodyOffset > _limits.maxBodySize) {
+                    return fail(413);
+                }
+                _offset = _scanned = length;
+                return kIncomplete;
+            }
+            case kDone:
+                return kComplete;
+            default:
+                return kError;
+        }
+    }
+}
+
+HTTPMessageParser::Status HTTPMessageParser::finish(Byte *data, size_t length) {
+    if (_state == kDone) {
+        return kComplete;
+    }
+    if (_state != kBodyUntilClose) {
+        return fail(400);
+    }
+    if (_streaming) {
+        _state = kDone;
+        _body.clear();
+        return kComplete;
+    }
+    _bodyEnd = _offset = length;
+    return complete(data);
+}
+
+void HTTPMessageParser::reset() {
+    resetStartLine();
+    _state = kStartLine;
+    _errorCode = 0;
+    _offset = 0;
+    _scanned = 0;
+    _sectionStart = 0;
+    _versionMinor = 1;
+    _headerRanges.clear();
+    _headers.clear();
+    _hasContentLength = false;
+    _contentLength = 0;
+    _hasTransferEncoding = false;
+    _chunked = false;
+    _connectionClose = false;
+    _connectionKeepAlive = false;
+    _expectContinue = false;
+    _bodyOffset = 0;
+    _bodyEnd = 0;
+    _chunkSize = 0;
+    _bodyRemaining = 0;
+    _body.clear();
+}
+
+const HTTPHeader* HTTPMessageParser::findHeader(boost::string_view name) const {
+    for (auto &header: _headers) {
+        if (equalsIgnoreCase(header.name, name)) {
+            return &header;
+        }
+    }
+    return nullptr;
+}
+
+bool HTTPMessageParser::parseVersion(const Byte *data, size_t offset, size_t length) {
+    const Byte *version = data + offset;
+    if (length != 8 || memcmp(version, "HTTP/", 5) != 0 || !isdigit(version[5]) || version[6] != '.' ||
+        !isdigit(version[7])) {
+        _errorCode = 400;
+        return false;
+    }
+    if (version[5] != '1') {
+        _errorCode = 505;
+        return false;
+    }
+    _versionMinor = version[7] - '0';
+    return true;
+}
+
+bool HTTPMessageParser::parseHeader(const Byte *data, size_t offset, size_t length) {
+    size_t end = offset + length;
+    // A line starting with whitespace, an obsolete continuation, has no name and fails here.
+    size_t nameEnd = HTTPScanner::scanToken(data, offset, end);
+    if (nameEnd == offset || nameEnd == end || data[nameEnd] != ':') {
+        _errorCode = 400;
+        return false;
+    }
+    if (_headerRanges.size() == _limits.maxHeaders || _offset - _sectionStart > _limits.maxHeaderBytes) {
+        _errorCode = 431;
+        return false;
+    }
+    size_t valueStart = nameEnd + 1;
+    while (valueStart != end && (data[valueStart] == ' ' || data[valueStart] == '\t')) {
+        ++valueStart;
+    }
+    size_t valueEnd = HTTPScanner::scanValue(data, valueStart, end);
+    if (valueEnd != end) {
+        _errorCode = 400;
+        return false;
+    }
+    while (valueEnd != valueStart && (data[valueEnd - 1] == ' ' || data[valueEnd - 1] == '\t')) {
+        --valueEnd;
+    }
+    HeaderRange range{{offset, nameEnd - offset}, {valueStart, valueEnd - valueStart}};
+    _headerRanges.push_back(range);
+    boost::string_view name = getView(data, range.name);
+    boost::string_view value = getView(data, range.value);
+    if (equalsIgnoreCase(name, "content-length")) {
+        if (value.empty() || value.size() > 19) {
+            _errorCode = 400;
+            return false;
+        }
+        uint64 contentLength = 0;
+        for (char c: value) {
+            if (!isdigit((unsigned char)c)) {
+                _errorCode = 400;
+                return false;
+            }
+            contentLength = contentLength * 10 + (uint64)(c - '0');
+        }
+        if (_hasContentLength && contentLength != _contentLength) {
+            _errorCode = 400;
+            return false;
+        }
+        _hasContentLength = true;
+        _contentLength = contentLength;
+    } else if (equalsIgnoreCase(name, "transfer-encoding")) {
+        // Only the last coding counts, and it has to be chunked for the body to have an end.
+        size_t comma = value.rfind(',');
+        _hasTransferEncoding = true;
+        _chunked = equalsIgnoreCase(trim(comma == boost::string_view::npos ? value : value.substr(comma + 1)),
+                                    "chunked");
+    } else if (equalsIgnoreCase(name, "connection")) {
+        while (!value.empty()) {
+            size_t comma = value.find(',');
+            boost::string_view option = trim(value.substr(0, comma));
+            if (equalsIgnoreCase(option, "close")) {
+                _connectionClose = true;
+            } else if (equalsIgnoreCase(option, "keep-alive")) {
+                _connectionKeepAlive = true;
+            }
+            value = comma == boost::string_view::npos ? boost::string_view() : value.substr(comma + 1);
+        }
+    } else if (equalsIgnoreCase(name, "expect")) {
+        _expectContinue = equalsIgnoreCase(value, "100-continue");
+    }
+    return true;
+}
+
+bool HTTPMessageParser::parseChunkSize(const Byte *data, size_t offset, size_t length) {
+    size_t end = offset + length;
+    size_t position = offset;
+    uint64 chunkSize = 0;
+    for (; position != end && isxdigit(data[position]); ++position) {
+        if (position - offset == 15) {
+            _errorCode = 400;
+            return false;
+        }
+        Byte c = data[position];
+        chunkSize = chunkSize * 16 + (uint64)(isdigit(c) ? c - '0' : (c | 0x20) - 'a' + 10);
+    }
+    // Chunk extensions are ignored.
+    if (position == offset || (position != end && data[position] != ';' && data[position] != ' ' &&
+                               data[position] != '\t')) {
+        _errorCode = 400;
+        return false;
+    }
+    if (!chunkSize) {
+        _state = kTrailer;
+        _sectionStart = _offset;
+        return true;
+    }
+    if (!_streaming && chunkSize > _limits.maxBodySize - (_bodyEnd - _bodyOffset)) {
+        _errorCode = 413;
+        return false;
+    }
+    _chunkSize = chunkSize;
+    _state = kChunkData;
+    return true;
+}
+
+bool HTTPMessageParser::finishHeaders() {
+    if (_offset - _sectionStart > _limits.maxHeaderBytes) {
+        _errorCode = 431;
+        return false;
+    }
+    _bodyOffset = _bodyEnd = _offset;
+    if (!hasBody()) {
+        _state = kDone;
+    } else if (_hasTransferEncoding) {
+        if (!_chunked && !hasBodyUntilClose()) {
+            _errorCode = 501;
+            return false;
+        }
+        if (_hasContentLength) {
+            // Both framings at once is how requests get smuggled past proxies.
+            _errorCode = 400;
+            return false;
+        }
+        _state = _chunked ? kChunkSize : kBodyUntilClose;
+    } else if (_contentLength) {
+        if (!_streaming && _contentLength > _limits.maxBodySize) {
+            _errorCode = 413;
+            return false;
+        }
+        _bodyRemaining = _contentLength;
+        _state = kBody;
+    } else if (!_hasContentLength && hasBodyUntilClose()) {
+        _state = kBodyUntilClose;
+    } else {
+        _state = kDone;
+    }
+    return true;
+}
+
+HTTPMessageParser::Status HTTPMessageParser::checkPartialLine(size_t length) {
+    size_t pending = length - _offset;
+    if (_state == kStartLine && pending > _limits.maxRequestLine) {
+        return fail(414);
+    }
+    if (_state == kChunkSize && pending > _limits.maxRequestLine) {
+        return fail(400);
+    }
+    if ((_state == kHeader || _state == kTrailer) && length - _sectionStart > _limits.maxHeaderBytes) {
+        return fail(431);
+    }
+    if ((_state == kChunkSize || _state == kTrailer) && isFramingOverLimit(length)) {
+        return fail(413);
+    }
+    return kIncomplete;
+}
+
+HTTPMessageParser::Status HTTPMessageParser::parseStreamingBody(const Byte *data, size_t length) {
+    size_t available = length - _offset;
+    if (_state == kBodyUntilClose) {
+        _body = boost::string_view((const char *)data + _offset, available);
+        _offset = _scanned = length;
+        return kIncomplete;
+    }
+    uint64 &remaining = _state == kBody ? _bodyRemaining : _chunkSize;
+    auto size = (size_t)std::min<uint64>(available, remaining);
+    _body = boost::string_view((const char *)data + _offset, size);
+    _offset = _scanned = _offset + size;
+    remaining -= size;
+    if (remaining) {
+        return kIncomplete;
+    }
+    if (_state == kBody) {
+        _state = kDone;
+        return kComplete;
+    }
+    _state = kChunkEnd;
+    return kIncomplete;
+}
+
+void HTTPMessageParser::resolveHeaders(const Byte *data) {
+    completeStartLine(data);
+    _headers.clear();
+    for (auto &range: _headerRanges) {
+        _headers.push_back({getView(data, range.name), getView(data, range.value)});
+    }
+}
+
+HTTPMessageParser::Status HTTPMessageParser::complete(const Byte *data) {
+    _state = kDone;
+    if (!_streaming) {
+        resolveHeaders(data);
+        _body = boost::string_view((const char *)data + _bodyOffset, _bodyEnd - _bodyOffset);
+    }
+    return kComplete;
+}
+
+
+bool HTTPRequestParser::parseStartLine(const Byte *data, size_t offset, size_t length) {
+    if (length > _limits.maxRequestLine) {
+        _errorCode = 414;
+        return false;
+    }
+    size_t end = offset + length;
+    size_t methodEnd = HTTPScanner::scanToken(data, offset, end);
+    if (methodEnd == offset || methodEnd == end || data[methodEnd] != ' ') {
+        _errorCode = 400;
+        return false;
+    }
+    size_t targetEnd = HTTPScanner::scanTarget(data, methodEnd + 1, end);
+    if (targetEnd == methodEnd + 1 || targetEnd == end || data[targetEnd] != ' ') {
+        _errorCode = 400;
+        return false;
+    }
+    _methodRange = {offset, methodEnd - offset};
+    _targetRange = {methodEnd + 1, targetEnd - methodEnd - 1};
+    return parseVersion(data, targetEnd + 1, end - targetEnd - 1);
+}
+
+void HTTPRequestParser::completeStartLine(const Byte *data) {
+    _method = getView(data, _methodRange);
+    _target = getView(data, _targetRange);
+}
+
+
+bool HTTPResponseParser::parseStartLine(const Byte *data, size_t offset, size_t length) {
+    if (length > _limits.maxRequestLine) {
+        _errorCode = 414;
+        return false;
+    }
+    const Byte *line = data + offset;
+    // The reason phrase may be missing, and the space before it with it.
+    if (length < 12 || line[8] != ' ' || !isdigit(line[9]) || !isdigit(line[10]) || !isdigit(line[11]) ||
+        (length > 12 && line[12] != ' ')) {
+        _errorCode = 400;
+        return false;
+    }
+    _statusCode = (line[9] - '0') * 100 + (line[10] - '0') * 10 + (line[11] - '0');
+    _reasonRange = length > 12 ? Range{offset + 13, length - 13} : Range{offset + 12, 0};
+    return parseVersion(data, offset, 8);
+}
+
+void HTTPResponseParser::completeStartLine(const Byte *data) {
+    _reason = getView(data, _reasonRange);
+}
+
+NS_END
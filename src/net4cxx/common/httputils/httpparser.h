@@ -0,0 +1,296 @@
+//
+// Created by yuwenyong on 17-12-7.
+//
+
+#ifndef NET4CXX_COMMON_HTTPUTILS_HTTPPARSER_H
+#define NET4CXX_COMMON_HTTPUTILS_HTTPPARSER_H
+
+#include "net4cxx/common/common.h"
+#include <boost/utility/string_view.hpp>
+
+NS_BEGIN
+
+
+struct HTTPHeader {
+    boost::string_view name;
+    boost::string_view value;
+};
+
+
+/// Exceeding a limit fails the message with the status code noted on it.
+struct HTTPParserLimits {
+    /// 414, or 400 for a chunk size line and for the empty lines ahead of a request.
+    size_t maxRequestLine{8192};
+    /// 431, or 413 for the chunk framing and trailers of a buffered body.
+    size_t maxHeaderBytes{65536};
+    /// 431.
+    size_t maxHeaders{100};
+    /// 413.
+    size_t maxBodySize{1024 * 1024};
+
+    /// Most bytes a buffered message within the limits can take up.
+    size_t getMaxMessageBytes() const {
+        return maxRequestLine + maxHeaderBytes * 2 + maxBodySize;
+    }
+};
+
+
+/// Incremental HTTP/1.x parser; parse takes the whole message so far, and its views last until the bytes change.
+class NET4CXX_COMMON_API HTTPMessageParser {
+public:
+    enum Status {
+        kIncomplete,
+        kHeaders,
+        kComplete,
+        kError,
+    };
+
+    explicit HTTPMessageParser(const HTTPParserLimits &limits, bool streaming=false)
+            : _limits(limits)
+            , _streaming(streaming) {
+
+    }
+
+    virtual ~HTTPMessageParser() = default;
+
+    Status parse(Byte *data, size_t length);
+
+    /// Ends a message whose body runs until the connection closes.
+    Status finish(Byte *data, size_t length);
+
+    void reset();
+
+    /// Bytes parse went through; a streaming caller drops them before the next call.
+    size_t getConsumed() const {
+        return _offset;
+    }
+
+    /// Status code to answer a malformed message with.
+    int getErrorCode() const {
+        return _errorCode;
+    }
+
+    int getVersionMinor() const {
+        return _versionMinor;
+    }
+
+    const std::vector<HTTPHeader>& getHeaders() const {
+        return _headers;
+    }
+
+    /// First header named name, compared case-insensitively; nullptr if there is none.
+    const HTTPHeader* findHeader(boost::string_view name) const;
+
+    const boost::string_view& getBody() const {
+        return _body;
+    }
+
+    bool isChunked() const {
+        return _chunked;
+    }
+
+    bool isKeepAlive() const {
+        return _versionMinor >= 1 ? !_connectionClose : _connectionKeepAlive;
+    }
+
+    bool isAwaitingBody() const {
+        return _state == kBody || _state == kChunkSize || _state == kChunkData || _state == kChunkEnd ||
+               _state == kTrailer || _state == kBodyUntilClose;
+    }
+
+    bool isExpectingContinue() const {
+        return _expectContinue;
+    }
+
+    const HTTPParserLimits& getLimits() const {
+        return _limits;
+    }
+
+    bool isStreaming() const {
+        return _streaming;
+    }
+protected:
+    enum State {
+        kStartLine,
+        kHeader,
+        kBody,
+        kChunkSize,
+        kChunkData,
+        kChunkEnd,
+        kTrailer,
+        kBodyUntilClose,
+        kDone,
+        kFailed,
+    };
+
+    struct Range {
+        size_t offset;
+        size_t length;
+    };
+
+    struct HeaderRange {
+        Range name;
+        Range value;
+    };
+
+    /// Parses the start line of length bytes at offset, line break excluded; sets the error code on failure.
+    virtual bool parseStartLine(const Byte *data, size_t offset, size_t length) = 0;
+
+    virtual void completeStartLine(const Byte *data) = 0;
+
+    virtual void resetStartLine() = 0;
+
+    virtual bool hasBody() const {
+        return true;
+    }
+
+    /// Whether a message without a length has a body running until the connection closes.
+    virtual bool hasBodyUntilClose() const {
+        return false;
+    }
+
+    bool parseVersion(const Byte *data, size_t offset, size_t length);
+
+    bool parseHeader(const Byte *data, size_t offset, size_t length);
+
+    bool parseChunkSize(const Byte *data, size_t offset, size_t length);
+
+    bool finishHeaders();
+
+    Status checkPartialLine(size_t length);
+
+    bool isFramingOverLimit(size_t end) const {
+        return !_streaming && end - _bodyEnd > _limits.maxHeaderBytes;
+    }
+
+    Status parseStreamingBody(const Byte *data, size_t length);
+
+    void resolveHeaders(const Byte *data);
+
+    Status complete(const Byte *data);
+
+    Status fail(int errorCode) {
+        _state = kFailed;
+        _errorCode = errorCode;
+        return kError;
+    }
+
+    static boost::string_view getView(const Byte *data, const Range &range) {
+        return {(const char *)data + range.offset, range.length};
+    }
+
+    HTTPParserLimits _limits;
+    bool _streaming;
+    State _state{kStartLine};
+    int _errorCode{0};
+    size_t _offset{0};
+    size_t _scanned{0};
+    /// Where the headers, or the trailers, begin.
+    size_t _sectionStart{0};
+    int _versionMinor{1};
+    std::vector<HeaderRange> _headerRanges;
+    std::vector<HTTPHeader> _headers;
+    bool _hasContentLength{false};
+    uint64 _contentLength{0};
+    bool _hasTransferEncoding{false};
+    bool _chunked{false};
+    bool _connectionClose{false};
+    bool _connectionKeepAlive{false};
+    bool _expectContinue{false};
+    size_t _bodyOffset{0};
+    size_t _bodyEnd{0};
+    uint64 _chunkSize{0};
+    /// Bytes of a streamed body with a length yet to come.
+    uint64 _bodyRemaining{0};
+    boost::string_view _body;
+};
+
+
+class NET4CXX_COMMON_API HTTPRequestParser: public HTTPMessageParser {
+public:
+    explicit HTTPRequestParser(const HTTPParserLimits &limits=HTTPParserLimits())
+            : HTTPMessageParser(limits) {
+
+    }
+
+    const boost::string_view& getMethod() const {
+        return _method;
+    }
+
+    /// The request target as sent, path and query.
+    const boost::string_view& getTarget() const {
+        return _target;
+    }
+
+    bool isHead() const {
+        return _method == "HEAD";
+    }
+protected:
+    bool parseStartLine(const Byte *data, size_t offset, size_t length) override;
+
+    void completeStartLine(const Byte *data) override;
+
+    void resetStartLine() override {
+        _method.clear();
+        _target.clear();
+    }
+
+    Range _methodRange;
+    Range _targetRange;
+    boost::string_view _method;
+    boost::string_view _target;
+};
+
+
+/// Parser of responses; setHeadRequest has to be called ahead of one answering a HEAD request.
+class NET4CXX_COMMON_API HTTPResponseParser: public HTTPMessageParser {
+public:
+    explicit HTTPResponseParser(const HTTPParserLimits &limits=HTTPParserLimits(), bool streaming=false)
+            : HTTPMessageParser(limits, streaming) {
+
+    }
+
+    int getStatusCode() const {
+        return _statusCode;
+    }
+
+    const boost::string_view& getReason() const {
+        return _reason;
+    }
+
+    bool isInterim() const {
+        return _statusCode >= 100 && _statusCode < 200 && _statusCode != 101;
+    }
+
+    /// Makes the next response bodiless whatever its headers say; reset clears it.
+    void setHeadRequest(bool headRequest) {
+        _headRequest = headRequest;
+    }
+protected:
+    bool parseStartLine(const Byte *data, size_t offset, size_t length) override;
+
+    void completeStartLine(const Byte *data) override;
+
+    void resetStartLine() override {
+        _statusCode = 0;
+        _reason.clear();
+        _headRequest = false;
+    }
+
+    bool hasBody() const override {
+        return !_headRequest && _statusCode >= 200 && _statusCode != 204 && _statusCode != 304;
+    }
+
+    bool hasBodyUntilClose() const override {
+        return true;
+    }
+
+    int _statusCode{0};
+    Range _reasonRange;
+    boost::string_view _reason;
+    bool _headRequest{false};
+};
+
+NS_END
+
+#endif //NET4CXX_COMMON_HTTPUTILS_HTTPPARSER_H
@@ -0,0 +1,242 @@
+//
+// Created by yuwenyong on 17-12-8.
+//
+
+#include "net4cxx/common/httputils/httpscan.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && COMPILER == COMPILER_GNU
+#define NET4CXX_HAS_SIMD_SCAN
+#include <immintrin.h>
+#endif
+
+
+NS_BEGIN
+
+namespace {
+
+enum CharClassIndex {
+    kToken,
+    kTarget,
+    kValue,
+};
+
+
+/// A set of bytes as a table, as the byte ranges outside it for PCMPESTRI when there are at most eight, and as two
+/// nibble tables whose entries for the low and the high nibble of a byte share a bit exactly when it is in the set.
+struct CharClass {
+    explicit CharClass(CharClassIndex index) {
+        const char *tokenSymbols = "!#$%&'*+-.^_`|~";
+        for (int c = 0; c != 256; ++c) {
+            if (index == kToken) {
+                allowed[c] = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                             (c != 0 && strchr(tokenSymbols, c) != nullptr);
+            } else if (index == kTarget) {
+                allowed[c] = c > 0x20 && c != 0x7f;
+            } else {
+                allowed[c] = c == '\t' || (c >= 0x20 && c != 0x7f);
+            }
+        }
+        for (int c = 0; c != 256; ++c) {
+            if (!allowed[c] && (c == 0 || allowed[c - 1])) {
+                if (rangesLength == sizeof(ranges)) {
+                    rangesLength = 0;
+                    break;
+                }
+                ranges[rangesLength] = ranges[rangesLength + 1] = (Byte)c;
+                rangesLength += 2;
+            } else if (!allowed[c]) {
+                ranges[rangesLength - 1] = (Byte)c;
+            }
+        }
+        // Each distinct row of the 16x16 byte table, one per high nibble, gets a bit; there are few enough rows in
+        // every class here to fit in a byte.
+        uint16 patterns[8];
+        int patternCount = 0;
+        for (int high = 0; high != 16; ++high) {
+            uint16 row = 0;
+            for (int low = 0; low != 16; ++low) {
+                if (allowed[high << 4 | low]) {
+                    row |= (uint16)(1 << low);
+                }
+            }
+            if (!row) {
+                continue;
+            }
+            int pattern = 0;
+            while (pattern != patternCount && patterns[pattern] != row) {
+                ++pattern;
+            }
+            if (pattern == patternCount) {
+                BOOST_ASSERT(patternCount != 8);
+                patterns[patternCount++] = row;
+            }
+            highNibbles[high] = (Byte)(1 << pattern);
+            for (int low = 0; low != 16; ++low) {
+                if (row & (1 << low)) {
+                    lowNibbles[low] |= (Byte)(1 << pattern);
+                }
+            }
+        }
+    }
+
+    bool allowed[256];
+    alignas(16) Byte ranges[16]{};
+    int rangesLength{0};
+    alignas(16) Byte lowNibbles[16]{};
+    alignas(16) Byte highNibbles[16]{};
+};
+
+const CharClass charClasses[] = {CharClass(kToken), CharClass(kTarget), CharClass(kValue)};
+
+
+inline size_t scanScalar(const CharClass &charClass, const Byte *data, size_t offset, size_t end) {
+    while (offset != end && charClass.allowed[data[offset]]) {
+        ++offset;
+    }
+    return offset;
+}
+
+template <CharClassIndex Index>
+size_t scanScalar(const Byte *data, size_t offset, size_t end) {
+    return scanScalar(charClasses[Index], data, offset, end);
+}
+
+
+#ifdef NET4CXX_HAS_SIMD_SCAN
+
+/// Mask of the bytes of block outside the class, one bit per byte.
+__attribute__((target("sse4.2")))
+inline int classifyNibbles(const CharClass &charClass, __m128i block) {
+    const __m128i lowNibbles = _mm_load_si128((const __m128i *)charClass.lowNibbles);
+    const __m128i highNibbles = _mm_load_si128((const __m128i *)charClass.highNibbles);
+    const __m128i nibbleMask = _mm_set1_epi8(0x0f);
+    __m128i low = _mm_shuffle_epi8(lowNibbles, _mm_and_si128(block, nibbleMask));
+    __m128i high = _mm_shuffle_epi8(highNibbles, _mm_and_si128(_mm_srli_epi16(block, 4), nibbleMask));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(low, high), _mm_setzero_si128()));
+}
+
+template <CharClassIndex Index>
+__attribute__((target("sse4.2")))
+size_t scanSSE42(const Byte *data, size_t offset, size_t end) {
+    const CharClass &charClass = charClasses[Index];
+    if (charClass.rangesLength) {
+        const __m128i ranges = _mm_load_si128((const __m128i *)charClass.ranges);
+        for (; end - offset >= 16; offset += 16) {
+            __m128i block = _mm_loadu_si128((const __m128i *)(data + offset));
+            int index = _mm_cmpestri(ranges, charClass.rangesLength, block, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES);
+            if (index != 16) {
+                return offset + (size_t)index;
+            }
+        }
+    } else {
+        for (; end - offset >= 16; offset += 16) {
+            int rejected = classifyNibbles(charClass, _mm_loadu_si128((const __m128i *)(data + offset)));
+            if (rejected) {
+                return offset + (size_t)__builtin_ctz((unsigned)rejected);
+            }
+        }
+    }
+    return scanScalar(charClass, data, offset, end);
+}
+
+template <CharClassIndex Index>
+__attribute__((target("avx2")))
+size_t scanAVX2(const Byte *data, size_t offset, size_t end) {
+    const CharClass &charClass = charClasses[Index];
+    const __m256i lowNibbles = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)charClass.lowNibbles));
+    const __m256i highNibbles = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)charClass.highNibbles));
+    const __m256i nibbleMask = _mm256_set1_epi8(0x0f);
+    for (; end - offset >= 32; offset += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(data + offset));
+        __m256i low = _mm256_shuffle_epi8(lowNibbles, _mm256_and_si256(block, nibbleMask));
+        __m256i high = _mm256_shuffle_epi8(highNibbles, _mm256_and_si256(_mm256_srli_epi16(block, 4), nibbleMask));
+        auto rejected = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(low, high),
+                                                                        _mm256_setzero_si256()));
+        if (rejected) {
+            return offset + (size_t)__builtin_ctz(rejected);
+        }
+    }
+    if (end - offset >= 16) {
+        int rejected = classifyNibbles(charClass, _mm_loadu_si128((const __m128i *)(data + offset)));
+        if (rejected) {
+            return offset + (size_t)__builtin_ctz((unsigned)rejected);
+        }
+        offset += 16;
+    }
+    return scanScalar(charClass, data, offset, end);
+}
+
+#endif
+
+}
+
+
+HTTPScanner::Kernel HTTPScanner::_kernel = HTTPScanner::getBestKernel();
+
+const HTTPScanner::Functions *HTTPScanner::_functions = HTTPScanner::getFunctions(HTTPScanner::_kernel);
+
+
+bool HTTPScanner::isSupported(Kernel kernel) {
+    switch (kernel) {
+        case kScalar:
+            return true;
+#ifdef NET4CXX_HAS_SIMD_SCAN
+        case kSSE42:
+            return __builtin_cpu_supports("sse4.2") != 0;
+        case kAVX2:
+            return __builtin_cpu_supports("avx2") != 0;
+#endif
+        default:
+            return false;
+    }
+}
+
+bool HTTPScanner::setKernel(Kernel kernel) {
+    if (!isSupported(kernel)) {
+        return false;
+    }
+    _kernel = kernel;
+    _functions = getFunctions(kernel);
+    return true;
+}
+
+const char* HTTPScanner::getKernelName(Kernel kernel) {
+    switch (kernel) {
+        case kSSE42:
+            return "sse4.2";
+        case kAVX2:
+            return "avx2";
+        default:
+            return "scalar";
+    }
+}
+
+const HTTPScanner::Functions* HTTPScanner::getFunctions(Kernel kernel) {
+    static const Functions scalarFunctions = {scanScalar<kToken>, scanScalar<kTarget>, scanScalar<kValue>};
+#ifdef NET4CXX_HAS_SIMD_SCAN
+    static const Functions sse42Functions = {scanSSE42<kToken>, scanSSE42<kTarget>, scanSSE42<kValue>};
+    static const Functions avx2Functions = {scanAVX2<kToken>, scanAVX2<kTarget>, scanAVX2<kValue>};
+    if (kernel == kAVX2) {
+        return &avx2Functions;
+    }
+    if (kernel == kSSE42) {
+        return &sse42Functions;
+    }
+#endif
+    return &scalarFunctions;
+}
+
+HTTPScanner::Kernel HTTPScanner::getBestKernel() {
+#ifdef NET4CXX_HAS_SIMD_SCAN
+    __builtin_cpu_init();
+#endif
+    if (isSupported(kAVX2)) {
+        return kAVX2;
+    }
+    if (isSupported(kSSE42)) {
+        return kSSE42;
+    }
+    return kScalar;
+}
+
+NS_END
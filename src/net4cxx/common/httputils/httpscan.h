@@ -0,0 +1,71 @@
+//
+// Created by yuwenyong on 17-12-8.
+//
+
+#ifndef NET4CXX_COMMON_HTTPUTILS_HTTPSCAN_H
+#define NET4CXX_COMMON_HTTPUTILS_HTTPSCAN_H
+
+#include "net4cxx/common/common.h"
+
+NS_BEGIN
+
+
+/// Character class scans of the HTTP parser, each returning the offset of the first byte in [offset, end) outside
+/// its class, or end.
+///
+/// On x86 the kernel is picked once from what the CPU supports: AVX2 and SSE4.2 kernels classify 32 or 16 bytes at
+/// a time with a nibble lookup or, for classes that are a handful of byte ranges, PCMPESTRI, and leave the last few
+/// bytes of a span to the scalar table lookup that every other CPU uses throughout.
+class NET4CXX_COMMON_API HTTPScanner {
+public:
+    enum Kernel {
+        kScalar,
+        kSSE42,
+        kAVX2,
+    };
+
+    /// tchar of RFC 7230, which methods and header names are made of.
+    static size_t scanToken(const Byte *data, size_t offset, size_t end) {
+        return _functions->scanToken(data, offset, end);
+    }
+
+    /// Visible characters and obs-text, which a request target is made of.
+    static size_t scanTarget(const Byte *data, size_t offset, size_t end) {
+        return _functions->scanTarget(data, offset, end);
+    }
+
+    /// Visible characters, obs-text, spaces and tabs, which a header value is made of.
+    static size_t scanValue(const Byte *data, size_t offset, size_t end) {
+        return _functions->scanValue(data, offset, end);
+    }
+
+    static Kernel getKernel() {
+        return _kernel;
+    }
+
+    static bool isSupported(Kernel kernel);
+
+    /// Switches every scan to kernel if the CPU supports it, for benchmarks comparing kernels; not thread safe.
+    static bool setKernel(Kernel kernel);
+
+    static const char* getKernelName(Kernel kernel);
+protected:
+    typedef size_t (*ScanFunction)(const Byte *data, size_t offset, size_t end);
+
+    struct Functions {
+        ScanFunction scanToken;
+        ScanFunction scanTarget;
+        ScanFunction scanValue;
+    };
+
+    static const Functions* getFunctions(Kernel kernel);
+
+    static Kernel getBestKernel();
+
+    static Kernel _kernel;
+    static const Functions *_functions;
+};
+
+NS_END
+
+#endif //NET4CXX_COMMON_HTTPUTILS_HTTPSCAN_H
@@ -399,7 +399,7 @@ NS_END
 #define NET4CXX_DEBUG(...)      net4cxx::LoggingHelper::debug(__FILE__, __LINE__, __FUNCTION__, ##__VA_ARGS__)
 #endif
 #define NET4CXX_INFO(...)       net4cxx::LoggingHelper::info(__FILE__, __LINE__, __FUNCTION__, ##__VA_ARGS__)
-#define NET4CXX_WARN(...)       net4cxx::LoggingHelper::warning(__FILE__, __LINE__, __FUNCTION__, ##__VA_ARGS__)
+#define NET4CXX_WARN(...)       net4cxx::LoggingHelper::warn(__FILE__, __LINE__, __FUNCTION__, ##__VA_ARGS__)
 #define NET4CXX_ERROR(...)      net4cxx::LoggingHelper::error(__FILE__, __LINE__, __FUNCTION__, ##__VA_ARGS__)
 #define NET4CXX_FATAL(...)      net4cxx::LoggingHelper::fatal(__FILE__, __LINE__, __FUNCTION__, ##__VA_ARGS__)
 
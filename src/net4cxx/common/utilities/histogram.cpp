@@ -0,0 +1,55 @@
+//
+// Created by yuwenyong on 17-12-1.
+//
+
+#include "net4cxx/common/utilities/histogram.h"
+
+
+NS_BEGIN
+
+Histogram::Histogram(uint64 highestTrackableValue)
+        : _highestTrackableValue(std::max(highestTrackableValue, 2 * SubBucketHalfCount))
+        , _counts(getIndex(_highestTrackableValue) + 1, 0) {
+
+}
+
+void Histogram::reset() {
+    std::fill(_counts.begin(), _counts.end(), 0);
+    _totalCount = 0;
+    _total = 0;
+    _min = std::numeric_limits<uint64>::max();
+    _max = 0;
+}
+
+void Histogram::merge(const Histogram &other) {
+    if (other._counts.size() > _counts.size()) {
+        _counts.resize(other._counts.size(), 0);
+        _highestTrackableValue = other._highestTrackableValue;
+    }
+    for (size_t i = 0; i != other._counts.size(); ++i) {
+        _counts[i] += other._counts[i];
+    }
+    _totalCount += other._totalCount;
+    _total += other._total;
+    _min = std::min(_min, other._min);
+    _max = std::max(_max, other._max);
+}
+
+uint64 Histogram::getValueAtPercentile(double percentile) const {
+    if (!_totalCount) {
+        return 0;
+    }
+    percentile = std::min(std::max(percentile, 0.0), 100.0);
+    auto countAtPercentile = (uint64)std::ceil(percentile / 100.0 * _totalCount);
+    countAtPercentile = std::max(countAtPercentile, (uint64)1);
+    uint64 count = 0;
+    for (size_t i = 0; i != _counts.size(); ++i) {
+        count += _counts[i];
+        if (count >= countAtPercentile) {
+            return std::min(getHighestEquivalentValue(i), _max);
+        }
+    }
+    return _max;
+}
+
+NS_END
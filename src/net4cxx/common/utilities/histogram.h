@@ -0,0 +1,92 @@
+//
+// Created by yuwenyong on 17-12-1.
+//
+
+#ifndef NET4CXX_COMMON_UTILITIES_HISTOGRAM_H
+#define NET4CXX_COMMON_UTILITIES_HISTOGRAM_H
+
+#include "net4cxx/common/common.h"
+#include <limits>
+
+NS_BEGIN
+
+
+/// High dynamic range histogram of non-negative integers in the layout of HdrHistogram.
+///
+/// Values below 2 * SubBucketHalfCount are counted exactly; above that every power-of-two range is split into
+/// SubBucketHalfCount linear buckets, which keeps two significant digits over the whole range. Recording is an index
+/// computation and an increment, with no allocation, so it can stay on in hot paths. Values above the highest
+/// trackable value are clamped to it.
+class NET4CXX_COMMON_API Histogram {
+public:
+    static constexpr int SubBucketBits = 7;
+    static constexpr uint64 SubBucketHalfCount = 1ull << SubBucketBits;
+
+    explicit Histogram(uint64 highestTrackableValue=3600000000000ull);
+
+    void record(uint64 value) {
+        if (value > _highestTrackableValue) {
+            value = _highestTrackableValue;
+        }
+        ++_counts[getIndex(value)];
+        ++_totalCount;
+        _total += value;
+        _min = std::min(_min, value);
+        _max = std::max(_max, value);
+    }
+
+    void reset();
+
+    void merge(const Histogram &other);
+
+    uint64 getTotalCount() const {
+        return _totalCount;
+    }
+
+    uint64 getMin() const {
+        return _totalCount ? _min : 0;
+    }
+
+    uint64 getMax() const {
+        return _max;
+    }
+
+    double getMean() const {
+        return _totalCount ? (double)_total / _totalCount : 0.0;
+    }
+
+    /// Highest value equivalent to the one at percentile, which is in [0, 100].
+    uint64 getValueAtPercentile(double percentile) const;
+
+    uint64 getHighestTrackableValue() const {
+        return _highestTrackableValue;
+    }
+protected:
+    static size_t getIndex(uint64 value) {
+        if (value < 2 * SubBucketHalfCount) {
+            return (size_t)value;
+        }
+        int shift = 63 - __builtin_clzll(value) - SubBucketBits;
+        return (size_t)shift * SubBucketHalfCount + (size_t)(value >> shift);
+    }
+
+    static uint64 getHighestEquivalentValue(size_t index) {
+        if (index < 2 * SubBucketHalfCount) {
+            return index;
+        }
+        size_t shift = index / SubBucketHalfCount - 1;
+        uint64 subBucket = index % SubBucketHalfCount + SubBucketHalfCount;
+        return ((subBucket + 1) << shift) - 1;
+    }
+
+    uint64 _highestTrackableValue;
+    std::vector<uint64> _counts;
+    uint64 _totalCount{0};
+    uint64 _total{0};
+    uint64 _min{std::numeric_limits<uint64>::max()};
+    uint64 _max{0};
+};
+
+NS_END
+
+#endif //NET4CXX_COMMON_UTILITIES_HISTOGRAM_H
@@ -15,7 +15,7 @@ public:
             : _wpos(0)
             , _rpos(0)
             , _storage() {
-        _storage.resize(4096);
+        _storage.resize(DefaultSize);
     }
 
     explicit MessageBuffer(size_t initialSize)
@@ -34,6 +34,11 @@ public:
         _storage.resize(bytes);
     }
 
+    void release() {
+        ByteArray().swap(_storage);
+        reset();
+    }
+
     Byte* getBasePointer() {
         return _storage.data();
     }
@@ -78,7 +83,8 @@ public:
 
     void ensureFreeSpace() {
         if (getRemainingSpace() == 0) {
-            _storage.resize(_storage.size() * 3 / 2);
+            size_t newSize = _storage.size() * 3 / 2;
+            _storage.resize(newSize > DefaultSize ? newSize : DefaultSize);
         }
     }
 
@@ -94,6 +100,8 @@ public:
             writeCompleted(size);
         }
     }
+
+    static constexpr size_t DefaultSize = 4096;
 protected:
     size_t _wpos;
     size_t _rpos;
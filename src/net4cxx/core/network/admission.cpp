@@ -0,0 +1,166 @@
+//
+// Created by yuwenyong on 17-12-2.
+//
+
+#include "net4cxx/core/network/admission.h"
+#include "net4cxx/common/global/loggers.h"
+#include "net4cxx/core/network/protocol.h"
+#include "net4cxx/core/network/reactor.h"
+#include "net4cxx/core/network/tcp.h"
+
+
+NS_BEGIN
+
+void AdmissionController::start() {
+    if (_started) {
+        return;
+    }
+    _started = true;
+    scheduleProbe();
+}
+
+void AdmissionController::stop() {
+    if (!_started) {
+        return;
+    }
+    _started = false;
+    if (!_probeCall.cancelled()) {
+        _probeCall.cancel();
+    }
+    setOverloaded(false);
+}
+
+void AdmissionController::addListener(const std::shared_ptr<TCPListener> &listener) {
+    _listeners.emplace_back(listener);
+    if (_overloaded) {
+        listener->setOverloaded(true);
+    }
+}
+
+void AdmissionController::track(const ConnectionPtr &connection, const std::shared_ptr<TCPListener> &listener) {
+    _connections.push_back({connection, listener, connection->getBytesReceived(), 0, false});
+}
+
+void AdmissionController::scheduleProbe() {
+    Timestamp scheduled = TimestampClock::now() + _options.probeInterval;
+    std::weak_ptr<AdmissionController> controller = shared_from_this();
+    _probeCall = _reactor->callAt(scheduled, [controller, scheduled]() {
+        auto self = controller.lock();
+        if (self) {
+            self->probe(scheduled);
+        }
+    });
+}
+
+void AdmissionController::probe(const Timestamp &scheduled) {
+    _lag = std::max(TimestampClock::now() - scheduled, Duration::zero());
+    size_t memoryUsage = 0;
+    auto iter = std::remove_if(_connections.begin(), _connections.end(), [this, &memoryUsage](
+            TrackedConnection &entry) {
+        auto connection = entry.connection.lock();
+        if (!connection) {
+            if (entry.throttled) {
+                --_throttledCount;
+            }
+            return true;
+        }
+        memoryUsage += connection->getMemoryUsage();
+        uint64 bytesReceived = connection->getBytesReceived();
+        entry.recentBytes = bytesReceived - entry.bytesReceived;
+        entry.bytesReceived = bytesReceived;
+        return false;
+    });
+    _connections.erase(iter, _connections.end());
+    _memoryUsage = memoryUsage;
+    size_t memoryThreshold = _options.memoryThreshold;
+    if (!_overloaded) {
+        if (_lag > _options.lagThreshold || (memoryThreshold && _memoryUsage > memoryThreshold)) {
+            setOverloaded(true);
+        }
+    } else if (_lag < _options.lagThreshold * _options.recoverRatio &&
+               (!memoryThreshold || _memoryUsage < memoryThreshold * _options.recoverRatio)) {
+        setOverloaded(false);
+    }
+    if (_overloaded) {
+        throttle();
+    }
+    scheduleProbe();
+}
+
+void AdmissionController::setOverloaded(bool overloaded) {
+    if (_overloaded == overloaded) {
+        return;
+    }
+    _overloaded = overloaded;
+    if (overloaded) {
+        NET4CXX_WARN(gGenLog, "Overloaded with lag %.3fms and %lu bytes buffered, shedding load",
+                     std::chrono::duration<double, std::milli>(_lag).count(), (unsigned long)_memoryUsage);
+    } else {
+        NET4CXX_INFO(gGenLog, "Load back to normal, stopped shedding");
+        unthrottleAll();
+    }
+    auto iter = std::remove_if(_listeners.begin(), _listeners.end(), [overloaded](
+            const std::weak_ptr<TCPListener> &entry) {
+        auto listener = entry.lock();
+        if (!listener) {
+            return true;
+        }
+        listener->setOverloaded(overloaded);
+        return false;
+    });
+    _listeners.erase(iter, _listeners.end());
+}
+
+void AdmissionController::throttle() {
+    std::vector<TrackedConnection *> candidates;
+    for (auto &entry: _connections) {
+        if (entry.throttled || !entry.recentBytes) {
+            continue;
+        }
+        // Pausing a transport that cannot hold data back would count it as throttled while it keeps reading.
+        auto connection = entry.connection.lock();
+        if (connection && connection->canPauseReading()) {
+            candidates.push_back(&entry);
+        }
+    }
+    if (candidates.empty()) {
+        return;
+    }
+    auto count = (size_t)std::ceil((double)candidates.size() * _options.throttleFraction);
+    count = std::min(std::max(count, (size_t)1), candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(), [](
+            const TrackedConnection *lhs, const TrackedConnection *rhs) {
+        return lhs->recentBytes > rhs->recentBytes;
+    });
+    for (size_t i = 0; i != count; ++i) {
+        TrackedConnection &entry = *candidates[i];
+        auto connection = entry.connection.lock();
+        auto protocol = connection->getProtocol();
+        // Connections the application paused itself are left to it.
+        if (!protocol || connection->isReadingPaused()) {
+            continue;
+        }
+        auto listener = entry.listener.lock();
+        if (listener && !listener->allowThrottle(protocol)) {
+            continue;
+        }
+        connection->pauseReading();
+        entry.throttled = true;
+        ++_throttledCount;
+    }
+}
+
+void AdmissionController::unthrottleAll() {
+    for (auto &entry: _connections) {
+        if (entry.throttled) {
+            entry.throttled = false;
+            auto connection = entry.connection.lock();
+            if (connection) {
+                connection->resumeReading();
+            }
+        }
+    }
+    _throttledCount = 0;
+}
+
+NS_END
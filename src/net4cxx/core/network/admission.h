@@ -0,0 +1,134 @@
+//
+// Created by yuwenyong on 17-12-2.
+//
+
+#ifndef NET4CXX_CORE_NETWORK_ADMISSION_H
+#define NET4CXX_CORE_NETWORK_ADMISSION_H
+
+#include "net4cxx/common/common.h"
+#include "net4cxx/core/network/base.h"
+
+NS_BEGIN
+
+class TCPListener;
+
+
+enum class ShedMode {
+    kPauseAccept,
+    kReject,
+};
+
+
+struct AdmissionOptions {
+    Duration lagThreshold{std::chrono::milliseconds(100)};
+    /// Bytes of read and write buffers over all tracked connections; 0 leaves memory out.
+    size_t memoryThreshold{512 * 1024 * 1024};
+    double recoverRatio{0.5};
+    /// Share of the connections not yet throttled that each overloaded probe pauses.
+    double throttleFraction{0.1};
+    Duration probeInterval{std::chrono::milliseconds(50)};
+    ShedMode mode{ShedMode::kPauseAccept};
+};
+
+
+/// Sheds load on the TCP listeners attached to it when the reactor falls behind.
+///
+/// A probe timer measures how late it fires, which is the loop lag, and adds up the memory held by the connections
+/// the listeners accepted. Once either passes its threshold the controller is overloaded: listeners stop accepting,
+/// so that new connections wait in the kernel backlog, or in kReject mode accept them only to write the factory's
+/// overload response and close them; and every probe pauses reading on another slice of the connections that
+/// received the most since the previous probe. Everything goes back to normal when lag and memory have both fallen
+/// below recoverRatio of their thresholds. Factories can admit or exempt connections through their overload hooks.
+class NET4CXX_COMMON_API AdmissionController: public std::enable_shared_from_this<AdmissionController> {
+public:
+    friend class TCPListener;
+
+    explicit AdmissionController(Reactor *reactor, AdmissionOptions options={})
+            : _reactor(reactor)
+            , _options(options) {
+
+    }
+
+    AdmissionController(const AdmissionController&) = delete;
+
+    AdmissionController& operator=(const AdmissionController&) = delete;
+
+    void start();
+
+    /// Lifts any shedding in force.
+    void stop();
+
+    const AdmissionOptions& getOptions() const {
+        return _options;
+    }
+
+    bool isOverloaded() const {
+        return _overloaded;
+    }
+
+    /// Lag measured by the latest probe.
+    const Duration& getLag() const {
+        return _lag;
+    }
+
+    /// Memory of the tracked connections as of the latest probe.
+    size_t getMemoryUsage() const {
+        return _memoryUsage;
+    }
+
+    size_t getTrackedCount() const {
+        return _connections.size();
+    }
+
+    size_t getThrottledCount() const {
+        return _throttledCount;
+    }
+
+    size_t getRejectedCount() const {
+        return _rejectedCount;
+    }
+protected:
+    struct TrackedConnection {
+        std::weak_ptr<Connection> connection;
+        std::weak_ptr<TCPListener> listener;
+        uint64 bytesReceived;
+        uint64 recentBytes;
+        bool throttled;
+    };
+
+    void addListener(const std::shared_ptr<TCPListener> &listener);
+
+    void track(const ConnectionPtr &connection, const std::shared_ptr<TCPListener> &listener);
+
+    void recordRejected() {
+        ++_rejectedCount;
+    }
+
+    void scheduleProbe();
+
+    void probe(const Timestamp &scheduled);
+
+    void setOverloaded(bool overloaded);
+
+    void throttle();
+
+    void unthrottleAll();
+
+    Reactor *_reactor{nullptr};
+    AdmissionOptions _options;
+    bool _started{false};
+    bool _overloaded{false};
+    Duration _lag{0};
+    size_t _memoryUsage{0};
+    size_t _throttledCount{0};
+    size_t _rejectedCount{0};
+    DelayedCall _probeCall;
+    std::vector<std::weak_ptr<TCPListener>> _listeners;
+    std::vector<TrackedConnection> _connections;
+};
+
+using AdmissionControllerPtr = std::shared_ptr<AdmissionController>;
+
+NS_END
+
+#endif //NET4CXX_CORE_NETWORK_ADMISSION_H
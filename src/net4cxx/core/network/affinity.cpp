@@ -0,0 +1,142 @@
+//
+// Created by yuwenyong on 17-11-29.
+//
+
+#include "net4cxx/core/network/affinity.h"
+#include <boost/algorithm/string.hpp>
+#include "net4cxx/common/global/loggers.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+NS_BEGIN
+
+std::vector<int> ReactorPlacement::_defaultCpus;
+std::atomic<size_t> ReactorPlacement::_nextCpu{0};
+bool ReactorPlacement::_defaultNumaBind = false;
+bool ReactorPlacement::_defaultSteerIncomingCpu = false;
+
+std::vector<int> ReactorPlacement::parseCpuList(const std::string &cpuList) {
+    std::vector<int> cpus;
+    std::vector<std::string> items;
+    boost::split(items, cpuList, boost::is_any_of(","));
+    for (auto &item: items) {
+        boost::trim(item);
+        if (item.empty()) {
+            continue;
+        }
+        try {
+            auto pos = item.find('-');
+            if (pos == std::string::npos) {
+                cpus.push_back(std::stoi(item));
+            } else {
+                int first = std::stoi(item.substr(0, pos));
+                int last = std::stoi(item.substr(pos + 1));
+                if (first > last) {
+                    NET4CXX_THROW_EXCEPTION(ValueError, "Invalid cpu range " + item);
+                }
+                for (int cpu = first; cpu <= last; ++cpu) {
+                    cpus.push_back(cpu);
+                }
+            }
+        } catch (std::logic_error &) {
+            NET4CXX_THROW_EXCEPTION(ValueError, "Invalid cpu list " + cpuList);
+        }
+    }
+    return cpus;
+}
+
+bool ReactorPlacement::pinCurrentThread(const std::vector<int> &cpus) {
+#ifdef __linux__
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (int cpu: cpus) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            return false;
+        }
+        CPU_SET(cpu, &cpuSet);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+#else
+    return false;
+#endif
+}
+
+int ReactorPlacement::getCurrentNumaNode() {
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu, node;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+        return (int)node;
+    }
+#endif
+    return -1;
+}
+
+bool ReactorPlacement::bindMemory(int node) {
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+    // Spelled out rather than taken from numaif.h so that libnuma is not needed.
+    const int mpolPreferred = 1;
+    if (node < 0 || node >= (int)(sizeof(unsigned long) * 8)) {
+        return false;
+    }
+    unsigned long nodeMask = 1ul << node;
+    return syscall(SYS_set_mempolicy, mpolPreferred, &nodeMask, sizeof(nodeMask) * 8) == 0;
+#else
+    return false;
+#endif
+}
+
+bool ReactorPlacement::steerIncoming(int fd, int cpu) {
+#if defined(__linux__) && defined(SO_REUSEPORT) && defined(SO_INCOMING_CPU)
+    int enabled = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enabled, sizeof(enabled)) != 0) {
+        return false;
+    }
+    return setsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) == 0;
+#else
+    return false;
+#endif
+}
+
+void ReactorPlacement::defineOptions(OptionParser *options) {
+    options->addArgument<std::string>("reactor_cpus", "CPUs to pin reactors to, one per reactor, such as 0-3,8", {},
+                                      {}, "reactor");
+    options->addArgument("reactor_numa_bind", "Keep reactor allocations on the NUMA node of its CPU", "reactor");
+    options->addArgument("reactor_steer_incoming_cpu", "Have pinned reactors accept connections handled on their CPU",
+                         "reactor");
+    options->addParseCallback([options]() {
+        if (options->has("reactor_cpus")) {
+            _defaultCpus = parseCpuList(options->get<std::string>("reactor_cpus"));
+        }
+        _defaultNumaBind = options->has("reactor_numa_bind");
+        _defaultSteerIncomingCpu = options->has("reactor_steer_incoming_cpu");
+    });
+}
+
+int ReactorPlacement::nextDefaultCpu() {
+    if (_defaultCpus.empty()) {
+        return -1;
+    }
+    size_t index = _nextCpu.fetch_add(1, std::memory_order_relaxed);
+    return _defaultCpus[index % _defaultCpus.size()];
+}
+
+
+namespace {
+
+/// Defines the reactor options on the global parser as the library loads, ahead of whichever GlobalInit call parses
+/// them.
+struct ReactorOptionsRegistration {
+    ReactorOptionsRegistration() {
+        ReactorPlacement::defineOptions(NET4CXX_Options);
+    }
+} gReactorOptionsRegistration;
+
+}
+
+NS_END
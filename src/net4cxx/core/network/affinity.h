@@ -0,0 +1,60 @@
+//
+// Created by yuwenyong on 17-11-29.
+//
+
+#ifndef NET4CXX_CORE_NETWORK_AFFINITY_H
+#define NET4CXX_CORE_NETWORK_AFFINITY_H
+
+#include "net4cxx/common/common.h"
+#include <atomic>
+#include "net4cxx/common/configuration/options.h"
+
+NS_BEGIN
+
+
+/// CPU and NUMA placement of reactor threads.
+///
+/// The reactor group of options sets the defaults every new Reactor starts from: reactor_cpus hands out one CPU per
+/// reactor in construction order, reactor_numa_bind keeps a reactor's allocations on the node of the CPU it runs on,
+/// and reactor_steer_incoming_cpu makes TCP listeners of pinned reactors share their port and ask the kernel for
+/// the connections whose packets are handled on their CPU. Everything here is Linux-only and a no-op elsewhere.
+class NET4CXX_COMMON_API ReactorPlacement {
+public:
+    /// Parses a cpu list in the kernel's format, such as "0-3,8,10-11".
+    static std::vector<int> parseCpuList(const std::string &cpuList);
+
+    /// Restricts the calling thread to cpus; returns false if the system refused.
+    static bool pinCurrentThread(const std::vector<int> &cpus);
+
+    /// NUMA node of the CPU the calling thread is running on, -1 when unknown.
+    static int getCurrentNumaNode();
+
+    /// Makes node the preferred node for the calling thread's future allocations.
+    static bool bindMemory(int node);
+
+    /// Sets SO_REUSEPORT and SO_INCOMING_CPU on a listening socket that is not bound yet.
+    static bool steerIncoming(int fd, int cpu);
+
+    /// Adds the reactor group to options; done for NET4CXX_Options when the library loads.
+    static void defineOptions(OptionParser *options);
+
+    /// Next CPU of reactor_cpus, or -1 when the option is not set.
+    static int nextDefaultCpu();
+
+    static bool getDefaultNumaBind() {
+        return _defaultNumaBind;
+    }
+
+    static bool getDefaultSteerIncomingCpu() {
+        return _defaultSteerIncomingCpu;
+    }
+protected:
+    static std::vector<int> _defaultCpus;
+    static std::atomic<size_t> _nextCpu;
+    static bool _defaultNumaBind;
+    static bool _defaultSteerIncomingCpu;
+};
+
+NS_END
+
+#endif //NET4CXX_CORE_NETWORK_AFFINITY_H
@@ -4,7 +4,12 @@
 
 #include "net4cxx/core/network/base.h"
 #include <boost/filesystem.hpp>
+#include <openssl/rand.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#endif
 #include "net4cxx/common/debugging/assert.h"
+#include "net4cxx/core/network/ktls.h"
 #include "net4cxx/core/network/protocol.h"
 #include "net4cxx/core/network/reactor.h"
 
@@ -12,14 +17,55 @@
 NS_BEGIN
 
 
+template <typename ExceptionT>
+class LightweightException: public ExceptionT {
+public:
+    LightweightException(const char *file, int line, const char *func, const std::string &message)
+            : ExceptionT(file, line, func, message, tagException{}) {
+
+    }
+};
+
+#define NET4CXX_LIGHTWEIGHT_EXCEPTION_PTR(Exception, message) \
+    std::make_exception_ptr(LightweightException<Exception>(__FILE__, __LINE__, __FUNCTION__, message))
+
+
+std::exception_ptr DisconnectReason::getException() const {
+    switch (_type) {
+        case kConnectionDone:
+            return NET4CXX_LIGHTWEIGHT_EXCEPTION_PTR(ConnectionDone, _message);
+        case kConnectionAbort:
+            return NET4CXX_LIGHTWEIGHT_EXCEPTION_PTR(ConnectionAbort, _message);
+        case kConnectionError:
+            return std::make_exception_ptr(boost::system::system_error(_errorCode, _message));
+        case kException:
+            return _exception;
+        default:
+            return nullptr;
+    }
+}
+
+
+namespace {
+
+const unsigned char sessionIdContext[] = "net4cxx";
+
+}
+
 SSLOptionPtr SSLOption::create(const SSLParams &sslParams) {
     struct EnableMakeShared: public SSLOption {
         explicit EnableMakeShared(const SSLParams &params): SSLOption(params) {}
     };
     if (sslParams.isServerSide()) {
-        if (sslParams.getCertFile().empty()) {
+        if (sslParams.getCertFile().empty() && sslParams.getCertificates().empty()) {
             NET4CXX_THROW_EXCEPTION(KeyError, "missing cert file in sslParams");
         }
+        for (auto &certificate: sslParams.getCertificates()) {
+            if (!boost::filesystem::exists(certificate.certFile)) {
+                NET4CXX_THROW_EXCEPTION(ValueError, StrUtil::format("cert file \"%s\" does not exist",
+                                                                    certificate.certFile.c_str()));
+            }
+        }
     } else {
         if (sslParams.getVerifyMode() != SSLVerifyMode::CERT_NONE && sslParams.getVerifyFile().empty()) {
             NET4CXX_THROW_EXCEPTION(KeyError, "missing verify file in sslParams");
@@ -43,7 +89,11 @@ SSLOptionPtr SSLOption::create(const SSLParams &sslParams) {
 
 SSLOption::SSLOption(const SSLParams &sslParams)
         : _serverSide(sslParams.isServerSide())
-        , _context(boost::asio::ssl::context::sslv23) {
+        , _context(boost::asio::ssl::context::sslv23)
+        , _initialRecordSize(std::min<size_t>(sslParams.getInitialRecordSize(), SSL3_RT_MAX_PLAIN_LENGTH))
+        , _recordSizeBoost(sslParams.getRecordSizeBoost())
+        , _recordSizeIdle(std::chrono::duration_cast<Duration>(
+                std::chrono::duration<double>(sslParams.getRecordSizeIdle()))) {
     boost::system::error_code ec;
     _context.set_options(boost::asio::ssl::context::no_sslv3, ec);
     const std::string &certFile = sslParams.getCertFile();
@@ -71,6 +121,298 @@ SSLOption::SSLOption(const SSLParams &sslParams)
         if (!checkHost.empty()) {
             setCheckHost(checkHost);
         }
+        setClientSessionCache(sslParams);
+    } else {
+        setSessionCache(sslParams);
+    }
+    if (sslParams.getHandshakeThreads()) {
+        _handshakePool = std::make_unique<ThreadPool>(sslParams.getHandshakeThreads(),
+                                                      sslParams.getHandshakeQueueLimit());
+        _handshakePool->start();
+    }
+#ifdef NET4CXX_HAS_KTLS
+    if (sslParams.isKernelTLS()) {
+        _kernelTLS = true;
+        KernelTLS::prepareContext(_context.native_handle());
+    }
+#endif
+    if (_serverSide) {
+        _defaultCertificate = !certFile.empty();
+        SSL_CTX_set_tlsext_servername_callback(_context.native_handle(), &SSLOption::cbServerName);
+        SSL_CTX_set_tlsext_servername_arg(_context.native_handle(), this);
+        setCertificates(sslParams.getCertificates());
+    }
+}
+
+SSLStats SSLOption::getStats() {
+    SSL_CTX *context = _context.native_handle();
+    SSLStats stats;
+    stats.handshakes = _handshakes;
+    stats.resumptions = _resumptions;
+    stats.kernelOffloads = _kernelOffloads;
+    stats.cacheHits = SSL_CTX_sess_hits(context);
+    stats.cacheMisses = SSL_CTX_sess_misses(context);
+    stats.cacheTimeouts = SSL_CTX_sess_timeouts(context);
+    if (_clientSessionCache) {
+        stats.cachedSessions = (long)_clientSessionCache->getSessionCount();
+    } else if (_sessionCache && SSL_CTX_get_session_cache_mode(context) & SSL_SESS_CACHE_NO_INTERNAL) {
+        stats.cachedSessions = (long)_sessionCache->getSessionCount();
+    } else {
+        stats.cachedSessions = SSL_CTX_sess_number(context);
+    }
+    return stats;
+}
+
+void SSLOption::setSessionCache(const SSLParams &sslParams) {
+    SSL_CTX *context = _context.native_handle();
+    SSL_CTX_set_ex_data(context, getExDataIndex(), this);
+    SSL_CTX_set_session_id_context(context, sessionIdContext, sizeof(sessionIdContext) - 1);
+    long timeout = sslParams.getSessionTimeout();
+    size_t cacheSize = sslParams.getSessionCacheSize();
+    const std::string &cacheName = sslParams.getSessionCacheName();
+    Duration rotation = std::chrono::seconds(sslParams.getTicketKeyRotation());
+    SSL_CTX_set_timeout(context, timeout);
+    if (!cacheName.empty()) {
+        _sessionCache = SSLSessionCache::getShared(cacheName, cacheSize, std::chrono::seconds(timeout), rotation);
+    }
+    if (cacheSize == 0) {
+        SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_OFF);
+    } else if (_sessionCache) {
+        SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+        SSL_CTX_sess_set_new_cb(context, &SSLOption::cbNewSession);
+        SSL_CTX_sess_set_get_cb(context, &SSLOption::cbGetSession);
+        SSL_CTX_sess_set_remove_cb(context, &SSLOption::cbRemoveSession);
+    } else {
+        SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_SERVER);
+        SSL_CTX_sess_set_cache_size(context, (long)cacheSize);
+    }
+    if (!sslParams.getSessionTickets()) {
+        SSL_CTX_set_options(context, SSL_OP_NO_TICKET);
+    } else if (_sessionCache || rotation != Duration::zero()) {
+        if (!_sessionCache) {
+            _sessionCache = std::make_shared<SSLSessionCache>(0, std::chrono::seconds(timeout), rotation);
+        }
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+        SSL_CTX_set_tlsext_ticket_key_evp_cb(context, &SSLOption::cbTicketKey);
+#else
+        SSL_CTX_set_tlsext_ticket_key_cb(context, &SSLOption::cbTicketKey);
+#endif
+    }
+}
+
+std::vector<std::string> SSLOption::addCertificate(const std::string &certFile, const std::string &keyFile,
+                                                   const std::string &password) {
+    if (!_serverSide) {
+        NET4CXX_THROW_EXCEPTION(ValueError, "certificates are picked by server name on the server side only");
+    }
+    std::vector<std::string> serverNames;
+    auto context = loadCertificate({certFile, keyFile, password}, serverNames);
+    _certificates.add(serverNames, std::move(context));
+    return serverNames;
+}
+
+void SSLOption::setCertificates(const std::vector<SSLCertificateFiles> &certificates) {
+    std::vector<SSLCertificateMap::SSLContextPtr> contexts(certificates.size());
+    std::vector<std::vector<std::string>> serverNames(certificates.size());
+    for (size_t i = 0; i != certificates.size(); ++i) {
+        contexts[i] = loadCertificate(certificates[i], serverNames[i]);
+    }
+    // Added in order, so that of two certificates for the same name the later one is presented.
+    for (size_t i = 0; i != certificates.size(); ++i) {
+        _certificates.add(serverNames[i], std::move(contexts[i]));
+    }
+}
+
+SSLCertificateMap::SSLContextPtr SSLOption::loadCertificate(const SSLCertificateFiles &files,
+                                                            std::vector<std::string> &serverNames) {
+    auto context = std::make_shared<SSLContextType>(boost::asio::ssl::context::sslv23);
+    if (!files.password.empty()) {
+        std::string password = files.password;
+        context->set_password_callback([password](size_t, boost::asio::ssl::context::password_purpose) {
+            return password;
+        });
+    }
+    context->use_certificate_chain_file(files.certFile);
+    context->use_private_key_file(files.keyFile.empty() ? files.certFile : files.keyFile,
+                                  boost::asio::ssl::context::pem);
+    SSL_CTX *handle = context->native_handle();
+    serverNames = SSLCertificateMap::getServerNames(SSL_CTX_get0_certificate(handle));
+    if (serverNames.empty()) {
+        NET4CXX_THROW_EXCEPTION(ValueError, StrUtil::format("cert file \"%s\" names no host",
+                                                            files.certFile.c_str()));
+    }
+    // A connection switches over to the context of the certificate it picks, the session and key log callbacks
+    // have to find their way back to the option from there too.
+    SSL_CTX_set_ex_data(handle, getExDataIndex(), this);
+    SSL_CTX_set_session_id_context(handle, sessionIdContext, sizeof(sessionIdContext) - 1);
+#ifdef NET4CXX_HAS_KTLS
+    if (_kernelTLS) {
+        KernelTLS::prepareContext(handle);
+    }
+#endif
+    return context;
+}
+
+void SSLOption::resumeSession(SSL *ssl, const std::string &sessionKey) {
+    if (!_clientSessionCache) {
+        return;
+    }
+    SSL_set_ex_data(ssl, getSessionKeyIndex(), const_cast<std::string *>(&sessionKey));
+    SSL_SESSION *session = _clientSessionCache->findSession(sessionKey);
+    if (session) {
+        SSL_set_session(ssl, session);
+        SSL_SESSION_free(session);
+    }
+}
+
+void SSLOption::setClientSessionCache(const SSLParams &sslParams) {
+    size_t cacheSize = sslParams.getSessionCacheSize();
+    if (cacheSize == 0) {
+        return;
+    }
+    SSL_CTX *context = _context.native_handle();
+    if (!sslParams.getSessionTickets()) {
+        SSL_CTX_set_options(context, SSL_OP_NO_TICKET);
+    }
+    _clientSessionCache = std::make_unique<SSLClientSessionCache>(cacheSize);
+    SSL_CTX_set_ex_data(context, getExDataIndex(), this);
+    SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(context, &SSLOption::cbNewSession);
+}
+
+int SSLOption::getExDataIndex() {
+    static int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+int SSLOption::getSessionKeyIndex() {
+    static int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+SSLOption* SSLOption::fromContext(SSL_CTX *context) {
+    return static_cast<SSLOption *>(SSL_CTX_get_ex_data(context, getExDataIndex()));
+}
+
+int SSLOption::cbNewSession(SSL *ssl, SSL_SESSION *session) {
+    SSLOption *option = fromContext(SSL_get_SSL_CTX(ssl));
+    if (option && !option->_serverSide) {
+        auto sessionKey = static_cast<const std::string *>(SSL_get_ex_data(ssl, getSessionKeyIndex()));
+        if (!sessionKey) {
+            return 0;
+        }
+        // The cache keeps the reference OpenSSL hands over.
+        option->_clientSessionCache->addSession(*sessionKey, session);
+        return 1;
+    }
+    int length = i2d_SSL_SESSION(session, nullptr);
+    if (!option || length <= 0) {
+        return 0;
+    }
+    ByteArray data((size_t)length);
+    unsigned char *cursor = data.data();
+    i2d_SSL_SESSION(session, &cursor);
+    unsigned int idLength;
+    const unsigned char *id = SSL_SESSION_get_id(session, &idLength);
+    option->_sessionCache->addSession(id, idLength, std::move(data));
+    // Not keeping a reference to the session, it lives on DER encoded in the cache.
+    return 0;
+}
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+SSL_SESSION* SSLOption::cbGetSession(SSL *ssl, const unsigned char *id, int idLength, int *copy) {
+#else
+SSL_SESSION* SSLOption::cbGetSession(SSL *ssl, unsigned char *id, int idLength, int *copy) {
+#endif
+    *copy = 0;
+    SSLOption *option = fromContext(SSL_get_SSL_CTX(ssl));
+    ByteArray data;
+    if (!option || !option->_sessionCache->findSession(id, (size_t)idLength, data)) {
+        return nullptr;
+    }
+    const unsigned char *cursor = data.data();
+    return d2i_SSL_SESSION(nullptr, &cursor, (long)data.size());
+}
+
+void SSLOption::cbRemoveSession(SSL_CTX *context, SSL_SESSION *session) {
+    SSLOption *option = fromContext(context);
+    if (option) {
+        unsigned int idLength;
+        const unsigned char *id = SSL_SESSION_get_id(session, &idLength);
+        option->_sessionCache->removeSession(id, idLength);
+    }
+}
+
+int SSLOption::cbServerName(SSL *ssl, int *alert, void *arg) {
+    auto option = static_cast<SSLOption *>(arg);
+    const char *serverName = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+    auto context = serverName ? option->_certificates.find(serverName) : nullptr;
+    if (context) {
+        SSL_set_SSL_CTX(ssl, context->native_handle());
+    } else if (!option->_defaultCertificate) {
+        *alert = SSL_AD_UNRECOGNIZED_NAME;
+        return SSL_TLSEXT_ERR_ALERT_FATAL;
+    }
+    return SSL_TLSEXT_ERR_OK;
+}
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+int SSLOption::cbTicketKey(SSL *ssl, unsigned char *keyName, unsigned char *iv, EVP_CIPHER_CTX *cipher,
+                           EVP_MAC_CTX *mac, int encrypt) {
+#else
+int SSLOption::cbTicketKey(SSL *ssl, unsigned char *keyName, unsigned char *iv, EVP_CIPHER_CTX *cipher,
+                           HMAC_CTX *mac, int encrypt) {
+#endif
+    SSLOption *option = fromContext(SSL_get_SSL_CTX(ssl));
+    if (!option) {
+        return -1;
+    }
+    SSLSessionCache::TicketKey key;
+    bool current = true;
+    if (encrypt) {
+        key = option->_sessionCache->getTicketKey();
+        if (RAND_bytes(iv, EVP_MAX_IV_LENGTH) != 1) {
+            return -1;
+        }
+        memcpy(keyName, key.name, sizeof(key.name));
+        if (EVP_EncryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr, key.aesKey, iv) != 1) {
+            return -1;
+        }
+    } else {
+        if (!option->_sessionCache->findTicketKey(keyName, key, current)) {
+            // Unknown or expired key, fall back to a full handshake.
+            return 0;
+        }
+        if (EVP_DecryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr, key.aesKey, iv) != 1) {
+            return -1;
+        }
+    }
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    OSSL_PARAM params[] = {
+            OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, key.hmacKey, sizeof(key.hmacKey)),
+            OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, const_cast<char *>("SHA256"), 0),
+            OSSL_PARAM_construct_end(),
+    };
+    if (EVP_MAC_CTX_set_params(mac, params) != 1) {
+        return -1;
+    }
+#else
+    if (HMAC_Init_ex(mac, key.hmacKey, sizeof(key.hmacKey), EVP_sha256(), nullptr) != 1) {
+        return -1;
+    }
+#endif
+    // A ticket under a retired key is still accepted, but gets replaced by one under the current key.
+    return current ? 1 : 2;
+}
+
+
+DeferredPool::~DeferredPool() {
+    for (auto block: _freeLists) {
+        while (block) {
+            FreeBlock *next = block->next;
+            ::operator delete(block);
+            block = next;
+        }
     }
 }
 
@@ -90,16 +432,76 @@ void DelayedCall::cancel() {
 }
 
 
+size_t WriteQueue::getMemoryUsage() const {
+    size_t memoryUsage = spilled() ? _buffers.capacity() * sizeof(MessageBuffer) : 0;
+    for (auto &buffer: _buffers) {
+        memoryUsage += buffer.getBufferSize();
+    }
+    return memoryUsage;
+}
+
+
 void Connection::dataReceived(Byte *data, size_t length) {
     auto protocol = _protocol.lock();
     BOOST_ASSERT(protocol);
+    _bytesReceived += length;
+    if (!_rateLimiters.empty()) {
+        Timestamp now = TimestampClock::now();
+        for (auto &limiter: _rateLimiters) {
+            limiter->charge(length, now);
+        }
+    }
     protocol->dataReceived(data, length);
 }
 
-void Connection::connectionLost(std::exception_ptr reason) {
+void Connection::connectionLost(const DisconnectReason &reason) {
     auto protocol = _protocol.lock();
     BOOST_ASSERT(protocol);
-    protocol->connectionLost(std::move(reason));
+    protocol->connectionLost(reason);
+}
+
+Duration Connection::getRateLimitDelay() const {
+    Duration delay = Duration::zero();
+    Timestamp now = TimestampClock::now();
+    for (auto &limiter: _rateLimiters) {
+        delay = std::max(delay, limiter->getDelay(now));
+    }
+    return delay;
+}
+
+void Connection::trimLater(std::weak_ptr<Connection> connection) {
+    if (_trimPending) {
+        _recentlyActive = true;
+        return;
+    }
+    double quietPeriod = _reactor->getIdleTrimTimeout();
+    if (quietPeriod < 0.0) {
+        return;
+    }
+    _trimPending = true;
+    _recentlyActive = false;
+    _reactor->callLater(quietPeriod, [connection]() {
+        auto self = connection.lock();
+        if (!self) {
+            return;
+        }
+        self->_trimPending = false;
+        if (self->_disconnected) {
+            return;
+        }
+        if (self->_recentlyActive || self->_writing || !self->_writeQueue.empty()) {
+            self->trimLater(connection);
+        } else {
+            self->trimMemory();
+        }
+    });
+}
+
+void Connection::trimMemory() {
+    _writeQueue.trim();
+    if (!_reading) {
+        _readBuffer.release();
+    }
 }
 
 
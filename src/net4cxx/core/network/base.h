@@ -6,12 +6,35 @@
 #define NET4CXX_CORE_NETWORK_BASE_H
 
 #include "net4cxx/common/common.h"
+#include <atomic>
 #include <boost/asio.hpp>
 #include <boost/asio/ssl.hpp>
 #include <boost/asio/steady_timer.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/container/small_vector.hpp>
 #include "net4cxx/common/utilities/errors.h"
 #include "net4cxx/common/utilities/messagebuffer.h"
+#include "net4cxx/core/network/loopmonitor.h"
+#include "net4cxx/core/network/ratelimit.h"
+#include "net4cxx/core/network/sslcache.h"
+#include "net4cxx/core/network/sslcerts.h"
+#include "net4cxx/core/network/threadpool.h"
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS) && defined(BOOST_ASIO_HAS_POSIX_STREAM_DESCRIPTOR) && defined(__linux__)
+#define NET4CXX_HAS_SHM_TRANSPORT
+#endif
+
+#if defined(__linux__) && defined(BOOST_ASIO_HAS_POSIX_STREAM_DESCRIPTOR) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define NET4CXX_HAS_URING
+#endif
+#endif
+
+#if defined(__linux__) && defined(__has_include) && OPENSSL_VERSION_NUMBER >= 0x10101000L
+#if __has_include(<linux/tls.h>)
+#define NET4CXX_HAS_KTLS
+#endif
+#endif
 
 NS_BEGIN
 
@@ -25,7 +48,69 @@ NET4CXX_DECLARE_EXCEPTION(ConnectionAbort, IOError);
 NET4CXX_DECLARE_EXCEPTION(UserAbort, Exception);
 
 
+class NET4CXX_COMMON_API DisconnectReason {
+public:
+    enum Type {
+        kNone,
+        kConnectionDone,
+        kConnectionAbort,
+        kConnectionError,
+        kException,
+    };
+
+    DisconnectReason() = default;
+
+    explicit DisconnectReason(Type type, std::string message={})
+            : _type(type)
+            , _message(std::move(message)) {
+
+    }
+
+    explicit DisconnectReason(const boost::system::error_code &ec, std::string message={})
+            : _type(kConnectionError)
+            , _errorCode(ec)
+            , _message(std::move(message)) {
+
+    }
+
+    DisconnectReason(std::exception_ptr exception)
+            : _type(exception ? kException : kNone)
+            , _exception(std::move(exception)) {
+
+    }
+
+    Type getType() const {
+        return _type;
+    }
+
+    const boost::system::error_code& getErrorCode() const {
+        return _errorCode;
+    }
+
+    const std::string& getMessage() const {
+        return _message;
+    }
+
+    bool isClean() const {
+        return _type == kConnectionDone || (_type == kConnectionError && _errorCode == boost::asio::error::eof);
+    }
+
+    std::exception_ptr getException() const;
+
+    explicit operator bool() const {
+        return _type != kNone;
+    }
+protected:
+    Type _type{kNone};
+    boost::system::error_code _errorCode;
+    std::string _message;
+    std::exception_ptr _exception;
+};
+
+
 class Reactor;
+class URing;
+class URingOperation;
 class Protocol;
 using ProtocolPtr = std::shared_ptr<Protocol>;
 class SSLOption;
@@ -39,6 +124,14 @@ enum class SSLVerifyMode {
 };
 
 
+struct SSLCertificateFiles {
+    std::string certFile;
+    /// Empty when the key is in the cert file.
+    std::string keyFile;
+    std::string password;
+};
+
+
 class SSLParams {
 public:
     explicit SSLParams(bool serverSide= false)
@@ -69,6 +162,17 @@ public:
         return _password;
     }
 
+    /// Adds a certificate a server presents to clients asking for one of the names it was issued to, as given by its
+    /// DNS subject alternative names or else its common name; the cert file is for clients that ask for no name, or
+    /// for one no certificate covers.
+    void addCertificate(const std::string &certFile, const std::string &keyFile="", const std::string &password="") {
+        _certificates.push_back({certFile, keyFile, password});
+    }
+
+    const std::vector<SSLCertificateFiles>& getCertificates() const {
+        return _certificates;
+    }
+
     void setVerifyMode(SSLVerifyMode verifyMode) {
         _verifyMode = verifyMode;
     }
@@ -93,6 +197,109 @@ public:
         return _checkHost;
     }
 
+    /// Sessions cached for resumption: by a server for its clients, by a client one per host and port it connects to;
+    /// 0 turns session caching off.
+    void setSessionCacheSize(size_t sessionCacheSize) {
+        _sessionCacheSize = sessionCacheSize;
+    }
+
+    size_t getSessionCacheSize() const {
+        return _sessionCacheSize;
+    }
+
+    /// Seconds a cached session or session ticket stays resumable.
+    void setSessionTimeout(long sessionTimeout) {
+        _sessionTimeout = sessionTimeout;
+    }
+
+    long getSessionTimeout() const {
+        return _sessionTimeout;
+    }
+
+    void setSessionTickets(bool sessionTickets) {
+        _sessionTickets = sessionTickets;
+    }
+
+    bool getSessionTickets() const {
+        return _sessionTickets;
+    }
+
+    /// Seconds between session-ticket key rotations; 0 keeps one key for the lifetime of the cache.
+    void setTicketKeyRotation(long ticketKeyRotation) {
+        _ticketKeyRotation = ticketKeyRotation;
+    }
+
+    long getTicketKeyRotation() const {
+        return _ticketKeyRotation;
+    }
+
+    /// Server options created with the same name share their session cache and ticket keys, so that sessions resume
+    /// across reactor threads; empty gives the option a cache of its own.
+    void setSessionCacheName(const std::string &sessionCacheName) {
+        _sessionCacheName = sessionCacheName;
+    }
+
+    const std::string& getSessionCacheName() const {
+        return _sessionCacheName;
+    }
+
+    /// Threads of a pool dedicated to the option that run the handshake crypto, so that a flood of handshakes does
+    /// not stall the reactors; 0 handshakes on the reactor thread.
+    void setHandshakeThreads(size_t handshakeThreads) {
+        _handshakeThreads = handshakeThreads;
+    }
+
+    size_t getHandshakeThreads() const {
+        return _handshakeThreads;
+    }
+
+    /// Handshake steps waiting for the pool at most; the reactor thread runs those over it.
+    void setHandshakeQueueLimit(size_t handshakeQueueLimit) {
+        _handshakeQueueLimit = handshakeQueueLimit;
+    }
+
+    size_t getHandshakeQueueLimit() const {
+        return _handshakeQueueLimit;
+    }
+
+    /// Moves the record layer into the kernel after the handshake where the kernel supports it, so that data goes
+    /// through plain socket calls; connections it cannot take stay in user space.
+    void setKernelTLS(bool kernelTLS) {
+        _kernelTLS = kernelTLS;
+    }
+
+    bool isKernelTLS() const {
+        return _kernelTLS;
+    }
+
+    /// Plaintext bytes of the records a connection sends first and after going idle, small enough for a record to
+    /// fit one TCP segment so that the peer decrypts it as soon as it arrives; 0 always sends full 16KB records.
+    void setInitialRecordSize(size_t initialRecordSize) {
+        _initialRecordSize = initialRecordSize;
+    }
+
+    size_t getInitialRecordSize() const {
+        return _initialRecordSize;
+    }
+
+    /// Bytes sent after which records are full size; until then each record grows by the initial record size.
+    void setRecordSizeBoost(size_t recordSizeBoost) {
+        _recordSizeBoost = recordSizeBoost;
+    }
+
+    size_t getRecordSizeBoost() const {
+        return _recordSizeBoost;
+    }
+
+    /// Seconds without writes after which records start small again.
+    void setRecordSizeIdle(double recordSizeIdle) {
+        _recordSizeIdle = recordSizeIdle;
+    }
+
+    double getRecordSizeIdle() const {
+        return _recordSizeIdle;
+    }
+
     bool isServerSide() const {
         return _serverSide;
     }
@@ -103,8 +310,37 @@ protected:
     std::string _certFile;
     std::string _keyFile;
     std::string _password;
+    std::vector<SSLCertificateFiles> _certificates;
     std::string _verifyFile;
     std::string _checkHost;
+    size_t _sessionCacheSize{20480};
+    long _sessionTimeout{300};
+    bool _sessionTickets{true};
+    long _ticketKeyRotation{0};
+    std::string _sessionCacheName;
+    size_t _handshakeThreads{0};
+    size_t _handshakeQueueLimit{65536};
+    bool _kernelTLS{false};
+    size_t _initialRecordSize{1360};
+    size_t _recordSizeBoost{128 * 1024};
+    double _recordSizeIdle{1.0};
+};
+
+
+struct SSLStats {
+    uint64 handshakes{0};
+    uint64 resumptions{0};
+    /// Session cache lookups, as counted by OpenSSL.
+    long cacheHits{0};
+    long cacheMisses{0};
+    long cacheTimeouts{0};
+    long cachedSessions{0};
+    /// Handshakes whose connection went on with the kernel sending its records.
+    uint64 kernelOffloads{0};
+
+    double getResumptionRate() const {
+        return handshakes ? (double)resumptions / (double)handshakes : 0.0;
+    }
 };
 
 
@@ -120,10 +356,93 @@ public:
         return _context;
     }
 
+    void recordHandshake(bool resumed) {
+        ++_handshakes;
+        if (resumed) {
+            ++_resumptions;
+        }
+    }
+
+    void recordKernelOffload() {
+        ++_kernelOffloads;
+    }
+
+    SSLStats getStats();
+
+    /// Pool the handshakes run on, nullptr when they run on the reactor thread.
+    ThreadPool* getHandshakePool() {
+        return _handshakePool.get();
+    }
+
+    bool isKernelTLS() const {
+        return _kernelTLS;
+    }
+
+    size_t getInitialRecordSize() const {
+        return _initialRecordSize;
+    }
+
+    size_t getRecordSizeBoost() const {
+        return _recordSizeBoost;
+    }
+
+    const Duration& getRecordSizeIdle() const {
+        return _recordSizeIdle;
+    }
+
+    /// Starts presenting the certificate to the names it was issued to, in place of the one presenting it so far;
+    /// handshakes under way keep the certificate they picked. Returns the names.
+    std::vector<std::string> addCertificate(const std::string &certFile, const std::string &keyFile="",
+                                            const std::string &password="");
+
+    /// Stops presenting the certificate serving serverName, to that name as to the others it was issued to.
+    bool removeCertificate(const std::string &serverName) {
+        return _certificates.remove(serverName);
+    }
+
+    /// Offers the session cached for sessionKey to a client connection about to handshake, and caches the session
+    /// it ends up with under sessionKey. sessionKey has to outlive ssl.
+    void resumeSession(SSL *ssl, const std::string &sessionKey);
+
     static SSLOptionPtr create(const SSLParams &sslParams);
 protected:
     explicit SSLOption(const SSLParams &sslParams);
 
+    void setSessionCache(const SSLParams &sslParams);
+
+    void setClientSessionCache(const SSLParams &sslParams);
+
+    void setCertificates(const std::vector<SSLCertificateFiles> &certificates);
+
+    SSLCertificateMap::SSLContextPtr loadCertificate(const SSLCertificateFiles &files,
+                                                     std::vector<std::string> &serverNames);
+
+    static int getExDataIndex();
+
+    static int getSessionKeyIndex();
+
+    static SSLOption* fromContext(SSL_CTX *context);
+
+    static int cbNewSession(SSL *ssl, SSL_SESSION *session);
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+    static SSL_SESSION* cbGetSession(SSL *ssl, const unsigned char *id, int idLength, int *copy);
+#else
+    static SSL_SESSION* cbGetSession(SSL *ssl, unsigned char *id, int idLength, int *copy);
+#endif
+
+    static void cbRemoveSession(SSL_CTX *context, SSL_SESSION *session);
+
+    static int cbServerName(SSL *ssl, int *alert, void *arg);
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    static int cbTicketKey(SSL *ssl, unsigned char *keyName, unsigned char *iv, EVP_CIPHER_CTX *cipher,
+                           EVP_MAC_CTX *mac, int encrypt);
+#else
+    static int cbTicketKey(SSL *ssl, unsigned char *keyName, unsigned char *iv, EVP_CIPHER_CTX *cipher,
+                           HMAC_CTX *mac, int encrypt);
+#endif
+
     void setCertFile(const std::string &certFile) {
         _context.use_certificate_chain_file(certFile);
     }
@@ -162,6 +481,18 @@ protected:
 
     bool _serverSide;
     SSLContextType _context;
+    bool _defaultCertificate{false};
+    SSLCertificateMap _certificates;
+    std::atomic<uint64> _handshakes{0};
+    std::atomic<uint64> _resumptions{0};
+    std::atomic<uint64> _kernelOffloads{0};
+    std::shared_ptr<SSLSessionCache> _sessionCache;
+    std::unique_ptr<SSLClientSessionCache> _clientSessionCache;
+    std::unique_ptr<ThreadPool> _handshakePool;
+    bool _kernelTLS{false};
+    size_t _initialRecordSize;
+    size_t _recordSizeBoost;
+    Duration _recordSizeIdle;
 };
 
 
@@ -179,6 +510,14 @@ public:
         }
         return boost::all(port, boost::is_digit());
     }
+
+    static bool setBusyPoll(int fd, int microseconds) {
+#ifdef SO_BUSY_POLL
+        return setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &microseconds, sizeof(microseconds)) == 0;
+#else
+        return false;
+#endif
+    }
 };
 
 class NET4CXX_COMMON_API Address {
@@ -216,6 +555,178 @@ protected:
 };
 
 
+template <size_t StorageSize=256>
+class HandlerMemory {
+public:
+    HandlerMemory() = default;
+
+    HandlerMemory(const HandlerMemory&) = delete;
+
+    HandlerMemory& operator=(const HandlerMemory&) = delete;
+
+    void* allocate(size_t size) {
+        if (!_inUse && size <= sizeof(_storage)) {
+            _inUse = true;
+            return &_storage;
+        }
+        return ::operator new(size);
+    }
+
+    void deallocate(void *pointer) {
+        if (pointer == &_storage) {
+            _inUse = false;
+        } else {
+            ::operator delete(pointer);
+        }
+    }
+protected:
+    typename std::aligned_storage<StorageSize>::type _storage;
+    bool _inUse{false};
+};
+
+
+template <typename T, typename MemoryT>
+class HandlerAllocator {
+public:
+    template <typename U, typename OtherMemoryT>
+    friend class HandlerAllocator;
+
+    using value_type = T;
+
+    explicit HandlerAllocator(MemoryT &memory)
+            : _memory(memory) {
+
+    }
+
+    template <typename U>
+    HandlerAllocator(const HandlerAllocator<U, MemoryT> &other) noexcept
+            : _memory(other._memory) {
+
+    }
+
+    T* allocate(size_t n) const {
+        return static_cast<T *>(_memory.allocate(sizeof(T) * n));
+    }
+
+    void deallocate(T *p, size_t n) const {
+        _memory.deallocate(p);
+    }
+
+    bool operator==(const HandlerAllocator &rhs) const noexcept {
+        return &_memory == &rhs._memory;
+    }
+
+    bool operator!=(const HandlerAllocator &rhs) const noexcept {
+        return &_memory != &rhs._memory;
+    }
+protected:
+    MemoryT &_memory;
+};
+
+
+template <typename HandlerT, typename MemoryT>
+class CustomAllocHandler {
+public:
+    using allocator_type = HandlerAllocator<HandlerT, MemoryT>;
+
+    CustomAllocHandler(MemoryT &memory, HandlerT handler)
+            : _memory(memory)
+            , _handler(std::move(handler)) {
+
+    }
+
+    allocator_type get_allocator() const noexcept {
+        return allocator_type(_memory);
+    }
+
+    template <typename... Args>
+    void operator()(Args&&... args) {
+#ifdef NET4CXX_HAS_LOOP_STATS
+        LoopMonitor::HandlerScope scope(LoopMonitor::kIo, typeid(HandlerT));
+#endif
+        _handler(std::forward<Args>(args)...);
+    }
+
+    friend void* asio_handler_allocate(size_t size, CustomAllocHandler *thisHandler) {
+        return thisHandler->_memory.allocate(size);
+    }
+
+    friend void asio_handler_deallocate(void *pointer, size_t size, CustomAllocHandler *thisHandler) {
+        thisHandler->_memory.deallocate(pointer);
+    }
+protected:
+    MemoryT &_memory;
+    HandlerT _handler;
+};
+
+
+template <typename HandlerT, typename MemoryT>
+inline CustomAllocHandler<typename std::decay<HandlerT>::type, MemoryT> makeCustomAllocHandler(MemoryT &memory,
+                                                                                               HandlerT &&handler) {
+    return CustomAllocHandler<typename std::decay<HandlerT>::type, MemoryT>(memory, std::forward<HandlerT>(handler));
+}
+
+
+/// Per-reactor free lists for the small blocks Deferred chains are made of.
+///
+/// Requests are rounded up to a multiple of Granularity and served from the matching list, so steady-state chaining
+/// reuses freed blocks instead of going to malloc. Larger requests and blocks beyond MaxFreeBlocks per list go
+/// straight to operator new/delete. Not thread-safe; only the reactor thread may use it.
+class NET4CXX_COMMON_API DeferredPool: public boost::noncopyable {
+public:
+    static constexpr size_t Granularity = 32;
+    static constexpr size_t MaxBlockSize = 256;
+    static constexpr size_t MaxFreeBlocks = 1024;
+
+    DeferredPool() = default;
+
+    ~DeferredPool();
+
+    void* allocate(size_t size) {
+        if (size > MaxBlockSize) {
+            return ::operator new(size);
+        }
+        size_t index = getIndex(size);
+        FreeBlock *block = _freeLists[index];
+        if (block) {
+            _freeLists[index] = block->next;
+            --_freeCounts[index];
+            return block;
+        }
+        return ::operator new((index + 1) * Granularity);
+    }
+
+    void deallocate(void *pointer, size_t size) {
+        if (size > MaxBlockSize) {
+            ::operator delete(pointer);
+            return;
+        }
+        size_t index = getIndex(size);
+        if (_freeCounts[index] >= MaxFreeBlocks) {
+            ::operator delete(pointer);
+            return;
+        }
+        auto block = static_cast<FreeBlock *>(pointer);
+        block->next = _freeLists[index];
+        _freeLists[index] = block;
+        ++_freeCounts[index];
+    }
+protected:
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    static constexpr size_t NumLists = MaxBlockSize / Granularity;
+
+    static size_t getIndex(size_t size) {
+        return size ? (size - 1) / Granularity : 0;
+    }
+
+    std::array<FreeBlock *, NumLists> _freeLists{};
+    std::array<size_t, NumLists> _freeCounts{};
+};
+
+
 class NET4CXX_COMMON_API Timeout: public std::enable_shared_from_this<Timeout> {
 public:
     friend Reactor;
@@ -248,12 +759,17 @@ protected:
 
     template <typename CallbackT>
     void wait(CallbackT &&callback) {
-        _timer.async_wait([callback = std::forward<CallbackT>(callback), timeout = shared_from_this()](
+        _timer.async_wait(makeCustomAllocHandler(_memory, [callback = std::forward<CallbackT>(callback),
+                                                           timeout = shared_from_this()](
                 const boost::system::error_code &ec) {
             if (!ec) {
+#ifdef NET4CXX_HAS_LOOP_STATS
+                LoopMonitor::HandlerScope scope(LoopMonitor::kTimer, typeid(typename std::decay<CallbackT>::type));
+                LoopMonitor::recordTimerFired(timeout->_timer.expires_at());
+#endif
                 callback();
             }
-        });
+        }));
     }
 
     void cancel() {
@@ -261,6 +777,7 @@ protected:
     }
 
     TimerType _timer;
+    HandlerMemory<> _memory;
 };
 
 typedef std::weak_ptr<Timeout> TimeoutHandle;
@@ -284,6 +801,102 @@ protected:
 };
 
 
+class NET4CXX_COMMON_API WriteQueue {
+public:
+    using ContainerType = boost::container::small_vector<MessageBuffer, 1>;
+    using iterator = ContainerType::iterator;
+    using const_iterator = ContainerType::const_iterator;
+
+    bool empty() const {
+        return _head == _buffers.size();
+    }
+
+    size_t size() const {
+        return _buffers.size() - _head;
+    }
+
+    MessageBuffer& front() {
+        return _buffers[_head];
+    }
+
+    MessageBuffer& back() {
+        return _buffers.back();
+    }
+
+    iterator begin() {
+        return _buffers.begin() + _head;
+    }
+
+    iterator end() {
+        return _buffers.end();
+    }
+
+    const_iterator begin() const {
+        return _buffers.begin() + _head;
+    }
+
+    const_iterator end() const {
+        return _buffers.end();
+    }
+
+    void emplace_back(MessageBuffer &&buffer) {
+        if (_head != 0 && _buffers.size() == _buffers.capacity()) {
+            _buffers.erase(_buffers.begin(), _buffers.begin() + _head);
+            _head = 0;
+        }
+        _buffers.emplace_back(std::move(buffer));
+    }
+
+    void pop_front() {
+        _buffers[_head].release();
+        if (++_head == _buffers.size()) {
+            _buffers.clear();
+            _head = 0;
+        }
+    }
+
+    /// Drops bytes sent from the front buffers, however many buffers they span.
+    void consume(size_t bytes) {
+        while (bytes) {
+            MessageBuffer &buffer = front();
+            size_t length = std::min(bytes, buffer.getActiveSize());
+            buffer.readCompleted(length);
+            bytes -= length;
+            if (!buffer.getActiveSize()) {
+                pop_front();
+            }
+        }
+    }
+
+    void pop_back() {
+        _buffers.pop_back();
+        if (_head == _buffers.size()) {
+            _buffers.clear();
+            _head = 0;
+        }
+    }
+
+    bool spilled() const {
+        return _buffers.capacity() > InlineCapacity;
+    }
+
+    void trim() {
+        if (empty() && spilled()) {
+            // small_vector never returns to its inline slot once it has grown, so rebuild it in place
+            _buffers.~ContainerType();
+            new (&_buffers) ContainerType();
+        }
+    }
+
+    size_t getMemoryUsage() const;
+
+    static constexpr size_t InlineCapacity = 1;
+protected:
+    ContainerType _buffers;
+    size_t _head{0};
+};
+
+
 class NET4CXX_COMMON_API Connection {
 public:
     Connection(const ProtocolPtr &protocol, Reactor *reactor)
@@ -316,23 +929,71 @@ public:
 
     virtual unsigned short getRemotePort() const = 0;
 
+    /// Stops delivering data, so that it piles up on the transport's side and flow control pushes back on the peer.
+    ///
+    /// A read already in progress still delivers its data. The base implementation only records the state.
+    virtual void pauseReading() {
+        _readPaused = true;
+    }
+
+    virtual void resumeReading() {
+        _readPaused = false;
+    }
+
+    /// Whether pauseReading really stops reads, rather than only recording that it was called.
+    virtual bool canPauseReading() const {
+        return false;
+    }
+
+    bool isReadingPaused() const {
+        return _readPaused;
+    }
+
+    /// Charges every read from now on to limiter; once it runs dry the transport holds data back until it refills.
+    void addRateLimiter(RateLimiterPtr limiter) {
+        _rateLimiters.emplace_back(std::move(limiter));
+    }
+
     Reactor* reactor() {
         return _reactor;
     }
+
+    ProtocolPtr getProtocol() const {
+        return _protocol.lock();
+    }
+
+    size_t getMemoryUsage() const {
+        return _readBuffer.getBufferSize() + _writeQueue.getMemoryUsage();
+    }
+
+    uint64 getBytesReceived() const {
+        return _bytesReceived;
+    }
 protected:
     void dataReceived(Byte *data, size_t length);
 
-    void connectionLost(std::exception_ptr reason);
+    void connectionLost(const DisconnectReason &reason);
+
+    void trimLater(std::weak_ptr<Connection> connection);
+
+    void trimMemory();
+
+    Duration getRateLimitDelay() const;
 
     std::weak_ptr<Protocol> _protocol;
     Reactor *_reactor{nullptr};
-    MessageBuffer _readBuffer;
-    std::deque<MessageBuffer> _writeQueue;
+    MessageBuffer _readBuffer{0};
+    WriteQueue _writeQueue;
+    boost::container::small_vector<RateLimiterPtr, 2> _rateLimiters;
+    uint64 _bytesReceived{0};
     bool _reading{false};
+    bool _readPaused{false};
     bool _writing{false};
     bool _connected{false};
     bool _disconnected{false};
     bool _disconnecting{false};
+    bool _trimPending{false};
+    bool _recentlyActive{false};
 };
 
 using ConnectionPtr = std::shared_ptr<Connection>;
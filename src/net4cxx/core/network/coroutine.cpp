@@ -0,0 +1,244 @@
+//
+// Created by yuwenyong on 17-11-27.
+//
+
+#include "net4cxx/core/network/coroutine.h"
+#include "net4cxx/core/network/endpoints.h"
+
+#if defined(__SANITIZE_ADDRESS__)
+#define NET4CXX_COROUTINE_ASAN
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define NET4CXX_COROUTINE_ASAN
+#endif
+#endif
+
+#ifdef NET4CXX_COROUTINE_ASAN
+#include <sanitizer/common_interface_defs.h>
+#endif
+
+NS_BEGIN
+
+thread_local Coroutine* Coroutine::_current = nullptr;
+
+Coroutine::~Coroutine() {
+    if (_fiber) {
+        // Unwinds the suspended stack; the coroutine announces the switch back from its forced_unwind handler.
+        void *fakeStack = nullptr;
+        startSwitch(&fakeStack, _stackBottom, _stackSize);
+        _fiber = FiberType();
+        finishSwitch(fakeStack, nullptr, nullptr);
+    }
+}
+
+void Coroutine::resume() {
+    BOOST_ASSERT(_current != this);
+    if (_finished || !_fiber) {
+        return;
+    }
+    auto self = shared_from_this();
+    Coroutine *oldCurrent = _current;
+    _current = this;
+    void *fakeStack = nullptr;
+    startSwitch(&fakeStack, _stackBottom, _stackSize);
+    _fiber = std::move(_fiber).resume();
+    finishSwitch(fakeStack, nullptr, nullptr);
+    _current = oldCurrent;
+}
+
+void Coroutine::suspend() {
+    BOOST_ASSERT(_current == this);
+    startSwitch(&_fakeStack, _callerStackBottom, _callerStackSize);
+    try {
+        _caller = std::move(_caller).resume();
+    } catch (boost::context::detail::forced_unwind &) {
+        finishSwitch(_fakeStack, &_callerStackBottom, &_callerStackSize);
+        throw;
+    }
+    finishSwitch(_fakeStack, &_callerStackBottom, &_callerStackSize);
+}
+
+void Coroutine::sleep(double seconds) {
+    Coroutine *coroutine = current();
+    if (!coroutine) {
+        NET4CXX_THROW_EXCEPTION(Exception, "Can't sleep outside a coroutine");
+    }
+    coroutine->_reactor->callLater(seconds, [self=coroutine->shared_from_this()]() {
+        self->resume();
+    });
+    coroutine->suspend();
+}
+
+void Coroutine::startSwitch(void **fakeStack, const void *stackBottom, size_t stackSize) {
+#ifdef NET4CXX_COROUTINE_ASAN
+    __sanitizer_start_switch_fiber(fakeStack, stackBottom, stackSize);
+#endif
+}
+
+void Coroutine::finishSwitch(void *fakeStack, const void **stackBottom, size_t *stackSize) {
+#ifdef NET4CXX_COROUTINE_ASAN
+    __sanitizer_finish_switch_fiber(fakeStack, stackBottom, stackSize);
+#endif
+}
+
+
+class CoStreamFactory: public ClientFactory {
+public:
+    struct State {
+        CoroutinePtr waiter;
+        // Weak so the connector, which owns this factory, does not keep the stream alive.
+        std::weak_ptr<CoStream> stream;
+        std::exception_ptr error;
+    };
+
+    explicit CoStreamFactory(std::shared_ptr<State> state)
+            : _state(std::move(state)) {
+
+    }
+
+    ProtocolPtr buildProtocol(const Address &address) override {
+        auto stream = std::make_shared<CoStream>();
+        stream->_driven = true;
+        stream->_waiter = std::move(_state->waiter);
+        _state->stream = stream;
+        return stream;
+    }
+
+    void clientConnectionFailed(ConnectorPtr connector, std::exception_ptr reason) override {
+        _state->error = reason ? reason : NET4CXX_EXCEPTION_PTR(ConnectionAbort, "Connect failed");
+        if (_state->waiter) {
+            connector->reactor()->addCallback([waiter=std::move(_state->waiter)]() {
+                waiter->resume();
+            });
+        }
+    }
+protected:
+    std::shared_ptr<State> _state;
+};
+
+
+void CoStream::connectionMade() {
+    if (_driven) {
+        wakeUp();
+    } else {
+        Coroutine::spawn(reactor(), [self=shared_from_this()]() {
+            self->run();
+        });
+    }
+}
+
+void CoStream::dataReceived(Byte *data, size_t length) {
+    if (!_buffer.getActiveSize()) {
+        _buffer.reset();
+    } else if (_buffer.getRemainingSpace() < length) {
+        _buffer.normalize();
+    }
+    _buffer.ensureFreeSpace(length);
+    _buffer.write(data, length);
+    wakeUp();
+}
+
+void CoStream::connectionLost(const DisconnectReason &reason) {
+    _lost = true;
+    _reason = reason;
+    wakeUp();
+}
+
+std::string CoStream::readExactly(size_t length) {
+    while (_buffer.getActiveSize() < length) {
+        waitData();
+    }
+    std::string data((const char *)_buffer.getReadPointer(), length);
+    _buffer.readCompleted(length);
+    return data;
+}
+
+std::string CoStream::readUntil(const std::string &delimiter, size_t maxLength) {
+    size_t searched = 0;
+    while (true) {
+        const char *begin = (const char *)_buffer.getReadPointer();
+        const char *end = begin + _buffer.getActiveSize();
+        const char *found = std::search(begin + searched, end, delimiter.begin(), delimiter.end());
+        if (found != end) {
+            size_t length = (size_t)(found - begin) + delimiter.size();
+            std::string data(begin, length);
+            _buffer.readCompleted(length);
+            return data;
+        }
+        if (_buffer.getActiveSize() >= maxLength) {
+            NET4CXX_THROW_EXCEPTION(ValueError, "Delimiter not found within " + std::to_string(maxLength) + " bytes");
+        }
+        // Only the tail that might hold a partial delimiter needs another look.
+        searched = _buffer.getActiveSize() < delimiter.size() ? 0 : _buffer.getActiveSize() - delimiter.size() + 1;
+        waitData();
+    }
+}
+
+std::string CoStream::readSome() {
+    while (!_buffer.getActiveSize()) {
+        waitData();
+    }
+    std::string data((const char *)_buffer.getReadPointer(), _buffer.getActiveSize());
+    _buffer.reset();
+    return data;
+}
+
+std::shared_ptr<CoStream> CoStream::connect(const std::string &description) {
+    return waitConnected([&description](Reactor *reactor, std::unique_ptr<ClientFactory> &&factory) {
+        clientFromString(reactor, description)->connect(std::move(factory));
+    });
+}
+
+std::shared_ptr<CoStream> CoStream::connectTCP(const std::string &host, const std::string &port, double timeout) {
+    return waitConnected([&](Reactor *reactor, std::unique_ptr<ClientFactory> &&factory) {
+        reactor->connectTCP(host, port, std::move(factory), timeout);
+    });
+}
+
+void CoStream::run() {
+
+}
+
+std::shared_ptr<CoStream> CoStream::waitConnected(const ConnectFunc &connectFunc) {
+    Coroutine *coroutine = Coroutine::current();
+    if (!coroutine) {
+        NET4CXX_THROW_EXCEPTION(Exception, "Can't connect outside a coroutine");
+    }
+    auto state = std::make_shared<CoStreamFactory::State>();
+    state->waiter = coroutine->shared_from_this();
+    connectFunc(coroutine->reactor(), std::make_unique<CoStreamFactory>(state));
+    coroutine->suspend();
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+    auto stream = state->stream.lock();
+    BOOST_ASSERT(stream);
+    if (stream->_lost) {
+        stream->waitData();
+    }
+    return stream;
+}
+
+void CoStream::waitData() {
+    if (_lost) {
+        if (_reason.isClean()) {
+            NET4CXX_THROW_EXCEPTION(ConnectionDone, "Connection was closed cleanly");
+        }
+        auto error = _reason.getException();
+        if (!error) {
+            NET4CXX_THROW_EXCEPTION(ConnectionAbort, "Connection was lost");
+        }
+        std::rethrow_exception(error);
+    }
+    Coroutine *coroutine = Coroutine::current();
+    if (!coroutine) {
+        NET4CXX_THROW_EXCEPTION(Exception, "Can't read outside a coroutine");
+    }
+    if (_waiter) {
+        NET4CXX_THROW_EXCEPTION(AlreadyExist, "Another coroutine is already reading");
+    }
+    _waiter = coroutine->shared_from_this();
+    coroutine->suspend();
+}
+
+NS_END
@@ -0,0 +1,208 @@
+//
+// Created by yuwenyong on 17-11-27.
+//
+
+#ifndef NET4CXX_CORE_NETWORK_COROUTINE_H
+#define NET4CXX_CORE_NETWORK_COROUTINE_H
+
+#include "net4cxx/common/common.h"
+#include <boost/context/fiber.hpp>
+#include "net4cxx/core/network/protocol.h"
+#include "net4cxx/core/network/reactor.h"
+
+NS_BEGIN
+
+
+/// Stackful coroutine bound to a reactor.
+///
+/// The language level is C++14, so coroutines run on Boost.Context fibers instead of co_await; a blocking-looking
+/// call such as CoStream::readExactly suspends the fiber and the reactor resumes it from the handler that completes
+/// the wait. Stacks come from the reactor's pooled allocator and return to it when the coroutine finishes.
+class NET4CXX_COMMON_API Coroutine: public std::enable_shared_from_this<Coroutine> {
+public:
+    using FiberType = boost::context::fiber;
+
+    /// Holds its own reference to the reactor's pool, so a coroutine may outlive the reactor, and records where the
+    /// stack lives for the sanitizer.
+    class StackAllocator {
+    public:
+        StackAllocator(const Reactor::CoroutineStacks &stacks, Coroutine *owner)
+                : _stacks(stacks)
+                , _owner(owner) {
+
+        }
+
+        boost::context::stack_context allocate() {
+            boost::context::stack_context stack = _stacks.allocate();
+            _owner->_stackBottom = (const char *)stack.sp - stack.size;
+            _owner->_stackSize = stack.size;
+            return stack;
+        }
+
+        void deallocate(boost::context::stack_context &stack) noexcept {
+            _stacks.deallocate(stack);
+        }
+    protected:
+        Reactor::CoroutineStacks _stacks;
+        Coroutine *_owner;
+    };
+
+    explicit Coroutine(Reactor *reactor)
+            : _reactor(reactor) {
+
+    }
+
+    ~Coroutine();
+
+    Coroutine(const Coroutine&) = delete;
+    Coroutine& operator=(const Coroutine&) = delete;
+
+    /// Queues func to start on the reactor; the returned handle may be dropped.
+    template <typename FuncT>
+    static std::shared_ptr<Coroutine> spawn(Reactor *reactor, FuncT &&func) {
+        auto coroutine = std::make_shared<Coroutine>(reactor);
+        coroutine->start(std::forward<FuncT>(func));
+        reactor->addCallback([coroutine]() {
+            coroutine->resume();
+        });
+        return coroutine;
+    }
+
+    Reactor* reactor() {
+        return _reactor;
+    }
+
+    bool finished() const {
+        return _finished;
+    }
+
+    void resume();
+
+    /// Gives control back to whoever resumed the coroutine; only valid inside it.
+    void suspend();
+
+    /// Suspends the current coroutine for the given number of seconds.
+    static void sleep(double seconds);
+
+    static Coroutine* current() {
+        return _current;
+    }
+protected:
+    template <typename FuncT>
+    void start(FuncT &&func) {
+        _fiber = FiberType(std::allocator_arg, StackAllocator(_reactor->getCoroutineStacks(), this),
+                           [this, func=std::forward<FuncT>(func)](FiberType &&caller) mutable {
+            _caller = std::move(caller);
+            enter();
+            run(func);
+            return leave();
+        });
+    }
+
+    template <typename FuncT>
+    void run(FuncT &func) {
+        try {
+            func();
+        } catch (boost::context::detail::forced_unwind &) {
+            startSwitch(nullptr, _callerStackBottom, _callerStackSize);
+            throw;
+        } catch (std::exception &e) {
+            NET4CXX_ERROR(gAppLog, "Unexpected Exception:%s", e.what());
+        } catch (...) {
+            NET4CXX_ERROR(gAppLog, "Unknown Exception");
+        }
+        _finished = true;
+    }
+
+    void enter() {
+        finishSwitch(nullptr, &_callerStackBottom, &_callerStackSize);
+    }
+
+    FiberType leave() {
+        startSwitch(nullptr, _callerStackBottom, _callerStackSize);
+        return std::move(_caller);
+    }
+
+    static void startSwitch(void **fakeStack, const void *stackBottom, size_t stackSize);
+
+    static void finishSwitch(void *fakeStack, const void **stackBottom, size_t *stackSize);
+
+    Reactor *_reactor;
+    FiberType _fiber;
+    FiberType _caller;
+    bool _finished{false};
+    const void *_stackBottom{nullptr};
+    size_t _stackSize{0};
+    const void *_callerStackBottom{nullptr};
+    size_t _callerStackSize{0};
+    void *_fakeStack{nullptr};
+    thread_local static Coroutine *_current;
+};
+
+using CoroutinePtr = std::shared_ptr<Coroutine>;
+
+
+/// Protocol read from a coroutine.
+///
+/// Subclasses override run(), which is spawned once the connection is made; streams returned by connect() are
+/// driven by the coroutine that connected them instead. Incoming data is kept in one buffer that the read calls
+/// consume in place. A read that cannot be satisfied suspends the calling coroutine until more data arrives; if the
+/// connection goes away first it throws the disconnect reason, or ConnectionDone for a clean close.
+class NET4CXX_COMMON_API CoStream: public Protocol, public std::enable_shared_from_this<CoStream> {
+public:
+    CoStream()
+            : _buffer(0) {
+
+    }
+
+    void connectionMade() override;
+
+    void dataReceived(Byte *data, size_t length) override;
+
+    void connectionLost(const DisconnectReason &reason) override;
+
+    using Protocol::connectionLost;
+
+    std::string readExactly(size_t length);
+
+    std::string readUntil(const std::string &delimiter, size_t maxLength=65536);
+
+    /// Returns whatever is buffered, waiting for at least one byte.
+    std::string readSome();
+
+    bool connected() const {
+        return _connected && !_lost;
+    }
+
+    static std::shared_ptr<CoStream> connect(const std::string &description);
+
+    static std::shared_ptr<CoStream> connectTCP(const std::string &host, const std::string &port,
+                                                double timeout=30.0);
+protected:
+    using ConnectFunc = std::function<void (Reactor *, std::unique_ptr<ClientFactory> &&)>;
+
+    virtual void run();
+
+    static std::shared_ptr<CoStream> waitConnected(const ConnectFunc &connectFunc);
+
+    void waitData();
+
+    void wakeUp() {
+        if (_waiter) {
+            auto waiter = std::move(_waiter);
+            waiter->resume();
+        }
+    }
+
+    friend class CoStreamFactory;
+
+    MessageBuffer _buffer;
+    CoroutinePtr _waiter;
+    bool _lost{false};
+    bool _driven{false};
+    DisconnectReason _reason;
+};
+
+NS_END
+
+#endif //NET4CXX_CORE_NETWORK_COROUTINE_H
@@ -0,0 +1,58 @@
+//
+// Created by yuwenyong on 17-11-28.
+//
+
+#include "net4cxx/core/network/defer.h"
+#include "net4cxx/core/network/endpoints.h"
+
+
+NS_BEGIN
+
+void logUnhandledDeferredError(std::exception_ptr error) {
+    try {
+        std::rethrow_exception(error);
+    } catch (std::exception &e) {
+        NET4CXX_ERROR(gGenLog, "Unhandled error in Deferred:%s", e.what());
+    } catch (...) {
+        NET4CXX_ERROR(gGenLog, "Unhandled error in Deferred");
+    }
+}
+
+
+/// Gives up its references once the protocol is built, so the connector owning it does not keep the protocol alive.
+class DeferredProtocolFactory: public ClientFactory {
+public:
+    DeferredProtocolFactory(ProtocolPtr protocol, Deferred<ProtocolPtr> deferred)
+            : _protocol(std::move(protocol))
+            , _deferred(std::move(deferred)) {
+
+    }
+
+    ProtocolPtr buildProtocol(const Address &address) override {
+        BOOST_ASSERT(_protocol);
+        Reactor *reactor = _deferred.reactor();
+        // The transport calls connectionMade right after this returns; fire once it has.
+        reactor->addCallback([deferred=std::move(_deferred), protocol=_protocol]() mutable {
+            deferred.callback(std::move(protocol));
+        });
+        return std::move(_protocol);
+    }
+
+    void clientConnectionFailed(ConnectorPtr connector, std::exception_ptr reason) override {
+        if (_deferred && !_deferred.called()) {
+            _deferred.errback(reason ? reason : NET4CXX_EXCEPTION_PTR(ConnectionAbort, "Connect failed"));
+        }
+    }
+protected:
+    ProtocolPtr _protocol;
+    Deferred<ProtocolPtr> _deferred;
+};
+
+
+Deferred<ProtocolPtr> connectProtocol(ClientEndpoint &endpoint, ProtocolPtr protocol) {
+    Deferred<ProtocolPtr> deferred(endpoint.reactor());
+    endpoint.connect(std::make_unique<DeferredProtocolFactory>(std::move(protocol), deferred));
+    return deferred;
+}
+
+NS_END
@@ -0,0 +1,473 @@
+//
+// Created by yuwenyong on 17-11-28.
+//
+
+#ifndef NET4CXX_CORE_NETWORK_DEFER_H
+#define NET4CXX_CORE_NETWORK_DEFER_H
+
+#include "net4cxx/common/common.h"
+#include <boost/optional.hpp>
+#include "net4cxx/common/global/loggers.h"
+#include "net4cxx/core/network/protocol.h"
+#include "net4cxx/core/network/reactor.h"
+
+NS_BEGIN
+
+
+NET4CXX_DECLARE_EXCEPTION(AlreadyCalledError, Exception);
+
+
+class ClientEndpoint;
+
+template <typename ResultT>
+class Deferred;
+
+template <typename ResultT>
+class DeferredState;
+
+
+template <typename ResultT>
+class DeferredLink {
+public:
+    virtual ~DeferredLink() = default;
+
+    virtual void run(DeferredState<ResultT> &state) = 0;
+
+    virtual void destroy(DeferredPool &pool) = 0;
+
+    DeferredLink *_next{nullptr};
+};
+
+
+template <typename ResultT, typename CallbackT>
+class DeferredLinkImpl: public DeferredLink<ResultT> {
+public:
+    template <typename ArgT>
+    explicit DeferredLinkImpl(ArgT &&callback)
+            : _callback(std::forward<ArgT>(callback)) {
+
+    }
+
+    void run(DeferredState<ResultT> &state) override {
+        _callback(state);
+    }
+
+    void destroy(DeferredPool &pool) override {
+        this->~DeferredLinkImpl();
+        pool.deallocate(this, sizeof(DeferredLinkImpl));
+    }
+protected:
+    CallbackT _callback;
+};
+
+
+NET4CXX_COMMON_API void logUnhandledDeferredError(std::exception_ptr error);
+
+
+template <typename ResultT>
+class DeferredState {
+public:
+    explicit DeferredState(Reactor *reactor)
+            : _reactor(reactor) {
+
+    }
+
+    ~DeferredState() {
+        DeferredPool &pool = _reactor->getDeferredPool();
+        while (_head) {
+            DeferredLink<ResultT> *next = _head->_next;
+            _head->destroy(pool);
+            _head = next;
+        }
+        if (_error && !_errorHandled) {
+            logUnhandledDeferredError(_error);
+        }
+    }
+
+    void setValue(ResultT &&value) {
+        _value.emplace(std::move(value));
+        _error = nullptr;
+    }
+
+    void setError(std::exception_ptr error) {
+        _value = boost::none;
+        _error = std::move(error);
+        _errorHandled = false;
+    }
+
+    Reactor *_reactor;
+    size_t _refs{0};
+    boost::optional<ResultT> _value;
+    std::exception_ptr _error;
+    bool _errorHandled{false};
+    bool _called{false};
+    bool _running{false};
+    DeferredLink<ResultT> *_head{nullptr};
+    DeferredLink<ResultT> *_tail{nullptr};
+    DelayedCall _timeout;
+};
+
+
+template <typename ValueT>
+struct DeferredTraits {
+    using ResultType = ValueT;
+
+    template <typename NextT>
+    static void chain(NextT &next, ValueT &&value) {
+        next.callback(std::move(value));
+    }
+};
+
+
+template <typename ValueT>
+struct DeferredTraits<Deferred<ValueT>> {
+    using ResultType = ValueT;
+
+    template <typename NextT>
+    static void chain(NextT &next, Deferred<ValueT> &&inner) {
+        inner.addCallbacks([next](ValueT &value) mutable {
+            next.callback(std::move(value));
+        }, [next](std::exception_ptr error) mutable {
+            next.errback(error);
+        });
+    }
+};
+
+
+/// Twisted-style Deferred; use only on its reactor's thread, and never after the reactor is gone.
+template <typename ResultT>
+class Deferred {
+public:
+    template <typename OtherT>
+    friend class Deferred;
+
+    using ResultType = ResultT;
+    using StateType = DeferredState<ResultT>;
+
+    Deferred() = default;
+
+    explicit Deferred(Reactor *reactor) {
+        void *storage = reactor->getDeferredPool().allocate(sizeof(StateType));
+        _state = new (storage) StateType(reactor);
+        _state->_refs = 1;
+    }
+
+    Deferred(const Deferred &rhs)
+            : _state(rhs._state) {
+        if (_state) {
+            ++_state->_refs;
+        }
+    }
+
+    Deferred(Deferred &&rhs) noexcept
+            : _state(rhs._state) {
+        rhs._state = nullptr;
+    }
+
+    Deferred& operator=(const Deferred &rhs) {
+        Deferred(rhs).swap(*this);
+        return *this;
+    }
+
+    Deferred& operator=(Deferred &&rhs) noexcept {
+        Deferred(std::move(rhs)).swap(*this);
+        return *this;
+    }
+
+    ~Deferred() {
+        if (_state && --_state->_refs == 0) {
+            Reactor *reactor = _state->_reactor;
+            _state->~StateType();
+            reactor->getDeferredPool().deallocate(_state, sizeof(StateType));
+        }
+    }
+
+    void swap(Deferred &rhs) noexcept {
+        std::swap(_state, rhs._state);
+    }
+
+    explicit operator bool() const {
+        return _state != nullptr;
+    }
+
+    Reactor* reactor() const {
+        BOOST_ASSERT(_state);
+        return _state->_reactor;
+    }
+
+    bool called() const {
+        BOOST_ASSERT(_state);
+        return _state->_called;
+    }
+
+    void callback(ResultT value) {
+        startFiring();
+        _state->setValue(std::move(value));
+        runCallbacks();
+    }
+
+    void errback(std::exception_ptr error) {
+        BOOST_ASSERT(error);
+        startFiring();
+        _state->setError(std::move(error));
+        runCallbacks();
+    }
+
+    /// callback takes ResultT& and may change it in place; errback takes std::exception_ptr.
+    template <typename CallbackT, typename ErrbackT>
+    Deferred& addCallbacks(CallbackT &&callback, ErrbackT &&errback) {
+        using ErrbackType = typename std::decay<ErrbackT>::type;
+        using ObserveOnly = typename std::is_void<typename std::result_of<ErrbackType &(std::exception_ptr)>::type>;
+        appendLink([callback=std::forward<CallbackT>(callback), errback=std::forward<ErrbackT>(errback)](
+                StateType &state) mutable {
+            if (state._error) {
+                runErrback(state, errback, ObserveOnly{});
+            } else {
+                try {
+                    callback(*state._value);
+                } catch (...) {
+                    state.setError(std::current_exception());
+                }
+            }
+        });
+        return *this;
+    }
+
+    template <typename CallbackT>
+    Deferred& addCallback(CallbackT &&callback) {
+        BOOST_ASSERT(_state);
+        appendLink([callback=std::forward<CallbackT>(callback)](StateType &state) mutable {
+            if (!state._error) {
+                try {
+                    callback(*state._value);
+                } catch (...) {
+                    state.setError(std::current_exception());
+                }
+            }
+        });
+        return *this;
+    }
+
+    template <typename ErrbackT>
+    Deferred& addErrback(ErrbackT &&errback) {
+        using ErrbackType = typename std::decay<ErrbackT>::type;
+        using ObserveOnly = typename std::is_void<typename std::result_of<ErrbackType &(std::exception_ptr)>::type>;
+        BOOST_ASSERT(_state);
+        appendLink([errback=std::forward<ErrbackT>(errback)](StateType &state) mutable {
+            if (state._error) {
+                runErrback(state, errback, ObserveOnly{});
+            }
+        });
+        return *this;
+    }
+
+    /// func takes ResultT& and returns a value or a Deferred of one.
+    template <typename FuncT>
+    auto then(FuncT &&func) -> Deferred<typename DeferredTraits<typename std::result_of<
+            typename std::decay<FuncT>::type &(ResultT &)>::type>::ResultType> {
+        using ReturnType = typename std::result_of<typename std::decay<FuncT>::type &(ResultT &)>::type;
+        using TraitsType = DeferredTraits<ReturnType>;
+        static_assert(!std::is_void<ReturnType>::value, "then() requires a function that returns a value");
+        Deferred<typename TraitsType::ResultType> next(reactor());
+        appendLink([next, func=std::forward<FuncT>(func)](StateType &state) mutable {
+            if (state._error) {
+                state._errorHandled = true;
+                next.errback(state._error);
+                return;
+            }
+            try {
+                TraitsType::chain(next, func(*state._value));
+            } catch (...) {
+                if (!next.called()) {
+                    next.errback(std::current_exception());
+                }
+            }
+        });
+        return next;
+    }
+
+    /// Fails the Deferred with TimeoutError unless it fires within the given number of seconds.
+    Deferred& addTimeout(double seconds) {
+        BOOST_ASSERT(_state);
+        if (_state->_called) {
+            return *this;
+        }
+        _state->_timeout = reactor()->callLater(seconds, [self=*this]() {
+            Deferred deferred(self);
+            if (!deferred.called()) {
+                deferred.errback(NET4CXX_EXCEPTION_PTR(TimeoutError, "Deferred timed out"));
+            }
+        });
+        return *this;
+    }
+
+    static Deferred succeed(Reactor *reactor, ResultT value) {
+        Deferred deferred(reactor);
+        deferred.callback(std::move(value));
+        return deferred;
+    }
+
+    static Deferred fail(Reactor *reactor, std::exception_ptr error) {
+        Deferred deferred(reactor);
+        deferred.errback(std::move(error));
+        return deferred;
+    }
+protected:
+    template <typename ErrbackT>
+    static void runErrback(StateType &state, ErrbackT &errback, std::true_type) {
+        state._errorHandled = true;
+        try {
+            errback(state._error);
+        } catch (...) {
+            state.setError(std::current_exception());
+        }
+    }
+
+    template <typename ErrbackT>
+    static void runErrback(StateType &state, ErrbackT &errback, std::false_type) {
+        state._errorHandled = true;
+        try {
+            state.setValue(errback(state._error));
+        } catch (...) {
+            state.setError(std::current_exception());
+        }
+    }
+
+    void startFiring() {
+        BOOST_ASSERT(_state);
+        if (_state->_called) {
+            NET4CXX_THROW_EXCEPTION(AlreadyCalledError, "Deferred already fired");
+        }
+        _state->_called = true;
+        if (!_state->_timeout.cancelled()) {
+            _state->_timeout.cancel();
+        }
+    }
+
+    template <typename CallbackT>
+    void appendLink(CallbackT &&callback) {
+        using LinkType = DeferredLinkImpl<ResultT, typename std::decay<CallbackT>::type>;
+        void *storage = reactor()->getDeferredPool().allocate(sizeof(LinkType));
+        DeferredLink<ResultT> *link;
+        try {
+            link = new (storage) LinkType(std::forward<CallbackT>(callback));
+        } catch (...) {
+            reactor()->getDeferredPool().deallocate(storage, sizeof(LinkType));
+            throw;
+        }
+        if (_state->_tail) {
+            _state->_tail->_next = link;
+        } else {
+            _state->_head = link;
+        }
+        _state->_tail = link;
+        if (_state->_called) {
+            runCallbacks();
+        }
+    }
+
+    void runCallbacks() {
+        // A callback adding to this chain appends to the running loop instead of starting another one.
+        if (_state->_running) {
+            return;
+        }
+        Deferred self(*this);
+        DeferredPool &pool = reactor()->getDeferredPool();
+        _state->_running = true;
+        while (DeferredLink<ResultT> *link = _state->_head) {
+            _state->_head = link->_next;
+            if (!_state->_head) {
+                _state->_tail = nullptr;
+            }
+            link->run(*_state);
+            link->destroy(pool);
+        }
+        _state->_running = false;
+    }
+
+    StateType *_state{nullptr};
+};
+
+
+/// Fires with all results, moved out in order, or with the first error.
+template <typename ResultT>
+Deferred<std::vector<ResultT>> gatherResults(Reactor *reactor, const std::vector<Deferred<ResultT>> &deferreds) {
+    struct Gather {
+        std::vector<boost::optional<ResultT>> values;
+        size_t remaining;
+    };
+    Deferred<std::vector<ResultT>> result(reactor);
+    if (deferreds.empty()) {
+        result.callback({});
+        return result;
+    }
+    auto gather = std::make_shared<Gather>();
+    gather->values.resize(deferreds.size());
+    gather->remaining = deferreds.size();
+    for (size_t i = 0; i != deferreds.size(); ++i) {
+        Deferred<ResultT> deferred(deferreds[i]);
+        deferred.addCallbacks([gather, result, i](ResultT &value) mutable {
+            gather->values[i].emplace(std::move(value));
+            if (--gather->remaining == 0 && !result.called()) {
+                std::vector<ResultT> values;
+                values.reserve(gather->values.size());
+                for (auto &item: gather->values) {
+                    values.emplace_back(std::move(*item));
+                }
+                result.callback(std::move(values));
+            }
+        }, [result](std::exception_ptr error) mutable {
+            if (!result.called()) {
+                result.errback(error);
+            }
+        });
+    }
+    return result;
+}
+
+
+/// Calls func after the given number of seconds and fires with what it returns or throws.
+template <typename FuncT>
+auto deferLater(Reactor *reactor, double seconds, FuncT &&func) -> Deferred<typename std::result_of<
+        typename std::decay<FuncT>::type &()>::type> {
+    using ResultType = typename std::result_of<typename std::decay<FuncT>::type &()>::type;
+    Deferred<ResultType> deferred(reactor);
+    // The timer runs its callback as const, so both are called through copies.
+    reactor->callLater(seconds, [deferred, func=std::forward<FuncT>(func)]() {
+        Deferred<ResultType> result(deferred);
+        auto call = func;
+        boost::optional<ResultType> value;
+        try {
+            value.emplace(call());
+        } catch (...) {
+            result.errback(std::current_exception());
+            return;
+        }
+        result.callback(std::move(*value));
+    });
+    return deferred;
+}
+
+
+template <typename FuncT>
+auto deferToThread(Reactor *reactor, FuncT &&func) -> Deferred<typename std::result_of<
+        typename std::decay<FuncT>::type &()>::type> {
+    using ResultType = typename std::result_of<typename std::decay<FuncT>::type &()>::type;
+    Deferred<ResultType> deferred(reactor);
+    reactor->deferToThread(std::forward<FuncT>(func), [deferred](ThreadResult<ResultType> &result) mutable {
+        if (result.failed()) {
+            deferred.errback(result.getError());
+        } else {
+            deferred.callback(std::move(result.get()));
+        }
+    });
+    return deferred;
+}
+
+
+/// Connects protocol through endpoint and fires with it once connectionMade has run.
+NET4CXX_COMMON_API Deferred<ProtocolPtr> connectProtocol(ClientEndpoint &endpoint, ProtocolPtr protocol);
+
+NS_END
+
+#endif //NET4CXX_CORE_NETWORK_DEFER_H
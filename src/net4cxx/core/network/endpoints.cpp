@@ -5,6 +5,7 @@
 #include "net4cxx/core/network/endpoints.h"
 #include <boost/algorithm/string.hpp>
 #include "net4cxx/common/utilities/strutil.h"
+#include "net4cxx/common/utilities/util.h"
 #include "net4cxx/core/network/protocol.h"
 #include "net4cxx/core/network/reactor.h"
 
@@ -28,6 +29,18 @@ ListenerPtr UNIXServerEndpoint::listen(std::unique_ptr<Factory> &&protocolFactor
 
 #endif
 
+ListenerPtr LoopbackServerEndpoint::listen(std::unique_ptr<Factory> &&protocolFactory) const {
+    return _reactor->listenLoopback(_name, std::move(protocolFactory));
+}
+
+#ifdef NET4CXX_HAS_SHM_TRANSPORT
+
+ListenerPtr SHMServerEndpoint::listen(std::unique_ptr<Factory> &&protocolFactory) const {
+    return _reactor->listenSHM(_path, std::move(protocolFactory), _capacity, _busyPoll);
+}
+
+#endif
+
 std::unique_ptr<ServerEndpoint> _parseTCP(Reactor *reactor, const StringVector &args, const StringMap &params) {
     std::string port = args[0];
     std::string interface;
@@ -52,6 +65,40 @@ std::unique_ptr<ServerEndpoint> _parseSSL(Reactor *reactor, const StringVector &
     if (!certKey.empty()) {
         sslParams.setCertFile(certKey);
     }
+    decltype(params.begin()) iter;
+    if ((iter = params.find("sessionCacheSize")) != params.end()) {
+        sslParams.setSessionCacheSize(std::stoul(iter->second));
+    }
+    if ((iter = params.find("sessionTimeout")) != params.end()) {
+        sslParams.setSessionTimeout(std::stol(iter->second));
+    }
+    if ((iter = params.find("sessionTickets")) != params.end()) {
+        sslParams.setSessionTickets(StringToBool(iter->second));
+    }
+    if ((iter = params.find("ticketKeyRotation")) != params.end()) {
+        sslParams.setTicketKeyRotation(std::stol(iter->second));
+    }
+    if ((iter = params.find("sessionCache")) != params.end()) {
+        sslParams.setSessionCacheName(iter->second);
+    }
+    if ((iter = params.find("handshakeThreads")) != params.end()) {
+        sslParams.setHandshakeThreads(std::stoul(iter->second));
+    }
+    if ((iter = params.find("handshakeQueueLimit")) != params.end()) {
+        sslParams.setHandshakeQueueLimit(std::stoul(iter->second));
+    }
+    if ((iter = params.find("kernelTLS")) != params.end()) {
+        sslParams.setKernelTLS(StringToBool(iter->second));
+    }
+    if ((iter = params.find("initialRecordSize")) != params.end()) {
+        sslParams.setInitialRecordSize(std::stoul(iter->second));
+    }
+    if ((iter = params.find("recordSizeBoost")) != params.end()) {
+        sslParams.setRecordSizeBoost(std::stoul(iter->second));
+    }
+    if ((iter = params.find("recordSizeIdle")) != params.end()) {
+        sslParams.setRecordSizeIdle(std::stod(iter->second));
+    }
     return std::make_unique<SSLServerEndpoint>(reactor, port, SSLOption::create(sslParams), std::move(interface));
 }
 
@@ -64,6 +111,29 @@ std::unique_ptr<ServerEndpoint> _parseUNIX(Reactor *reactor, const StringVector
 
 #endif
 
+std::unique_ptr<ServerEndpoint> _parseLoopback(Reactor *reactor, const StringVector &args, const StringMap &params) {
+    std::string name = args[0];
+    return std::make_unique<LoopbackServerEndpoint>(reactor, std::move(name));
+}
+
+#ifdef NET4CXX_HAS_SHM_TRANSPORT
+
+std::unique_ptr<ServerEndpoint> _parseSHM(Reactor *reactor, const StringVector &args, const StringMap &params) {
+    std::string path = args[0];
+    decltype(params.begin()) iter;
+    size_t capacity = 262144;
+    if ((iter = params.find("size")) != params.end()) {
+        capacity = std::stoul(iter->second);
+    }
+    int busyPoll = 0;
+    if ((iter = params.find("busyPoll")) != params.end()) {
+        busyPoll = std::stoi(iter->second);
+    }
+    return std::make_unique<SHMServerEndpoint>(reactor, std::move(path), capacity, busyPoll);
+}
+
+#endif
+
 void _parse(const std::string &description, StringVector &args, StringMap &params) {
     StringVector parsedArgs;
     StringMap parsedParams;
@@ -130,6 +200,14 @@ std::unique_ptr<ServerEndpoint> serverFromString(Reactor *reactor, const std::st
         return _parseUNIX(reactor, args, params);
 #else
         NET4CXX_THROW_EXCEPTION(ValueError, StrUtil::format("Unsupported endpoint type: '%s'", endpointType.c_str()));
+#endif
+    } else if (endpointType == "memory") {
+        return _parseLoopback(reactor, args, params);
+    } else if (endpointType == "shm") {
+#ifdef NET4CXX_HAS_SHM_TRANSPORT
+        return _parseSHM(reactor, args, params);
+#else
+        NET4CXX_THROW_EXCEPTION(ValueError, StrUtil::format("Unsupported endpoint type: '%s'", endpointType.c_str()));
 #endif
     } else {
         NET4CXX_THROW_EXCEPTION(ValueError, StrUtil::format("Unknown endpoint type: '%s'", endpointType.c_str()));
@@ -154,6 +232,18 @@ ConnectorPtr UNIXClientEndpoint::connect(std::unique_ptr<ClientFactory> &&protoc
 
 #endif
 
+ConnectorPtr LoopbackClientEndpoint::connect(std::unique_ptr<ClientFactory> &&protocolFactory) const {
+    return _reactor->connectLoopback(_name, std::move(protocolFactory));
+}
+
+#ifdef NET4CXX_HAS_SHM_TRANSPORT
+
+ConnectorPtr SHMClientEndpoint::connect(std::unique_ptr<ClientFactory> &&protocolFactory) const {
+    return _reactor->connectSHM(_path, std::move(protocolFactory), _busyPoll, _timeout);
+}
+
+#endif
+
 std::unique_ptr<ClientEndpoint> _parseClientTCP(Reactor *reactor, const StringVector &args, const StringMap &params) {
     std::string host, port;
     if (args.size() == 2) {
@@ -222,6 +312,24 @@ std::unique_ptr<ClientEndpoint> _parseClientSSL(Reactor *reactor, const StringVe
         sslParams.setVerifyMode(SSLVerifyMode::CERT_REQUIRED);
         sslParams.setVerifyFile(iter->second);
     }
+    if ((iter = params.find("sessionCacheSize")) != params.end()) {
+        sslParams.setSessionCacheSize(std::stoul(iter->second));
+    }
+    if ((iter = params.find("sessionTickets")) != params.end()) {
+        sslParams.setSessionTickets(StringToBool(iter->second));
+    }
+    if ((iter = params.find("kernelTLS")) != params.end()) {
+        sslParams.setKernelTLS(StringToBool(iter->second));
+    }
+    if ((iter = params.find("initialRecordSize")) != params.end()) {
+        sslParams.setInitialRecordSize(std::stoul(iter->second));
+    }
+    if ((iter = params.find("recordSizeBoost")) != params.end()) {
+        sslParams.setRecordSizeBoost(std::stoul(iter->second));
+    }
+    if ((iter = params.find("recordSizeIdle")) != params.end()) {
+        sslParams.setRecordSizeIdle(std::stod(iter->second));
+    }
     return std::make_unique<SSLClientEndpoint>(reactor, std::move(host), std::move(port), SSLOption::create(sslParams),
                                                timeout, std::move(bindAddress));
 }
@@ -245,6 +353,40 @@ std::unique_ptr<ClientEndpoint> _parseClientUNIX(Reactor *reactor, const StringV
 
 #endif
 
+std::unique_ptr<ClientEndpoint> _parseClientLoopback(Reactor *reactor, const StringVector &args,
+                                                     const StringMap &params) {
+    std::string name;
+    if (!args.empty()) {
+        name = args[0];
+    } else {
+        name = params.at("name");
+    }
+    return std::make_unique<LoopbackClientEndpoint>(reactor, std::move(name));
+}
+
+#ifdef NET4CXX_HAS_SHM_TRANSPORT
+
+std::unique_ptr<ClientEndpoint> _parseClientSHM(Reactor *reactor, const StringVector &args, const StringMap &params) {
+    std::string path;
+    if (!args.empty()) {
+        path = args[0];
+    } else {
+        path = params.at("path");
+    }
+    decltype(params.begin()) iter;
+    int busyPoll = 0;
+    if ((iter = params.find("busyPoll")) != params.end()) {
+        busyPoll = std::stoi(iter->second);
+    }
+    double timeout = 30.0;
+    if ((iter = params.find("timeout")) != params.end()) {
+        timeout = std::stod(iter->second);
+    }
+    return std::make_unique<SHMClientEndpoint>(reactor, std::move(path), busyPoll, timeout);
+}
+
+#endif
+
 std::string _parseClient(const std::string &description, StringVector &args, StringMap &params) {
     _parse(description, args, params);
     std::string endpointType;
@@ -270,6 +412,14 @@ std::unique_ptr<ClientEndpoint> clientFromString(Reactor *reactor, const std::st
         return _parseClientUNIX(reactor, args, params);
 #else
         NET4CXX_THROW_EXCEPTION(ValueError, StrUtil::format("Unsupported endpoint type: '%s'", endpointType.c_str()));
+#endif
+    } else if (endpointType == "memory") {
+        return _parseClientLoopback(reactor, args, params);
+    } else if (endpointType == "shm") {
+#ifdef NET4CXX_HAS_SHM_TRANSPORT
+        return _parseClientSHM(reactor, args, params);
+#else
+        NET4CXX_THROW_EXCEPTION(ValueError, StrUtil::format("Unsupported endpoint type: '%s'", endpointType.c_str()));
 #endif
     } else {
         NET4CXX_THROW_EXCEPTION(ValueError, StrUtil::format("Unknown endpoint type: '%s'", endpointType.c_str()));
@@ -68,6 +68,10 @@ public:
     }
 
     ListenerPtr listen(std::unique_ptr<Factory> &&protocolFactory) const override;
+
+    const SSLOptionPtr& getSSLOption() const {
+        return _sslOption;
+    }
 protected:
     std::string _port;
     std::string _interface;
@@ -93,6 +97,42 @@ protected:
 #endif
 
 
+class NET4CXX_COMMON_API LoopbackServerEndpoint: public ServerEndpoint {
+public:
+    LoopbackServerEndpoint(Reactor *reactor, std::string name)
+            : ServerEndpoint(reactor)
+            , _name(std::move(name)) {
+
+    }
+
+    ListenerPtr listen(std::unique_ptr<Factory> &&protocolFactory) const override;
+protected:
+    std::string _name;
+};
+
+
+#ifdef NET4CXX_HAS_SHM_TRANSPORT
+
+class NET4CXX_COMMON_API SHMServerEndpoint: public ServerEndpoint {
+public:
+    SHMServerEndpoint(Reactor *reactor, std::string path, size_t capacity=262144, int busyPoll=0)
+            : ServerEndpoint(reactor)
+            , _path(std::move(path))
+            , _capacity(capacity)
+            , _busyPoll(busyPoll) {
+
+    }
+
+    ListenerPtr listen(std::unique_ptr<Factory> &&protocolFactory) const override;
+protected:
+    std::string _path;
+    size_t _capacity;
+    int _busyPoll;
+};
+
+#endif
+
+
 ///
 /// \param reactor
 /// \param description
@@ -100,6 +140,8 @@ protected:
 ///     tcp:80:interface=127.0.0.1
 ///     ssl:443:privateKey=key.pem:certKey=crt.pem
 ///     unix:/var/run/finger
+///     shm:/var/run/finger:size=1048576:busyPoll=50
+///     memory:finger
 /// \return
 NET4CXX_COMMON_API std::unique_ptr<ServerEndpoint> serverFromString(Reactor *reactor, const std::string &description);
 
@@ -146,6 +188,10 @@ public:
     }
 
     ConnectorPtr connect(std::unique_ptr<ClientFactory> &&protocolFactory) const override;
+
+    const SSLOptionPtr& getSSLOption() const {
+        return _sslOption;
+    }
 protected:
     std::string _host;
     std::string _port;
@@ -173,6 +219,40 @@ protected:
 
 #endif
 
+class NET4CXX_COMMON_API LoopbackClientEndpoint: public ClientEndpoint {
+public:
+    LoopbackClientEndpoint(Reactor *reactor, std::string name)
+            : ClientEndpoint(reactor)
+            , _name(std::move(name)) {
+
+    }
+
+    ConnectorPtr connect(std::unique_ptr<ClientFactory> &&protocolFactory) const override;
+protected:
+    std::string _name;
+};
+
+#ifdef NET4CXX_HAS_SHM_TRANSPORT
+
+class NET4CXX_COMMON_API SHMClientEndpoint: public ClientEndpoint {
+public:
+    SHMClientEndpoint(Reactor *reactor, std::string path, int busyPoll=0, double timeout=30.0)
+            : ClientEndpoint(reactor)
+            , _path(std::move(path))
+            , _busyPoll(busyPoll)
+            , _timeout(timeout) {
+
+    }
+
+    ConnectorPtr connect(std::unique_ptr<ClientFactory> &&protocolFactory) const override;
+protected:
+    std::string _path;
+    int _busyPoll;
+    double _timeout;
+};
+
+#endif
+
 ///
 /// \param reactor
 /// \param description
@@ -186,6 +266,8 @@ protected:
 ///     unix:path=/var/foo/bar:timeout=9
 ///     unix:/var/foo/bar
 ///     unix:/var/foo/bar:timeout=9
+///     shm:/var/foo/bar:busyPoll=50
+///     memory:finger
 /// \return
 NET4CXX_COMMON_API std::unique_ptr<ClientEndpoint> clientFromString(Reactor *reactor, const std::string &description);
 
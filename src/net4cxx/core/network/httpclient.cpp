@@ -0,0 +1,592 @@
+//
+// Created by yuwenyong on 17-12-8.
+//
+
+#include "net4cxx/core/network/httpclient.h"
+#include "net4cxx/common/crypto/base64.h"
+#include "net4cxx/core/network/reactor.h"
+
+
+NS_BEGIN
+
+namespace {
+
+class HTTPClientFactory: public ClientFactory {
+public:
+    explicit HTTPClientFactory(std::weak_ptr<HTTPConnectionPool> pool)
+            : _pool(std::move(pool)) {
+
+    }
+
+    ProtocolPtr buildProtocol(const Address &address) override {
+        auto pool = _pool.lock();
+        if (!pool || !pool->getClient()) {
+            return nullptr;
+        }
+        return std::make_shared<HTTPClientProtocol>(_pool, pool->getClient()->getLimits());
+    }
+
+    void clientConnectionFailed(ConnectorPtr connector, std::exception_ptr reason) override {
+        auto pool = _pool.lock();
+        if (pool) {
+            pool->connectionFailed(std::move(reason));
+        }
+    }
+protected:
+    std::weak_ptr<HTTPConnectionPool> _pool;
+};
+
+
+/// Cancels call if it is pending and forgets it, so that it reads as cancelled straight away.
+void cancelCall(DelayedCall &call) {
+    if (!call.cancelled()) {
+        call.cancel();
+        call = DelayedCall();
+    }
+}
+
+/// Words for why a connection went away, built without materializing the reason as an exception.
+std::string describeReason(const DisconnectReason &reason) {
+    std::string detail;
+    switch (reason.getType()) {
+        case DisconnectReason::kConnectionDone:
+            detail = "Connection was closed cleanly";
+            break;
+        case DisconnectReason::kConnectionAbort:
+            detail = "Connection was lost";
+            break;
+        case DisconnectReason::kConnectionError:
+            detail = reason.getErrorCode().message();
+            break;
+        case DisconnectReason::kException:
+            try {
+                std::rethrow_exception(reason.getException());
+            } catch (std::exception &e) {
+                return e.what();
+            } catch (...) {
+                return detail;
+            }
+        default:
+            return detail;
+    }
+    if (!reason.getMessage().empty()) {
+        detail = reason.getMessage() + ": " + detail;
+    }
+    return detail;
+}
+
+}
+
+
+const std::string* HTTPResponse::getHeader(const std::string &name) const {
+    for (auto &header: _headers) {
+        if (boost::iequals(header.first, name)) {
+            return &header.second;
+        }
+    }
+    return nullptr;
+}
+
+
+void HTTPClientProtocol::connectionMade() {
+    _transport->setNoDelay(true);
+    auto pool = _pool.lock();
+    if (!pool) {
+        close();
+        return;
+    }
+    _ready = true;
+    pool->connectionMade(shared_from_this());
+}
+
+void HTTPClientProtocol::dataReceived(Byte *data, size_t length) {
+    if (_closing) {
+        return;
+    }
+    if (_inflight.empty()) {
+        // Nothing was asked for, so the bytes can only be garbage, or a server giving up on the connection.
+        _closing = true;
+        _transport->abortConnection();
+        return;
+    }
+    auto self = shared_from_this();
+    _lastRead = std::chrono::steady_clock::now();
+    _buffer.normalize();
+    _buffer.ensureFreeSpace(length);
+    _buffer.write(data, length);
+    while (!_inflight.empty() && !_closing) {
+        auto status = _parser.parse(_buffer.getReadPointer(), _buffer.getActiveSize());
+        if (status == HTTPMessageParser::kError) {
+            failResponse(NET4CXX_EXCEPTION_PTR(HTTPClientError, StrUtil::format("Malformed response (%d)",
+                                                                                _parser.getErrorCode())));
+            return;
+        }
+        if ((status == HTTPMessageParser::kHeaders || status == HTTPMessageParser::kComplete) && !_response) {
+            startResponse();
+        }
+        size_t consumed = 0;
+        if (status != HTTPMessageParser::kIncomplete || _parser.isAwaitingBody()) {
+            consumed = _parser.getConsumed();
+        }
+        if (!_parser.getBody().empty()) {
+            receiveBody((const Byte *)_parser.getBody().data(), _parser.getBody().size());
+            if (_closing) {
+                return;
+            }
+        }
+        _buffer.readCompleted(consumed);
+        if (status == HTTPMessageParser::kComplete) {
+            finishResponse();
+        } else if (status == HTTPMessageParser::kIncomplete && consumed == 0) {
+            break;
+        }
+    }
+    if (_buffer.getActiveSize() == 0) {
+        _buffer.reset();
+    }
+}
+
+void HTTPClientProtocol::connectionLost(const DisconnectReason &reason) {
+    auto self = shared_from_this();
+    _closing = true;
+    cancelCall(_readTimeout);
+    cancelCall(_idleTimeout);
+    if (!_inflight.empty() && _response &&
+        _parser.finish(_buffer.getReadPointer(), _buffer.getActiveSize()) == HTTPMessageParser::kComplete) {
+        finishResponse();
+    }
+    std::string message = "Connection closed before the response completed";
+    std::string detail = describeReason(reason);
+    if (!detail.empty()) {
+        message += StrUtil::format(" (%s)", detail.c_str());
+    }
+    auto pool = _pool.lock();
+    std::vector<HTTPClientFetchPtr> retries, failures;
+    // Only what the server never started answering may go out again; the first request of a fresh connection is
+    // not retried either, a server closing that one is telling the request something.
+    bool started = _response || _buffer.getActiveSize() != 0;
+    for (size_t i = 0; i != _inflight.size(); ++i) {
+        auto &fetch = _inflight[i];
+        if (pool && pool->getClient() && fetch->request->isIdempotent() && !fetch->retried &&
+            (i != 0 || (!started && _answered != 0))) {
+            fetch->retried = true;
+            retries.push_back(std::move(fetch));
+        } else {
+            failures.push_back(std::move(fetch));
+        }
+    }
+    _inflight.clear();
+    _response.reset();
+    _decompressor.reset();
+    if (pool) {
+        pool->connectionLost(self);
+        for (auto iter = retries.rbegin(); iter != retries.rend(); ++iter) {
+            pool->fetch(std::move(*iter));
+        }
+    }
+    for (auto &fetch: failures) {
+        fetch->deferred.errback(NET4CXX_EXCEPTION_PTR(HTTPClientError, message));
+    }
+}
+
+void HTTPClientProtocol::send(HTTPClientFetchPtr fetch) {
+    BOOST_ASSERT(_ready && !_closing);
+    if (_inflight.empty()) {
+        cancelCall(_idleTimeout);
+        _lastRead = std::chrono::steady_clock::now();
+        _parser.setHeadRequest(fetch->request->getMethod() == "HEAD");
+    }
+    write(fetch->message);
+    _inflight.push_back(std::move(fetch));
+    armReadTimeout();
+}
+
+bool HTTPClientProtocol::canPipeline(const HTTPClientFetch &fetch, size_t depth) const {
+    if (!_ready || _closing || !_keepAlive || _answered == 0 || _inflight.size() >= depth ||
+        !fetch.request->isIdempotent()) {
+        return false;
+    }
+    for (auto &inflight: _inflight) {
+        if (!inflight->request->isIdempotent()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void HTTPClientProtocol::close() {
+    if (_closing) {
+        return;
+    }
+    _closing = true;
+    cancelCall(_readTimeout);
+    cancelCall(_idleTimeout);
+    loseConnection();
+}
+
+void HTTPClientProtocol::startResponse() {
+    const auto &fetch = _inflight.front();
+    _response = std::make_shared<HTTPResponse>(fetch->request);
+    _response->_code = _parser.getStatusCode();
+    _response->_reason = _parser.getReason().to_string();
+    for (auto &header: _parser.getHeaders()) {
+        _response->_headers.emplace_back(header.name.to_string(), header.value.to_string());
+    }
+    _response->_reusedConnection = _answered != 0;
+    if (_parser.isInterim()) {
+        return;
+    }
+    _keepAlive = _parser.isKeepAlive() && _response->_code != 101;
+    if (_parser.isAwaitingBody() && !_parser.findHeader("Content-Length") && !_parser.findHeader("Transfer-Encoding")) {
+        // The body runs until the server closes, taking whatever was pipelined behind with it.
+        _keepAlive = false;
+    }
+    if (fetch->request->getDecompressResponse()) {
+        auto encoding = _parser.findHeader("Content-Encoding");
+        if (encoding && (boost::iequals(encoding->value, "gzip") || boost::iequals(encoding->value, "x-gzip") ||
+                         boost::iequals(encoding->value, "deflate"))) {
+            // Window bits past 32 let zlib tell gzip from zlib by the header.
+            _decompressor = std::make_unique<DecompressObj>(32 + Zlib::maxWBits);
+        }
+    }
+    if (fetch->request->getHeaderCallback()) {
+        fetch->request->getHeaderCallback()(*_response);
+    }
+}
+
+void HTTPClientProtocol::receiveBody(const Byte *data, size_t length) {
+    const auto &request = *_inflight.front()->request;
+    std::string inflated;
+    if (_decompressor) {
+        try {
+            inflated = _decompressor->decompressToString(data, length);
+        } catch (...) {
+            failResponse(std::current_exception());
+            return;
+        }
+        data = (const Byte *)inflated.data();
+        length = inflated.size();
+    }
+    if (length == 0) {
+        return;
+    }
+    if (request.getStreamingCallback()) {
+        request.getStreamingCallback()(data, length);
+    } else if (_response->_body.size() + length > request.getMaxBodySize()) {
+        failResponse(NET4CXX_EXCEPTION_PTR(HTTPClientError, "Response body too large"));
+    } else {
+        _response->_body.append((const char *)data, length);
+    }
+}
+
+void HTTPClientProtocol::finishResponse() {
+    if (_parser.isInterim()) {
+        _response.reset();
+        _parser.reset();
+        _parser.setHeadRequest(_inflight.front()->request->getMethod() == "HEAD");
+        return;
+    }
+    if (_decompressor) {
+        std::string rest;
+        try {
+            rest = _decompressor->flushToString();
+        } catch (...) {
+            failResponse(std::current_exception());
+            return;
+        }
+        _decompressor.reset();
+        if (!rest.empty()) {
+            receiveBody((const Byte *)rest.data(), rest.size());
+            if (_closing) {
+                return;
+            }
+        }
+    }
+    auto fetch = std::move(_inflight.front());
+    _inflight.pop_front();
+    auto response = std::move(_response);
+    response->_requestTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - fetch->start).count();
+    ++_answered;
+    _parser.reset();
+    if (!_inflight.empty()) {
+        _parser.setHeadRequest(_inflight.front()->request->getMethod() == "HEAD");
+    }
+    auto pool = _pool.lock();
+    if (!_keepAlive) {
+        // Whatever was pipelined behind goes out again on another connection once this one is gone.
+        close();
+    } else if (_inflight.empty()) {
+        cancelCall(_readTimeout);
+        if (pool && pool->getClient() && pool->getClient()->getIdleTimeout() > 0.0) {
+            _idleTimeout = reactor()->callLater(pool->getClient()->getIdleTimeout(),
+                                                [self = shared_from_this()]() {
+                if (self->isIdle()) {
+                    self->close();
+                }
+            });
+        }
+    }
+    fetch->deferred.callback(std::move(response));
+    if (pool) {
+        pool->dispatch();
+    }
+}
+
+void HTTPClientProtocol::failResponse(std::exception_ptr error) {
+    auto fetch = std::move(_inflight.front());
+    _inflight.pop_front();
+    _response.reset();
+    _decompressor.reset();
+    _closing = true;
+    cancelCall(_readTimeout);
+    cancelCall(_idleTimeout);
+    _transport->abortConnection();
+    fetch->deferred.errback(std::move(error));
+}
+
+void HTTPClientProtocol::armReadTimeout() {
+    if (_inflight.empty() || !_readTimeout.cancelled()) {
+        return;
+    }
+    double timeout = _inflight.front()->request->getReadTimeout();
+    if (timeout <= 0.0) {
+        return;
+    }
+    _readTimeout = reactor()->callLater(timeout, [self = shared_from_this()]() {
+        self->cbReadTimeout();
+    });
+}
+
+void HTTPClientProtocol::cbReadTimeout() {
+    if (_inflight.empty() || _closing) {
+        return;
+    }
+    double timeout = _inflight.front()->request->getReadTimeout();
+    if (timeout <= 0.0) {
+        return;
+    }
+    // Reads only note their time, the timer catches up with them here.
+    double waited = std::chrono::duration<double>(std::chrono::steady_clock::now() - _lastRead).count();
+    if (waited < timeout) {
+        _readTimeout = reactor()->callLater(timeout - waited, [self = shared_from_this()]() {
+            self->cbReadTimeout();
+        });
+        return;
+    }
+    failResponse(NET4CXX_EXCEPTION_PTR(TimeoutError, "Timed out waiting for the response"));
+}
+
+
+void HTTPConnectionPool::fetch(HTTPClientFetchPtr fetch) {
+    if (!_client) {
+        fetch->deferred.errback(NET4CXX_EXCEPTION_PTR(HTTPClientError, "Client closed"));
+        return;
+    }
+    if (fetch->retried) {
+        _queue.push_front(std::move(fetch));
+    } else {
+        _queue.push_back(std::move(fetch));
+    }
+    dispatch();
+}
+
+void HTTPConnectionPool::dispatch() {
+    if (!_client) {
+        return;
+    }
+    auto self = shared_from_this();
+    size_t depth = _client->getPipelineDepth();
+    while (!_queue.empty()) {
+        std::shared_ptr<HTTPClientProtocol> target;
+        for (auto &connection: _connections) {
+            if (connection->isIdle()) {
+                target = connection;
+                break;
+            }
+        }
+        if (!target && depth > 1) {
+            for (auto &connection: _connections) {
+                if (connection->canPipeline(*_queue.front(), depth) &&
+                    (!target || connection->getInflight() < target->getInflight())) {
+                    target = connection;
+                }
+            }
+        }
+        if (!target) {
+            break;
+        }
+        auto fetch = std::move(_queue.front());
+        _queue.pop_front();
+        target->send(std::move(fetch));
+    }
+    while (_queue.size() > _connecting && _connections.size() + _connecting < _client->getMaxConnectionsPerOrigin()) {
+        startConnecting(_queue[_connecting]->request->getConnectTimeout());
+    }
+}
+
+void HTTPConnectionPool::connectionMade(std::shared_ptr<HTTPClientProtocol> protocol) {
+    BOOST_ASSERT(_connecting != 0);
+    --_connecting;
+    if (!_client) {
+        protocol->close();
+        return;
+    }
+    _connections.push_back(std::move(protocol));
+    dispatch();
+}
+
+void HTTPConnectionPool::connectionFailed(std::exception_ptr reason) {
+    BOOST_ASSERT(_connecting != 0);
+    --_connecting;
+    if (!_client || !_connections.empty() || _queue.empty()) {
+        dispatch();
+        return;
+    }
+    // With no connection to wait for, everything queued fails; otherwise the connections still coming take over
+    // all but the request this one was for.
+    auto self = shared_from_this();
+    std::deque<HTTPClientFetchPtr> failures;
+    if (_connecting == 0) {
+        failures.swap(_queue);
+    } else {
+        failures.push_back(std::move(_queue.front()));
+        _queue.pop_front();
+    }
+    if (!reason) {
+        reason = NET4CXX_EXCEPTION_PTR(HTTPClientError, "Connection failed");
+    }
+    for (auto &fetch: failures) {
+        fetch->deferred.errback(reason);
+    }
+}
+
+void HTTPConnectionPool::connectionLost(const std::shared_ptr<HTTPClientProtocol> &protocol) {
+    auto iter = std::find(_connections.begin(), _connections.end(), protocol);
+    if (iter != _connections.end()) {
+        _connections.erase(iter);
+    }
+    dispatch();
+}
+
+void HTTPConnectionPool::close() {
+    auto self = shared_from_this();
+    _client = nullptr;
+    auto queue = std::move(_queue);
+    _queue.clear();
+    auto connections = std::move(_connections);
+    _connections.clear();
+    for (auto &connection: connections) {
+        connection->close();
+    }
+    for (auto &fetch: queue) {
+        fetch->deferred.errback(NET4CXX_EXCEPTION_PTR(HTTPClientError, "Client closed"));
+    }
+}
+
+void HTTPConnectionPool::startConnecting(double timeout) {
+    ++_connecting;
+    auto factory = std::make_unique<HTTPClientFactory>(shared_from_this());
+    if (_sslOption) {
+        _client->reactor()->connectSSL(_host, _port, std::move(factory), _sslOption, timeout);
+    } else {
+        _client->reactor()->connectTCP(_host, _port, std::move(factory), timeout);
+    }
+}
+
+
+Deferred<HTTPResponsePtr> HTTPClient::fetch(HTTPRequestPtr request) {
+    Deferred<HTTPResponsePtr> deferred(_reactor);
+    std::string scheme, host;
+    unsigned short port;
+    URLSplitResult parts;
+    try {
+        parts = URLParse::urlSplit(request->getURL());
+        scheme = boost::to_lower_copy(parts.getScheme());
+        if (scheme != "http" && scheme != "https") {
+            NET4CXX_THROW_EXCEPTION(HTTPClientError, "Unsupported scheme: " + request->getURL());
+        }
+        auto hostName = parts.getHostName();
+        if (!hostName || hostName->empty()) {
+            NET4CXX_THROW_EXCEPTION(HTTPClientError, "No host in " + request->getURL());
+        }
+        host = std::move(*hostName);
+        port = parts.getPort().value_or(scheme == "https" ? (unsigned short)443 : (unsigned short)80);
+    } catch (...) {
+        deferred.errback(std::current_exception());
+        return deferred;
+    }
+    bool secure = scheme == "https";
+    std::string key = StrUtil::format("%s://%s:%u", scheme, host, (unsigned)port);
+    auto &pool = _pools[key];
+    if (!pool) {
+        SSLOptionPtr sslOption;
+        if (secure) {
+            SSLParams sslParams(_sslParams);
+            if (sslParams.getVerifyMode() != SSLVerifyMode::CERT_NONE && sslParams.getCheckHost().empty()) {
+                sslParams.setCheckHost(host);
+            }
+            sslOption = SSLOption::create(sslParams);
+        }
+        pool = std::make_shared<HTTPConnectionPool>(this, host, port, std::move(sslOption));
+    }
+    auto fetch = std::make_shared<HTTPClientFetch>();
+    fetch->request = std::move(request);
+    fetch->deferred = deferred;
+    fetch->message = buildMessage(*fetch->request, parts, host, port, secure);
+    fetch->start = std::chrono::steady_clock::now();
+    pool->fetch(std::move(fetch));
+    return deferred;
+}
+
+void HTTPClient::close() {
+    auto pools = std::move(_pools);
+    _pools.clear();
+    for (auto &pool: pools) {
+        pool.second->close();
+    }
+}
+
+std::string HTTPClient::buildMessage(const HTTPRequest &request, const URLSplitResult &parts, const std::string &host,
+                                     unsigned short port, bool secure) {
+    std::string message = request.getMethod() + " " + (parts.getPath().empty() ? "/" : parts.getPath());
+    if (!parts.getQuery().empty()) {
+        message += "?" + parts.getQuery();
+    }
+    message += " HTTP/1.1\r\n";
+    bool hasHost = false, hasAuthorization = false, hasAcceptEncoding = false, hasContentLength = false;
+    for (auto &header: request.getHeaders()) {
+        hasHost = hasHost || boost::iequals(header.first, "Host");
+        hasAuthorization = hasAuthorization || boost::iequals(header.first, "Authorization");
+        hasAcceptEncoding = hasAcceptEncoding || boost::iequals(header.first, "Accept-Encoding");
+        hasContentLength = hasContentLength || boost::iequals(header.first, "Content-Length") ||
+                           boost::iequals(header.first, "Transfer-Encoding");
+    }
+    if (!hasHost) {
+        message += "Host: " + (host.find(':') != std::string::npos ? "[" + host + "]" : host);
+        if (port != (secure ? 443 : 80)) {
+            message += ":" + std::to_string(port);
+        }
+        message += "\r\n";
+    }
+    auto userName = parts.getUserName();
+    if (userName && !hasAuthorization) {
+        auto password = parts.getPassword();
+        message += "Authorization: Basic " + Base64::b64encode(*userName + ":" + password.value_or("")) + "\r\n";
+    }
+    if (request.getDecompressResponse() && !hasAcceptEncoding) {
+        message += "Accept-Encoding: gzip\r\n";
+    }
+    for (auto &header: request.getHeaders()) {
+        message += header.first + ": " + header.second + "\r\n";
+    }
+    const auto &method = request.getMethod();
+    if (!hasContentLength && (!request.getBody().empty() || method == "POST" || method == "PUT" ||
+                              method == "PATCH")) {
+        message += "Content-Length: " + std::to_string(request.getBody().size()) + "\r\n";
+    }
+    message += "\r\n";
+    message += request.getBody();
+    return message;
+}
+
+NS_END
@@ -0,0 +1,375 @@
+//
+// Created by yuwenyong on 17-12-8.
+//
+
+#ifndef NET4CXX_CORE_NETWORK_HTTPCLIENT_H
+#define NET4CXX_CORE_NETWORK_HTTPCLIENT_H
+
+#include "net4cxx/common/common.h"
+#include "net4cxx/common/compress/zlib.h"
+#include "net4cxx/common/httputils/httpparser.h"
+#include "net4cxx/common/httputils/urlparse.h"
+#include "net4cxx/common/utilities/messagebuffer.h"
+#include "net4cxx/core/network/defer.h"
+#include "net4cxx/core/network/protocol.h"
+
+NS_BEGIN
+
+
+NET4CXX_DECLARE_EXCEPTION(HTTPClientError, IOError);
+
+
+class HTTPResponse;
+
+
+class NET4CXX_COMMON_API HTTPRequest {
+public:
+    typedef std::function<void (const HTTPResponse &)> HeaderCallbackType;
+    typedef std::function<void (const Byte *, size_t)> StreamingCallbackType;
+
+    explicit HTTPRequest(std::string url, std::string method="GET")
+            : _url(std::move(url))
+            , _method(std::move(method)) {
+
+    }
+
+    const std::string& getURL() const {
+        return _url;
+    }
+
+    const std::string& getMethod() const {
+        return _method;
+    }
+
+    /// Sent after Host, as given.
+    void addHeader(std::string name, std::string value) {
+        _headers.emplace_back(std::move(name), std::move(value));
+    }
+
+    const std::vector<std::pair<std::string, std::string>>& getHeaders() const {
+        return _headers;
+    }
+
+    void setBody(std::string body) {
+        _body = std::move(body);
+    }
+
+    const std::string& getBody() const {
+        return _body;
+    }
+
+    void setConnectTimeout(double connectTimeout) {
+        _connectTimeout = connectTimeout;
+    }
+
+    double getConnectTimeout() const {
+        return _connectTimeout;
+    }
+
+    /// Longest wait for the next bytes of the response; zero waits forever.
+    void setReadTimeout(double readTimeout) {
+        _readTimeout = readTimeout;
+    }
+
+    double getReadTimeout() const {
+        return _readTimeout;
+    }
+
+    /// Asks for gzip and inflates gzip and deflate bodies.
+    void setDecompressResponse(bool decompressResponse) {
+        _decompressResponse = decompressResponse;
+    }
+
+    bool getDecompressResponse() const {
+        return _decompressResponse;
+    }
+
+    /// Bodies over this size fail the request, unless they are streamed.
+    void setMaxBodySize(size_t maxBodySize) {
+        _maxBodySize = maxBodySize;
+    }
+
+    size_t getMaxBodySize() const {
+        return _maxBodySize;
+    }
+
+    void setHeaderCallback(HeaderCallbackType headerCallback) {
+        _headerCallback = std::move(headerCallback);
+    }
+
+    const HeaderCallbackType& getHeaderCallback() const {
+        return _headerCallback;
+    }
+
+    /// Streams the body, which then stays out of the response.
+    void setStreamingCallback(StreamingCallbackType streamingCallback) {
+        _streamingCallback = std::move(streamingCallback);
+    }
+
+    const StreamingCallbackType& getStreamingCallback() const {
+        return _streamingCallback;
+    }
+
+    /// Whether the request may be retried and pipelined.
+    bool isIdempotent() const {
+        return _method == "GET" || _method == "HEAD" || _method == "OPTIONS" || _method == "PUT" ||
+               _method == "DELETE" || _method == "TRACE";
+    }
+protected:
+    std::string _url;
+    std::string _method;
+    std::vector<std::pair<std::string, std::string>> _headers;
+    std::string _body;
+    double _connectTimeout{20.0};
+    double _readTimeout{20.0};
+    bool _decompressResponse{true};
+    size_t _maxBodySize{64 * 1024 * 1024};
+    HeaderCallbackType _headerCallback;
+    StreamingCallbackType _streamingCallback;
+};
+
+using HTTPRequestPtr = std::shared_ptr<HTTPRequest>;
+
+
+class NET4CXX_COMMON_API HTTPResponse {
+public:
+    friend class HTTPClientProtocol;
+
+    explicit HTTPResponse(HTTPRequestPtr request)
+            : _request(std::move(request)) {
+
+    }
+
+    const HTTPRequestPtr& getRequest() const {
+        return _request;
+    }
+
+    int getCode() const {
+        return _code;
+    }
+
+    const std::string& getReason() const {
+        return _reason;
+    }
+
+    const std::vector<std::pair<std::string, std::string>>& getHeaders() const {
+        return _headers;
+    }
+
+    /// Compared case-insensitively; nullptr if missing.
+    const std::string* getHeader(const std::string &name) const;
+
+    /// Empty when the body was streamed.
+    const std::string& getBody() const {
+        return _body;
+    }
+
+    /// Seconds from issuing the request to the end of its response.
+    double getRequestTime() const {
+        return _requestTime;
+    }
+
+    bool isReusedConnection() const {
+        return _reusedConnection;
+    }
+protected:
+    HTTPRequestPtr _request;
+    int _code{0};
+    std::string _reason;
+    std::vector<std::pair<std::string, std::string>> _headers;
+    std::string _body;
+    double _requestTime{0.0};
+    bool _reusedConnection{false};
+};
+
+using HTTPResponsePtr = std::shared_ptr<HTTPResponse>;
+
+
+struct HTTPClientFetch {
+    HTTPRequestPtr request;
+    Deferred<HTTPResponsePtr> deferred;
+    std::string message;
+    std::chrono::steady_clock::time_point start;
+    bool retried{false};
+};
+
+using HTTPClientFetchPtr = std::shared_ptr<HTTPClientFetch>;
+
+
+class HTTPClient;
+class HTTPConnectionPool;
+
+
+class NET4CXX_COMMON_API HTTPClientProtocol: public Protocol, public std::enable_shared_from_this<HTTPClientProtocol> {
+public:
+    HTTPClientProtocol(std::weak_ptr<HTTPConnectionPool> pool, const HTTPParserLimits &limits)
+            : _pool(std::move(pool))
+            , _parser(limits, true) {
+
+    }
+
+    void connectionMade() override;
+
+    void dataReceived(Byte *data, size_t length) override;
+
+    void connectionLost(const DisconnectReason &reason) override;
+
+    void send(HTTPClientFetchPtr fetch);
+
+    bool isIdle() const {
+        return _ready && !_closing && _inflight.empty();
+    }
+
+    /// Whether fetch may be pipelined with at most depth requests in flight.
+    bool canPipeline(const HTTPClientFetch &fetch, size_t depth) const;
+
+    size_t getInflight() const {
+        return _inflight.size();
+    }
+
+    void close();
+protected:
+    void startResponse();
+
+    void receiveBody(const Byte *data, size_t length);
+
+    void finishResponse();
+
+    void failResponse(std::exception_ptr error);
+
+    void armReadTimeout();
+
+    void cbReadTimeout();
+
+    std::weak_ptr<HTTPConnectionPool> _pool;
+    HTTPResponseParser _parser;
+    MessageBuffer _buffer;
+    std::deque<HTTPClientFetchPtr> _inflight;
+    HTTPResponsePtr _response;
+    std::unique_ptr<DecompressObj> _decompressor;
+    bool _ready{false};
+    bool _closing{false};
+    bool _keepAlive{true};
+    size_t _answered{0};
+    std::chrono::steady_clock::time_point _lastRead;
+    DelayedCall _readTimeout;
+    DelayedCall _idleTimeout;
+};
+
+
+class NET4CXX_COMMON_API HTTPConnectionPool: public std::enable_shared_from_this<HTTPConnectionPool> {
+public:
+    HTTPConnectionPool(HTTPClient *client, std::string host, unsigned short port, SSLOptionPtr sslOption)
+            : _client(client)
+            , _host(std::move(host))
+            , _port(std::to_string(port))
+            , _sslOption(std::move(sslOption)) {
+
+    }
+
+    /// Queues fetch, first in line if it is being retried.
+    void fetch(HTTPClientFetchPtr fetch);
+
+    void dispatch();
+
+    void connectionMade(std::shared_ptr<HTTPClientProtocol> protocol);
+
+    void connectionFailed(std::exception_ptr reason);
+
+    void connectionLost(const std::shared_ptr<HTTPClientProtocol> &protocol);
+
+    HTTPClient* getClient() {
+        return _client;
+    }
+
+    void close();
+protected:
+    void startConnecting(double timeout);
+
+    HTTPClient *_client;
+    std::string _host;
+    std::string _port;
+    SSLOptionPtr _sslOption;
+    std::deque<HTTPClientFetchPtr> _queue;
+    std::vector<std::shared_ptr<HTTPClientProtocol>> _connections;
+    size_t _connecting{0};
+};
+
+using HTTPConnectionPoolPtr = std::shared_ptr<HTTPConnectionPool>;
+
+
+/// Asynchronous HTTP/1.1 client with a pool of persistent connections per origin; use on the reactor thread only.
+class NET4CXX_COMMON_API HTTPClient: public boost::noncopyable {
+public:
+    /// sslParams checks the certificate against the request's host unless it names one.
+    explicit HTTPClient(Reactor *reactor, SSLParams sslParams=SSLParams())
+            : _reactor(reactor)
+            , _sslParams(std::move(sslParams)) {
+
+    }
+
+    ~HTTPClient() {
+        close();
+    }
+
+    Deferred<HTTPResponsePtr> fetch(HTTPRequestPtr request);
+
+    Deferred<HTTPResponsePtr> fetch(std::string url) {
+        return fetch(std::make_shared<HTTPRequest>(std::move(url)));
+    }
+
+    void close();
+
+    Reactor* reactor() {
+        return _reactor;
+    }
+
+    void setMaxConnectionsPerOrigin(size_t maxConnections) {
+        _maxConnections = std::max<size_t>(maxConnections, 1);
+    }
+
+    size_t getMaxConnectionsPerOrigin() const {
+        return _maxConnections;
+    }
+
+    /// Requests in flight at once on a connection; one turns pipelining off.
+    void setPipelineDepth(size_t pipelineDepth) {
+        _pipelineDepth = std::max<size_t>(pipelineDepth, 1);
+    }
+
+    size_t getPipelineDepth() const {
+        return _pipelineDepth;
+    }
+
+    /// Seconds an idle connection is kept around.
+    void setIdleTimeout(double idleTimeout) {
+        _idleTimeout = idleTimeout;
+    }
+
+    double getIdleTimeout() const {
+        return _idleTimeout;
+    }
+
+    void setLimits(const HTTPParserLimits &limits) {
+        _limits = limits;
+    }
+
+    const HTTPParserLimits& getLimits() const {
+        return _limits;
+    }
+protected:
+    std::string buildMessage(const HTTPRequest &request, const URLSplitResult &parts, const std::string &host,
+                             unsigned short port, bool secure);
+
+    Reactor *_reactor;
+    SSLParams _sslParams;
+    size_t _maxConnections{8};
+    size_t _pipelineDepth{1};
+    double _idleTimeout{60.0};
+    HTTPParserLimits _limits;
+    std::unordered_map<std::string, HTTPConnectionPoolPtr> _pools;
+};
+
+NS_END
+
+#endif //NET4CXX_CORE_NETWORK_HTTPCLIENT_H
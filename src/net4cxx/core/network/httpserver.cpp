@@ -0,0 +1,147 @@
+//
+// Created by yuwenyong on 17-12-7.
+//
+
+#include "net4cxx/core/network/httpserver.h"
+#include "net4cxx/common/httputils/httplib.h"
+
+
+NS_BEGIN
+
+void HTTPServerProtocol::dataReceived(Byte *data, size_t length) {
+    if (_closing || _overflowed) {
+        return;
+    }
+    if (!_buffer.getActiveSize()) {
+        size_t consumed = processRequests(data, length);
+        if (!_closing && consumed != length) {
+            _buffer.reset();
+            bufferData(data + consumed, length - consumed);
+        }
+    } else {
+        bufferData(data, length);
+        processBuffer();
+    }
+    if (_pending && !_closing) {
+        pauseReading();
+    }
+}
+
+void HTTPServerProtocol::sendResponse(int statusCode, boost::string_view body,
+                                      std::initializer_list<HTTPHeader> headers) {
+    BOOST_ASSERT(_pending);
+    if (_closing) {
+        return;
+    }
+    auto iter = gHTTPResponses.find(statusCode);
+    _response.clear();
+    _response.append("HTTP/1.1 ");
+    _response.append(std::to_string(statusCode));
+    _response.push_back(' ');
+    _response.append(iter != gHTTPResponses.end() ? iter->second : "Unknown");
+    _response.append("\r\n");
+    for (auto &header: headers) {
+        _response.append(header.name.data(), header.name.size());
+        _response.append(": ");
+        _response.append(header.value.data(), header.value.size());
+        _response.append("\r\n");
+    }
+    bool hasBody = statusCode >= 200 && statusCode != 204 && statusCode != 304;
+    if (hasBody) {
+        _response.append("Content-Length: ");
+        _response.append(std::to_string(body.size()));
+        _response.append("\r\n");
+    }
+    if (!_keepAlive) {
+        _response.append("Connection: close\r\n");
+    } else if (_versionMinor == 0) {
+        _response.append("Connection: keep-alive\r\n");
+    }
+    _response.append("\r\n");
+    if (hasBody && !_head) {
+        _response.append(body.data(), body.size());
+    }
+    write(_response);
+    _pending = false;
+    if (!_keepAlive) {
+        _closing = true;
+        loseConnection();
+    } else if (!_processing) {
+        // Answered from the reactor: requests that came in meanwhile are waiting in the buffer.
+        resumeReading();
+        processBuffer();
+        if (_overflowed && !_pending && !_closing) {
+            // What was dropped behind the buffered requests cannot be answered.
+            sendError(413);
+        } else if (_pending && !_closing) {
+            pauseReading();
+        }
+    }
+}
+
+size_t HTTPServerProtocol::processRequests(Byte *data, size_t length) {
+    _processing = true;
+    size_t offset = 0;
+    while (offset != length && !_pending && !_closing) {
+        auto status = _parser.parse(data + offset, length - offset);
+        if (status == HTTPMessageParser::kIncomplete) {
+            if (_parser.isAwaitingBody() && _parser.isExpectingContinue() && !_continueSent) {
+                write("HTTP/1.1 100 Continue\r\n\r\n");
+                _continueSent = true;
+            }
+            break;
+        }
+        if (status == HTTPMessageParser::kError) {
+            sendError(_parser.getErrorCode());
+            offset = length;
+            break;
+        }
+        _keepAlive = _parser.isKeepAlive();
+        _head = _parser.isHead();
+        _versionMinor = _parser.getVersionMinor();
+        _pending = true;
+        handleRequest(_parser);
+        offset += _parser.getConsumed();
+        _parser.reset();
+        _continueSent = false;
+    }
+    _processing = false;
+    return offset;
+}
+
+void HTTPServerProtocol::bufferData(Byte *data, size_t length) {
+    if (_buffer.getActiveSize() + length > _parser.getLimits().getMaxMessageBytes()) {
+        if (!_pending) {
+            sendError(413);
+            return;
+        }
+        // Requests pipelined behind a pending response: keep what is buffered for after it and stop taking more.
+        _overflowed = true;
+        return;
+    }
+    _buffer.normalize();
+    _buffer.ensureFreeSpace(length);
+    _buffer.write(data, length);
+}
+
+void HTTPServerProtocol::processBuffer() {
+    if (_processing) {
+        return;
+    }
+    size_t consumed = processRequests(_buffer.getReadPointer(), _buffer.getActiveSize());
+    if (_closing || consumed == _buffer.getActiveSize()) {
+        _buffer.reset();
+    } else {
+        _buffer.readCompleted(consumed);
+    }
+}
+
+void HTTPServerProtocol::sendError(int statusCode) {
+    _keepAlive = false;
+    _head = false;
+    _versionMinor = 1;
+    _pending = true;
+    sendResponse(statusCode, "");
+}
+
+NS_END
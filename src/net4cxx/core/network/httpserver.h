@@ -0,0 +1,69 @@
+//
+// Created by yuwenyong on 17-12-7.
+//
+
+#ifndef NET4CXX_CORE_NETWORK_HTTPSERVER_H
+#define NET4CXX_CORE_NETWORK_HTTPSERVER_H
+
+#include "net4cxx/common/common.h"
+#include "net4cxx/common/httputils/httpparser.h"
+#include "net4cxx/common/utilities/messagebuffer.h"
+#include "net4cxx/core/network/protocol.h"
+
+NS_BEGIN
+
+
+/// HTTP/1.1 server side of a connection, answering its requests one at a time in the order they came in.
+///
+/// Requests are parsed straight from the bytes handed to dataReceived; only the part of a request that has not fully
+/// arrived, or requests pipelined behind one still being answered, get copied into a buffer of the protocol's own.
+/// handleRequest answers each request with sendResponse, either before it returns or later from the reactor, in which
+/// case reading pauses until the response has gone out. Malformed requests and requests over the limits are answered
+/// with the matching error status and the connection is closed, as is one that keeps pipelining past the limits while
+/// a response is pending, once the requests it had buffered until then have been answered.
+class NET4CXX_COMMON_API HTTPServerProtocol: public Protocol {
+public:
+    explicit HTTPServerProtocol(const HTTPParserLimits &limits=HTTPParserLimits())
+            : _parser(limits) {
+
+    }
+
+    void dataReceived(Byte *data, size_t length) override;
+
+    /// Called for every complete request; the views of request are only valid until it returns.
+    virtual void handleRequest(const HTTPRequestParser &request) = 0;
+
+    /// Answers the request being handled; Content-Length and, when needed, Connection are added to headers.
+    void sendResponse(int statusCode, boost::string_view body, std::initializer_list<HTTPHeader> headers={});
+
+    bool isResponsePending() const {
+        return _pending;
+    }
+protected:
+    /// Handles the requests in data, stopping at an incomplete one or one answered later; returns the bytes used up.
+    size_t processRequests(Byte *data, size_t length);
+
+    /// Appends data to the buffer, or drops it and marks the protocol overflowed once the buffer would hold more than
+    /// a request of the largest size the limits allow.
+    void bufferData(Byte *data, size_t length);
+
+    void processBuffer();
+
+    void sendError(int statusCode);
+
+    HTTPRequestParser _parser;
+    MessageBuffer _buffer;
+    std::string _response;
+    bool _pending{false};
+    bool _processing{false};
+    bool _closing{false};
+    bool _overflowed{false};
+    bool _continueSent{false};
+    bool _keepAlive{true};
+    bool _head{false};
+    int _versionMinor{1};
+};
+
+NS_END
+
+#endif //NET4CXX_CORE_NETWORK_HTTPSERVER_H
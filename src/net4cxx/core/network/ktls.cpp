@@ -0,0 +1,291 @@
+//
+// Created by yuwenyong on 17-12-5.
+//
+
+#include "net4cxx/core/network/ktls.h"
+
+#ifdef NET4CXX_HAS_KTLS
+
+#include <linux/tls.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <openssl/kdf.h>
+#include "net4cxx/common/global/loggers.h"
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+
+
+NS_BEGIN
+
+namespace {
+
+bool decodeHex(const char *text, ByteArray &data) {
+    data.clear();
+    // Sized up front so that no partial copy of the secret is left behind by a reallocation.
+    data.reserve(strlen(text) / 2);
+    for (; text[0] && text[1]; text += 2) {
+        int high = isdigit(text[0]) ? text[0] - '0' : tolower(text[0]) - 'a' + 10;
+        int low = isdigit(text[1]) ? text[1] - '0' : tolower(text[1]) - 'a' + 10;
+        if (high < 0 || high > 15 || low < 0 || low > 15) {
+            return false;
+        }
+        data.push_back((Byte)((high << 4) | low));
+    }
+    return !data.empty();
+}
+
+bool expandLabel(const EVP_MD *md, const ByteArray &secret, const std::string &label, Byte *out, size_t length) {
+    std::string fullLabel = "tls13 " + label;
+    ByteArray info{(Byte)(length >> 8), (Byte)length, (Byte)fullLabel.size()};
+    info.insert(info.end(), fullLabel.begin(), fullLabel.end());
+    info.push_back(0);
+    EVP_PKEY_CTX *context = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr);
+    bool success = context && EVP_PKEY_derive_init(context) > 0 &&
+                   EVP_PKEY_CTX_hkdf_mode(context, EVP_PKEY_HKDEF_MODE_EXPAND_ONLY) > 0 &&
+                   EVP_PKEY_CTX_set_hkdf_md(context, md) > 0 &&
+                   EVP_PKEY_CTX_set1_hkdf_key(context, secret.data(), (int)secret.size()) > 0 &&
+                   EVP_PKEY_CTX_add1_hkdf_info(context, info.data(), (int)info.size()) > 0 &&
+                   EVP_PKEY_derive(context, out, &length) > 0;
+    EVP_PKEY_CTX_free(context);
+    return success;
+}
+
+bool expandKeyBlock(SSL *ssl, const EVP_MD *md, Byte *out, size_t length) {
+    Byte masterKey[SSL_MAX_MASTER_KEY_LENGTH];
+    size_t masterKeyLength = SSL_SESSION_get_master_key(SSL_get_session(ssl), masterKey, sizeof(masterKey));
+    Byte clientRandom[SSL3_RANDOM_SIZE], serverRandom[SSL3_RANDOM_SIZE];
+    SSL_get_client_random(ssl, clientRandom, sizeof(clientRandom));
+    SSL_get_server_random(ssl, serverRandom, sizeof(serverRandom));
+    const Byte label[] = "key expansion";
+    EVP_PKEY_CTX *context = EVP_PKEY_CTX_new_id(EVP_PKEY_TLS1_PRF, nullptr);
+    bool success = masterKeyLength && context && EVP_PKEY_derive_init(context) > 0 &&
+                   EVP_PKEY_CTX_set_tls1_prf_md(context, md) > 0 &&
+                   EVP_PKEY_CTX_set1_tls1_prf_secret(context, masterKey, (int)masterKeyLength) > 0 &&
+                   EVP_PKEY_CTX_add1_tls1_prf_seed(context, label, (int)sizeof(label) - 1) > 0 &&
+                   EVP_PKEY_CTX_add1_tls1_prf_seed(context, serverRandom, (int)sizeof(serverRandom)) > 0 &&
+                   EVP_PKEY_CTX_add1_tls1_prf_seed(context, clientRandom, (int)sizeof(clientRandom)) > 0 &&
+                   EVP_PKEY_derive(context, out, &length) > 0;
+    EVP_PKEY_CTX_free(context);
+    OPENSSL_cleanse(masterKey, sizeof(masterKey));
+    return success;
+}
+
+/// Fills in the kernel's crypto info; iv is the full nonce base for TLS 1.3 and the fixed part of it for TLS 1.2,
+/// whose explicit nonce carries on from the sequence number as OpenSSL's does.
+template <typename CryptoInfoT>
+bool installCryptoInfo(int fd, bool sending, bool tls13, unsigned short cipherType, const Byte *key, const Byte *iv,
+                       uint64 sequence) {
+    CryptoInfoT info;
+    memset(&info, 0, sizeof(info));
+    info.info.version = tls13 ? TLS_1_3_VERSION : TLS_1_2_VERSION;
+    info.info.cipher_type = cipherType;
+    for (size_t i = 0; i != sizeof(info.rec_seq); ++i) {
+        info.rec_seq[i] = (unsigned char)(sequence >> (8 * (sizeof(info.rec_seq) - 1 - i)));
+    }
+    memcpy(info.key, key, sizeof(info.key));
+    memcpy(info.salt, iv, sizeof(info.salt));
+    if (tls13 || sizeof(info.salt) == 0) {
+        memcpy(info.iv, iv + sizeof(info.salt), sizeof(info.iv));
+    } else {
+        memcpy(info.iv, info.rec_seq, sizeof(info.iv));
+    }
+    int result = setsockopt(fd, SOL_TLS, sending ? TLS_TX : TLS_RX, &info, sizeof(info));
+    OPENSSL_cleanse(&info, sizeof(info));
+    return result == 0;
+}
+
+}
+
+
+std::atomic<bool> KernelTLS::_available{true};
+
+void KernelTLS::prepareContext(SSL_CTX *context) {
+    SSL_CTX_set_keylog_callback(context, &KernelTLS::cbKeyLog);
+    SSL_CTX_set_msg_callback(context, &KernelTLS::cbMessage);
+}
+
+KernelTLS::~KernelTLS() {
+    releaseSecrets();
+}
+
+void KernelTLS::attach(SSL *ssl) {
+    SSL_set_ex_data(ssl, getIndex(), this);
+}
+
+int KernelTLS::enable(SSL *ssl, int fd, int directions) {
+    int enabled = 0;
+    if (_available && setUpperLayer(ssl, fd)) {
+        if ((directions & kSend) && setCryptoInfo(ssl, fd, true)) {
+            enabled |= kSend;
+        }
+        if ((directions & kReceive) && setCryptoInfo(ssl, fd, false)) {
+            enabled |= kReceive;
+        }
+    }
+    // Directions left out stay with OpenSSL for good, so the secrets are of no more use either way.
+    releaseSecrets();
+    return enabled;
+}
+
+void KernelTLS::sendCloseNotify(SSL *ssl, int fd) {
+    Byte alert[2] = {SSL3_AL_WARNING, SSL_AD_CLOSE_NOTIFY};
+    char control[CMSG_SPACE(sizeof(Byte))];
+    memset(control, 0, sizeof(control));
+    iovec iov{alert, sizeof(alert)};
+    msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    cmsghdr *header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_TLS;
+    header->cmsg_type = TLS_SET_RECORD_TYPE;
+    header->cmsg_len = CMSG_LEN(sizeof(Byte));
+    *CMSG_DATA(header) = SSL3_RT_ALERT;
+    sendmsg(fd, &message, MSG_DONTWAIT | MSG_NOSIGNAL);
+    SSL_set_shutdown(ssl, SSL_get_shutdown(ssl) | SSL_SENT_SHUTDOWN);
+}
+
+bool KernelTLS::receiveCloseNotify(SSL *ssl, int fd) {
+    Byte data[512];
+    char control[CMSG_SPACE(sizeof(Byte))];
+    memset(control, 0, sizeof(control));
+    iovec iov{data, sizeof(data)};
+    msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    ssize_t length = recvmsg(fd, &message, MSG_DONTWAIT);
+    cmsghdr *header = length >= 2 ? CMSG_FIRSTHDR(&message) : nullptr;
+    if (!header || header->cmsg_level != SOL_TLS || header->cmsg_type != TLS_GET_RECORD_TYPE ||
+        *CMSG_DATA(header) != SSL3_RT_ALERT || data[1] != SSL_AD_CLOSE_NOTIFY) {
+        return false;
+    }
+    SSL_set_shutdown(ssl, SSL_get_shutdown(ssl) | SSL_RECEIVED_SHUTDOWN);
+    return true;
+}
+
+int KernelTLS::getIndex() {
+    static int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+void KernelTLS::cbKeyLog(const SSL *ssl, const char *line) {
+    auto kernelTLS = static_cast<KernelTLS *>(SSL_get_ex_data(ssl, getIndex()));
+    const char *secret = strrchr(line, ' ');
+    if (!kernelTLS || !secret) {
+        return;
+    }
+    if (strncmp(line, "CLIENT_TRAFFIC_SECRET_0 ", 24) == 0) {
+        decodeHex(secret + 1, kernelTLS->_clientSecret);
+    } else if (strncmp(line, "SERVER_TRAFFIC_SECRET_0 ", 24) == 0) {
+        decodeHex(secret + 1, kernelTLS->_serverSecret);
+    }
+}
+
+void KernelTLS::cbMessage(int writing, int version, int contentType, const void *buf, size_t length, SSL *ssl,
+                          void *arg) {
+    auto kernelTLS = static_cast<KernelTLS *>(SSL_get_ex_data(ssl, getIndex()));
+    if (!kernelTLS) {
+        return;
+    }
+    Traffic &traffic = writing ? kernelTLS->_send : kernelTLS->_receive;
+    if (contentType == SSL3_RT_HEADER) {
+        if (traffic.started) {
+            ++traffic.sequence;
+        }
+        return;
+    }
+    if (contentType != SSL3_RT_HANDSHAKE || length == 0 || static_cast<const Byte *>(buf)[0] != SSL3_MT_FINISHED) {
+        return;
+    }
+    // TLS 1.3 switches to the application keys after Finished, TLS 1.2 before it, so that Finished went out under
+    // them as the first record; the header callback of every later record comes after this one.
+    traffic.started = true;
+    traffic.sequence = SSL_version(ssl) == TLS1_3_VERSION ? 0 : 1;
+}
+
+bool KernelTLS::setUpperLayer(SSL *ssl, int fd) {
+    int version = SSL_version(ssl);
+    int cipher = SSL_CIPHER_get_cipher_nid(SSL_get_current_cipher(ssl));
+    if ((version != TLS1_2_VERSION && version != TLS1_3_VERSION) ||
+        (cipher != NID_aes_128_gcm && cipher != NID_aes_256_gcm && cipher != NID_chacha20_poly1305)) {
+        return false;
+    }
+    if (setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) != 0) {
+        int error = errno;
+        if ((error == ENOENT || error == ENOPROTOOPT || error == EOPNOTSUPP) && _available.exchange(false)) {
+            NET4CXX_WARN(gGenLog, "Kernel TLS unavailable, records stay in user space: %s", strerror(error));
+        }
+        return false;
+    }
+    return true;
+}
+
+void KernelTLS::releaseSecrets() {
+    for (ByteArray *secret: {&_clientSecret, &_serverSecret}) {
+        if (!secret->empty()) {
+            OPENSSL_cleanse(secret->data(), secret->size());
+        }
+        ByteArray().swap(*secret);
+    }
+}
+
+bool KernelTLS::setCryptoInfo(SSL *ssl, int fd, bool sending) {
+    const SSL_CIPHER *cipher = SSL_get_current_cipher(ssl);
+    int nid = SSL_CIPHER_get_cipher_nid(cipher);
+    const EVP_MD *md = SSL_CIPHER_get_handshake_digest(cipher);
+    Traffic &traffic = sending ? _send : _receive;
+    if (!md || !traffic.started) {
+        return false;
+    }
+    size_t keyLength = nid == NID_aes_128_gcm ? 16 : 32;
+    // Keys are named after the side that sends with them.
+    bool clientKeys = sending != (SSL_is_server(ssl) != 0);
+    bool tls13 = SSL_version(ssl) == TLS1_3_VERSION;
+    Byte key[32], iv[12];
+    if (tls13) {
+        const ByteArray &secret = clientKeys ? _clientSecret : _serverSecret;
+        if (secret.empty() || !expandLabel(md, secret, "key", key, keyLength) ||
+            !expandLabel(md, secret, "iv", iv, sizeof(iv))) {
+            return false;
+        }
+    } else {
+        size_t ivLength = nid == NID_chacha20_poly1305 ? 12 : 4;
+        Byte keyBlock[2 * 32 + 2 * 12];
+        if (!expandKeyBlock(ssl, md, keyBlock, 2 * keyLength + 2 * ivLength)) {
+            return false;
+        }
+        memcpy(key, keyBlock + (clientKeys ? 0 : keyLength), keyLength);
+        memcpy(iv, keyBlock + 2 * keyLength + (clientKeys ? 0 : ivLength), ivLength);
+        OPENSSL_cleanse(keyBlock, sizeof(keyBlock));
+    }
+    bool success;
+    if (nid == NID_aes_128_gcm) {
+        success = installCryptoInfo<tls12_crypto_info_aes_gcm_128>(fd, sending, tls13, TLS_CIPHER_AES_GCM_128, key, iv,
+                                                                   traffic.sequence);
+    } else if (nid == NID_aes_256_gcm) {
+        success = installCryptoInfo<tls12_crypto_info_aes_gcm_256>(fd, sending, tls13, TLS_CIPHER_AES_GCM_256, key, iv,
+                                                                   traffic.sequence);
+    } else {
+        success = installCryptoInfo<tls12_crypto_info_chacha20_poly1305>(fd, sending, tls13,
+                                                                         TLS_CIPHER_CHACHA20_POLY1305, key, iv,
+                                                                         traffic.sequence);
+    }
+    OPENSSL_cleanse(key, sizeof(key));
+    OPENSSL_cleanse(iv, sizeof(iv));
+    return success;
+}
+
+NS_END
+
+#endif //NET4CXX_HAS_KTLS
@@ -0,0 +1,88 @@
+//
+// Created by yuwenyong on 17-12-5.
+//
+
+#ifndef NET4CXX_CORE_NETWORK_KTLS_H
+#define NET4CXX_CORE_NETWORK_KTLS_H
+
+#include "net4cxx/common/common.h"
+#include <atomic>
+#include <openssl/ssl.h>
+#include "net4cxx/core/network/base.h"
+
+#ifdef NET4CXX_HAS_KTLS
+
+NS_BEGIN
+
+
+/// Hands the record layer of a TLS connection over to the kernel once OpenSSL is through with the handshake, so that
+/// reads and writes become plain socket calls.
+///
+/// OpenSSL never sees the socket behind the asio stream, so the keys are set up by hand: TLS 1.3 traffic secrets come
+/// from the key log callback and TLS 1.2 keys are expanded from the master secret, while the message callback counts
+/// the records each direction has already sent under them. AES-GCM and ChaCha20-Poly1305 suites are supported. The
+/// first connection the kernel turns down for want of the tls module switches the offload off for the process.
+class NET4CXX_COMMON_API KernelTLS: public boost::noncopyable {
+public:
+    enum Direction {
+        kSend = 0x01,
+        kReceive = 0x02,
+    };
+
+    /// Installs the callbacks the connections on context report their handshakes through.
+    static void prepareContext(SSL_CTX *context);
+
+    ~KernelTLS();
+
+    /// Has to be called before the handshake of ssl starts.
+    void attach(SSL *ssl);
+
+    /// Moves the directions asked for into the kernel and returns those that made it; the rest stay with OpenSSL.
+    ///
+    /// Called once per connection: the traffic secrets are wiped when it returns.
+    int enable(SSL *ssl, int fd, int directions);
+
+    static bool isAvailable() {
+        return _available;
+    }
+
+    /// Sends close_notify through the kernel, without blocking, and notes it on ssl so that the session stays
+    /// resumable.
+    static void sendCloseNotify(SSL *ssl, int fd);
+
+    /// Reads the non-data record a kernel receive stopped at; tells whether it was the peer's close_notify.
+    static bool receiveCloseNotify(SSL *ssl, int fd);
+protected:
+    struct Traffic {
+        bool started{false};
+        uint64 sequence{0};
+    };
+
+    static int getIndex();
+
+    static void cbKeyLog(const SSL *ssl, const char *line);
+
+    static void cbMessage(int writing, int version, int contentType, const void *buf, size_t length, SSL *ssl,
+                          void *arg);
+
+    /// Checks that the kernel can take over the negotiated version and suite, and attaches its tls layer to fd.
+    bool setUpperLayer(SSL *ssl, int fd);
+
+    /// Wipes the TLS 1.3 traffic secrets and gives their memory back.
+    void releaseSecrets();
+
+    bool setCryptoInfo(SSL *ssl, int fd, bool sending);
+
+    static std::atomic<bool> _available;
+
+    Traffic _send;
+    Traffic _receive;
+    ByteArray _clientSecret;
+    ByteArray _serverSecret;
+};
+
+NS_END
+
+#endif //NET4CXX_HAS_KTLS
+
+#endif //NET4CXX_CORE_NETWORK_KTLS_H
@@ -0,0 +1,428 @@
+//
+// Created by yuwenyong on 17-11-25.
+//
+
+#include "net4cxx/core/network/loopback.h"
+#include "net4cxx/common/debugging/assert.h"
+#include "net4cxx/core/network/protocol.h"
+#include "net4cxx/core/network/reactor.h"
+
+NS_BEGIN
+
+LoopbackConnection::LoopbackConnection(const ProtocolPtr &protocol, std::string name, Reactor *reactor)
+        : Connection(protocol, reactor)
+        , _name(std::move(name)) {
+
+}
+
+void LoopbackConnection::write(const Byte *data, size_t length) {
+    if (_disconnecting || _disconnected || !_connected || length == 0) {
+        return;
+    }
+    if (!_writing && _inFlight < WindowSize) {
+        size_t bytesToSend = std::min(length, WindowSize - _inFlight);
+        handOff(makePacket(data, bytesToSend));
+        if (bytesToSend == length) {
+            return;
+        }
+        data += bytesToSend;
+        length -= bytesToSend;
+    }
+    MessageBuffer packet(length);
+    packet.write(data, length);
+    _writeQueue.emplace_back(std::move(packet));
+    if (_writeQueue.spilled()) {
+        trimLater(shared_from_this());
+    }
+    _writing = true;
+}
+
+void LoopbackConnection::loseConnection() {
+    if (_disconnecting || _disconnected || !_connected) {
+        return;
+    }
+    _error = DisconnectReason(DisconnectReason::kConnectionDone);
+    _disconnecting = true;
+    doClose();
+}
+
+void LoopbackConnection::abortConnection() {
+    if (_disconnecting || _disconnected || !_connected) {
+        return;
+    }
+    _error = DisconnectReason(DisconnectReason::kConnectionAbort);
+    _disconnecting = true;
+    doAbort();
+}
+
+void LoopbackConnection::doClose() {
+    if (!_writing) {
+        _reactor->addCallback([this, self=shared_from_this(), protocol=_protocol.lock()]() {
+            if (!_disconnected) {
+                closeSocket();
+            }
+        });
+    }
+}
+
+void LoopbackConnection::doAbort() {
+    _reactor->addCallback([this, self=shared_from_this(), protocol=_protocol.lock()]() {
+        if (!_disconnected) {
+            closeSocket();
+        }
+    });
+}
+
+void LoopbackConnection::resumeReading() {
+    if (!_readPaused) {
+        return;
+    }
+    _readPaused = false;
+    releaseHeld();
+}
+
+void LoopbackConnection::closeSocket() {
+    auto protocol = std::move(_activeProtocol);
+    if (!_rateLimitCall.cancelled()) {
+        _rateLimitCall.cancel();
+    }
+    _heldPackets.clear();
+    _connected = false;
+    _disconnected = true;
+    _disconnecting = false;
+    if (_peer) {
+        // Queued after every packet already handed off, so the peer sees the data before the close.
+        boost::system::error_code ec = boost::asio::error::eof;
+        if (_error.getType() == DisconnectReason::kConnectionAbort) {
+            ec = boost::asio::error::connection_reset;
+        }
+        DisconnectReason reason(ec);
+        auto peer = std::move(_peer);
+        peer->reactor()->addCallback([peer, reason]() {
+            peer->cbPeerClosed(reason);
+        });
+    }
+    connectionLost(_error);
+}
+
+void LoopbackConnection::cbRefused() {
+    _disconnected = true;
+    if (_peer) {
+        auto peer = std::move(_peer);
+        peer->reactor()->addCallback([peer]() {
+            peer->cbPeerClosed(DisconnectReason(boost::asio::error::connection_reset));
+        });
+    }
+}
+
+MessageBuffer LoopbackConnection::makePacket(const Byte *data, size_t length) {
+    MessageBuffer packet(std::move(_readBuffer));
+    packet.reset();
+    if (packet.getBufferSize() < length) {
+        packet.resize(length);
+    }
+    packet.write(data, length);
+    return packet;
+}
+
+void LoopbackConnection::handOff(MessageBuffer &&packet) {
+    BOOST_ASSERT(_peer);
+    _inFlight += packet.getActiveSize();
+    _peer->reactor()->addCallback([peer=_peer, packet=std::move(packet), self=shared_from_this()]() mutable {
+        peer->cbData(packet, std::move(self));
+    });
+}
+
+void LoopbackConnection::doWrite() {
+    while (!_writeQueue.empty() && _inFlight < WindowSize) {
+        MessageBuffer &buffer = _writeQueue.front();
+        size_t bytesToSend = std::min(buffer.getActiveSize(), WindowSize - _inFlight);
+        if (bytesToSend == buffer.getActiveSize()) {
+            handOff(std::move(buffer));
+            _writeQueue.pop_front();
+            continue;
+        }
+        handOff(makePacket(buffer.getReadPointer(), bytesToSend));
+        buffer.readCompleted(bytesToSend);
+        if (!buffer.getActiveSize()) {
+            _writeQueue.pop_front();
+        }
+    }
+    _writing = !_writeQueue.empty();
+}
+
+void LoopbackConnection::cbData(MessageBuffer &packet, std::shared_ptr<LoopbackConnection> peer) {
+    if (_heldPackets.empty() && !shouldHoldData()) {
+        deliver(packet, peer);
+    } else {
+        _heldPackets.push_back({std::move(packet), std::move(peer)});
+    }
+}
+
+void LoopbackConnection::deliver(MessageBuffer &packet, const std::shared_ptr<LoopbackConnection> &peer) {
+    if (_connected && !_disconnecting) {
+        dataReceived(packet.getReadPointer(), packet.getActiveSize());
+    }
+    if (peer->reactor() == _reactor) {
+        peer->cbAck(packet);
+    } else {
+        peer->reactor()->addCallback([peer, packet=std::move(packet)]() mutable {
+            peer->cbAck(packet);
+        });
+    }
+}
+
+bool LoopbackConnection::shouldHoldData() {
+    return _connected && !_disconnecting &&
+           (_readPaused || _readLimited || (!_rateLimiters.empty() && waitForTokens()));
+}
+
+void LoopbackConnection::releaseHeld() {
+    // A protocol resuming from within dataReceived leaves the rest to the loop already running.
+    if (_releasing) {
+        return;
+    }
+    _releasing = true;
+    while (!_heldPackets.empty() && !_disconnected && !shouldHoldData()) {
+        HeldPacket held = std::move(_heldPackets.front());
+        _heldPackets.pop_front();
+        deliver(held.packet, held.peer);
+    }
+    _releasing = false;
+    if (_heldPackets.empty() && _peerCloseReason) {
+        DisconnectReason reason = std::move(_peerCloseReason);
+        _peerCloseReason = DisconnectReason();
+        cbPeerClosed(reason);
+    }
+}
+
+bool LoopbackConnection::waitForTokens() {
+    Duration delay = getRateLimitDelay();
+    if (delay == Duration::zero()) {
+        return false;
+    }
+    _readLimited = true;
+    _rateLimitCall = _reactor->callLater(delay, [this, self=shared_from_this()]() {
+        _readLimited = false;
+        releaseHeld();
+    });
+    return true;
+}
+
+void LoopbackConnection::cbAck(MessageBuffer &packet) {
+    _inFlight -= packet.getActiveSize();
+    if (packet.getBufferSize() > _readBuffer.getBufferSize()) {
+        _readBuffer = std::move(packet);
+    }
+    if (_disconnected) {
+        return;
+    }
+    if (_readBuffer.getBufferSize() > MessageBuffer::DefaultSize) {
+        trimLater(shared_from_this());
+    }
+    if (_writing) {
+        doWrite();
+        if (!_writing && _disconnecting) {
+            doClose();
+        }
+    }
+}
+
+
+void LoopbackConnection::cbPeerClosed(const DisconnectReason &reason) {
+    if (_disconnected) {
+        return;
+    }
+    if (!_heldPackets.empty() && reason.isClean()) {
+        // The data held back goes first, as it would from a socket.
+        _peerCloseReason = reason;
+        return;
+    }
+    _peer.reset();
+    _error = reason;
+    closeSocket();
+}
+
+
+void LoopbackServerConnection::cbAccept(const ProtocolPtr &protocol) {
+    _protocol = protocol;
+    _activeProtocol = protocol;
+    _connected = true;
+    protocol->makeConnection(shared_from_this());
+}
+
+
+void LoopbackClientConnection::cbConnect(const ProtocolPtr &protocol, std::shared_ptr<LoopbackConnector> connector) {
+    _protocol = protocol;
+    _activeProtocol = protocol;
+    _connector = std::move(connector);
+    _connected = true;
+    protocol->makeConnection(shared_from_this());
+}
+
+void LoopbackClientConnection::closeSocket() {
+    LoopbackConnection::closeSocket();
+    _connector->connectionLost(_error);
+}
+
+
+std::mutex LoopbackListener::_listenersLock;
+std::map<std::string, std::weak_ptr<LoopbackListener>> LoopbackListener::_listeners;
+
+LoopbackListener::LoopbackListener(std::string name, std::unique_ptr<Factory> &&factory, Reactor *reactor)
+        : Listener(reactor)
+        , _name(std::move(name))
+        , _factory(std::move(factory)) {
+#ifndef NET4CXX_NDEBUG
+    NET4CXX_Watcher->inc(NET4CXX_LoopbackListener_COUNT);
+#endif
+}
+
+void LoopbackListener::startListening() {
+    {
+        std::lock_guard<std::mutex> lock(_listenersLock);
+        auto &listener = _listeners[_name];
+        if (!listener.expired()) {
+            NET4CXX_THROW_EXCEPTION(AlreadyExist, "Loopback address already in use: " + _name);
+        }
+        listener = shared_from_this();
+    }
+    NET4CXX_INFO(gGenLog, "LoopbackListener starting on %s", _name.c_str());
+    _factory->doStart();
+    _connected = true;
+}
+
+void LoopbackListener::stopListening() {
+    if (_connected) {
+        _connected = false;
+        {
+            std::lock_guard<std::mutex> lock(_listenersLock);
+            _listeners.erase(_name);
+        }
+        _factory->doStop();
+        NET4CXX_INFO(gGenLog, "LoopbackListener closed on %s", _name.c_str());
+    }
+}
+
+std::shared_ptr<LoopbackListener> LoopbackListener::find(const std::string &name) {
+    std::lock_guard<std::mutex> lock(_listenersLock);
+    auto iter = _listeners.find(name);
+    if (iter == _listeners.end()) {
+        return nullptr;
+    }
+    return iter->second.lock();
+}
+
+void LoopbackListener::cbAccept(std::shared_ptr<LoopbackServerConnection> connection) {
+    ProtocolPtr protocol;
+    if (_connected) {
+        Address address{_name, 0};
+        protocol = _factory->buildProtocol(address);
+    }
+    if (protocol) {
+        connection->cbAccept(protocol);
+    } else {
+        connection->cbRefused();
+    }
+}
+
+
+LoopbackConnector::LoopbackConnector(std::string name, std::unique_ptr<ClientFactory> &&factory, Reactor *reactor)
+        : Connector(reactor)
+        , _name(std::move(name))
+        , _factory(std::move(factory)) {
+#ifndef NET4CXX_NDEBUG
+    NET4CXX_Watcher->inc(NET4CXX_LoopbackConnector_COUNT);
+#endif
+}
+
+void LoopbackConnector::startConnecting() {
+    if (_state != kDisconnected) {
+        NET4CXX_THROW_EXCEPTION(Exception, "Can't connect in this state");
+    }
+    _state = kConnecting;
+    if (!_factoryStarted) {
+        _factory->doStart();
+        _factoryStarted = true;
+    }
+    doConnect();
+    _factory->startedConnecting(shared_from_this());
+}
+
+void LoopbackConnector::stopConnecting() {
+    if (_state != kConnecting) {
+        NET4CXX_THROW_EXCEPTION(NotConnectingError, "We're not trying to connect");
+    }
+    _error = NET4CXX_EXCEPTION_PTR(UserAbort, "");
+    _state = kDisconnected;
+}
+
+void LoopbackConnector::connectionFailed(std::exception_ptr reason) {
+    if (reason) {
+        _error = std::move(reason);
+    }
+    _state = kDisconnected;
+    _factory->clientConnectionFailed(shared_from_this(), _error);
+    if (_state == kDisconnected) {
+        _factory->doStop();
+        _factoryStarted = false;
+    }
+}
+
+void LoopbackConnector::connectionLost(const DisconnectReason &reason) {
+    _state = kDisconnected;
+    _factory->clientConnectionLost(shared_from_this(), reason);
+    if (_state == kDisconnected) {
+        _factory->doStop();
+        _factoryStarted = false;
+    }
+}
+
+ProtocolPtr LoopbackConnector::buildProtocol(const Address &address) {
+    _state = kConnected;
+    return _factory->buildProtocol(address);
+}
+
+void LoopbackConnector::doConnect() {
+    auto listener = LoopbackListener::find(_name);
+    if (!listener) {
+        _reactor->addCallback([this, self=shared_from_this()]() {
+            if (_state == kConnecting) {
+                NET4CXX_ERROR(gGenLog, "Connect error : No loopback listener on %s", _name.c_str());
+                _error = std::make_exception_ptr(boost::system::system_error(
+                        boost::asio::error::connection_refused));
+            }
+            connectionFailed();
+        });
+        return;
+    }
+    auto connection = std::make_shared<LoopbackClientConnection>(_name, _reactor);
+    auto serverConnection = std::make_shared<LoopbackServerConnection>(_name, listener->reactor());
+    connection->setPeer(serverConnection);
+    serverConnection->setPeer(connection);
+    // The client half is queued first: anything the server writes from connectionMade lands behind it.
+    _reactor->addCallback([this, self=shared_from_this(), connection]() {
+        cbConnect(connection);
+    });
+    listener->reactor()->addCallback([listener, serverConnection]() {
+        listener->cbAccept(serverConnection);
+    });
+}
+
+void LoopbackConnector::handleConnect(std::shared_ptr<LoopbackClientConnection> connection) {
+    if (_state != kConnecting) {
+        connection->cbRefused();
+        connectionFailed();
+        return;
+    }
+    Address address{_name, 0};
+    auto protocol = buildProtocol(address);
+    if (!protocol) {
+        connection->cbRefused();
+        connectionLost();
+    } else {
+        connection->cbConnect(protocol, shared_from_this());
+    }
+}
+
+NS_END
@@ -0,0 +1,255 @@
+//
+// Created by yuwenyong on 17-11-25.
+//
+
+#ifndef NET4CXX_CORE_NETWORK_LOOPBACK_H
+#define NET4CXX_CORE_NETWORK_LOOPBACK_H
+
+#include "net4cxx/common/common.h"
+#include <list>
+#include <mutex>
+#include <boost/asio.hpp>
+#include "net4cxx/common/debugging/watcher.h"
+#include "net4cxx/common/global/loggers.h"
+#include "net4cxx/core/network/base.h"
+
+NS_BEGIN
+
+class Factory;
+class ClientFactory;
+class LoopbackConnector;
+
+
+/// One half of an in-process connection pair.
+///
+/// Packets are handed to the peer by posting them on the peer's reactor, so the two halves may live on different
+/// reactors. At most WindowSize bytes are in flight at a time; the rest waits in the write queue until the peer has
+/// delivered what it was given, the same way a socket send buffer would push back; a paused or rate limited half
+/// holds the packets, and so the acknowledgements. Delivered packets come back with the acknowledgement and the
+/// largest is parked in the otherwise unused read buffer for the next write, where the idle trim can release it.
+class NET4CXX_COMMON_API LoopbackConnection: public Connection,
+                                             public std::enable_shared_from_this<LoopbackConnection> {
+public:
+    static constexpr size_t WindowSize = 65536;
+
+    LoopbackConnection(const ProtocolPtr &protocol, std::string name, Reactor *reactor);
+
+    void setPeer(std::shared_ptr<LoopbackConnection> peer) {
+        _peer = std::move(peer);
+    }
+
+    void cbRefused();
+
+    void write(const Byte *data, size_t length) override;
+
+    void loseConnection() override;
+
+    void abortConnection() override;
+
+    bool getNoDelay() const override {
+        return true;
+    }
+
+    void setNoDelay(bool enabled) override {
+
+    }
+
+    bool getKeepAlive() const override {
+        return false;
+    }
+
+    void setKeepAlive(bool enabled) override {
+
+    }
+
+    std::string getLocalAddress() const override {
+        return _name;
+    }
+
+    unsigned short getLocalPort() const override {
+        return 0;
+    }
+
+    std::string getRemoteAddress() const override {
+        return _name;
+    }
+
+    unsigned short getRemotePort() const override {
+        return 0;
+    }
+
+    void resumeReading() override;
+
+    bool canPauseReading() const override {
+        return true;
+    }
+protected:
+    struct HeldPacket {
+        MessageBuffer packet;
+        std::shared_ptr<LoopbackConnection> peer;
+    };
+
+    void doClose();
+
+    void doAbort();
+
+    virtual void closeSocket();
+
+    MessageBuffer makePacket(const Byte *data, size_t length);
+
+    void handOff(MessageBuffer &&packet);
+
+    void doWrite();
+
+    void cbData(MessageBuffer &packet, std::shared_ptr<LoopbackConnection> peer);
+
+    void deliver(MessageBuffer &packet, const std::shared_ptr<LoopbackConnection> &peer);
+
+    /// Whether incoming packets have to be held, with their acknowledgements; arms the refill timer when a rate
+    /// limiter is what holds them.
+    bool shouldHoldData();
+
+    void releaseHeld();
+
+    bool waitForTokens();
+
+    /// Runs without calling into the protocol, so a peer on the same reactor acknowledges inline.
+    void cbAck(MessageBuffer &packet);
+
+    void cbPeerClosed(const DisconnectReason &reason);
+
+    std::string _name;
+    // Stands in for the protocol reference a pending socket read would hold.
+    ProtocolPtr _activeProtocol;
+    std::shared_ptr<LoopbackConnection> _peer;
+    size_t _inFlight{0};
+    DisconnectReason _error;
+    std::list<HeldPacket> _heldPackets;
+    DisconnectReason _peerCloseReason;
+    bool _releasing{false};
+    bool _readLimited{false};
+    DelayedCall _rateLimitCall;
+};
+
+
+class NET4CXX_COMMON_API LoopbackServerConnection: public LoopbackConnection {
+public:
+    LoopbackServerConnection(std::string name, Reactor *reactor)
+            : LoopbackConnection({}, std::move(name), reactor) {
+#ifndef NET4CXX_NDEBUG
+        NET4CXX_Watcher->inc(NET4CXX_LoopbackServerConnection_COUNT);
+#endif
+    }
+
+#ifndef NET4CXX_NDEBUG
+    ~LoopbackServerConnection() override {
+        NET4CXX_Watcher->dec(NET4CXX_LoopbackServerConnection_COUNT);
+    }
+#endif
+
+    void cbAccept(const ProtocolPtr &protocol);
+};
+
+
+class NET4CXX_COMMON_API LoopbackClientConnection: public LoopbackConnection {
+public:
+    LoopbackClientConnection(std::string name, Reactor *reactor)
+            : LoopbackConnection({}, std::move(name), reactor) {
+#ifndef NET4CXX_NDEBUG
+        NET4CXX_Watcher->inc(NET4CXX_LoopbackClientConnection_COUNT);
+#endif
+    }
+
+#ifndef NET4CXX_NDEBUG
+    ~LoopbackClientConnection() override {
+        NET4CXX_Watcher->dec(NET4CXX_LoopbackClientConnection_COUNT);
+    }
+#endif
+
+    void cbConnect(const ProtocolPtr &protocol, std::shared_ptr<LoopbackConnector> connector);
+protected:
+    void closeSocket() override;
+
+    std::shared_ptr<LoopbackConnector> _connector;
+};
+
+
+class NET4CXX_COMMON_API LoopbackListener: public Listener, public std::enable_shared_from_this<LoopbackListener> {
+public:
+    LoopbackListener(std::string name, std::unique_ptr<Factory> &&factory, Reactor *reactor);
+
+#ifndef NET4CXX_NDEBUG
+    ~LoopbackListener() override {
+        NET4CXX_Watcher->dec(NET4CXX_LoopbackListener_COUNT);
+    }
+#endif
+
+    void startListening() override;
+
+    void stopListening() override;
+
+    std::string getLocalAddress() const {
+        return _name;
+    }
+
+    unsigned short getLocalPort() const {
+        return 0;
+    }
+
+    static std::shared_ptr<LoopbackListener> find(const std::string &name);
+
+    void cbAccept(std::shared_ptr<LoopbackServerConnection> connection);
+protected:
+    std::string _name;
+    std::unique_ptr<Factory> _factory;
+    bool _connected{false};
+
+    static std::mutex _listenersLock;
+    static std::map<std::string, std::weak_ptr<LoopbackListener>> _listeners;
+};
+
+
+class NET4CXX_COMMON_API LoopbackConnector: public Connector, public std::enable_shared_from_this<LoopbackConnector> {
+public:
+    LoopbackConnector(std::string name, std::unique_ptr<ClientFactory> &&factory, Reactor *reactor);
+
+#ifndef NET4CXX_NDEBUG
+    ~LoopbackConnector() override {
+        NET4CXX_Watcher->dec(NET4CXX_LoopbackConnector_COUNT);
+    }
+#endif
+
+    void startConnecting() override;
+
+    void stopConnecting() override;
+
+    void connectionFailed(std::exception_ptr reason={});
+
+    void connectionLost(const DisconnectReason &reason={});
+protected:
+    ProtocolPtr buildProtocol(const Address &address);
+
+    void doConnect();
+
+    void cbConnect(std::shared_ptr<LoopbackClientConnection> connection) {
+        handleConnect(std::move(connection));
+    }
+
+    void handleConnect(std::shared_ptr<LoopbackClientConnection> connection);
+
+    enum State {
+        kDisconnected,
+        kConnecting,
+        kConnected,
+    };
+
+    std::string _name;
+    std::unique_ptr<ClientFactory> _factory;
+    State _state{kDisconnected};
+    bool _factoryStarted{false};
+    std::exception_ptr _error;
+};
+
+NS_END
+
+#endif //NET4CXX_CORE_NETWORK_LOOPBACK_H
@@ -0,0 +1,60 @@
+//
+// Created by yuwenyong on 17-12-1.
+//
+
+#include "net4cxx/core/network/loopmonitor.h"
+#include <boost/core/demangle.hpp>
+#include "net4cxx/common/global/loggers.h"
+
+#ifdef NET4CXX_HAS_LOOP_STATS
+
+NS_BEGIN
+
+thread_local LoopMonitor* LoopMonitor::_current = nullptr;
+
+LoopMonitor::LoopMonitor()
+        : _resetTime(TimestampClock::now()) {
+
+}
+
+double LoopMonitor::getIterationsPerSecond() const {
+    double seconds = std::chrono::duration<double>(TimestampClock::now() - _resetTime).count();
+    return seconds > 0.0 ? (double)_iterations / seconds : 0.0;
+}
+
+void LoopMonitor::reset() {
+    for (auto &histogram: _handlerDurations) {
+        histogram.reset();
+    }
+    _timerLag.reset();
+    _queueDepth.reset();
+    _lastTimerLag = Duration::zero();
+    _iterations = 0;
+    _slowHandlers = 0;
+    _resetTime = TimestampClock::now();
+}
+
+void LoopMonitor::finishHandler() {
+    Duration elapsed = TimestampClock::now() - _handlerStart;
+    _handlerDurations[_handlerKind].record((uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            elapsed).count());
+    ++_iterations;
+    if (_slowHandlerThreshold > Duration::zero() && elapsed >= _slowHandlerThreshold) {
+        if (_slowHandlers++ % _slowHandlerSampling == 0) {
+            static const char *kindNames[kHandlerKindCount] = {"callback", "timer", "io", "thread callback"};
+            NET4CXX_WARN(gGenLog, "Slow %s handler took %.3fms: %s", kindNames[_handlerKind],
+                         std::chrono::duration<double, std::milli>(elapsed).count(),
+                         boost::core::demangle(_handlerType->name()).c_str());
+        }
+    }
+}
+
+void LoopMonitor::timerFired(const Timestamp &deadline) {
+    Duration lag = std::max(TimestampClock::now() - deadline, Duration::zero());
+    _lastTimerLag = lag;
+    _timerLag.record((uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(lag).count());
+}
+
+NS_END
+
+#endif //NET4CXX_HAS_LOOP_STATS
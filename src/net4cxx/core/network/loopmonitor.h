@@ -0,0 +1,182 @@
+//
+// Created by yuwenyong on 17-12-1.
+//
+
+#ifndef NET4CXX_CORE_NETWORK_LOOPMONITOR_H
+#define NET4CXX_CORE_NETWORK_LOOPMONITOR_H
+
+#include "net4cxx/common/common.h"
+#include <atomic>
+#include <typeinfo>
+#include <boost/noncopyable.hpp>
+#include "net4cxx/common/utilities/histogram.h"
+
+#ifdef NET4CXX_HAS_LOOP_STATS
+
+NS_BEGIN
+
+
+/// Event-loop lag and handler latency of one reactor, built in when the NET4CXX_LOOP_STATS CMake option is on.
+///
+/// Every handler the reactor runs is timed: callbacks posted with addCallback, timers, I/O completions wrapped by
+/// makeCustomAllocHandler and callbacks delivered with callFromThread, each into its own histogram. Timers also
+/// record how late they fired against their deadline, which is the loop lag, and the queue depth histogram holds
+/// how many posted callbacks were waiting when each of them ran and the size of every callFromThread batch. A handler
+/// that runs inside another one, such as a timer callback inside its completion handler, is accounted to the
+/// innermost kind. Durations are in nanoseconds.
+///
+/// Only the reactor thread may read the histograms; the queue depth counter is the only state written by other
+/// threads.
+class NET4CXX_COMMON_API LoopMonitor: public boost::noncopyable {
+public:
+    enum HandlerKind {
+        kCallback,
+        kTimer,
+        kIo,
+        kThreadCallback,
+        kHandlerKindCount,
+    };
+
+    /// Times the handler run in its lifetime on the reactor of the calling thread, if it has monitoring enabled.
+    class HandlerScope {
+    public:
+        HandlerScope(HandlerKind kind, const std::type_info &type)
+                : _monitor(_current) {
+            if (_monitor) {
+                _monitor->enterHandler(kind, type);
+            }
+        }
+
+        HandlerScope(const HandlerScope&) = delete;
+
+        HandlerScope& operator=(const HandlerScope&) = delete;
+
+        ~HandlerScope() {
+            if (_monitor) {
+                _monitor->leaveHandler();
+            }
+        }
+    protected:
+        LoopMonitor *_monitor;
+    };
+
+    LoopMonitor();
+
+    /// Makes this the monitor of the calling thread if it is enabled; called by Reactor::run.
+    void makeCurrent() {
+        _current = _enabled ? this : nullptr;
+    }
+
+    /// Takes effect the next time the reactor starts running.
+    void setEnabled(bool enabled) {
+        _enabled = enabled;
+    }
+
+    bool getEnabled() const {
+        return _enabled;
+    }
+
+    /// Logs handlers that run longer than threshold, one in every sampling of them; zero turns the log off.
+    void setSlowHandlerLog(const Duration &threshold, size_t sampling=1) {
+        _slowHandlerThreshold = threshold;
+        _slowHandlerSampling = std::max(sampling, (size_t)1);
+    }
+
+    const Histogram& getHandlerDuration(HandlerKind kind) const {
+        return _handlerDurations[kind];
+    }
+
+    const Histogram& getTimerLag() const {
+        return _timerLag;
+    }
+
+    const Histogram& getQueueDepth() const {
+        return _queueDepth;
+    }
+
+    /// Lag of the most recent timer, a cheap current reading of how far behind the loop is.
+    const Duration& getLastTimerLag() const {
+        return _lastTimerLag;
+    }
+
+    /// Handlers run since the last reset; every handler the loop dispatches counts as one iteration.
+    uint64 getIterations() const {
+        return _iterations;
+    }
+
+    double getIterationsPerSecond() const;
+
+    size_t getSlowHandlers() const {
+        return _slowHandlers;
+    }
+
+    void reset();
+
+    void callbackPosted() {
+        _pendingCallbacks.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void callbackStarted() {
+        size_t depth = _pendingCallbacks.fetch_sub(1, std::memory_order_relaxed);
+        _queueDepth.record(depth);
+    }
+
+    void recordQueueDepth(size_t depth) {
+        _queueDepth.record(depth);
+    }
+
+    static LoopMonitor* current() {
+        return _current;
+    }
+
+    static void restoreCurrent(LoopMonitor *monitor) {
+        _current = monitor;
+    }
+
+    static void recordTimerFired(const Timestamp &deadline) {
+        if (_current) {
+            _current->timerFired(deadline);
+        }
+    }
+protected:
+    void enterHandler(HandlerKind kind, const std::type_info &type) {
+        if (_depth++ == 0) {
+            _handlerStart = TimestampClock::now();
+        }
+        _handlerKind = kind;
+        _handlerType = &type;
+    }
+
+    void leaveHandler() {
+        if (--_depth == 0) {
+            finishHandler();
+        }
+    }
+
+    void finishHandler();
+
+    void timerFired(const Timestamp &deadline);
+
+    bool _enabled{true};
+    Duration _slowHandlerThreshold{0};
+    size_t _slowHandlerSampling{1};
+    size_t _slowHandlers{0};
+    int _depth{0};
+    Timestamp _handlerStart;
+    HandlerKind _handlerKind{kCallback};
+    const std::type_info *_handlerType{nullptr};
+    std::array<Histogram, kHandlerKindCount> _handlerDurations;
+    Histogram _timerLag;
+    Histogram _queueDepth;
+    Duration _lastTimerLag{0};
+    uint64 _iterations{0};
+    Timestamp _resetTime;
+    std::atomic<size_t> _pendingCallbacks{0};
+    thread_local static LoopMonitor *_current;
+};
+
+NS_END
+
+#endif //NET4CXX_HAS_LOOP_STATS
+
+#endif //NET4CXX_CORE_NETWORK_LOOPMONITOR_H
@@ -35,6 +35,22 @@ void Factory::stopFactory() {
 
 }
 
+bool Factory::admitUnderOverload(const Address &address) {
+    return false;
+}
+
+std::string Factory::getOverloadResponse(const Address &address) {
+    return {};
+}
+
+bool Factory::allowThrottle(const ProtocolPtr &protocol) {
+    return true;
+}
+
+void Factory::overloadStateChanged(bool overloaded) {
+
+}
+
 
 void ClientFactory::startedConnecting(ConnectorPtr connector) {
 
@@ -48,6 +64,10 @@ void ClientFactory::clientConnectionLost(ConnectorPtr connector, std::exception_
 
 }
 
+void ClientFactory::clientConnectionLost(ConnectorPtr connector, const DisconnectReason &reason) {
+    clientConnectionLost(std::move(connector), reason.getException());
+}
+
 
 ProtocolPtr OneShotFactory::buildProtocol(const Address &address) {
     return _protocol;
@@ -119,4 +139,8 @@ void Protocol::connectionLost(std::exception_ptr reason) {
 
 }
 
+void Protocol::connectionLost(const DisconnectReason &reason) {
+    connectionLost(reason.getException());
+}
+
 NS_END
\ No newline at end of file
@@ -27,6 +27,18 @@ public:
     virtual void stopFactory();
 
     virtual ProtocolPtr buildProtocol(const Address &address) = 0;
+
+    /// Asked for every connection accepted while an AdmissionController reports overload; true lets it in anyway.
+    virtual bool admitUnderOverload(const Address &address);
+
+    /// Written to a connection turned away under overload before it is closed; empty closes it without a word.
+    virtual std::string getOverloadResponse(const Address &address);
+
+    /// Asked before reading is paused on one of the connections with the most traffic; false exempts it.
+    virtual bool allowThrottle(const ProtocolPtr &protocol);
+
+    /// Called when a listener serving this factory starts or stops shedding load.
+    virtual void overloadStateChanged(bool overloaded);
 protected:
     int _numPorts{0};
 };
@@ -39,6 +51,8 @@ public:
     virtual void clientConnectionFailed(ConnectorPtr connector, std::exception_ptr reason);
 
     virtual void clientConnectionLost(ConnectorPtr connector, std::exception_ptr reason);
+
+    virtual void clientConnectionLost(ConnectorPtr connector, const DisconnectReason &reason);
 };
 
 
@@ -61,6 +75,8 @@ public:
 
     void clientConnectionLost(ConnectorPtr connector, std::exception_ptr reason) override;
 
+    using ClientFactory::clientConnectionLost;
+
     void stopTrying();
 
     double getMaxDelay() const {
@@ -116,6 +132,8 @@ public:
 
     virtual void connectionLost(std::exception_ptr reason);
 
+    virtual void connectionLost(const DisconnectReason &reason);
+
     void makeConnection(ConnectionPtr transport) {
         _connected = true;
         _transport = std::move(transport);
@@ -153,6 +171,21 @@ public:
         _transport->abortConnection();
     }
 
+    void pauseReading() {
+        BOOST_ASSERT(_transport);
+        _transport->pauseReading();
+    }
+
+    void resumeReading() {
+        BOOST_ASSERT(_transport);
+        _transport->resumeReading();
+    }
+
+    void addRateLimiter(RateLimiterPtr limiter) {
+        BOOST_ASSERT(_transport);
+        _transport->addRateLimiter(std::move(limiter));
+    }
+
     bool getNoDelay() const {
         BOOST_ASSERT(_transport);
         return _transport->getNoDelay();
@@ -192,6 +225,11 @@ public:
         BOOST_ASSERT(_transport);
         return _transport->getRemotePort();
     }
+
+    size_t getMemoryUsage() const {
+        BOOST_ASSERT(_transport);
+        return _transport->getMemoryUsage();
+    }
 protected:
     bool _connected{false};
     ConnectionPtr _transport;
@@ -0,0 +1,21 @@
+//
+// Created by yuwenyong on 17-12-3.
+//
+
+#include "net4cxx/core/network/ratelimit.h"
+
+
+NS_BEGIN
+
+Duration TokenBucket::getDelay(const Timestamp &now) {
+    if (_rate <= 0.0) {
+        return Duration::zero();
+    }
+    refill(now);
+    if (_tokens >= 1.0) {
+        return Duration::zero();
+    }
+    return std::chrono::duration_cast<Duration>(std::chrono::duration<double>((1.0 - _tokens) / _rate));
+}
+
+NS_END
@@ -0,0 +1,98 @@
+//
+// Created by yuwenyong on 17-12-3.
+//
+
+#ifndef NET4CXX_CORE_NETWORK_RATELIMIT_H
+#define NET4CXX_CORE_NETWORK_RATELIMIT_H
+
+#include "net4cxx/common/common.h"
+
+NS_BEGIN
+
+
+/// Token bucket refilled continuously at rate tokens per second up to burst, which is at least one token; a rate of
+/// zero never runs dry.
+///
+/// Consumption may overdraw the bucket, so a large read is charged in full and paid back before the next one.
+class NET4CXX_COMMON_API TokenBucket {
+public:
+    TokenBucket(double rate, double burst, const Timestamp &now)
+            : _rate(rate)
+            , _burst(std::max(burst > 0.0 ? burst : rate, 1.0))
+            , _tokens(_burst)
+            , _lastRefill(now) {
+
+    }
+
+    void consume(double tokens, const Timestamp &now) {
+        if (_rate > 0.0) {
+            refill(now);
+            _tokens -= tokens;
+        }
+    }
+
+    /// Time until at least one token is available, zero if one already is.
+    Duration getDelay(const Timestamp &now);
+
+    double getRate() const {
+        return _rate;
+    }
+
+    double getBurst() const {
+        return _burst;
+    }
+protected:
+    void refill(const Timestamp &now) {
+        double elapsed = std::chrono::duration<double>(now - _lastRefill).count();
+        _lastRefill = now;
+        _tokens = std::min(_tokens + elapsed * _rate, _burst);
+    }
+
+    double _rate;
+    double _burst;
+    double _tokens;
+    Timestamp _lastRefill;
+};
+
+
+/// Limits for RateLimiter; a zero rate leaves that dimension unlimited and a zero burst defaults to one second's worth.
+struct RateLimit {
+    double bytesPerSecond{0.0};
+    double bytesBurst{0.0};
+    double readsPerSecond{0.0};
+    double readsBurst{0.0};
+
+    bool isLimited() const {
+        return bytesPerSecond > 0.0 || readsPerSecond > 0.0;
+    }
+};
+
+
+/// Bytes and reads buckets charged by the connections it is attached to; sharing one among connections makes them
+/// draw from the same budget.
+class NET4CXX_COMMON_API RateLimiter {
+public:
+    explicit RateLimiter(const RateLimit &limit, const Timestamp &now=TimestampClock::now())
+            : _bytes(limit.bytesPerSecond, limit.bytesBurst, now)
+            , _reads(limit.readsPerSecond, limit.readsBurst, now) {
+
+    }
+
+    void charge(size_t bytes, const Timestamp &now) {
+        _bytes.consume((double)bytes, now);
+        _reads.consume(1.0, now);
+    }
+
+    Duration getDelay(const Timestamp &now) {
+        return std::max(_bytes.getDelay(now), _reads.getDelay(now));
+    }
+protected:
+    TokenBucket _bytes;
+    TokenBucket _reads;
+};
+
+using RateLimiterPtr = std::shared_ptr<RateLimiter>;
+
+NS_END
+
+#endif //NET4CXX_CORE_NETWORK_RATELIMIT_H
@@ -5,20 +5,69 @@
 #include "net4cxx/core/network/reactor.h"
 #include "net4cxx/common/global/loggers.h"
 #include "net4cxx/common/utilities/random.h"
+#include "net4cxx/core/network/affinity.h"
+#include "net4cxx/core/network/loopback.h"
 #include "net4cxx/core/network/protocol.h"
+#include "net4cxx/core/network/shm.h"
 #include "net4cxx/core/network/ssl.h"
 #include "net4cxx/core/network/tcp.h"
 #include "net4cxx/core/network/unix.h"
+#include "net4cxx/core/network/uring.h"
+#ifdef BOOST_ASIO_HAS_EVENTFD
+#include <sys/eventfd.h>
+#endif
 
 
 NS_BEGIN
 
 thread_local Reactor* Reactor::_current = nullptr;
 
-Reactor::Reactor()
-        : _ioService()
-        , _signalSet(_ioService) {
+Reactor::Reactor(Backend backend)
+        : _deferredPool()
+        , _ioService()
+        , _signalSet(_ioService)
+        , _readScratch(65536)
+        , _coroutineStacks(CoroutineStackSize, 16)
+#ifdef BOOST_ASIO_HAS_EVENTFD
+        , _wakeUpDescriptor(_ioService)
+#endif
+{
+    int cpu = ReactorPlacement::nextDefaultCpu();
+    if (cpu >= 0) {
+        _cpuAffinity.push_back(cpu);
+    }
+    _numaBind = ReactorPlacement::getDefaultNumaBind();
+    _steerIncomingCpu = ReactorPlacement::getDefaultSteerIncomingCpu();
+#ifdef BOOST_ASIO_HAS_EVENTFD
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd == -1) {
+        NET4CXX_THROW_EXCEPTION(IOError, "eventfd failed");
+    }
+    _wakeUpDescriptor.assign(fd);
+    waitWakeUp();
+#endif
+    if (backend == Backend::kURing) {
+#ifdef NET4CXX_HAS_URING
+        try {
+            _uring = std::make_unique<URing>(_ioService);
+        } catch (std::exception &e) {
+            NET4CXX_ERROR(gGenLog, "io_uring backend unavailable, falling back to epoll:%s", e.what());
+        }
+#else
+        NET4CXX_ERROR(gGenLog, "io_uring backend not supported on this platform, falling back to epoll");
+#endif
+    }
+}
 
+Reactor::~Reactor() {
+    // Workers deliver through callFromThread, stop them before the queue goes away.
+    _threadPool.reset();
+    ThreadCallback *callback = _threadCallbacks.exchange(nullptr, std::memory_order_acquire);
+    while (callback) {
+        ThreadCallback *next = callback->_next;
+        delete callback;
+        callback = next;
+    }
 }
 
 void Reactor::run(bool installSignalHandlers) {
@@ -31,12 +80,32 @@ void Reactor::run(bool installSignalHandlers) {
     }
     Reactor *oldCurrent = _current;
     _current = this;
+#ifdef NET4CXX_HAS_LOOP_STATS
+    LoopMonitor *oldMonitor = LoopMonitor::current();
+    _loopMonitor.makeCurrent();
+#endif
     WorkType work(_ioService);
+    applyPlacement();
     startRunning(installSignalHandlers);
     _running = false;
+#ifdef NET4CXX_HAS_LOOP_STATS
+    LoopMonitor::restoreCurrent(oldMonitor);
+#endif
     _current = oldCurrent;
 }
 
+ThreadPool* Reactor::getThreadPool() {
+    if (!_threadPool) {
+        size_t size = _threadPoolSize;
+        if (size == 0) {
+            size = std::max(std::thread::hardware_concurrency(), 4u);
+        }
+        _threadPool = std::make_unique<ThreadPool>(size, _threadPoolMaxQueued);
+        _threadPool->start();
+    }
+    return _threadPool.get();
+}
+
 void Reactor::stop() {
     if (_ioService.stopped()) {
         NET4CXX_THROW_EXCEPTION(ReactorNotRunning, "Can't stop reactor that isn't running.");
@@ -49,8 +118,11 @@ void Reactor::stop() {
 }
 
 ListenerPtr Reactor::listenTCP(const std::string &port, std::unique_ptr<Factory> &&factory,
-                               const std::string &interface) {
+                               const std::string &interface, std::shared_ptr<AdmissionController> admission) {
     auto l = std::make_shared<TCPListener>(port, std::move(factory), interface, this);
+    if (admission) {
+        l->setAdmissionController(std::move(admission));
+    }
     l->startListening();
     return l;
 }
@@ -94,6 +166,40 @@ ConnectorPtr Reactor::connectUNIX(const std::string &path, std::unique_ptr<Clien
 
 #endif
 
+ListenerPtr Reactor::listenLoopback(const std::string &name, std::unique_ptr<Factory> &&factory) {
+    auto l = std::make_shared<LoopbackListener>(name, std::move(factory), this);
+    l->startListening();
+    return l;
+}
+
+ConnectorPtr Reactor::connectLoopback(const std::string &name, std::unique_ptr<ClientFactory> &&factory) {
+    auto c = std::make_shared<LoopbackConnector>(name, std::move(factory), this);
+    c->startConnecting();
+    return c;
+}
+
+#ifdef NET4CXX_HAS_SHM_TRANSPORT
+
+ListenerPtr Reactor::listenSHM(const std::string &path, std::unique_ptr<Factory> &&factory, size_t capacity,
+                               int busyPoll) {
+    size_t ringCapacity = 4096;
+    while (ringCapacity < capacity && ringCapacity < SHMRing::MaxCapacity) {
+        ringCapacity <<= 1;
+    }
+    auto l = std::make_shared<SHMListener>(path, std::move(factory), ringCapacity, busyPoll, this);
+    l->startListening();
+    return l;
+}
+
+ConnectorPtr Reactor::connectSHM(const std::string &path, std::unique_ptr<ClientFactory> &&factory, int busyPoll,
+                                 double timeout) {
+    auto c = std::make_shared<SHMConnector>(path, std::move(factory), busyPoll, timeout, this);
+    c->startConnecting();
+    return c;
+}
+
+#endif
+
 void Reactor::startRunning(bool installSignalHandlers) {
     if (installSignalHandlers) {
         _installSignalHandlers = installSignalHandlers;
@@ -102,7 +208,11 @@ void Reactor::startRunning(bool installSignalHandlers) {
     _running = true;
     while (!_ioService.stopped()) {
         try {
-            _ioService.run();
+            if (_busyPollWindow > Duration::zero()) {
+                runBusyPoll();
+            } else {
+                _ioService.run();
+            }
         } catch (std::exception &e) {
             NET4CXX_ERROR(gAppLog, "Unexpected Exception:%s", e.what());
         } catch (...) {
@@ -111,6 +221,121 @@ void Reactor::startRunning(bool installSignalHandlers) {
     }
 }
 
+void Reactor::applyPlacement() {
+    if (!_cpuAffinity.empty() && !ReactorPlacement::pinCurrentThread(_cpuAffinity)) {
+        NET4CXX_ERROR(gGenLog, "Failed to pin reactor thread to %d CPUs starting at %d", (int)_cpuAffinity.size(),
+                      _cpuAffinity.front());
+    }
+    _numaNode = ReactorPlacement::getCurrentNumaNode();
+    if (_numaBind && _numaNode >= 0) {
+        if (ReactorPlacement::bindMemory(_numaNode)) {
+            // The scratch buffer was touched by the constructing thread; fault it in again on the local node.
+            ByteArray(_readScratch.size()).swap(_readScratch);
+        } else {
+            NET4CXX_ERROR(gGenLog, "Failed to bind reactor memory to node %d", _numaNode);
+        }
+    }
+}
+
+void Reactor::runBusyPoll() {
+    Timestamp idleSince = TimestampClock::now();
+    while (!_ioService.stopped()) {
+        ++_loopStats.iterations;
+        if (_ioService.poll()) {
+            idleSince = TimestampClock::now();
+            continue;
+        }
+        ++_loopStats.idleSpins;
+        if (TimestampClock::now() - idleSince >= _busyPollWindow) {
+            ++_loopStats.blockingWaits;
+            _ioService.run_one();
+            idleSince = TimestampClock::now();
+        }
+    }
+}
+
+void Reactor::wakeUp() {
+    _wakeUpRequested.store(TimestampClock::now().time_since_epoch().count(), std::memory_order_relaxed);
+#ifdef BOOST_ASIO_HAS_EVENTFD
+    uint64_t counter = 1;
+    ssize_t result;
+    do {
+        result = ::write(_wakeUpDescriptor.native_handle(), &counter, sizeof(counter));
+    } while (result == -1 && errno == EINTR);
+#else
+    _ioService.post([this]() {
+        runThreadCallbacks();
+    });
+#endif
+}
+
+void Reactor::waitWakeUp() {
+#ifdef BOOST_ASIO_HAS_EVENTFD
+    _wakeUpDescriptor.async_wait(boost::asio::posix::stream_descriptor::wait_read,
+                                 [this](const boost::system::error_code &ec) {
+        if (ec) {
+            return;
+        }
+        // Reset the counter before taking the batch: a push landing after the exchange must raise it again.
+        uint64_t counter;
+        ssize_t result;
+        do {
+            result = ::read(_wakeUpDescriptor.native_handle(), &counter, sizeof(counter));
+        } while (result == -1 && errno == EINTR);
+        waitWakeUp();
+        runThreadCallbacks();
+    });
+#endif
+}
+
+void Reactor::recordWakeUp() {
+    int64_t requested = _wakeUpRequested.exchange(0, std::memory_order_relaxed);
+    if (!requested) {
+        return;
+    }
+    Duration latency = TimestampClock::now().time_since_epoch() - Duration(requested);
+    ++_loopStats.wakeUps;
+    _loopStats.totalWakeLatency += latency;
+    _loopStats.maxWakeLatency = std::max(_loopStats.maxWakeLatency, latency);
+}
+
+void Reactor::runThreadCallbacks() {
+    recordWakeUp();
+    ThreadCallback *batch = _threadCallbacks.exchange(nullptr, std::memory_order_acquire);
+    ThreadCallback *callback = nullptr;
+#ifdef NET4CXX_HAS_LOOP_STATS
+    size_t batchSize = 0;
+#endif
+    while (batch) {
+        ThreadCallback *next = batch->_next;
+        batch->_next = callback;
+        callback = batch;
+        batch = next;
+#ifdef NET4CXX_HAS_LOOP_STATS
+        ++batchSize;
+#endif
+    }
+#ifdef NET4CXX_HAS_LOOP_STATS
+    if (batchSize) {
+        _loopMonitor.recordQueueDepth(batchSize);
+    }
+#endif
+    while (callback) {
+        std::unique_ptr<ThreadCallback> current(callback);
+        callback = callback->_next;
+#ifdef NET4CXX_HAS_LOOP_STATS
+        LoopMonitor::HandlerScope scope(LoopMonitor::kThreadCallback, typeid(*current));
+#endif
+        try {
+            current->run();
+        } catch (std::exception &e) {
+            NET4CXX_ERROR(gAppLog, "Unexpected Exception:%s", e.what());
+        } catch (...) {
+            NET4CXX_ERROR(gAppLog, "Unknown Exception");
+        }
+    }
+}
+
 void Reactor::handleSignals() {
     _signalSet.cancel();
     _signalSet.clear();
@@ -6,30 +6,98 @@
 #define NET4CXX_CORE_NETWORK_REACTOR_H
 
 #include "net4cxx/common/common.h"
+#include <atomic>
+#include <boost/context/pooled_fixedsize_stack.hpp>
 #include <boost/signals2.hpp>
 #include "net4cxx/core/network/base.h"
+#include "net4cxx/core/network/threadpool.h"
 
 
 NS_BEGIN
 
 
+class AdmissionController;
 class Factory;
 class ClientFactory;
 
 
+#ifdef NET4CXX_HAS_LOOP_STATS
+
+/// Wraps a callback given to Reactor::addCallback so that the loop monitor sees it run.
+///
+/// The allocation hooks are forwarded to the callback, so one made with makeCustomAllocHandler keeps posting without
+/// touching the heap.
+template <typename CallbackT>
+class MonitoredCallback {
+public:
+    using allocator_type = typename boost::asio::associated_allocator<CallbackT>::type;
+
+    MonitoredCallback(LoopMonitor *monitor, CallbackT callback)
+            : _monitor(monitor)
+            , _callback(std::move(callback)) {
+
+    }
+
+    allocator_type get_allocator() const noexcept {
+        return boost::asio::get_associated_allocator(_callback);
+    }
+
+    void operator()() {
+        LoopMonitor::HandlerScope scope(LoopMonitor::kCallback, typeid(CallbackT));
+        _monitor->callbackStarted();
+        _callback();
+    }
+
+    friend void* asio_handler_allocate(size_t size, MonitoredCallback *thisHandler) {
+        return boost_asio_handler_alloc_helpers::allocate(size, thisHandler->_callback);
+    }
+
+    friend void asio_handler_deallocate(void *pointer, size_t size, MonitoredCallback *thisHandler) {
+        boost_asio_handler_alloc_helpers::deallocate(pointer, size, thisHandler->_callback);
+    }
+protected:
+    LoopMonitor *_monitor;
+    CallbackT _callback;
+};
+
+#endif
+
+
 class NET4CXX_COMMON_API Reactor {
 public:
     using ServiceType = boost::asio::io_service;
     using WorkType = ServiceType::work;
     using SignalSet = boost::asio::signal_set;
     using StopCallbacks = boost::signals2::signal<void ()>;
+    using CoroutineStacks = boost::context::pooled_fixedsize_stack;
+
+    static constexpr size_t CoroutineStackSize = 131072;
+
+    /// Iterations and idle spins are only counted in busy-poll mode; wake latency is the time from a callFromThread
+    /// that had to wake the reactor to the reactor picking up the batch, in either mode.
+    struct LoopStats {
+        size_t iterations{0};
+        size_t idleSpins{0};
+        size_t blockingWaits{0};
+        size_t wakeUps{0};
+        Duration totalWakeLatency{0};
+        Duration maxWakeLatency{0};
+    };
+
+    /// How TCP and UNIX connections are driven. kURing submits their reads, writes, accepts and connects to an
+    /// io_uring and falls back to kEpoll, with an error logged, when the kernel cannot provide one; every other
+    /// transport and the timers keep going through asio either way.
+    enum class Backend {
+        kEpoll,
+        kURing,
+    };
 
     Reactor(const Reactor&) = delete;
     Reactor& operator=(const Reactor&) = delete;
 
-    Reactor();
+    explicit Reactor(Backend backend=Backend::kEpoll);
 
-    ~Reactor() = default;
+    ~Reactor();
 
     void makeCurrent() {
         _current = this;
@@ -67,7 +135,46 @@ public:
 
     template <typename CallbackT>
     void addCallback(CallbackT &&callback) {
+#ifdef NET4CXX_HAS_LOOP_STATS
+        _loopMonitor.callbackPosted();
+        _ioService.post(MonitoredCallback<typename std::decay<CallbackT>::type>(&_loopMonitor,
+                                                                                std::forward<CallbackT>(callback)));
+#else
         _ioService.post(std::forward<CallbackT>(callback));
+#endif
+    }
+
+    /// Thread-safe counterpart of addCallback for producers outside the reactor thread.
+    ///
+    /// Callbacks are pushed on a lock-free stack and only the push that finds it empty wakes the reactor, so a burst
+    /// from many threads costs one wakeup. The reactor takes the whole stack at once and runs it in submission order,
+    /// then goes back to its other handlers; callbacks queued meanwhile form the next batch.
+    template <typename CallbackT>
+    void callFromThread(CallbackT &&callback) {
+        using ImplType = ThreadCallbackImpl<typename std::decay<CallbackT>::type>;
+        if (pushThreadCallback(new ImplType(std::forward<CallbackT>(callback)))) {
+            wakeUp();
+        }
+    }
+
+    /// Runs func on the reactor's thread pool and hands its ThreadResult to callback back on the reactor thread.
+    ///
+    /// Throws ThreadPoolFull when the pool's queue is at its bound.
+    template <typename FuncT, typename CallbackT>
+    void deferToThread(FuncT &&func, CallbackT &&callback) {
+        using FuncType = typename std::decay<FuncT>::type;
+        using ResultType = typename std::result_of<FuncType &()>::type;
+        auto task = [this, func=std::forward<FuncT>(func), callback=std::forward<CallbackT>(callback)]() mutable {
+            ThreadResult<ResultType> result;
+            result.run(func);
+            callFromThread([callback=std::move(callback), result=std::move(result)]() mutable {
+                callback(result);
+            });
+        };
+        auto pool = getThreadPool();
+        if (!pool->submit(std::make_unique<ThreadCallbackImpl<decltype(task)>>(std::move(task)))) {
+            NET4CXX_THROW_EXCEPTION(ThreadPoolFull, "Thread pool queue is full");
+        }
     }
 
     template <typename CallbackT>
@@ -75,7 +182,8 @@ public:
         _stopCallbacks.connect(std::forward<CallbackT>(callback));
     }
 
-    ListenerPtr listenTCP(const std::string &port, std::unique_ptr<Factory> &&factory, const std::string &interface={});
+    ListenerPtr listenTCP(const std::string &port, std::unique_ptr<Factory> &&factory, const std::string &interface={},
+                          std::shared_ptr<AdmissionController> admission={});
 
     ConnectorPtr connectTCP(const std::string &host, const std::string &port, std::unique_ptr<ClientFactory> &&factory,
                             double timeout=30.0, const Address &bindAddress={});
@@ -92,6 +200,18 @@ public:
     ConnectorPtr connectUNIX(const std::string &path, std::unique_ptr<ClientFactory> &&factory, double timeout=30.0);
 #endif
 
+    ListenerPtr listenLoopback(const std::string &name, std::unique_ptr<Factory> &&factory);
+
+    ConnectorPtr connectLoopback(const std::string &name, std::unique_ptr<ClientFactory> &&factory);
+
+#ifdef NET4CXX_HAS_SHM_TRANSPORT
+    ListenerPtr listenSHM(const std::string &path, std::unique_ptr<Factory> &&factory, size_t capacity=262144,
+                          int busyPoll=0);
+
+    ConnectorPtr connectSHM(const std::string &path, std::unique_ptr<ClientFactory> &&factory, int busyPoll=0,
+                            double timeout=30.0);
+#endif
+
     bool running() const {
         return !_running;
     }
@@ -100,6 +220,126 @@ public:
         return _ioService;
     }
 
+    Backend getBackend() const {
+        return _uring ? Backend::kURing : Backend::kEpoll;
+    }
+
+    /// The ring of the kURing backend, nullptr on kEpoll.
+    URing* getURing() {
+        return _uring.get();
+    }
+
+    Byte* getReadScratch() {
+        return _readScratch.data();
+    }
+
+    size_t getReadScratchSize() const {
+        return _readScratch.size();
+    }
+
+    void setIdleTrimTimeout(double quietPeriod) {
+        _idleTrimTimeout = quietPeriod;
+    }
+
+    double getIdleTrimTimeout() const {
+        return _idleTrimTimeout;
+    }
+
+    /// Spins on poll() while the loop has been idle for less than window, then blocks in run_one() until the next
+    /// event. Zero, the default, keeps the plain blocking run() loop.
+    void setBusyPoll(const Duration &window) {
+        _busyPollWindow = window;
+    }
+
+    const Duration& getBusyPoll() const {
+        return _busyPollWindow;
+    }
+
+    /// SO_BUSY_POLL in microseconds for TCP and SSL connections made afterwards; 0 leaves the sockets alone.
+    ///
+    /// Values above net.core.busy_poll need CAP_NET_ADMIN; the option is silently left unset without it.
+    void setSocketBusyPoll(int microseconds) {
+        _socketBusyPoll = microseconds;
+    }
+
+    int getSocketBusyPoll() const {
+        return _socketBusyPoll;
+    }
+
+    /// Must be called on the reactor thread.
+    const LoopStats& getLoopStats() const {
+        return _loopStats;
+    }
+
+#ifdef NET4CXX_HAS_LOOP_STATS
+    /// Handler latency, timer lag and queue depth histograms; like getLoopStats, only for the reactor thread.
+    LoopMonitor& getLoopMonitor() {
+        return _loopMonitor;
+    }
+
+    const LoopMonitor& getLoopMonitor() const {
+        return _loopMonitor;
+    }
+#endif
+
+    /// CPUs the reactor thread is pinned to when run starts; empty leaves it floating.
+    void setCpuAffinity(std::vector<int> cpus) {
+        _cpuAffinity = std::move(cpus);
+    }
+
+    const std::vector<int>& getCpuAffinity() const {
+        return _cpuAffinity;
+    }
+
+    /// Makes the NUMA node the reactor runs on the preferred node for the allocations of its thread.
+    void setNumaBind(bool numaBind) {
+        _numaBind = numaBind;
+    }
+
+    bool getNumaBind() const {
+        return _numaBind;
+    }
+
+    /// Only effective with a single-CPU affinity and for listeners created afterwards.
+    void setSteerIncomingCpu(bool steerIncomingCpu) {
+        _steerIncomingCpu = steerIncomingCpu;
+    }
+
+    bool getSteerIncomingCpu() const {
+        return _steerIncomingCpu;
+    }
+
+    /// CPU that TCP listeners should ask the kernel to steer connections from, -1 for none.
+    int getIncomingCpu() const {
+        return _steerIncomingCpu && _cpuAffinity.size() == 1 ? _cpuAffinity[0] : -1;
+    }
+
+    /// Node the reactor thread last ran on, -1 before run.
+    int getNumaNode() const {
+        return _numaNode;
+    }
+
+    /// Block pool for Deferred states and their callback links.
+    DeferredPool& getDeferredPool() {
+        return _deferredPool;
+    }
+
+    /// Stack allocator shared by the coroutines of this reactor; finished coroutines hand their stacks back to it.
+    CoroutineStacks& getCoroutineStacks() {
+        return _coroutineStacks;
+    }
+
+    /// Must be called before the first deferToThread.
+    void setThreadPoolSize(size_t size, size_t maxQueued=65536) {
+        if (_threadPool) {
+            NET4CXX_THROW_EXCEPTION(AlreadyExist, "Thread pool already started");
+        }
+        _threadPoolSize = size;
+        _threadPoolMaxQueued = maxQueued;
+    }
+
+    ThreadPool* getThreadPool();
+
     void stop();
 
     static Reactor *current() {
@@ -112,6 +352,10 @@ public:
 protected:
     void startRunning(bool installSignalHandlers=true);
 
+    void applyPlacement();
+
+    void runBusyPoll();
+
     void handleSignals();
 
     void onSignal(const boost::system::error_code &ec, int signalNumber);
@@ -124,11 +368,53 @@ protected:
 
     void sigQuit();
 
+    bool pushThreadCallback(ThreadCallback *callback) {
+        ThreadCallback *head = _threadCallbacks.load(std::memory_order_relaxed);
+        do {
+            callback->_next = head;
+        } while (!_threadCallbacks.compare_exchange_weak(head, callback, std::memory_order_release,
+                                                         std::memory_order_relaxed));
+        return head == nullptr;
+    }
+
+    void wakeUp();
+
+    void recordWakeUp();
+
+    void waitWakeUp();
+
+    void runThreadCallbacks();
+
+    // Declared first so that pending handlers still holding Deferreds can free into it while the service is torn down.
+    DeferredPool _deferredPool;
     ServiceType _ioService;
     SignalSet _signalSet;
     bool _installSignalHandlers{false};
     volatile bool _running{false};
     StopCallbacks _stopCallbacks;
+    ByteArray _readScratch;
+    double _idleTrimTimeout{30.0};
+    std::vector<int> _cpuAffinity;
+    bool _numaBind{false};
+    bool _steerIncomingCpu{false};
+    int _numaNode{-1};
+    std::atomic<ThreadCallback *> _threadCallbacks{nullptr};
+    std::atomic<int64_t> _wakeUpRequested{0};
+    Duration _busyPollWindow{0};
+    int _socketBusyPoll{0};
+    LoopStats _loopStats;
+#ifdef NET4CXX_HAS_LOOP_STATS
+    LoopMonitor _loopMonitor;
+#endif
+    size_t _threadPoolSize{0};
+    size_t _threadPoolMaxQueued{65536};
+    std::unique_ptr<ThreadPool> _threadPool;
+    CoroutineStacks _coroutineStacks;
+#ifdef BOOST_ASIO_HAS_EVENTFD
+    boost::asio::posix::stream_descriptor _wakeUpDescriptor;
+#endif
+    // Last, so that in-flight requests are cancelled and their owners released while everything else still exists.
+    std::unique_ptr<URing> _uring;
     thread_local static Reactor *_current;
 };
 
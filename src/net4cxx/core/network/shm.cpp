@@ -0,0 +1,665 @@
+//
+// Created by yuwenyong on 17-11-24.
+//
+
+#include "net4cxx/core/network/shm.h"
+#include <cstring>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "net4cxx/common/debugging/assert.h"
+#include "net4cxx/core/network/protocol.h"
+#include "net4cxx/core/network/reactor.h"
+
+#ifdef NET4CXX_HAS_SHM_TRANSPORT
+
+NS_BEGIN
+
+constexpr uint32_t SHMHandshakeMagic = 0x4e345348;
+
+struct SHMHandshake {
+    uint32_t magic;
+    uint32_t headerSize;
+    uint64_t capacity;
+};
+
+static void throwLastError() {
+    throw boost::system::system_error(boost::system::error_code(errno, boost::system::system_category()));
+}
+
+
+SHMConnection::SHMConnection(const ProtocolPtr &protocol, int busyPoll, Reactor *reactor)
+        : Connection(protocol, reactor)
+        , _socket(reactor->getService())
+        , _doorbell(reactor->getService())
+        , _busyPoll(busyPoll) {
+
+}
+
+SHMConnection::~SHMConnection() {
+    if (_peerDoorbell != -1) {
+        ::close(_peerDoorbell);
+    }
+    if (_mapping) {
+        ::munmap(_mapping, _mappingSize);
+    }
+}
+
+void SHMConnection::write(const Byte *data, size_t length) {
+    if (_disconnecting || _disconnected || !_connected) {
+        return;
+    }
+    if (!_writing && _writeQueue.empty()) {
+        size_t bytesSent = writeSome(data, length);
+        if (bytesSent == length) {
+            return;
+        }
+        data += bytesSent;
+        length -= bytesSent;
+    }
+    MessageBuffer packet(length);
+    packet.write(data, length);
+    _writeQueue.emplace_back(std::move(packet));
+    if (_writeQueue.spilled()) {
+        trimLater(shared_from_this());
+    }
+    startWriting();
+}
+
+void SHMConnection::loseConnection() {
+    if (_disconnecting || _disconnected || !_connected) {
+        return;
+    }
+    _error = DisconnectReason(DisconnectReason::kConnectionDone);
+    _disconnecting = true;
+    doClose();
+}
+
+void SHMConnection::abortConnection() {
+    if (_disconnecting || _disconnected || !_connected) {
+        return;
+    }
+    _error = DisconnectReason(DisconnectReason::kConnectionAbort);
+    _disconnecting = true;
+    doAbort();
+}
+
+void SHMConnection::resumeReading() {
+    if (!_readPaused) {
+        return;
+    }
+    _readPaused = false;
+    if (!_disconnected) {
+        // Wakes the doorbell wait, which goes on with the ring where readRing left it.
+        ringDoorbell(_doorbell.native_handle());
+    }
+}
+
+void SHMConnection::mapRings(int fd, size_t capacity, bool server) {
+    size_t ringSize = SHMRing::HeaderSize + capacity;
+    _mappingSize = ringSize * 2;
+    void *mapping = ::mmap(nullptr, _mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        throwLastError();
+    }
+    _mapping = mapping;
+    auto base = static_cast<Byte *>(_mapping);
+    if (server) {
+        _outbound.attach(base, capacity, true);
+        _inbound.attach(base + ringSize, capacity, true);
+    } else {
+        _inbound.attach(base, capacity, false);
+        _outbound.attach(base + ringSize, capacity, false);
+    }
+}
+
+void SHMConnection::openDoorbells(int doorbell, int peerDoorbell) {
+    _doorbell.assign(doorbell);
+    _peerDoorbell = peerDoorbell;
+}
+
+void SHMConnection::ringDoorbell(int fd) {
+    uint64_t value = 1;
+    ssize_t result = ::write(fd, &value, sizeof(value));
+    (void)result;
+}
+
+void SHMConnection::doClose() {
+    if (!_writing) {
+        _reactor->addCallback([this, self=shared_from_this(), protocol=_protocol.lock()]() {
+            if (!_disconnected) {
+                closeSocket();
+            }
+        });
+    }
+}
+
+void SHMConnection::doAbort() {
+    _reactor->addCallback([this, self=shared_from_this(), protocol=_protocol.lock()]() {
+        if (!_disconnected) {
+            closeSocket();
+        }
+    });
+}
+
+void SHMConnection::closeSocket() {
+    if (!_rateLimitCall.cancelled()) {
+        _rateLimitCall.cancel();
+    }
+    _connected = false;
+    _disconnected = true;
+    _disconnecting = false;
+    if (_socket.is_open()) {
+        _socket.close();
+    }
+    if (_doorbell.is_open()) {
+        _doorbell.close();
+    }
+    connectionLost(_error);
+}
+
+bool SHMConnection::pollRings() const {
+    if (hasPendingWork()) {
+        return true;
+    }
+    if (_busyPoll > 0) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(_busyPoll);
+        do {
+            for (int i = 0; i != 64; ++i) {
+                if (hasPendingWork()) {
+                    return true;
+                }
+            }
+        } while (std::chrono::steady_clock::now() < deadline);
+    }
+    return false;
+}
+
+void SHMConnection::doRead() {
+    auto protocol = _protocol.lock();
+    BOOST_ASSERT(protocol);
+    _reading = true;
+    bool pending = pollRings();
+    if (!pending) {
+        _inbound.setReaderWaiting(!_readPaused && !_readLimited);
+        _outbound.setWriterWaiting(_writing);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (hasPendingWork()) {
+            _inbound.setReaderWaiting(false);
+            _outbound.setWriterWaiting(false);
+            pending = true;
+        }
+    }
+    if (pending) {
+        _reactor->addCallback(makeCustomAllocHandler(_readMemory, [protocol, self = shared_from_this()]() {
+            self->cbReadable({});
+        }));
+    } else {
+        _doorbell.async_wait(DescriptorType::wait_read, makeCustomAllocHandler(
+                _readMemory, [protocol, self = shared_from_this()](const boost::system::error_code &ec) {
+            self->cbReadable(ec);
+        }));
+    }
+}
+
+void SHMConnection::handleRead(const boost::system::error_code &ec) {
+    if (ec) {
+        if (ec != boost::asio::error::operation_aborted) {
+            NET4CXX_ERROR(gGenLog, "Read error %d :%s", ec.value(), ec.message().c_str());
+        }
+        if (!_disconnected) {
+            if (ec != boost::asio::error::operation_aborted) {
+                _error = DisconnectReason(ec);
+            }
+            closeSocket();
+        }
+        return;
+    }
+    if (_disconnected) {
+        return;
+    }
+    uint64_t value;
+    if (::read(_doorbell.native_handle(), &value, sizeof(value)) < 0) {
+        value = 0;
+    }
+    _inbound.setReaderWaiting(false);
+    _outbound.setWriterWaiting(false);
+    if (_writing) {
+        doWrite();
+        if (!_writing && _disconnecting) {
+            closeSocket();
+            return;
+        }
+    }
+    readRing();
+    if (_peerClosed && !_disconnected && _inbound.empty()) {
+        closeSocket();
+    }
+}
+
+void SHMConnection::readRing() {
+    size_t budget = _inbound.getCapacity();
+    Byte *data;
+    size_t length;
+    while (budget != 0 && !_disconnected && (length = _inbound.peek(data)) != 0) {
+        // What is left in the ring fills it up, and the peer's writes wait for room.
+        if (!_disconnecting && (_readPaused || _readLimited || (!_rateLimiters.empty() && waitForTokens()))) {
+            break;
+        }
+        length = std::min(length, budget);
+        if (!_disconnecting) {
+            dataReceived(data, length);
+        }
+        _inbound.consume(length);
+        budget -= length;
+        if (_inbound.takeWriterWaiting()) {
+            ringDoorbell(_peerDoorbell);
+        }
+    }
+}
+
+bool SHMConnection::waitForTokens() {
+    Duration delay = getRateLimitDelay();
+    if (delay == Duration::zero()) {
+        return false;
+    }
+    _readLimited = true;
+    _rateLimitCall = _reactor->callLater(delay, [this, protocol=_protocol.lock(), self=shared_from_this()]() {
+        _readLimited = false;
+        if (!_disconnected) {
+            ringDoorbell(_doorbell.native_handle());
+        }
+    });
+    return true;
+}
+
+void SHMConnection::doWatch() {
+    auto protocol = _protocol.lock();
+    BOOST_ASSERT(protocol);
+    _socket.async_wait(SocketType::wait_read, makeCustomAllocHandler(
+            _watchMemory, [protocol, self = shared_from_this()](const boost::system::error_code &ec) {
+        self->cbWatch(ec);
+    }));
+}
+
+void SHMConnection::cbWatch(boost::system::error_code ec) {
+    if (_disconnected || ec == boost::asio::error::operation_aborted) {
+        return;
+    }
+    if (!ec) {
+        Byte scratch[64];
+        _socket.read_some(boost::asio::buffer(scratch), ec);
+        if (!ec || ec == boost::asio::error::would_block || ec == boost::asio::error::try_again) {
+            doWatch();
+            return;
+        }
+    }
+    if (ec != boost::asio::error::eof) {
+        NET4CXX_ERROR(gGenLog, "Read error %d :%s", ec.value(), ec.message().c_str());
+    }
+    readRing();
+    if (!_disconnected) {
+        _error = DisconnectReason(ec);
+        if (_inbound.empty()) {
+            closeSocket();
+        } else {
+            // Data held back by a pause or a rate limit is still delivered; handleRead closes once it has been.
+            _peerClosed = true;
+        }
+    }
+}
+
+size_t SHMConnection::writeSome(const Byte *data, size_t length) {
+    size_t bytesSent = _outbound.write(data, length);
+    if (bytesSent != 0 && _outbound.takeReaderWaiting()) {
+        ringDoorbell(_peerDoorbell);
+    }
+    return bytesSent;
+}
+
+void SHMConnection::doWrite() {
+    while (!_writeQueue.empty()) {
+        MessageBuffer &buffer = _writeQueue.front();
+        size_t bytesToSend = buffer.getActiveSize();
+        size_t bytesSent = writeSome(buffer.getReadPointer(), bytesToSend);
+        if (bytesSent < bytesToSend) {
+            buffer.readCompleted(bytesSent);
+            break;
+        }
+        _writeQueue.pop_front();
+    }
+    _writing = !_writeQueue.empty();
+}
+
+
+void SHMConnection::waitWritable() {
+    _outbound.setWriterWaiting(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!_outbound.full()) {
+        ringDoorbell(_doorbell.native_handle());
+    }
+}
+
+
+void SHMServerConnection::openRings(size_t capacity) {
+    BOOST_ASSERT(SHMRing::isValidCapacity(capacity));
+    int fds[3] = {-1, -1, -1};
+    try {
+        fds[0] = ::memfd_create("net4cxx-shm", MFD_CLOEXEC);
+        if (fds[0] == -1 || ::ftruncate(fds[0], (off_t)((SHMRing::HeaderSize + capacity) * 2)) == -1) {
+            throwLastError();
+        }
+        mapRings(fds[0], capacity, true);
+        fds[1] = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        fds[2] = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (fds[1] == -1 || fds[2] == -1) {
+            throwLastError();
+        }
+        SHMHandshake handshake{SHMHandshakeMagic, (uint32_t)SHMRing::HeaderSize, capacity};
+        iovec iov{&handshake, sizeof(handshake)};
+        char control[CMSG_SPACE(sizeof(fds))];
+        std::memset(control, 0, sizeof(control));
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+        std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+        if (::sendmsg(_socket.native_handle(), &msg, MSG_NOSIGNAL) != (ssize_t)sizeof(handshake)) {
+            throwLastError();
+        }
+    } catch (...) {
+        for (int fd: fds) {
+            if (fd != -1) {
+                ::close(fd);
+            }
+        }
+        throw;
+    }
+    ::close(fds[0]);
+    openDoorbells(fds[1], fds[2]);
+}
+
+void SHMServerConnection::cbAccept(const ProtocolPtr &protocol) {
+    _protocol = protocol;
+    _connected = true;
+    _socket.non_blocking(true);
+    protocol->makeConnection(shared_from_this());
+    if (!_disconnecting || _writing) {
+        startReading();
+    }
+}
+
+
+void SHMClientConnection::attachRings() {
+    SHMHandshake handshake{};
+    int fds[3] = {-1, -1, -1};
+    iovec iov{&handshake, sizeof(handshake)};
+    char control[CMSG_SPACE(sizeof(fds))];
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t received = ::recvmsg(_socket.native_handle(), &msg, MSG_CMSG_CLOEXEC);
+    cmsghdr *cmsg = received > 0 ? CMSG_FIRSTHDR(&msg) : nullptr;
+    if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+        cmsg->cmsg_len == CMSG_LEN(sizeof(fds))) {
+        std::memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+    }
+    try {
+        if (received < 0) {
+            throwLastError();
+        }
+        if (received != (ssize_t)sizeof(handshake) || fds[0] == -1 || handshake.magic != SHMHandshakeMagic ||
+            handshake.headerSize != SHMRing::HeaderSize || !SHMRing::isValidCapacity(handshake.capacity)) {
+            NET4CXX_THROW_EXCEPTION(IOError, "Bad shared memory handshake");
+        }
+        struct stat st;
+        if (::fstat(fds[0], &st) == -1) {
+            throwLastError();
+        }
+        if ((uint64_t)st.st_size != (SHMRing::HeaderSize + handshake.capacity) * 2) {
+            NET4CXX_THROW_EXCEPTION(IOError, "Bad shared memory size");
+        }
+        mapRings(fds[0], (size_t)handshake.capacity, false);
+    } catch (...) {
+        for (int fd: fds) {
+            if (fd != -1) {
+                ::close(fd);
+            }
+        }
+        throw;
+    }
+    ::close(fds[0]);
+    openDoorbells(fds[2], fds[1]);
+}
+
+void SHMClientConnection::cbConnect(const ProtocolPtr &protocol, std::shared_ptr<SHMConnector> connector) {
+    _protocol = protocol;
+    _connector = std::move(connector);
+    _connected = true;
+    _socket.non_blocking(true);
+    protocol->makeConnection(shared_from_this());
+    if (!_disconnecting || _writing) {
+        startReading();
+    }
+}
+
+void SHMClientConnection::closeSocket() {
+    SHMConnection::closeSocket();
+    _connector->connectionLost(_error);
+}
+
+
+SHMListener::SHMListener(std::string path, std::unique_ptr<Factory> &&factory, size_t capacity, int busyPoll,
+                         Reactor *reactor)
+        : Listener(reactor)
+        , _path(std::move(path))
+        , _factory(std::move(factory))
+        , _capacity(capacity)
+        , _busyPoll(busyPoll)
+        , _acceptor(reactor->getService()) {
+#ifndef NET4CXX_NDEBUG
+    NET4CXX_Watcher->inc(NET4CXX_SHMListener_COUNT);
+#endif
+}
+
+void SHMListener::startListening() {
+    EndpointType endpoint(_path);
+    ::unlink(_path.c_str());
+    _acceptor.open(endpoint.protocol());
+    _acceptor.set_option(boost::asio::socket_base::reuse_address(true));
+    _acceptor.bind(endpoint);
+    _acceptor.listen();
+    NET4CXX_INFO(gGenLog, "SHMListener starting on %s", _path.c_str());
+    _factory->doStart();
+    _connected = true;
+    doAccept();
+}
+
+void SHMListener::stopListening() {
+    if (_connected) {
+        _connected = false;
+        _acceptor.close();
+        _factory->doStop();
+        NET4CXX_INFO(gGenLog, "SHMListener closed on %s", _path.c_str());
+    }
+}
+
+void SHMListener::cbAccept(const boost::system::error_code &ec) {
+    handleAccept(ec);
+    if (!_connected) {
+        return;
+    }
+    doAccept();
+}
+
+void SHMListener::handleAccept(const boost::system::error_code &ec) {
+    if (ec) {
+        if (ec != boost::asio::error::operation_aborted) {
+            NET4CXX_ERROR(gGenLog, "Accept error %d: %s", ec.value(), ec.message().c_str());
+        }
+    } else {
+        try {
+            _connection->openRings(_capacity);
+        } catch (std::exception &e) {
+            NET4CXX_ERROR(gGenLog, "Accept error: %s", e.what());
+            _connection.reset();
+            return;
+        }
+        Address address{_connection->getRemoteAddress(), _connection->getRemotePort()};
+        auto protocol = _factory->buildProtocol(address);
+        if (protocol) {
+            _connection->cbAccept(protocol);
+        }
+    }
+    _connection.reset();
+}
+
+
+SHMConnector::SHMConnector(std::string path, std::unique_ptr<ClientFactory> &&factory, int busyPoll, double timeout,
+                           Reactor *reactor)
+        : Connector(reactor)
+        , _path(std::move(path))
+        , _factory(std::move(factory))
+        , _busyPoll(busyPoll)
+        , _timeout(timeout) {
+#ifndef NET4CXX_NDEBUG
+    NET4CXX_Watcher->inc(NET4CXX_SHMConnector_COUNT);
+#endif
+}
+
+void SHMConnector::startConnecting() {
+    if (_state != kDisconnected) {
+        NET4CXX_THROW_EXCEPTION(Exception, "Can't connect in this state");
+    }
+    _state = kConnecting;
+    if (!_factoryStarted) {
+        _factory->doStart();
+        _factoryStarted = true;
+    }
+    doConnect();
+    if (_timeout != 0.0) {
+        _timeoutId = _reactor->callLater(_timeout, [this, self=shared_from_this()]() {
+            cbTimeout();
+        });
+    }
+    _factory->startedConnecting(shared_from_this());
+}
+
+void SHMConnector::stopConnecting() {
+    if (_state != kConnecting) {
+        NET4CXX_THROW_EXCEPTION(NotConnectingError, "We're not trying to connect");
+    }
+    _error = NET4CXX_EXCEPTION_PTR(UserAbort, "");
+    BOOST_ASSERT(_connection);
+    _connection->getSocket().close();
+    _connection.reset();
+    _state = kDisconnected;
+}
+
+void SHMConnector::connectionFailed(std::exception_ptr reason) {
+    if (reason) {
+        _error = std::move(reason);
+    }
+    cancelTimeout();
+    _connection.reset();
+    _state = kDisconnected;
+    _factory->clientConnectionFailed(shared_from_this(), _error);
+    if (_state == kDisconnected) {
+        _factory->doStop();
+        _factoryStarted = false;
+    }
+}
+
+void SHMConnector::connectionLost(const DisconnectReason &reason) {
+    _state = kDisconnected;
+    _factory->clientConnectionLost(shared_from_this(), reason);
+    if (_state == kDisconnected) {
+        _factory->doStop();
+        _factoryStarted = false;
+    }
+}
+
+ProtocolPtr SHMConnector::buildProtocol(const Address &address) {
+    _state = kConnected;
+    cancelTimeout();
+    return _factory->buildProtocol(address);
+}
+
+void SHMConnector::doConnect() {
+    makeTransport();
+    EndpointType endpoint{_path};
+    _connection->getSocket().async_connect(endpoint, makeCustomAllocHandler(
+            _connectMemory, [this, self=shared_from_this(), connection=_connection](
+                    const boost::system::error_code &ec) {
+        cbConnect(ec);
+    }));
+}
+
+void SHMConnector::handleConnect(const boost::system::error_code &ec) {
+    if (ec) {
+        if (ec != boost::asio::error::operation_aborted) {
+            NET4CXX_ERROR(gGenLog, "Connect error %d :%s", ec.value(), ec.message().c_str());
+            _error = std::make_exception_ptr(boost::system::system_error(ec));
+        }
+        connectionFailed();
+    }
+}
+
+void SHMConnector::doHandshake() {
+    _connection->getSocket().async_wait(SocketType::wait_read, makeCustomAllocHandler(
+            _connectMemory, [this, self=shared_from_this(), connection=_connection](
+                    const boost::system::error_code &ec) {
+        cbHandshake(ec);
+    }));
+}
+
+void SHMConnector::handleHandshake(const boost::system::error_code &ec) {
+    if (ec) {
+        if (ec != boost::asio::error::operation_aborted) {
+            NET4CXX_ERROR(gGenLog, "Handshake error %d :%s", ec.value(), ec.message().c_str());
+            _error = std::make_exception_ptr(boost::system::system_error(ec));
+        }
+        connectionFailed();
+        return;
+    }
+    try {
+        _connection->attachRings();
+    } catch (std::exception &e) {
+        NET4CXX_ERROR(gGenLog, "Handshake error: %s", e.what());
+        _error = std::current_exception();
+        connectionFailed();
+        return;
+    }
+    Address address{_connection->getRemoteAddress(), _connection->getRemotePort()};
+    auto protocol = buildProtocol(address);
+    if (!protocol) {
+        _connection.reset();
+        connectionLost();
+    } else {
+        auto connection = std::move(_connection);
+        connection->cbConnect(protocol, shared_from_this());
+    }
+}
+
+void SHMConnector::handleTimeout() {
+    NET4CXX_ERROR(gGenLog, "Connect error : Timeout");
+    _error = NET4CXX_EXCEPTION_PTR(TimeoutError, "");
+    connectionFailed();
+}
+
+void SHMConnector::makeTransport() {
+    _connection = std::make_shared<SHMClientConnection>(_busyPoll, _reactor);
+}
+
+NS_END
+
+#endif //NET4CXX_HAS_SHM_TRANSPORT
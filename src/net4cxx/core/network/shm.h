@@ -0,0 +1,438 @@
+//
+// Created by yuwenyong on 17-11-24.
+//
+
+#ifndef NET4CXX_CORE_NETWORK_SHM_H
+#define NET4CXX_CORE_NETWORK_SHM_H
+
+#include "net4cxx/common/common.h"
+#include <atomic>
+#include <boost/asio.hpp>
+#include "net4cxx/common/debugging/watcher.h"
+#include "net4cxx/common/global/loggers.h"
+#include "net4cxx/core/network/base.h"
+
+#ifdef NET4CXX_HAS_SHM_TRANSPORT
+
+NS_BEGIN
+
+class Factory;
+class ClientFactory;
+class SHMConnector;
+
+
+/// Single-producer single-consumer byte ring living in a shared mapping.
+///
+/// The waiting flags form a Dekker pair with the positions: a side sets its flag, fences and rechecks the ring
+/// before sleeping on its doorbell, while the peer fences after publishing and rings the doorbell only if the flag
+/// was set.
+class NET4CXX_COMMON_API SHMRing {
+public:
+    struct Header {
+        alignas(64) std::atomic<uint64_t> head;
+        std::atomic<uint32_t> readerWaiting;
+        alignas(64) std::atomic<uint64_t> tail;
+        std::atomic<uint32_t> writerWaiting;
+    };
+
+    static constexpr size_t HeaderSize = sizeof(Header);
+    static constexpr size_t MaxCapacity = (size_t)1 << 30;
+
+    /// Positions are masked into the data area, so its size has to be a power of two.
+    static bool isValidCapacity(uint64_t capacity) {
+        return capacity != 0 && capacity <= MaxCapacity && (capacity & (capacity - 1)) == 0;
+    }
+
+    void attach(Byte *base, size_t capacity, bool initialize) {
+        if (initialize) {
+            new (base) Header{{0}, {0}, {0}, {0}};
+        }
+        _header = reinterpret_cast<Header *>(base);
+        _data = base + HeaderSize;
+        _capacity = capacity;
+    }
+
+    size_t getCapacity() const {
+        return _capacity;
+    }
+
+    bool empty() const {
+        return _header->tail.load(std::memory_order_acquire) == _header->head.load(std::memory_order_relaxed);
+    }
+
+    bool full() const {
+        return _header->tail.load(std::memory_order_relaxed) - _header->head.load(std::memory_order_acquire) ==
+               _capacity;
+    }
+
+    size_t write(const Byte *data, size_t length) {
+        uint64_t tail = _header->tail.load(std::memory_order_relaxed);
+        uint64_t head = _header->head.load(std::memory_order_acquire);
+        length = std::min(length, _capacity - (size_t)(tail - head));
+        size_t offset = (size_t)tail & (_capacity - 1);
+        size_t first = std::min(length, _capacity - offset);
+        std::memcpy(_data + offset, data, first);
+        std::memcpy(_data, data + first, length - first);
+        _header->tail.store(tail + length, std::memory_order_release);
+        return length;
+    }
+
+    size_t peek(Byte *&data) const {
+        uint64_t head = _header->head.load(std::memory_order_relaxed);
+        uint64_t tail = _header->tail.load(std::memory_order_acquire);
+        size_t offset = (size_t)head & (_capacity - 1);
+        data = _data + offset;
+        return std::min((size_t)(tail - head), _capacity - offset);
+    }
+
+    void consume(size_t length) {
+        uint64_t head = _header->head.load(std::memory_order_relaxed);
+        _header->head.store(head + length, std::memory_order_release);
+    }
+
+    void setReaderWaiting(bool waiting) {
+        _header->readerWaiting.store(waiting ? 1 : 0, std::memory_order_relaxed);
+    }
+
+    void setWriterWaiting(bool waiting) {
+        _header->writerWaiting.store(waiting ? 1 : 0, std::memory_order_relaxed);
+    }
+
+    bool takeReaderWaiting() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return _header->readerWaiting.load(std::memory_order_relaxed) && _header->readerWaiting.exchange(0);
+    }
+
+    bool takeWriterWaiting() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return _header->writerWaiting.load(std::memory_order_relaxed) && _header->writerWaiting.exchange(0);
+    }
+protected:
+    Header *_header{nullptr};
+    Byte *_data{nullptr};
+    size_t _capacity{0};
+};
+
+
+class NET4CXX_COMMON_API SHMConnection: public Connection, public std::enable_shared_from_this<SHMConnection> {
+public:
+    using SocketType = boost::asio::local::stream_protocol::socket;
+    using DescriptorType = boost::asio::posix::stream_descriptor;
+
+    SHMConnection(const ProtocolPtr &protocol, int busyPoll, Reactor *reactor);
+
+    ~SHMConnection() override;
+
+    SocketType& getSocket() {
+        return _socket;
+    }
+
+    void write(const Byte *data, size_t length) override;
+
+    void loseConnection() override;
+
+    void abortConnection() override;
+
+    bool getNoDelay() const override {
+        return true;
+    }
+
+    void setNoDelay(bool enabled) override {
+
+    }
+
+    bool getKeepAlive() const override {
+        boost::asio::socket_base::keep_alive option;
+        _socket.get_option(option);
+        return option.value();
+    }
+
+    void setKeepAlive(bool enabled) override {
+        boost::asio::socket_base::keep_alive option(enabled);
+        _socket.set_option(option);
+    }
+
+    std::string getLocalAddress() const override {
+        auto endpoint = _socket.local_endpoint();
+        return endpoint.path();
+    }
+
+    unsigned short getLocalPort() const override {
+        return 0;
+    }
+
+    std::string getRemoteAddress() const override {
+        auto endpoint = _socket.remote_endpoint();
+        return endpoint.path();
+    }
+
+    unsigned short getRemotePort() const override {
+        return 0;
+    }
+
+    void resumeReading() override;
+
+    bool canPauseReading() const override {
+        return true;
+    }
+protected:
+    void mapRings(int fd, size_t capacity, bool server);
+
+    void openDoorbells(int doorbell, int peerDoorbell);
+
+    void ringDoorbell(int fd);
+
+    void doClose();
+
+    void doAbort();
+
+    virtual void closeSocket();
+
+    bool hasPendingWork() const {
+        return (!_inbound.empty() && !_readPaused && !_readLimited) || (_writing && !_outbound.full());
+    }
+
+    bool pollRings() const;
+
+    void startReading() {
+        if (!_reading) {
+            doRead();
+        }
+        doWatch();
+    }
+
+    void doRead();
+
+    void cbReadable(const boost::system::error_code &ec) {
+        _reading = false;
+        handleRead(ec);
+        if (!_disconnected && (!_disconnecting || _writing)) {
+            doRead();
+        }
+    }
+
+    void handleRead(const boost::system::error_code &ec);
+
+    void readRing();
+
+    bool waitForTokens();
+
+    void doWatch();
+
+    void cbWatch(boost::system::error_code ec);
+
+    void startWriting() {
+        if (!_writing) {
+            doWrite();
+            if (_writing) {
+                waitWritable();
+            }
+        }
+    }
+
+    void waitWritable();
+
+    size_t writeSome(const Byte *data, size_t length);
+
+    void doWrite();
+
+    SocketType _socket;
+    DescriptorType _doorbell;
+    int _peerDoorbell{-1};
+    int _busyPoll{0};
+    void *_mapping{nullptr};
+    size_t _mappingSize{0};
+    SHMRing _inbound;
+    SHMRing _outbound;
+    DisconnectReason _error;
+    bool _peerClosed{false};
+    bool _readLimited{false};
+    DelayedCall _rateLimitCall;
+    HandlerMemory<160> _readMemory;
+    HandlerMemory<160> _watchMemory;
+};
+
+
+class NET4CXX_COMMON_API SHMServerConnection: public SHMConnection {
+public:
+    SHMServerConnection(int busyPoll, Reactor *reactor)
+            : SHMConnection({}, busyPoll, reactor) {
+#ifndef NET4CXX_NDEBUG
+        NET4CXX_Watcher->inc(NET4CXX_SHMServerConnection_COUNT);
+#endif
+    }
+
+#ifndef NET4CXX_NDEBUG
+    ~SHMServerConnection() override {
+        NET4CXX_Watcher->dec(NET4CXX_SHMServerConnection_COUNT);
+    }
+#endif
+
+    void openRings(size_t capacity);
+
+    void cbAccept(const ProtocolPtr &protocol);
+};
+
+
+class NET4CXX_COMMON_API SHMClientConnection: public SHMConnection {
+public:
+    SHMClientConnection(int busyPoll, Reactor *reactor)
+            : SHMConnection({}, busyPoll, reactor) {
+#ifndef NET4CXX_NDEBUG
+        NET4CXX_Watcher->inc(NET4CXX_SHMClientConnection_COUNT);
+#endif
+    }
+
+#ifndef NET4CXX_NDEBUG
+    ~SHMClientConnection() override {
+        NET4CXX_Watcher->dec(NET4CXX_SHMClientConnection_COUNT);
+    }
+#endif
+
+    void attachRings();
+
+    void cbConnect(const ProtocolPtr &protocol, std::shared_ptr<SHMConnector> connector);
+protected:
+    void closeSocket() override;
+
+    std::shared_ptr<SHMConnector> _connector;
+};
+
+
+class NET4CXX_COMMON_API SHMListener: public Listener, public std::enable_shared_from_this<SHMListener> {
+public:
+    using AcceptorType = boost::asio::local::stream_protocol::acceptor;
+    using SocketType = boost::asio::local::stream_protocol::socket;
+    using EndpointType = boost::asio::local::stream_protocol::endpoint;
+
+    SHMListener(std::string path, std::unique_ptr<Factory> &&factory, size_t capacity, int busyPoll,
+                Reactor *reactor);
+
+#ifndef NET4CXX_NDEBUG
+    ~SHMListener() override {
+        NET4CXX_Watcher->dec(NET4CXX_SHMListener_COUNT);
+    }
+#endif
+
+    void startListening() override;
+
+    void stopListening() override;
+
+    std::string getLocalAddress() const {
+        auto endpoint = _acceptor.local_endpoint();
+        return endpoint.path();
+    }
+
+    unsigned short getLocalPort() const {
+        return 0;
+    }
+protected:
+    void cbAccept(const boost::system::error_code &ec);
+
+    void handleAccept(const boost::system::error_code &ec);
+
+    void doAccept() {
+        _connection = std::make_shared<SHMServerConnection>(_busyPoll, _reactor);
+        _acceptor.async_accept(_connection->getSocket(),
+                               makeCustomAllocHandler(_acceptMemory, std::bind(&SHMListener::cbAccept,
+                                                                               shared_from_this(),
+                                                                               std::placeholders::_1)));
+    }
+
+    std::string _path;
+    std::unique_ptr<Factory> _factory;
+    size_t _capacity;
+    int _busyPoll;
+    AcceptorType _acceptor;
+    bool _connected{false};
+    std::shared_ptr<SHMServerConnection> _connection;
+    HandlerMemory<> _acceptMemory;
+};
+
+
+class NET4CXX_COMMON_API SHMConnector: public Connector, public std::enable_shared_from_this<SHMConnector> {
+public:
+    using SocketType = boost::asio::local::stream_protocol::socket;
+    using EndpointType = boost::asio::local::stream_protocol::endpoint;
+
+    SHMConnector(std::string path, std::unique_ptr<ClientFactory> &&factory, int busyPoll, double timeout,
+                 Reactor *reactor);
+
+#ifndef NET4CXX_NDEBUG
+    ~SHMConnector() override {
+        NET4CXX_Watcher->dec(NET4CXX_SHMConnector_COUNT);
+    }
+#endif
+
+    void startConnecting() override;
+
+    void stopConnecting() override;
+
+    void connectionFailed(std::exception_ptr reason={});
+
+    void connectionLost(const DisconnectReason &reason={});
+protected:
+    ProtocolPtr buildProtocol(const Address &address);
+
+    void cancelTimeout() {
+        if (!_timeoutId.cancelled()) {
+            _timeoutId.cancel();
+        }
+    }
+
+    void doConnect();
+
+    void cbConnect(const boost::system::error_code &ec) {
+        if (_state != kConnecting && ec != boost::asio::error::operation_aborted) {
+            return;
+        }
+        handleConnect(ec);
+        if (_state == kConnecting && !ec) {
+            doHandshake();
+        }
+    }
+
+    void handleConnect(const boost::system::error_code &ec);
+
+    void doHandshake();
+
+    void cbHandshake(const boost::system::error_code &ec) {
+        if (_state != kConnecting && ec != boost::asio::error::operation_aborted) {
+            return;
+        }
+        handleHandshake(ec);
+    }
+
+    void handleHandshake(const boost::system::error_code &ec);
+
+    void cbTimeout() {
+        handleTimeout();
+    }
+
+    void handleTimeout();
+
+    void makeTransport();
+
+    enum State {
+        kDisconnected,
+        kConnecting,
+        kConnected,
+    };
+
+    std::string _path;
+    std::unique_ptr<ClientFactory> _factory;
+    int _busyPoll{0};
+    double _timeout{0.0};
+    std::shared_ptr<SHMClientConnection> _connection;
+    State _state{kDisconnected};
+    DelayedCall _timeoutId;
+    bool _factoryStarted{false};
+    std::exception_ptr _error;
+    HandlerMemory<> _connectMemory;
+};
+
+NS_END
+
+#endif //NET4CXX_HAS_SHM_TRANSPORT
+
+#endif //NET4CXX_CORE_NETWORK_SHM_H
@@ -4,6 +4,7 @@
 
 #include "net4cxx/core/network/ssl.h"
 #include "net4cxx/common/debugging/assert.h"
+#include "net4cxx/core/network/affinity.h"
 #include "net4cxx/core/network/protocol.h"
 #include "net4cxx/core/network/reactor.h"
 
@@ -18,21 +19,43 @@ SSLConnection::SSLConnection(const ProtocolPtr &protocol, SSLOptionPtr sslOption
 
 }
 
+SSLConnection::~SSLConnection() {
+    if (_streamBio) {
+        BIO_free(_streamBio);
+    }
+}
+
 void SSLConnection::write(const Byte *data, size_t length) {
     if (_disconnecting || _disconnected || !_connected) {
         return;
     }
-    MessageBuffer packet(length);
-    packet.write(data, length);
-    _writeQueue.emplace_back(std::move(packet));
-    startWriting();
+    // Writes made before the queue is flushed share records, so they go into the last buffer unless that one is
+    // being written; the flush waits for the reactor to finish the current callback.
+    if (!_writeQueue.empty() && (_writeQueue.size() > 1 || !_writing)) {
+        MessageBuffer &buffer = _writeQueue.back();
+        buffer.ensureFreeSpace(length);
+        buffer.write(data, length);
+    } else {
+        MessageBuffer packet(length);
+        packet.write(data, length);
+        _writeQueue.emplace_back(std::move(packet));
+        if (_writeQueue.spilled()) {
+            trimLater(shared_from_this());
+        }
+    }
+    if (!_writing && !_flushing) {
+        _flushing = true;
+        _reactor->addCallback([protocol = _protocol.lock(), self = shared_from_this()]() {
+            self->cbFlush();
+        });
+    }
 }
 
 void SSLConnection::loseConnection() {
     if (_disconnecting || _disconnected || !_connected) {
         return;
     }
-    _error = NET4CXX_EXCEPTION_PTR(ConnectionDone, "");
+    _error = DisconnectReason(DisconnectReason::kConnectionDone);
     _disconnecting = true;
     doClose();
 }
@@ -41,13 +64,52 @@ void SSLConnection::abortConnection() {
     if (_disconnecting || _disconnected || !_connected) {
         return;
     }
-    _error = NET4CXX_EXCEPTION_PTR(ConnectionAbort, "");
+    _error = DisconnectReason(DisconnectReason::kConnectionAbort);
     _disconnecting = true;
     doAbort();
 }
 
+void SSLConnection::pauseReading() {
+    if (_readPaused) {
+        return;
+    }
+    _readPaused = true;
+    if (_connected && !_disconnected) {
+        _pausedProtocol = _protocol.lock();
+    }
+}
+
+void SSLConnection::resumeReading() {
+    if (!_readPaused) {
+        return;
+    }
+    _readPaused = false;
+    if (_connected && !_disconnecting && !_disconnected) {
+        startReading();
+    }
+    _pausedProtocol.reset();
+}
+
+bool SSLConnection::waitForTokens() {
+    Duration delay = getRateLimitDelay();
+    if (delay == Duration::zero()) {
+        return false;
+    }
+    _readLimited = true;
+    _rateLimitCall = _reactor->callLater(delay, [this, protocol=_protocol.lock(), self=shared_from_this()]() {
+        _readLimited = false;
+        if (_connected && !_disconnecting && !_disconnected) {
+            startReading();
+        }
+    });
+    return true;
+}
+
 void SSLConnection::doClose() {
     if (_sslAccepted) {
+        if (!_writeQueue.empty()) {
+            startWriting();
+        }
         if (!_writing) {
             startShutdown();
         }
@@ -55,7 +117,7 @@ void SSLConnection::doClose() {
         if (_sslAccepting) {
             _socket.lowest_layer().cancel();
         }
-        _reactor->addCallback([this, self=shared_from_this()]() {
+        _reactor->addCallback([this, self=shared_from_this(), protocol=_protocol.lock()]() {
             if (!_disconnected) {
                 closeSocket();
             }
@@ -73,7 +135,7 @@ void SSLConnection::doAbort() {
         if (_sslAccepting) {
             _socket.lowest_layer().cancel();
         }
-        _reactor->addCallback([this, self=shared_from_this()]() {
+        _reactor->addCallback([this, self=shared_from_this(), protocol=_protocol.lock()]() {
             if (!_disconnected) {
                 closeSocket();
             }
@@ -82,9 +144,13 @@ void SSLConnection::doAbort() {
 }
 
 void SSLConnection::closeSocket() {
+    auto pausedProtocol = std::move(_pausedProtocol);
     _connected = false;
     _disconnected = true;
     _disconnecting = false;
+    if (!_rateLimitCall.cancelled()) {
+        _rateLimitCall.cancel();
+    }
     if (_socket.lowest_layer().is_open()) {
         _socket.lowest_layer().close();
     }
@@ -95,16 +161,20 @@ void SSLConnection::doHandshake() {
     auto protocol = _protocol.lock();
     BOOST_ASSERT(protocol);
     _sslAccepting = true;
-    if (_sslOption->isServerSide()) {
+    if (_sslOption->getHandshakePool() || _sslOption->isKernelTLS()) {
+        doOffloadedHandshake();
+    } else if (_sslOption->isServerSide()) {
         _socket.async_handshake(boost::asio::ssl::stream_base::server,
-                                [protocol, self = shared_from_this()](const boost::system::error_code &ec) {
+                                makeCustomAllocHandler(_readMemory, [protocol, self = shared_from_this()](
+                                        const boost::system::error_code &ec) {
                                     self->cbHandshake(ec);
-                                });
+                                }));
     } else {
         _socket.async_handshake(boost::asio::ssl::stream_base::client,
-                                [protocol, self = shared_from_this()](const boost::system::error_code &ec) {
+                                makeCustomAllocHandler(_readMemory, [protocol, self = shared_from_this()](
+                                        const boost::system::error_code &ec) {
                                     self->cbHandshake(ec);
-                                });
+                                }));
     }
 }
 
@@ -115,13 +185,158 @@ void SSLConnection::handleHandshake(const boost::system::error_code &ec) {
         }
         if (!_disconnected) {
             if (ec != boost::asio::error::operation_aborted) {
-                _error = std::make_exception_ptr(boost::system::system_error(ec));
+                _error = DisconnectReason(ec);
             }
             closeSocket();
         }
     } else {
         _sslAccepted = true;
+        _sslOption->recordHandshake(SSL_session_reused(_socket.native_handle()) != 0);
+        if (!_handshakePlaintext.empty()) {
+            ByteArray plaintext = std::move(_handshakePlaintext);
+            dataReceived(plaintext.data(), plaintext.size());
+        }
+    }
+}
+
+void SSLConnection::doOffloadedHandshake() {
+    // The handshake runs over memory BIOs so that the pool works on the SSL object alone, while the reactor moves
+    // the bytes; the stream gets its BIO back once the handshake is done. Kernel TLS takes this path too, as it
+    // leaves no record read off the socket behind in the stream's buffers.
+    SSL *ssl = _socket.native_handle();
+#ifdef NET4CXX_HAS_KTLS
+    if (_sslOption->isKernelTLS() && KernelTLS::isAvailable()) {
+        _kernelTLSState = std::make_unique<KernelTLS>();
+        _kernelTLSState->attach(ssl);
+    }
+#endif
+    _streamBio = SSL_get_rbio(ssl);
+    BIO_up_ref(_streamBio);
+    SSL_set_bio(ssl, BIO_new(BIO_s_mem()), BIO_new(BIO_s_mem()));
+    if (_sslOption->isServerSide()) {
+        SSL_set_accept_state(ssl);
+    } else {
+        SSL_set_connect_state(ssl);
+    }
+    stepHandshake();
+}
+
+void SSLConnection::stepHandshake() {
+    ThreadPool *pool = _sslOption->getHandshakePool();
+    if (pool) {
+        auto protocol = _protocol.lock();
+        BOOST_ASSERT(protocol);
+        auto task = [this, protocol, self = shared_from_this()]() mutable {
+            runHandshakeStep();
+            _reactor->callFromThread([protocol = std::move(protocol), self = std::move(self)]() {
+                self->cbHandshakeStep();
+            });
+        };
+        if (pool->submit(std::make_unique<ThreadCallbackImpl<decltype(task)>>(std::move(task)))) {
+            return;
+        }
+        // The pool is backed up, the reactor takes this step itself rather than failing the handshake.
+    }
+    runHandshakeStep();
+    cbHandshakeStep();
+}
+
+void SSLConnection::runHandshakeStep() {
+    SSL *ssl = _socket.native_handle();
+    ERR_clear_error();
+    int result = SSL_do_handshake(ssl);
+    _handshakeStatus = result == 1 ? SSL_ERROR_NONE : SSL_get_error(ssl, result);
+    _handshakeError = ERR_get_error();
+    if (_handshakeStatus == SSL_ERROR_NONE) {
+        // Records that came in behind the peer's last handshake message are application data the stream will never
+        // see, decrypt them for handleHandshake to pass on.
+        Byte buffer[16384];
+        int length;
+        while (BIO_ctrl_pending(SSL_get_rbio(ssl)) > 0 && (length = SSL_read(ssl, buffer, sizeof(buffer))) > 0) {
+            _handshakePlaintext.insert(_handshakePlaintext.end(), buffer, buffer + length);
+        }
+        ERR_clear_error();
+    }
+    BIO *output = SSL_get_wbio(ssl);
+    size_t pending = BIO_ctrl_pending(output);
+    if (pending) {
+        _handshakeOutput.resize(pending);
+        BIO_read(output, _handshakeOutput.data(), (int)pending);
+    }
+}
+
+void SSLConnection::cbHandshakeStep() {
+    if (_disconnecting || _disconnected) {
+        // Closed while the step ran; the close already takes care of the socket.
+        return;
+    }
+    if (_handshakeStatus != SSL_ERROR_NONE && _handshakeStatus != SSL_ERROR_WANT_READ) {
+        boost::system::error_code ec;
+        if (_handshakeStatus == SSL_ERROR_SSL && _handshakeError) {
+            ec.assign((int)_handshakeError, boost::asio::error::get_ssl_category());
+        } else {
+            ec = boost::asio::ssl::error::unspecified_system_error;
+        }
+        cbHandshake(ec);
+    } else if (!_handshakeOutput.empty()) {
+        doHandshakeWrite();
+    } else {
+        continueHandshake();
+    }
+}
+
+void SSLConnection::doHandshakeRead() {
+    auto protocol = _protocol.lock();
+    BOOST_ASSERT(protocol);
+    _readBuffer.normalize();
+    _readBuffer.ensureFreeSpace();
+    _socket.next_layer().async_read_some(
+            boost::asio::buffer(_readBuffer.getWritePointer(), _readBuffer.getRemainingSpace()),
+            makeCustomAllocHandler(_readMemory, [protocol, self = shared_from_this()](
+                    const boost::system::error_code &ec, size_t transferredBytes) {
+                if (ec) {
+                    self->cbHandshake(ec);
+                } else {
+                    BIO_write(SSL_get_rbio(self->_socket.native_handle()), self->_readBuffer.getWritePointer(),
+                              (int)transferredBytes);
+                    self->stepHandshake();
+                }
+            }));
+}
+
+void SSLConnection::doHandshakeWrite() {
+    auto protocol = _protocol.lock();
+    BOOST_ASSERT(protocol);
+    boost::asio::async_write(_socket.next_layer(), boost::asio::buffer(_handshakeOutput),
+                             makeCustomAllocHandler(_writeMemory, [protocol, self = shared_from_this()](
+                                     const boost::system::error_code &ec, size_t transferredBytes) {
+                                 self->_handshakeOutput.clear();
+                                 if (ec) {
+                                     self->cbHandshake(ec);
+                                 } else {
+                                     self->continueHandshake();
+                                 }
+                             }));
+}
+
+void SSLConnection::finishOffloadedHandshake() {
+    SSL *ssl = _socket.native_handle();
+    SSL_set_bio(ssl, _streamBio, _streamBio);
+    _streamBio = nullptr;
+#ifdef NET4CXX_HAS_KTLS
+    if (_kernelTLSState) {
+        // OpenSSL keeps the records it has buffered, and a TLS 1.3 client the session tickets still to come.
+        int directions = KernelTLS::kSend;
+        if (!SSL_has_pending(ssl) && (SSL_is_server(ssl) || SSL_version(ssl) != TLS1_3_VERSION)) {
+            directions |= KernelTLS::kReceive;
+        }
+        _kernelTLS = _kernelTLSState->enable(ssl, _socket.lowest_layer().native_handle(), directions);
+        if (_kernelTLS & KernelTLS::kSend) {
+            _sslOption->recordKernelOffload();
+        }
     }
+#endif
+    cbHandshake({});
 }
 
 void SSLConnection::doRead() {
@@ -130,25 +345,42 @@ void SSLConnection::doRead() {
     _readBuffer.normalize();
     _readBuffer.ensureFreeSpace();
     _reading = true;
+#ifdef NET4CXX_HAS_KTLS
+    if (_kernelTLS & KernelTLS::kReceive) {
+        _socket.next_layer().async_read_some(
+                boost::asio::buffer(_readBuffer.getWritePointer(), _readBuffer.getRemainingSpace()),
+                makeCustomAllocHandler(_readMemory, [protocol, self = shared_from_this()](
+                        const boost::system::error_code &ec, size_t transferredBytes) {
+                    if (ec == boost::system::errc::io_error &&
+                        KernelTLS::receiveCloseNotify(self->_socket.native_handle(),
+                                                      self->_socket.lowest_layer().native_handle())) {
+                        // The kernel stops at records other than application data, the peer's close_notify
+                        // among them; any other is beyond it, so the connection fails with the read.
+                        self->cbRead(boost::asio::error::eof, transferredBytes);
+                    } else {
+                        self->cbRead(ec, transferredBytes);
+                    }
+                }));
+        return;
+    }
+#endif
     _socket.async_read_some(boost::asio::buffer(_readBuffer.getWritePointer(), _readBuffer.getRemainingSpace()),
-                            [protocol, self = shared_from_this()](const boost::system::error_code &ec,
-                                                                  size_t transferredBytes) {
+                            makeCustomAllocHandler(_readMemory, [protocol, self = shared_from_this()](
+                                    const boost::system::error_code &ec, size_t transferredBytes) {
                                 self->cbRead(ec, transferredBytes);
-                            });
+                            }));
 }
 
 void SSLConnection::handleRead(const boost::system::error_code &ec, size_t transferredBytes) {
     if (ec) {
         if (ec != boost::asio::error::operation_aborted && ec != boost::asio::error::eof &&
-            (ec.category() != boost::asio::error::get_ssl_category() ||
-             ERR_GET_REASON(ec.value()) != SSL_R_SHORT_READ)) {
+            ec != boost::asio::ssl::error::stream_truncated) {
             NET4CXX_ERROR(gGenLog, "Read error %d :%s", ec.value(), ec.message().c_str());
         }
         if (!_disconnected) {
             if (ec != boost::asio::error::operation_aborted && ec != boost::asio::error::eof &&
-                (ec.category() != boost::asio::error::get_ssl_category() ||
-                 ERR_GET_REASON(ec.value()) != SSL_R_SHORT_READ)) {
-                _error = std::make_exception_ptr(boost::system::system_error(ec));
+                ec != boost::asio::ssl::error::stream_truncated) {
+                _error = DisconnectReason(ec);
             }
             _disconnecting = true;
             startShutdown();
@@ -181,25 +413,36 @@ void SSLConnection::doWrite() {
     auto protocol = _protocol.lock();
     BOOST_ASSERT(protocol);
     _writing = true;
-    _socket.async_write_some(boost::asio::buffer(buffer.getReadPointer(), buffer.getActiveSize()),
-                             [protocol, self = shared_from_this()](const boost::system::error_code &ec,
-                                                                   size_t transferredBytes) {
+    // Each write makes one record, or as many full-size ones as the kernel cuts it into.
+    size_t length = std::min(buffer.getActiveSize(), getRecordSize());
+#ifdef NET4CXX_HAS_KTLS
+    if (_kernelTLS & KernelTLS::kSend) {
+        _socket.next_layer().async_write_some(
+                boost::asio::buffer(buffer.getReadPointer(), length),
+                makeCustomAllocHandler(_writeMemory, [protocol, self = shared_from_this()](
+                        const boost::system::error_code &ec, size_t transferredBytes) {
+                    self->cbWrite(ec, transferredBytes);
+                }));
+        return;
+    }
+#endif
+    _socket.async_write_some(boost::asio::buffer(buffer.getReadPointer(), length),
+                             makeCustomAllocHandler(_writeMemory, [protocol, self = shared_from_this()](
+                                     const boost::system::error_code &ec, size_t transferredBytes) {
                                  self->cbWrite(ec, transferredBytes);
-                             });
+                             }));
 }
 
 void SSLConnection::handleWrite(const boost::system::error_code &ec, size_t transferredBytes) {
     if (ec) {
         if (ec != boost::asio::error::operation_aborted && ec != boost::asio::error::eof &&
-            (ec.category() != boost::asio::error::get_ssl_category() ||
-             ERR_GET_REASON(ec.value()) != SSL_R_SHORT_READ)) {
+            ec != boost::asio::ssl::error::stream_truncated) {
             NET4CXX_ERROR(gGenLog, "Write error %d :%s", ec.value(), ec.message().c_str());
         }
         if (!_disconnected) {
             if (ec != boost::asio::error::operation_aborted && ec != boost::asio::error::eof &&
-                (ec.category() != boost::asio::error::get_ssl_category() ||
-                 ERR_GET_REASON(ec.value()) != SSL_R_SHORT_READ)) {
-                _error = std::make_exception_ptr(boost::system::system_error(ec));
+                ec != boost::asio::ssl::error::stream_truncated) {
+                _error = DisconnectReason(ec);
             }
             _disconnecting = true;
             startShutdown();
@@ -210,29 +453,58 @@ void SSLConnection::handleWrite(const boost::system::error_code &ec, size_t tran
             if (!_writeQueue.front().getActiveSize()) {
                 _writeQueue.pop_front();
             }
+            _recordBytes += transferredBytes;
+            ++_recordCount;
+            _lastWriteTime = TimestampClock::now();
         }
-        if (_disconnecting) {
+        // A closing connection sends what it has queued first.
+        if (_disconnecting && _writeQueue.empty()) {
             startShutdown();
         }
     }
 }
 
+size_t SSLConnection::getRecordSize() {
+    size_t initialRecordSize = _sslOption->getInitialRecordSize();
+    if (!initialRecordSize) {
+        return SIZE_MAX;
+    }
+    if (TimestampClock::now() - _lastWriteTime >= _sslOption->getRecordSizeIdle()) {
+        _recordBytes = 0;
+        _recordCount = 0;
+    }
+    if (_recordBytes >= _sslOption->getRecordSizeBoost()) {
+        return SIZE_MAX;
+    }
+    return std::min<size_t>(initialRecordSize * (_recordCount + 1), SSL3_RT_MAX_PLAIN_LENGTH);
+}
+
 void SSLConnection::doShutdown() {
     auto protocol = _protocol.lock();
     BOOST_ASSERT(protocol);
     _sslShutting = true;
-    _socket.async_shutdown([protocol, self = shared_from_this()](const boost::system::error_code &ec) {
+#ifdef NET4CXX_HAS_KTLS
+    if (_kernelTLS & KernelTLS::kSend) {
+        // OpenSSL no longer knows the sequence numbers, the kernel sends close_notify instead.
+        KernelTLS::sendCloseNotify(_socket.native_handle(), _socket.lowest_layer().native_handle());
+        _reactor->addCallback([protocol, self = shared_from_this()]() {
+            self->cbShutdown({});
+        });
+        return;
+    }
+#endif
+    _socket.async_shutdown(makeCustomAllocHandler(_writeMemory, [protocol, self = shared_from_this()](
+            const boost::system::error_code &ec) {
         self->cbShutdown(ec);
-    });
+    }));
 }
 
 void SSLConnection::handleShutdown(const boost::system::error_code &ec) {
     if (ec) {
         if (ec != boost::asio::error::operation_aborted && ec != boost::asio::error::eof &&
-            (ec.category() != boost::asio::error::get_ssl_category() ||
-             ERR_GET_REASON(ec.value()) != SSL_R_SHORT_READ)) {
+            ec != boost::asio::ssl::error::stream_truncated) {
             NET4CXX_ERROR(gGenLog, "Read error %d :%s", ec.value(), ec.message().c_str());
-            _error = std::make_exception_ptr(boost::system::system_error(ec));
+            _error = DisconnectReason(ec);
         }
     }
     BOOST_ASSERT(!_disconnected);
@@ -243,6 +515,9 @@ void SSLConnection::handleShutdown(const boost::system::error_code &ec) {
 void SSLServerConnection::cbAccept(const ProtocolPtr &protocol) {
     _protocol = protocol;
     _connected = true;
+    if (_reactor->getSocketBusyPoll() > 0) {
+        NetUtil::setBusyPoll(_socket.lowest_layer().native_handle(), _reactor->getSocketBusyPoll());
+    }
     protocol->makeConnection(shared_from_this());
     if (!_disconnecting) {
         startHandshake();
@@ -254,6 +529,9 @@ void SSLClientConnection::cbConnect(const ProtocolPtr &protocol, std::shared_ptr
     _protocol = protocol;
     _connector = std::move(connector);
     _connected = true;
+    if (_reactor->getSocketBusyPoll() > 0) {
+        NetUtil::setBusyPoll(_socket.lowest_layer().native_handle(), _reactor->getSocketBusyPoll());
+    }
     protocol->makeConnection(shared_from_this());
     if (!_disconnecting) {
         startHandshake();
@@ -294,6 +572,10 @@ void SSLListener::startListening() {
     }
     _acceptor.open(endpoint.protocol());
     _acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+    int incomingCpu = _reactor->getIncomingCpu();
+    if (incomingCpu >= 0 && !ReactorPlacement::steerIncoming(_acceptor.native_handle(), incomingCpu)) {
+        NET4CXX_ERROR(gGenLog, "SSLListener failed to steer incoming connections to CPU %d", incomingCpu);
+    }
     _acceptor.bind(endpoint);
     _acceptor.listen();
     NET4CXX_INFO(gGenLog, "SSLListener starting on %s", _port.c_str());
@@ -400,12 +682,9 @@ void SSLConnector::connectionFailed(std::exception_ptr reason) {
     }
 }
 
-void SSLConnector::connectionLost(std::exception_ptr reason) {
-    if (reason) {
-        _error = std::move(reason);
-    }
+void SSLConnector::connectionLost(const DisconnectReason &reason) {
     _state = kDisconnected;
-    _factory->clientConnectionLost(shared_from_this(), _error);
+    _factory->clientConnectionLost(shared_from_this(), reason);
     if (_state == kDisconnected) {
         _factory->doStop();
         _factoryStarted = false;
@@ -440,19 +719,20 @@ void SSLConnector::doConnect() {
     makeTransport();
     EndpointType endpoint{AddressType::from_string(_host), (unsigned short)std::stoul(_port)};
     _connection->getSocket().lowest_layer().async_connect(
-            endpoint, [this, self = shared_from_this(), connection = _connection](
-                    const boost::system::error_code &ec) {
+            endpoint, makeCustomAllocHandler(_connectMemory, [this, self = shared_from_this(),
+                    connection = _connection](const boost::system::error_code &ec) {
                 cbConnect(ec);
-            });
+            }));
 }
 
 void SSLConnector::doConnect(ResolverIterator iterator) {
     makeTransport();
     boost::asio::async_connect(_connection->getSocket().lowest_layer(), std::move(iterator),
-                               [this, self = shared_from_this(), connection = _connection](
-                                       const boost::system::error_code &ec, ResolverIterator iterator) {
+                               makeCustomAllocHandler(_connectMemory, [this, self = shared_from_this(),
+                                       connection = _connection](const boost::system::error_code &ec,
+                                                                 ResolverIterator iterator) {
                                    cbConnect(ec);
-                               });
+                               }));
 }
 
 void SSLConnector::handleConnect(const boost::system::error_code &ec) {
@@ -482,7 +762,11 @@ void SSLConnector::handleTimeout() {
 }
 
 void SSLConnector::makeTransport() {
-    _connection = std::make_shared<SSLClientConnection>(_sslOption, _reactor);
+    _connection = std::make_shared<SSLClientConnection>(_sslOption, _reactor, _host + ":" + _port);
+    if (!NetUtil::isValidIP(_host)) {
+        // Servers holding certificates for several names pick one by SNI.
+        SSL_set_tlsext_host_name(_connection->getSocket().native_handle(), _host.c_str());
+    }
     if (!_bindAddress.getAddress().empty()) {
         EndpointType endpoint{AddressType::from_string(_bindAddress.getAddress()), _bindAddress.getPort()};
         _connection->getSocket().lowest_layer().open(endpoint.protocol());
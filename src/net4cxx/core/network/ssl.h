@@ -11,6 +11,7 @@
 #include "net4cxx/common/debugging/watcher.h"
 #include "net4cxx/common/global/loggers.h"
 #include "net4cxx/core/network/base.h"
+#include "net4cxx/core/network/ktls.h"
 
 
 NS_BEGIN
@@ -26,6 +27,8 @@ public:
 
     SSLConnection(const ProtocolPtr &protocol, SSLOptionPtr sslOption, Reactor *reactor);
 
+    ~SSLConnection() override;
+
     SocketType& getSocket() {
         return _socket;
     }
@@ -36,6 +39,14 @@ public:
 
     void abortConnection() override;
 
+    void pauseReading() override;
+
+    void resumeReading() override;
+
+    bool canPauseReading() const override {
+        return true;
+    }
+
     bool getNoDelay() const override {
         boost::asio::ip::tcp::no_delay option;
         _socket.lowest_layer().get_option(option);
@@ -77,6 +88,12 @@ public:
         auto endpoint = _socket.lowest_layer().remote_endpoint();
         return endpoint.port();
     }
+
+    /// KernelTLS directions the kernel handles the records of; while it sends them, sendfile on the native socket
+    /// goes out encrypted.
+    int getKernelTLS() const {
+        return _kernelTLS;
+    }
 protected:
     void doClose();
 
@@ -105,19 +122,45 @@ protected:
 
     void handleHandshake(const boost::system::error_code &ec);
 
+    void doOffloadedHandshake();
+
+    void stepHandshake();
+
+    void runHandshakeStep();
+
+    void cbHandshakeStep();
+
+    void continueHandshake() {
+        if (_handshakeStatus == SSL_ERROR_NONE) {
+            finishOffloadedHandshake();
+        } else {
+            doHandshakeRead();
+        }
+    }
+
+    void doHandshakeRead();
+
+    void doHandshakeWrite();
+
+    void finishOffloadedHandshake();
+
     void startReading() {
-        if (!_reading && _sslAccepted) {
+        if (!_reading && _sslAccepted && !_readPaused && !_readLimited &&
+            (_rateLimiters.empty() || !waitForTokens())) {
             doRead();
         }
     }
 
+    /// Schedules the read for when the rate limiters have refilled if any of them is dry.
+    bool waitForTokens();
+
     void doRead();
 
     void cbRead(const boost::system::error_code &ec, size_t transferredBytes) {
         _reading = false;
         handleRead(ec, transferredBytes);
         if (!_disconnecting && !_disconnected) {
-            doRead();
+            startReading();
         }
     }
 
@@ -134,13 +177,23 @@ protected:
     void cbWrite(const boost::system::error_code &ec, size_t transferredBytes) {
         _writing = false;
         handleWrite(ec, transferredBytes);
-        if (!_disconnecting && !_disconnected && !_writeQueue.empty()) {
+        if (!_disconnected && !_sslShutting && !_writeQueue.empty()) {
             doWrite();
         }
     }
 
     void handleWrite(const boost::system::error_code &ec, size_t transferredBytes);
 
+    void cbFlush() {
+        _flushing = false;
+        if (!_disconnected && !_sslShutting && !_writeQueue.empty()) {
+            startWriting();
+        }
+    }
+
+    /// Plaintext bytes the next record carries, SIZE_MAX once records are full size.
+    size_t getRecordSize();
+
     void startShutdown() {
         if (!_sslShutting) {
             doShutdown();
@@ -159,9 +212,29 @@ protected:
     bool _sslAccepting{false};
     bool _sslAccepted{false};
     bool _sslShutting{false};
+    bool _flushing{false};
     SSLOptionPtr _sslOption;
     SocketType _socket;
-    std::exception_ptr _error;
+    /// The stream's own BIO, set aside while an offloaded handshake runs over memory BIOs.
+    BIO *_streamBio{nullptr};
+    int _handshakeStatus{SSL_ERROR_NONE};
+    unsigned long _handshakeError{0};
+    ByteArray _handshakeOutput;
+    ByteArray _handshakePlaintext;
+#ifdef NET4CXX_HAS_KTLS
+    std::unique_ptr<KernelTLS> _kernelTLSState;
+#endif
+    int _kernelTLS{0};
+    size_t _recordBytes{0};
+    size_t _recordCount{0};
+    Timestamp _lastWriteTime;
+    DisconnectReason _error;
+    HandlerMemory<448> _readMemory;
+    HandlerMemory<448> _writeMemory;
+    // Stands in for the pending read while reading is paused, which would otherwise keep the protocol alive.
+    ProtocolPtr _pausedProtocol;
+    bool _readLimited{false};
+    DelayedCall _rateLimitCall;
 };
 
 
@@ -186,11 +259,16 @@ public:
 
 class NET4CXX_COMMON_API SSLClientConnection: public SSLConnection {
 public:
-    explicit SSLClientConnection(SSLOptionPtr sslOption, Reactor *reactor)
-            : SSLConnection({}, std::move(sslOption), reactor) {
+    /// A non-empty sessionKey, the host and port connected to, resumes the session cached under it.
+    explicit SSLClientConnection(SSLOptionPtr sslOption, Reactor *reactor, std::string sessionKey={})
+            : SSLConnection({}, std::move(sslOption), reactor)
+            , _sessionKey(std::move(sessionKey)) {
 #ifndef NET4CXX_NDEBUG
         NET4CXX_Watcher->inc(NET4CXX_SSLClientConnection_COUNT);
 #endif
+        if (!_sessionKey.empty()) {
+            _sslOption->resumeSession(_socket.native_handle(), _sessionKey);
+        }
     }
 
 #ifndef NET4CXX_NDEBUG
@@ -203,6 +281,7 @@ public:
 protected:
     void closeSocket() override;
 
+    std::string _sessionKey;
     std::shared_ptr<SSLConnector> _connector;
 };
 
@@ -246,7 +325,9 @@ protected:
     void doAccept() {
         _connection = std::make_shared<SSLServerConnection>(_sslOption, _reactor);
         _acceptor.async_accept(_connection->getSocket().lowest_layer(),
-                               std::bind(&SSLListener::cbAccept, shared_from_this(), std::placeholders::_1));
+                               makeCustomAllocHandler(_acceptMemory, std::bind(&SSLListener::cbAccept,
+                                                                               shared_from_this(),
+                                                                               std::placeholders::_1)));
     }
 
     std::string _port;
@@ -256,6 +337,7 @@ protected:
     AcceptorType _acceptor;
     bool _connected{false};
     std::shared_ptr<SSLServerConnection> _connection;
+    HandlerMemory<> _acceptMemory;
 };
 
 
@@ -282,7 +364,7 @@ public:
 
     void connectionFailed(std::exception_ptr reason={});
 
-    void connectionLost(std::exception_ptr reason={});
+    void connectionLost(const DisconnectReason &reason={});
 protected:
     ProtocolPtr buildProtocol(const Address &address);
 
@@ -339,6 +421,7 @@ protected:
     DelayedCall _timeoutId;
     bool _factoryStarted{false};
     std::exception_ptr _error;
+    HandlerMemory<> _connectMemory;
 };
 
 NS_END
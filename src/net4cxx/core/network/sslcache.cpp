@@ -0,0 +1,222 @@
+//
+// Created by yuwenyong on 17-12-4.
+//
+
+#include "net4cxx/core/network/sslcache.h"
+#include <openssl/rand.h>
+#include "net4cxx/common/utilities/errors.h"
+#include "net4cxx/common/utilities/strutil.h"
+
+
+NS_BEGIN
+
+SSLSessionCache::SSLSessionCache(size_t capacity, const Duration &timeout, const Duration &ticketKeyRotation)
+        : _capacity(capacity)
+        , _timeout(timeout)
+        , _ticketKeyRotation(ticketKeyRotation) {
+
+}
+
+void SSLSessionCache::addSession(const Byte *id, size_t idLength, ByteArray session) {
+    std::string key((const char *)id, idLength);
+    Timestamp expires = TimestampClock::now() + _timeout;
+    std::lock_guard<std::mutex> lock(_sessionLock);
+    auto iter = _sessions.find(key);
+    if (iter != _sessions.end()) {
+        iter->second.session = std::move(session);
+        iter->second.expires = expires;
+        _recentlyUsed.splice(_recentlyUsed.begin(), _recentlyUsed, iter->second.position);
+        return;
+    }
+    while (_capacity && _sessions.size() >= _capacity) {
+        _sessions.erase(_recentlyUsed.back());
+        _recentlyUsed.pop_back();
+    }
+    _recentlyUsed.push_front(key);
+    _sessions.emplace(std::move(key), Entry{std::move(session), expires, _recentlyUsed.begin()});
+}
+
+bool SSLSessionCache::findSession(const Byte *id, size_t idLength, ByteArray &session) {
+    std::string key((const char *)id, idLength);
+    std::lock_guard<std::mutex> lock(_sessionLock);
+    auto iter = _sessions.find(key);
+    if (iter == _sessions.end()) {
+        return false;
+    }
+    if (iter->second.expires <= TimestampClock::now()) {
+        _recentlyUsed.erase(iter->second.position);
+        _sessions.erase(iter);
+        return false;
+    }
+    _recentlyUsed.splice(_recentlyUsed.begin(), _recentlyUsed, iter->second.position);
+    session = iter->second.session;
+    return true;
+}
+
+void SSLSessionCache::removeSession(const Byte *id, size_t idLength) {
+    std::string key((const char *)id, idLength);
+    std::lock_guard<std::mutex> lock(_sessionLock);
+    auto iter = _sessions.find(key);
+    if (iter != _sessions.end()) {
+        _recentlyUsed.erase(iter->second.position);
+        _sessions.erase(iter);
+    }
+}
+
+SSLSessionCache::TicketKey SSLSessionCache::getTicketKey() {
+    std::lock_guard<std::mutex> lock(_ticketKeyLock);
+    rotateTicketKeys(TimestampClock::now());
+    return _ticketKeys.back();
+}
+
+bool SSLSessionCache::findTicketKey(const Byte *name, TicketKey &key, bool &current) {
+    std::lock_guard<std::mutex> lock(_ticketKeyLock);
+    rotateTicketKeys(TimestampClock::now());
+    for (auto iter = _ticketKeys.rbegin(); iter != _ticketKeys.rend(); ++iter) {
+        if (memcmp(iter->name, name, sizeof(iter->name)) == 0) {
+            key = *iter;
+            current = iter == _ticketKeys.rbegin();
+            return true;
+        }
+    }
+    return false;
+}
+
+std::shared_ptr<SSLSessionCache> SSLSessionCache::getShared(const std::string &name, size_t capacity,
+                                                            const Duration &timeout,
+                                                            const Duration &ticketKeyRotation) {
+    static std::mutex registryLock;
+    static std::map<std::string, std::weak_ptr<SSLSessionCache>> registry;
+    std::lock_guard<std::mutex> lock(registryLock);
+    auto &entry = registry[name];
+    auto cache = entry.lock();
+    if (!cache) {
+        cache = std::make_shared<SSLSessionCache>(capacity, timeout, ticketKeyRotation);
+        entry = cache;
+    } else if (cache->_capacity != capacity || cache->_timeout != timeout ||
+               cache->_ticketKeyRotation != ticketKeyRotation) {
+        NET4CXX_THROW_EXCEPTION(ValueError, StrUtil::format("Session cache '%s' already exists with other settings",
+                                                            name.c_str()));
+    }
+    return cache;
+}
+
+void SSLSessionCache::rotateTicketKeys(const Timestamp &now) {
+    if (!_ticketKeys.empty()) {
+        if (_ticketKeyRotation == Duration::zero() || now - _ticketKeys.back().created < _ticketKeyRotation) {
+            return;
+        }
+        _ticketKeys.back().retired = now;
+        auto iter = std::remove_if(_ticketKeys.begin(), _ticketKeys.end(), [this, &now](const TicketKey &key) {
+            return now - key.retired >= _timeout;
+        });
+        _ticketKeys.erase(iter, _ticketKeys.end());
+    }
+    TicketKey key;
+    if (RAND_bytes(key.name, sizeof(key.name)) != 1 || RAND_bytes(key.aesKey, sizeof(key.aesKey)) != 1 ||
+        RAND_bytes(key.hmacKey, sizeof(key.hmacKey)) != 1) {
+        NET4CXX_THROW_EXCEPTION(IOError, "Generating session ticket key failed");
+    }
+    key.created = now;
+    key.retired = Timestamp::max();
+    _ticketKeys.push_back(key);
+}
+
+
+SSLClientSessionCache::~SSLClientSessionCache() {
+    for (auto &entry: _sessions) {
+        freeSessions(entry.second);
+    }
+}
+
+void SSLClientSessionCache::addSession(const std::string &key, SSL_SESSION *session) {
+    std::lock_guard<std::mutex> lock(_lock);
+    auto iter = _sessions.find(key);
+    if (iter != _sessions.end()) {
+        Entry &entry = iter->second;
+        if (!isSingleUse(session)) {
+            freeSessions(entry);
+        } else if (entry.sessions.size() == kMaxTickets) {
+            SSL_SESSION_free(entry.sessions.front());
+            entry.sessions.pop_front();
+        }
+        entry.sessions.push_back(session);
+        _recentlyUsed.splice(_recentlyUsed.begin(), _recentlyUsed, entry.position);
+        return;
+    }
+    while (_capacity && _sessions.size() >= _capacity) {
+        iter = _sessions.find(_recentlyUsed.back());
+        freeSessions(iter->second);
+        _sessions.erase(iter);
+        _recentlyUsed.pop_back();
+    }
+    _recentlyUsed.push_front(key);
+    _sessions.emplace(key, Entry{{session}, _recentlyUsed.begin()});
+}
+
+SSL_SESSION* SSLClientSessionCache::findSession(const std::string &key) {
+    std::lock_guard<std::mutex> lock(_lock);
+    auto iter = _sessions.find(key);
+    if (iter == _sessions.end()) {
+        return nullptr;
+    }
+    Entry &entry = iter->second;
+    SSL_SESSION *session = nullptr;
+    while (!entry.sessions.empty() && !session) {
+        session = entry.sessions.back();
+        if (!isResumable(session)) {
+            SSL_SESSION_free(session);
+            entry.sessions.pop_back();
+            session = nullptr;
+        }
+    }
+    if (session && isSingleUse(session)) {
+        // The caller takes over the cache's reference.
+        entry.sessions.pop_back();
+    } else if (session) {
+        SSL_SESSION_up_ref(session);
+    }
+    if (entry.sessions.empty()) {
+        _recentlyUsed.erase(entry.position);
+        _sessions.erase(iter);
+    } else {
+        _recentlyUsed.splice(_recentlyUsed.begin(), _recentlyUsed, entry.position);
+    }
+    return session;
+}
+
+void SSLClientSessionCache::removeSession(const std::string &key) {
+    std::lock_guard<std::mutex> lock(_lock);
+    auto iter = _sessions.find(key);
+    if (iter != _sessions.end()) {
+        freeSessions(iter->second);
+        _recentlyUsed.erase(iter->second.position);
+        _sessions.erase(iter);
+    }
+}
+
+bool SSLClientSessionCache::isResumable(SSL_SESSION *session) {
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+    if (!SSL_SESSION_is_resumable(session)) {
+        return false;
+    }
+#endif
+    return (long)time(nullptr) < SSL_SESSION_get_time(session) + SSL_SESSION_get_timeout(session);
+}
+
+bool SSLClientSessionCache::isSingleUse(SSL_SESSION *session) {
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+    return SSL_SESSION_get_protocol_version(session) == TLS1_3_VERSION;
+#else
+    return false;
+#endif
+}
+
+void SSLClientSessionCache::freeSessions(Entry &entry) {
+    for (auto session: entry.sessions) {
+        SSL_SESSION_free(session);
+    }
+    entry.sessions.clear();
+}
+
+NS_END
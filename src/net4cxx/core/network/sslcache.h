@@ -0,0 +1,124 @@
+//
+// Created by yuwenyong on 17-12-4.
+//
+
+#ifndef NET4CXX_CORE_NETWORK_SSLCACHE_H
+#define NET4CXX_CORE_NETWORK_SSLCACHE_H
+
+#include "net4cxx/common/common.h"
+#include <deque>
+#include <mutex>
+#include <openssl/ssl.h>
+
+NS_BEGIN
+
+
+/// Server-side TLS session store and session-ticket keys, safe to use from every reactor thread.
+///
+/// SSLOptions created with the same session cache name share one instance, so a client resumes on whichever reactor
+/// accepts it. Sessions are kept DER encoded and evicted least recently used first once capacity is reached. Ticket
+/// keys are rotated every rotation interval when one is set; retired keys still decrypt tickets until the session
+/// timeout has passed since their retirement, and tickets they decrypt are renewed under the current key.
+class NET4CXX_COMMON_API SSLSessionCache: public boost::noncopyable {
+public:
+    struct TicketKey {
+        Byte name[16];
+        Byte aesKey[32];
+        Byte hmacKey[32];
+        Timestamp created;
+        Timestamp retired;
+    };
+
+    SSLSessionCache(size_t capacity, const Duration &timeout, const Duration &ticketKeyRotation);
+
+    void addSession(const Byte *id, size_t idLength, ByteArray session);
+
+    bool findSession(const Byte *id, size_t idLength, ByteArray &session);
+
+    void removeSession(const Byte *id, size_t idLength);
+
+    size_t getSessionCount() const {
+        std::lock_guard<std::mutex> lock(_sessionLock);
+        return _sessions.size();
+    }
+
+    /// Key to encrypt new tickets with.
+    TicketKey getTicketKey();
+
+    /// Key named name, if it has not expired; current tells whether it is the one new tickets are encrypted with.
+    bool findTicketKey(const Byte *name, TicketKey &key, bool &current);
+
+    /// Instance registered under name, created if there is none yet; throws ValueError if its settings differ.
+    static std::shared_ptr<SSLSessionCache> getShared(const std::string &name, size_t capacity, const Duration &timeout,
+                                                      const Duration &ticketKeyRotation);
+protected:
+    struct Entry {
+        ByteArray session;
+        Timestamp expires;
+        std::list<std::string>::iterator position;
+    };
+
+    void rotateTicketKeys(const Timestamp &now);
+
+    size_t _capacity;
+    Duration _timeout;
+    Duration _ticketKeyRotation;
+    mutable std::mutex _sessionLock;
+    std::unordered_map<std::string, Entry> _sessions;
+    std::list<std::string> _recentlyUsed;
+    std::mutex _ticketKeyLock;
+    std::vector<TicketKey> _ticketKeys;
+};
+
+
+/// TLS sessions a client keeps to resume its next connection to the same server, keyed by host and port.
+///
+/// Entries hold a reference on their SSL_SESSIONs. A session is offered only while it is resumable and within its
+/// lifetime, which for a TLS 1.3 ticket is the lifetime the server gave it. OpenSSL uses a TLS 1.3 ticket only once,
+/// so a key keeps the latest few tickets the server issued and hands each out to a single connection; a TLS 1.2
+/// session is shared by every connection until a new one replaces it.
+class NET4CXX_COMMON_API SSLClientSessionCache: public boost::noncopyable {
+public:
+    explicit SSLClientSessionCache(size_t capacity)
+            : _capacity(capacity) {
+
+    }
+
+    ~SSLClientSessionCache();
+
+    /// Takes over the caller's reference on session.
+    void addSession(const std::string &key, SSL_SESSION *session);
+
+    /// Reference on the session to resume for key, nullptr if there is none.
+    SSL_SESSION* findSession(const std::string &key);
+
+    void removeSession(const std::string &key);
+
+    size_t getSessionCount() const {
+        std::lock_guard<std::mutex> lock(_lock);
+        return _sessions.size();
+    }
+protected:
+    struct Entry {
+        /// Latest last.
+        std::deque<SSL_SESSION *> sessions;
+        std::list<std::string>::iterator position;
+    };
+
+    static const size_t kMaxTickets = 32;
+
+    static bool isResumable(SSL_SESSION *session);
+
+    static bool isSingleUse(SSL_SESSION *session);
+
+    static void freeSessions(Entry &entry);
+
+    size_t _capacity;
+    mutable std::mutex _lock;
+    std::unordered_map<std::string, Entry> _sessions;
+    std::list<std::string> _recentlyUsed;
+};
+
+NS_END
+
+#endif //NET4CXX_CORE_NETWORK_SSLCACHE_H
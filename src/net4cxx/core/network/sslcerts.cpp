@@ -0,0 +1,112 @@
+//
+// Created by yuwenyong on 17-12-6.
+//
+
+#include "net4cxx/core/network/sslcerts.h"
+#include <boost/algorithm/string.hpp>
+#include <openssl/x509v3.h>
+
+
+NS_BEGIN
+
+void SSLCertificateMap::add(const std::vector<std::string> &serverNames, SSLContextPtr context) {
+    std::lock_guard<std::mutex> lock(_lock);
+    for (auto &serverName: serverNames) {
+        std::string name = normalize(serverName.data(), serverName.size());
+        if (boost::starts_with(name, "*.")) {
+            _wildcards[name.substr(2)] = context;
+        } else {
+            _names[name] = context;
+        }
+    }
+}
+
+bool SSLCertificateMap::remove(const std::string &serverName) {
+    std::string name = normalize(serverName.data(), serverName.size());
+    std::lock_guard<std::mutex> lock(_lock);
+    SSLContextPtr context;
+    if (boost::starts_with(name, "*.")) {
+        auto iter = _wildcards.find(name.substr(2));
+        if (iter != _wildcards.end()) {
+            context = iter->second;
+        }
+    } else {
+        auto iter = _names.find(name);
+        if (iter != _names.end()) {
+            context = iter->second;
+        }
+    }
+    if (!context) {
+        return false;
+    }
+    for (auto *names: {&_names, &_wildcards}) {
+        for (auto iter = names->begin(); iter != names->end();) {
+            if (iter->second == context) {
+                iter = names->erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+    }
+    return true;
+}
+
+SSLCertificateMap::SSLContextPtr SSLCertificateMap::find(const char *serverName) const {
+    std::string name = normalize(serverName, strlen(serverName));
+    std::lock_guard<std::mutex> lock(_lock);
+    auto iter = _names.find(name);
+    if (iter != _names.end()) {
+        return iter->second;
+    }
+    size_t pos = name.find('.');
+    if (pos == 0 || pos == std::string::npos) {
+        return nullptr;
+    }
+    iter = _wildcards.find(name.substr(pos + 1));
+    return iter != _wildcards.end() ? iter->second : nullptr;
+}
+
+std::vector<std::string> SSLCertificateMap::getServerNames(X509 *certificate) {
+    std::vector<std::string> serverNames;
+    auto altNames = static_cast<GENERAL_NAMES *>(X509_get_ext_d2i(certificate, NID_subject_alt_name, nullptr,
+                                                                  nullptr));
+    if (altNames) {
+        for (int i = 0; i != sk_GENERAL_NAME_num(altNames); ++i) {
+            GENERAL_NAME *altName = sk_GENERAL_NAME_value(altNames, i);
+            if (altName->type == GEN_DNS) {
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+                auto data = (const char *)ASN1_STRING_get0_data(altName->d.dNSName);
+#else
+                auto data = (const char *)ASN1_STRING_data(altName->d.dNSName);
+#endif
+                serverNames.emplace_back(data, (size_t)ASN1_STRING_length(altName->d.dNSName));
+            }
+        }
+        GENERAL_NAMES_free(altNames);
+    }
+    if (serverNames.empty()) {
+        X509_NAME *subject = X509_get_subject_name(certificate);
+        int index = X509_NAME_get_index_by_NID(subject, NID_commonName, -1);
+        if (index >= 0) {
+            ASN1_STRING *commonName = X509_NAME_ENTRY_get_data(X509_NAME_get_entry(subject, index));
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+            auto data = (const char *)ASN1_STRING_get0_data(commonName);
+#else
+            auto data = (const char *)ASN1_STRING_data(commonName);
+#endif
+            serverNames.emplace_back(data, (size_t)ASN1_STRING_length(commonName));
+        }
+    }
+    return serverNames;
+}
+
+std::string SSLCertificateMap::normalize(const char *serverName, size_t length) {
+    if (length && serverName[length - 1] == '.') {
+        --length;
+    }
+    std::string name(serverName, length);
+    boost::to_lower(name);
+    return name;
+}
+
+NS_END
@@ -0,0 +1,52 @@
+//
+// Created by yuwenyong on 17-12-6.
+//
+
+#ifndef NET4CXX_CORE_NETWORK_SSLCERTS_H
+#define NET4CXX_CORE_NETWORK_SSLCERTS_H
+
+#include "net4cxx/common/common.h"
+#include <mutex>
+#include <boost/asio/ssl.hpp>
+
+NS_BEGIN
+
+
+/// Server names mapped to the context holding the certificate a server presents for them, safe to use from every
+/// reactor and handshake thread while certificates come and go.
+///
+/// Names are matched case-insensitively. Exact names live in one hash map and wildcards, which cover a single label
+/// as in "*.example.com", in another keyed by the domain below the wildcard, so a lookup costs at most two probes
+/// whatever the number of certificates. An exact name wins over a wildcard covering it.
+class NET4CXX_COMMON_API SSLCertificateMap: public boost::noncopyable {
+public:
+    typedef boost::asio::ssl::context SSLContextType;
+    typedef std::shared_ptr<SSLContextType> SSLContextPtr;
+
+    /// Serves context for each of serverNames, in place of whatever served them before.
+    void add(const std::vector<std::string> &serverNames, SSLContextPtr context);
+
+    /// Drops the certificate serving serverName, a name or wildcard as added, from all the names it serves.
+    bool remove(const std::string &serverName);
+
+    /// Context for the name a client asked for, nullptr if no certificate covers it.
+    SSLContextPtr find(const char *serverName) const;
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(_lock);
+        return _names.size() + _wildcards.size();
+    }
+
+    /// DNS names of the subject alternative name extension, or the common name when there are none.
+    static std::vector<std::string> getServerNames(X509 *certificate);
+protected:
+    static std::string normalize(const char *serverName, size_t length);
+
+    mutable std::mutex _lock;
+    std::unordered_map<std::string, SSLContextPtr> _names;
+    std::unordered_map<std::string, SSLContextPtr> _wildcards;
+};
+
+NS_END
+
+#endif //NET4CXX_CORE_NETWORK_SSLCERTS_H
@@ -4,8 +4,11 @@
 
 #include "net4cxx/core/network/tcp.h"
 #include "net4cxx/common/debugging/assert.h"
+#include "net4cxx/core/network/admission.h"
+#include "net4cxx/core/network/affinity.h"
 #include "net4cxx/core/network/protocol.h"
 #include "net4cxx/core/network/reactor.h"
+#include "net4cxx/core/network/uring.h"
 
 NS_BEGIN
 
@@ -20,9 +23,22 @@ void TCPConnection::write(const Byte *data, size_t length) {
     if (_disconnecting || _disconnected || !_connected) {
         return;
     }
+#ifndef BOOST_ASIO_HAS_IOCP
+    if (!_writing && _writeQueue.empty() && !_reactor->getURing()) {
+        size_t bytesSent = writeSome(data, length);
+        if (_disconnecting || bytesSent == length) {
+            return;
+        }
+        data += bytesSent;
+        length -= bytesSent;
+    }
+#endif
     MessageBuffer packet(length);
     packet.write(data, length);
     _writeQueue.emplace_back(std::move(packet));
+    if (_writeQueue.spilled()) {
+        trimLater(shared_from_this());
+    }
     startWriting();
 }
 
@@ -30,7 +46,7 @@ void TCPConnection::loseConnection() {
     if (_disconnecting || _disconnected || !_connected) {
         return;
     }
-    _error = NET4CXX_EXCEPTION_PTR(ConnectionDone, "");
+    _error = DisconnectReason(DisconnectReason::kConnectionDone);
     _disconnecting = true;
     doClose();
 }
@@ -39,39 +55,88 @@ void TCPConnection::abortConnection() {
     if (_disconnecting || _disconnected || !_connected) {
         return;
     }
-    _error = NET4CXX_EXCEPTION_PTR(ConnectionAbort, "");
+    _error = DisconnectReason(DisconnectReason::kConnectionAbort);
     _disconnecting = true;
     doAbort();
 }
 
+void TCPConnection::pauseReading() {
+    if (_readPaused) {
+        return;
+    }
+    _readPaused = true;
+    if (_connected && !_disconnected) {
+        _pausedProtocol = _protocol.lock();
+    }
+#ifdef NET4CXX_HAS_URING
+    // The multishot recv would keep reading on its own; its cancellation ends in cbURingRead.
+    if (_readOperation) {
+        _reactor->getURing()->cancel(_readOperation);
+    }
+#endif
+}
+
+void TCPConnection::resumeReading() {
+    if (!_readPaused) {
+        return;
+    }
+    _readPaused = false;
+    if (_connected && !_disconnecting && !_disconnected) {
+        startReading();
+    }
+    _pausedProtocol.reset();
+}
+
+bool TCPConnection::waitForTokens() {
+    Duration delay = getRateLimitDelay();
+    if (delay == Duration::zero()) {
+        return false;
+    }
+    _readLimited = true;
+    _rateLimitCall = _reactor->callLater(delay, [this, protocol=_protocol.lock(), self=shared_from_this()]() {
+        _readLimited = false;
+        if (_connected && !_disconnecting && !_disconnected) {
+            startReading();
+        }
+    });
+    return true;
+}
+
 void TCPConnection::doClose() {
     if (!_writing && !_reading) {
-        _reactor->addCallback([this, self=shared_from_this()]() {
+        _reactor->addCallback([this, self=shared_from_this(), protocol=_protocol.lock()]() {
             if (!_disconnected) {
                 closeSocket();
             }
         });
     } else if (!_writing) {
+        cancelOperations();
         _socket.close();
     }
 }
 
 void TCPConnection::doAbort() {
     if (!_writing && !_reading) {
-        _reactor->addCallback([this, self=shared_from_this()]() {
+        _reactor->addCallback([this, self=shared_from_this(), protocol=_protocol.lock()]() {
             if (!_disconnected) {
                 closeSocket();
             }
         });
     } else {
+        cancelOperations();
         _socket.close();
     }
 }
 
 void TCPConnection::closeSocket() {
+    auto pausedProtocol = std::move(_pausedProtocol);
     _connected = false;
     _disconnected = true;
     _disconnecting = false;
+    if (!_rateLimitCall.cancelled()) {
+        _rateLimitCall.cancel();
+    }
+    cancelOperations();
     if (_socket.is_open()) {
         _socket.close();
     }
@@ -81,16 +146,49 @@ void TCPConnection::closeSocket() {
 void TCPConnection::doRead() {
     auto protocol = _protocol.lock();
     BOOST_ASSERT(protocol);
+    _reading = true;
+#ifdef NET4CXX_HAS_URING
+    if (_reactor->getURing()) {
+        // Rate limited connections read one buffer at a time, a multishot recv would drain the socket regardless.
+        _readOperation = _reactor->getURing()->recv(_socket.native_handle(), _readMemory, [
+                protocol, self = shared_from_this()](int result, unsigned flags) {
+            self->cbURingRead(result, flags);
+        }, _rateLimiters.empty());
+        return;
+    }
+#endif
+#ifndef BOOST_ASIO_HAS_IOCP
+    _socket.async_wait(SocketType::wait_read, makeCustomAllocHandler(_readMemory, [protocol, self = shared_from_this()](
+            const boost::system::error_code &ec) {
+        self->cbReadable(ec);
+    }));
+#else
     _readBuffer.normalize();
     _readBuffer.ensureFreeSpace();
-    _reading = true;
     _socket.async_read_some(boost::asio::buffer(_readBuffer.getWritePointer(), _readBuffer.getRemainingSpace()),
-                            [protocol, self = shared_from_this()](const boost::system::error_code &ec,
-                                                                  size_t transferredBytes) {
+                            makeCustomAllocHandler(_readMemory, [protocol, self = shared_from_this()](
+                                    const boost::system::error_code &ec, size_t transferredBytes) {
                                 self->cbRead(ec, transferredBytes);
-                            });
+                            }));
+#endif
+}
+
+#ifndef BOOST_ASIO_HAS_IOCP
+
+void TCPConnection::cbReadable(boost::system::error_code ec) {
+    size_t transferredBytes = 0;
+    if (!ec && !_readPaused) {
+        transferredBytes = _socket.read_some(boost::asio::buffer(_reactor->getReadScratch(),
+                                                                 _reactor->getReadScratchSize()), ec);
+        if (ec == boost::asio::error::would_block || ec == boost::asio::error::try_again) {
+            ec.clear();
+        }
+    }
+    cbRead(ec, transferredBytes);
 }
 
+#endif
+
 void TCPConnection::handleRead(const boost::system::error_code &ec, size_t transferredBytes) {
     if (ec) {
         if (ec != boost::asio::error::operation_aborted && ec != boost::asio::error::eof) {
@@ -98,41 +196,69 @@ void TCPConnection::handleRead(const boost::system::error_code &ec, size_t trans
         }
         if (!_disconnected) {
             if (ec != boost::asio::error::operation_aborted) {
-                _error = std::make_exception_ptr(boost::system::system_error(ec));
+                _error = DisconnectReason(ec);
             }
             closeSocket();
         }
     } else {
+#ifndef BOOST_ASIO_HAS_IOCP
+        if (_disconnecting || transferredBytes == 0) {
+            return;
+        }
+        dataReceived(_reactor->getReadScratch(), transferredBytes);
+#else
         _readBuffer.writeCompleted(transferredBytes);
         if (_disconnecting) {
             return;
         }
         dataReceived(_readBuffer.getReadPointer(), _readBuffer.getActiveSize());
         _readBuffer.readCompleted(_readBuffer.getActiveSize());
+#endif
+    }
+}
+
+#ifndef BOOST_ASIO_HAS_IOCP
+
+size_t TCPConnection::writeSome(const Byte *data, size_t length) {
+    boost::system::error_code ec;
+    size_t bytesSent = _socket.write_some(boost::asio::buffer(data, length), ec);
+    if (ec) {
+        if (ec == boost::asio::error::would_block || ec == boost::asio::error::try_again) {
+            return 0;
+        }
+        NET4CXX_ERROR(gGenLog, "Write error %d :%s", ec.value(), ec.message().c_str());
+        _error = DisconnectReason(ec);
+        _disconnecting = true;
+        doClose();
+    } else if (bytesSent == 0) {
+        _disconnecting = true;
+        doClose();
     }
+    return bytesSent;
 }
 
+#endif
+
 void TCPConnection::doWrite() {
+#ifdef NET4CXX_HAS_URING
+    if (_reactor->getURing()) {
+        auto protocol = _protocol.lock();
+        BOOST_ASSERT(protocol);
+        _writing = true;
+        _writeOperation = _reactor->getURing()->send(_socket.native_handle(), _writeQueue, _writeMemory, [
+                protocol, self = shared_from_this()](int result, unsigned flags) {
+            self->cbURingWrite(result);
+        });
+        return;
+    }
+#endif
 #ifndef BOOST_ASIO_HAS_IOCP
     size_t bytesToSend, bytesSent;
-    boost::system::error_code ec;
     for(;;) {
         MessageBuffer &buffer = _writeQueue.front();
         bytesToSend = buffer.getActiveSize();
-        bytesSent = _socket.write_some(boost::asio::buffer(buffer.getReadPointer(), bytesToSend), ec);
-        if (ec) {
-            if (ec == boost::asio::error::would_block || ec == boost::asio::error::try_again) {
-                break;
-            } else {
-                NET4CXX_ERROR(gGenLog, "Write error %d :%s", ec.value(), ec.message().c_str());
-            }
-            _error = std::make_exception_ptr(boost::system::system_error(ec));
-            _disconnecting = true;
-            doClose();
-            return;
-        } else if (bytesSent == 0){
-            _disconnecting = true;
-            doClose();
+        bytesSent = writeSome(buffer.getReadPointer(), bytesToSend);
+        if (_disconnecting) {
             return;
         } else if (bytesSent < bytesToSend) {
             buffer.readCompleted(bytesSent);
@@ -164,10 +290,10 @@ void TCPConnection::doWrite() {
     BOOST_ASSERT(protocol);
     _writing = true;
     _socket.async_write_some(boost::asio::buffer(buffer.getReadPointer(), buffer.getActiveSize()),
-                             [protocol, self = shared_from_this()](const boost::system::error_code &ec,
-                                                                   size_t transferredBytes) {
+                             makeCustomAllocHandler(_writeMemory, [protocol, self = shared_from_this()](
+                                     const boost::system::error_code &ec, size_t transferredBytes) {
                                  self->cbWrite(ec, transferredBytes);
-                             });
+                             }));
 }
 
 void TCPConnection::handleWrite(const boost::system::error_code &ec, size_t transferredBytes) {
@@ -177,7 +303,7 @@ void TCPConnection::handleWrite(const boost::system::error_code &ec, size_t tran
         }
         if (!_disconnected) {
             if (ec != boost::asio::error::operation_aborted) {
-                _error = std::make_exception_ptr(boost::system::system_error(ec));
+                _error = DisconnectReason(ec);
             }
             closeSocket();
         }
@@ -194,11 +320,87 @@ void TCPConnection::handleWrite(const boost::system::error_code &ec, size_t tran
     }
 }
 
+void TCPConnection::cancelOperations() {
+#ifdef NET4CXX_HAS_URING
+    // Closing the descriptor does not end requests the ring holds a reference to.
+    URing *ring = _reactor->getURing();
+    if (_readOperation) {
+        ring->cancel(_readOperation);
+    }
+    if (_writeOperation) {
+        ring->cancel(_writeOperation);
+    }
+#endif
+}
+
+#ifdef NET4CXX_HAS_URING
+
+void TCPConnection::cbURingRead(int result, unsigned flags) {
+    URing *ring = _reactor->getURing();
+    bool more = URing::hasMore(flags);
+    if (!more) {
+        _readOperation = nullptr;
+        _reading = false;
+    }
+    if (result > 0) {
+        if (!_disconnecting && !_disconnected) {
+            try {
+                dataReceived(ring->getBuffer(flags), (size_t)result);
+            } catch (...) {
+                ring->recycleBuffer(flags);
+                throw;
+            }
+        }
+        ring->recycleBuffer(flags);
+        if (!_disconnecting && !_disconnected) {
+            if (!more) {
+                startReading();
+            } else if (!_readPaused && !_rateLimiters.empty() && getRateLimitDelay() != Duration::zero()) {
+                // The multishot recv has to go for the connection to wait; its end re-arms through startReading.
+                ring->cancel(_readOperation);
+            }
+        }
+        return;
+    }
+    if (result == -ECANCELED && !_disconnecting && !_disconnected) {
+        // Cancelled by pauseReading, which resumeReading may have undone since.
+        startReading();
+        return;
+    }
+    boost::system::error_code ec;
+    if (result == 0) {
+        ec = boost::asio::error::eof;
+    } else if (result != -ENOBUFS) {
+        // -ENOBUFS only means the provided buffers ran dry for a moment, the read is simply re-armed.
+        ec.assign(-result, boost::system::system_category());
+    }
+    handleRead(ec, 0);
+    if (!_disconnecting && !_disconnected) {
+        startReading();
+    }
+}
+
+void TCPConnection::cbURingWrite(int result) {
+    _writeOperation = nullptr;
+    boost::system::error_code ec;
+    if (result < 0) {
+        ec.assign(-result, boost::system::system_category());
+    } else {
+        _writeQueue.consume((size_t)result);
+    }
+    cbWrite(ec, 0);
+}
+
+#endif
+
 
 void TCPServerConnection::cbAccept(const ProtocolPtr &protocol) {
     _protocol = protocol;
     _connected = true;
     _socket.non_blocking(true);
+    if (_reactor->getSocketBusyPoll() > 0) {
+        NetUtil::setBusyPoll(_socket.native_handle(), _reactor->getSocketBusyPoll());
+    }
     protocol->makeConnection(shared_from_this());
     if (!_disconnecting) {
         startReading();
@@ -211,6 +413,9 @@ void TCPClientConnection::cbConnect(const ProtocolPtr &protocol, std::shared_ptr
     _connector = std::move(connector);
     _connected = true;
     _socket.non_blocking(true);
+    if (_reactor->getSocketBusyPoll() > 0) {
+        NetUtil::setBusyPoll(_socket.native_handle(), _reactor->getSocketBusyPoll());
+    }
     protocol->makeConnection(shared_from_this());
     if (!_disconnecting) {
         startReading();
@@ -248,28 +453,58 @@ void TCPListener::startListening() {
         ResolverType::query query(_interface, _port);
         endpoint = *resolver.resolve(query);
     }
+    _protocolType = endpoint.protocol();
     _acceptor.open(endpoint.protocol());
     _acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+    int incomingCpu = _reactor->getIncomingCpu();
+    if (incomingCpu >= 0 && !ReactorPlacement::steerIncoming(_acceptor.native_handle(), incomingCpu)) {
+        NET4CXX_ERROR(gGenLog, "TCPListener failed to steer incoming connections to CPU %d", incomingCpu);
+    }
     _acceptor.bind(endpoint);
     _acceptor.listen();
     NET4CXX_INFO(gGenLog, "TCPListener starting on %s", _port.c_str());
     _factory->doStart();
     _connected = true;
+    if (_acceptPaused) {
+        return;
+    }
+#ifdef NET4CXX_HAS_URING
+    if (_reactor->getURing()) {
+        doURingAccept();
+        return;
+    }
+#endif
     doAccept();
 }
 
 void TCPListener::stopListening() {
     if (_connected) {
         _connected = false;
+#ifdef NET4CXX_HAS_URING
+        if (_acceptOperation) {
+            // Submitted right away, the accept holds the listening socket open until it is cancelled.
+            _reactor->getURing()->cancel(_acceptOperation);
+            _reactor->getURing()->flush();
+        }
+#endif
         _acceptor.close();
         _factory->doStop();
         NET4CXX_INFO(gGenLog, "TCPListener closed on %s", _port.c_str());
     }
 }
 
+void TCPListener::setAdmissionController(std::shared_ptr<AdmissionController> controller) {
+    if (_admission) {
+        NET4CXX_THROW_EXCEPTION(AlreadyExist, "Admission controller already set");
+    }
+    _admission = std::move(controller);
+    _admission->addListener(shared_from_this());
+}
+
 void TCPListener::cbAccept(const boost::system::error_code &ec) {
+    _accepting = false;
     handleAccept(ec);
-    if (!_connected) {
+    if (!_connected || _acceptPaused) {
         return;
     }
     doAccept();
@@ -282,14 +517,156 @@ void TCPListener::handleAccept(const boost::system::error_code &ec) {
         }
     } else {
         Address address{_connection->getRemoteAddress(), _connection->getRemotePort()};
-        auto protocol = _factory->buildProtocol(address);
-        if (protocol) {
-            _connection->cbAccept(protocol);
+        if (_overloaded && !_factory->admitUnderOverload(address)) {
+            rejectConnection(address);
+        } else {
+            auto protocol = _factory->buildProtocol(address);
+            if (protocol) {
+                if (_admission) {
+                    _admission->track(_connection, shared_from_this());
+                }
+                applyRateLimits(address);
+                _connection->cbAccept(protocol);
+            }
         }
     }
     _connection.reset();
 }
 
+void TCPListener::setOverloaded(bool overloaded) {
+    if (_overloaded == overloaded) {
+        return;
+    }
+    _overloaded = overloaded;
+    _factory->overloadStateChanged(overloaded);
+    if (_admission->getOptions().mode == ShedMode::kPauseAccept) {
+        if (overloaded) {
+            pauseAccepting();
+        } else {
+            resumeAccepting();
+        }
+    }
+}
+
+bool TCPListener::allowThrottle(const ProtocolPtr &protocol) {
+    return _factory->allowThrottle(protocol);
+}
+
+void TCPListener::pauseAccepting() {
+    if (_acceptPaused) {
+        return;
+    }
+    _acceptPaused = true;
+    if (!_connected) {
+        return;
+    }
+    // Connections keep queueing in the kernel backlog until accepts resume.
+#ifdef NET4CXX_HAS_URING
+    if (_acceptOperation) {
+        _reactor->getURing()->cancel(_acceptOperation);
+        return;
+    }
+#endif
+    if (_accepting) {
+        boost::system::error_code ec;
+        _acceptor.cancel(ec);
+    }
+}
+
+void TCPListener::resumeAccepting() {
+    if (!_acceptPaused) {
+        return;
+    }
+    _acceptPaused = false;
+    if (!_connected) {
+        return;
+    }
+    // An accept still being cancelled re-arms itself when it completes.
+#ifdef NET4CXX_HAS_URING
+    if (_reactor->getURing()) {
+        if (!_acceptOperation) {
+            doURingAccept();
+        }
+        return;
+    }
+#endif
+    if (!_accepting) {
+        doAccept();
+    }
+}
+
+void TCPListener::applyRateLimits(const Address &address) {
+    if (_connectionRateLimit.isLimited()) {
+        _connection->addRateLimiter(std::make_shared<RateLimiter>(_connectionRateLimit));
+    }
+    if (_listenerRateLimiter) {
+        _connection->addRateLimiter(_listenerRateLimiter);
+    }
+    if (_sourceRateLimit.isLimited()) {
+        auto &limiter = _sourceRateLimiters[address.getAddress()];
+        if (!limiter) {
+            limiter = std::make_shared<RateLimiter>(_sourceRateLimit);
+        }
+        _connection->addRateLimiter(limiter);
+        // Buckets outlive their connections so that reconnecting does not refill them; those of addresses with no
+        // connection left are swept whenever the table has doubled since the last sweep.
+        if (_sourceRateLimiters.size() > std::max(2 * _sourceRateLimitersSwept, (size_t)1024)) {
+            for (auto iter = _sourceRateLimiters.begin(); iter != _sourceRateLimiters.end();) {
+                if (iter->second.use_count() == 1) {
+                    iter = _sourceRateLimiters.erase(iter);
+                } else {
+                    ++iter;
+                }
+            }
+            _sourceRateLimitersSwept = _sourceRateLimiters.size();
+        }
+    }
+}
+
+void TCPListener::rejectConnection(const Address &address) {
+    _admission->recordRejected();
+    std::string response = _factory->getOverloadResponse(address);
+    auto &socket = _connection->getSocket();
+    boost::system::error_code ec;
+    if (!response.empty()) {
+        // Short enough to fit in an empty send buffer; whatever does not is dropped rather than waited for.
+        socket.non_blocking(true, ec);
+        socket.write_some(boost::asio::buffer(response), ec);
+    }
+    socket.close(ec);
+}
+
+#ifdef NET4CXX_HAS_URING
+
+void TCPListener::doURingAccept() {
+    _acceptOperation = _reactor->getURing()->accept(_acceptor.native_handle(), _acceptMemory, [
+            self = shared_from_this()](int result, unsigned flags) {
+        self->cbURingAccept(result, flags);
+    });
+}
+
+void TCPListener::cbURingAccept(int result, unsigned flags) {
+    if (!URing::hasMore(flags)) {
+        _acceptOperation = nullptr;
+    }
+    boost::system::error_code ec;
+    if (result >= 0) {
+        _connection = std::make_shared<TCPServerConnection>(_reactor);
+        _connection->getSocket().assign(_protocolType, result, ec);
+        if (ec) {
+            ::close(result);
+        }
+    } else {
+        ec.assign(-result, boost::system::system_category());
+    }
+    handleAccept(ec);
+    if (_connected && !_acceptPaused && !_acceptOperation) {
+        doURingAccept();
+    }
+}
+
+#endif
+
 
 TCPConnector::TCPConnector(std::string host, std::string port, std::unique_ptr<ClientFactory> &&factory, double timeout,
                            Address bindAddress, Reactor *reactor)
@@ -319,7 +696,8 @@ void TCPConnector::startConnecting() {
     } else {
         doResolve();
     }
-    if (_timeout != 0.0) {
+    // A connect submitted to the ring carries its own linked timeout.
+    if (_timeout != 0.0 && !_connectOperation) {
         _timeoutId = _reactor->callLater(_timeout, [this, self=shared_from_this()]() {
             cbTimeout();
         });
@@ -333,6 +711,11 @@ void TCPConnector::stopConnecting() {
     }
     _error = NET4CXX_EXCEPTION_PTR(UserAbort, "");
     if (_connection) {
+#ifdef NET4CXX_HAS_URING
+        if (_connectOperation) {
+            _reactor->getURing()->cancel(_connectOperation);
+        }
+#endif
         _connection->getSocket().close();
         _connection.reset();
     } else {
@@ -355,12 +738,9 @@ void TCPConnector::connectionFailed(std::exception_ptr reason) {
     }
 }
 
-void TCPConnector::connectionLost(std::exception_ptr reason) {
-    if (reason) {
-        _error = std::move(reason);
-    }
+void TCPConnector::connectionLost(const DisconnectReason &reason) {
     _state = kDisconnected;
-    _factory->clientConnectionLost(shared_from_this(), _error);
+    _factory->clientConnectionLost(shared_from_this(), reason);
     if (_state == kDisconnected) {
         _factory->doStop();
         _factoryStarted = false;
@@ -394,18 +774,35 @@ void TCPConnector::handleResolve(const boost::system::error_code &ec, ResolverIt
 void TCPConnector::doConnect() {
     makeTransport();
     EndpointType endpoint{AddressType::from_string(_host), (unsigned short)std::stoul(_port)};
-    _connection->getSocket().async_connect(endpoint, [this, self=shared_from_this(), connection=_connection](
-            const boost::system::error_code &ec) {
+#ifdef NET4CXX_HAS_URING
+    if (_reactor->getURing()) {
+        SocketType &socket = _connection->getSocket();
+        if (!socket.is_open()) {
+            socket.open(endpoint.protocol());
+        }
+        _connectEndpoint = endpoint;
+        _connectOperation = _reactor->getURing()->connect(
+                socket.native_handle(), _connectEndpoint.data(), (socklen_t)_connectEndpoint.size(), _timeout,
+                _connectMemory, [this, self=shared_from_this(), connection=_connection](int result, unsigned flags) {
+                    cbURingConnect(result);
+                });
+        return;
+    }
+#endif
+    _connection->getSocket().async_connect(endpoint, makeCustomAllocHandler(
+            _connectMemory, [this, self=shared_from_this(), connection=_connection](
+                    const boost::system::error_code &ec) {
         cbConnect(ec);
-    });
+    }));
 }
 
 void TCPConnector::doConnect(ResolverIterator iterator) {
     makeTransport();
-    boost::asio::async_connect(_connection->getSocket(), std::move(iterator), [this, self=shared_from_this(),
-            connection=_connection](const boost::system::error_code &ec, ResolverIterator iterator) {
+    boost::asio::async_connect(_connection->getSocket(), std::move(iterator), makeCustomAllocHandler(
+            _connectMemory, [this, self=shared_from_this(), connection=_connection](
+                    const boost::system::error_code &ec, ResolverIterator iterator) {
         cbConnect(ec);
-    });
+    }));
 }
 
 void TCPConnector::handleConnect(const boost::system::error_code &ec) {
@@ -428,6 +825,24 @@ void TCPConnector::handleConnect(const boost::system::error_code &ec) {
     }
 }
 
+#ifdef NET4CXX_HAS_URING
+
+void TCPConnector::cbURingConnect(int result) {
+    _connectOperation = nullptr;
+    if (result == -ECANCELED && _state == kConnecting) {
+        // Nobody stopped us, so it was the linked timeout that cancelled the connect.
+        handleTimeout();
+        return;
+    }
+    boost::system::error_code ec;
+    if (result < 0) {
+        ec.assign(-result, boost::system::system_category());
+    }
+    cbConnect(ec);
+}
+
+#endif
+
 void TCPConnector::handleTimeout() {
     NET4CXX_ERROR(gGenLog, "Connect error : Timeout");
     _error = NET4CXX_EXCEPTION_PTR(TimeoutError, "");
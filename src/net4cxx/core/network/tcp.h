@@ -13,6 +13,7 @@
 
 NS_BEGIN
 
+class AdmissionController;
 class Factory;
 class ClientFactory;
 class TCPConnector;
@@ -33,6 +34,14 @@ public:
 
     void abortConnection() override;
 
+    void pauseReading() override;
+
+    void resumeReading() override;
+
+    bool canPauseReading() const override {
+        return true;
+    }
+
     bool getNoDelay() const override {
         boost::asio::ip::tcp::no_delay option;
         _socket.get_option(option);
@@ -82,18 +91,25 @@ protected:
     virtual void closeSocket();
 
     void startReading() {
-        if (!_reading) {
+        if (!_reading && !_readPaused && !_readLimited && (_rateLimiters.empty() || !waitForTokens())) {
             doRead();
         }
     }
 
+    /// Schedules the read for when the rate limiters have refilled if any of them is dry.
+    bool waitForTokens();
+
     void doRead();
 
+#ifndef BOOST_ASIO_HAS_IOCP
+    void cbReadable(boost::system::error_code ec);
+#endif
+
     void cbRead(const boost::system::error_code &ec, size_t transferredBytes) {
         _reading = false;
         handleRead(ec, transferredBytes);
         if (!_disconnecting && !_disconnected) {
-            doRead();
+            startReading();
         }
     }
 
@@ -105,6 +121,10 @@ protected:
         }
     }
 
+#ifndef BOOST_ASIO_HAS_IOCP
+    size_t writeSome(const Byte *data, size_t length);
+#endif
+
     void doWrite();
 
     void cbWrite(const boost::system::error_code &ec, size_t transferredBytes) {
@@ -117,8 +137,24 @@ protected:
 
     void handleWrite(const boost::system::error_code &ec, size_t transferredBytes);
 
+    void cancelOperations();
+
+#ifdef NET4CXX_HAS_URING
+    void cbURingRead(int result, unsigned flags);
+
+    void cbURingWrite(int result);
+#endif
+
     SocketType _socket;
-    std::exception_ptr _error;
+    DisconnectReason _error;
+    HandlerMemory<160> _readMemory;
+    HandlerMemory<256> _writeMemory;
+    URingOperation *_readOperation{nullptr};
+    URingOperation *_writeOperation{nullptr};
+    // Stands in for the pending read while reading is paused, which would otherwise keep the protocol alive.
+    ProtocolPtr _pausedProtocol;
+    bool _readLimited{false};
+    DelayedCall _rateLimitCall;
 };
 
 
@@ -166,6 +202,8 @@ protected:
 
 class NET4CXX_COMMON_API TCPListener: public Listener, public std::enable_shared_from_this<TCPListener> {
 public:
+    friend class AdmissionController;
+
     using AddressType = boost::asio::ip::address;
     using AcceptorType = boost::asio::ip::tcp::acceptor;
     using SocketType = boost::asio::ip::tcp::socket;
@@ -185,6 +223,29 @@ public:
 
     void stopListening() override;
 
+    /// Puts the listener and the connections it accepts from now on under controller.
+    void setAdmissionController(std::shared_ptr<AdmissionController> controller);
+
+    const std::shared_ptr<AdmissionController>& getAdmissionController() const {
+        return _admission;
+    }
+
+    /// Each connection accepted from now on gets a limiter of its own.
+    void setConnectionRateLimit(const RateLimit &limit) {
+        _connectionRateLimit = limit;
+    }
+
+    /// Connections accepted from now on share one limiter for the whole listener.
+    void setListenerRateLimit(const RateLimit &limit) {
+        _listenerRateLimiter = limit.isLimited() ? std::make_shared<RateLimiter>(limit) : nullptr;
+    }
+
+    /// Connections accepted from now on share a limiter with the others from the same address.
+    void setSourceRateLimit(const RateLimit &limit) {
+        _sourceRateLimit = limit;
+        _sourceRateLimiters.clear();
+    }
+
     std::string getLocalAddress() const {
         auto endpoint = _acceptor.local_endpoint();
         return endpoint.address().to_string();
@@ -200,17 +261,51 @@ protected:
     void handleAccept(const boost::system::error_code &ec);
 
     void doAccept() {
+        _accepting = true;
         _connection = std::make_shared<TCPServerConnection>(_reactor);
-        _acceptor.async_accept(_connection->getSocket(), std::bind(&TCPListener::cbAccept, shared_from_this(),
-                                                                   std::placeholders::_1));
+        _acceptor.async_accept(_connection->getSocket(),
+                               makeCustomAllocHandler(_acceptMemory, std::bind(&TCPListener::cbAccept,
+                                                                               shared_from_this(),
+                                                                               std::placeholders::_1)));
     }
 
+#ifdef NET4CXX_HAS_URING
+    void doURingAccept();
+
+    void cbURingAccept(int result, unsigned flags);
+#endif
+
+    void setOverloaded(bool overloaded);
+
+    bool allowThrottle(const ProtocolPtr &protocol);
+
+    void pauseAccepting();
+
+    void resumeAccepting();
+
+    /// Writes the factory's overload response to the accepted connection and closes it.
+    void rejectConnection(const Address &address);
+
+    void applyRateLimits(const Address &address);
+
     std::string _port;
     std::unique_ptr<Factory> _factory;
     std::string _interface;
     AcceptorType _acceptor;
+    EndpointType::protocol_type _protocolType{EndpointType::protocol_type::v4()};
     bool _connected{false};
+    bool _accepting{false};
+    bool _acceptPaused{false};
+    bool _overloaded{false};
     std::shared_ptr<TCPServerConnection> _connection;
+    HandlerMemory<> _acceptMemory;
+    URingOperation *_acceptOperation{nullptr};
+    std::shared_ptr<AdmissionController> _admission;
+    RateLimit _connectionRateLimit;
+    RateLimiterPtr _listenerRateLimiter;
+    RateLimit _sourceRateLimit;
+    std::unordered_map<std::string, RateLimiterPtr> _sourceRateLimiters;
+    size_t _sourceRateLimitersSwept{0};
 };
 
 
@@ -237,7 +332,7 @@ public:
 
     void connectionFailed(std::exception_ptr reason={});
 
-    void connectionLost(std::exception_ptr reason={});
+    void connectionLost(const DisconnectReason &reason={});
 protected:
     ProtocolPtr buildProtocol(const Address &address);
 
@@ -268,6 +363,10 @@ protected:
 
     void handleConnect(const boost::system::error_code &ec);
 
+#ifdef NET4CXX_HAS_URING
+    void cbURingConnect(int result);
+#endif
+
     void cbTimeout() {
         handleTimeout();
     }
@@ -293,6 +392,9 @@ protected:
     DelayedCall _timeoutId;
     bool _factoryStarted{false};
     std::exception_ptr _error;
+    HandlerMemory<> _connectMemory;
+    EndpointType _connectEndpoint;
+    URingOperation *_connectOperation{nullptr};
 };
 
 
@@ -0,0 +1,148 @@
+//
+// Created by yuwenyong on 17-11-26.
+//
+
+#include "net4cxx/core/network/threadpool.h"
+#include "net4cxx/common/global/loggers.h"
+
+NS_BEGIN
+
+ThreadPool::ThreadPool(size_t size, size_t maxQueued)
+        : _maxQueued(maxQueued) {
+    if (size == 0) {
+        NET4CXX_THROW_EXCEPTION(ValueError, "Thread pool needs at least one worker");
+    }
+    for (size_t i = 0; i != size; ++i) {
+        _workers.emplace_back(std::make_unique<Worker>());
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    stop();
+}
+
+void ThreadPool::start() {
+    if (_started) {
+        return;
+    }
+    _started = true;
+    _stopping = false;
+    for (size_t i = 0; i != _workers.size(); ++i) {
+        _workers[i]->thread = std::thread(&ThreadPool::runWorker, this, i);
+    }
+}
+
+void ThreadPool::stop() {
+    if (!_started) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_idleLock);
+        _stopping = true;
+    }
+    _idleCond.notify_all();
+    for (auto &worker: _workers) {
+        worker->thread.join();
+    }
+    for (auto &worker: _workers) {
+        _queued -= worker->tasks.size();
+        worker->tasks.clear();
+    }
+    _started = false;
+}
+
+bool ThreadPool::submit(std::unique_ptr<ThreadCallback> &&task) {
+    if (_queued.fetch_add(1) >= _maxQueued) {
+        --_queued;
+        ++_rejected;
+        return false;
+    }
+    ++_submitted;
+    Worker &worker = *_workers[_next.fetch_add(1, std::memory_order_relaxed) % _workers.size()];
+    {
+        std::lock_guard<std::mutex> lock(worker.lock);
+        worker.tasks.push_back({std::move(task), TimestampClock::now()});
+    }
+    {
+        std::lock_guard<std::mutex> lock(_idleLock);
+    }
+    _idleCond.notify_one();
+    return true;
+}
+
+ThreadPool::Stats ThreadPool::getStats() const {
+    Stats stats;
+    stats.size = _workers.size();
+    stats.queued = _queued;
+    stats.submitted = _submitted;
+    stats.rejected = _rejected;
+    stats.completed = _completed;
+    stats.totalQueueWait = Duration(_totalQueueWait.load());
+    stats.maxQueueWait = Duration(_maxQueueWait.load());
+    stats.totalRunTime = Duration(_totalRunTime.load());
+    stats.maxRunTime = Duration(_maxRunTime.load());
+    return stats;
+}
+
+bool ThreadPool::popTask(size_t index, Task &task) {
+    {
+        Worker &worker = *_workers[index];
+        std::lock_guard<std::mutex> lock(worker.lock);
+        if (!worker.tasks.empty()) {
+            task = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+            --_queued;
+            return true;
+        }
+    }
+    for (size_t i = 1; i != _workers.size(); ++i) {
+        Worker &victim = *_workers[(index + i) % _workers.size()];
+        std::lock_guard<std::mutex> lock(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            --_queued;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::runTask(Task &task) {
+    Timestamp started = TimestampClock::now();
+    recordTime(_totalQueueWait, _maxQueueWait, started - task.enqueued);
+    try {
+        task.callback->run();
+    } catch (std::exception &e) {
+        NET4CXX_ERROR(gAppLog, "Unexpected Exception:%s", e.what());
+    } catch (...) {
+        NET4CXX_ERROR(gAppLog, "Unknown Exception");
+    }
+    task.callback.reset();
+    recordTime(_totalRunTime, _maxRunTime, TimestampClock::now() - started);
+    ++_completed;
+}
+
+void ThreadPool::runWorker(size_t index) {
+    Task task;
+    while (!_stopping) {
+        if (popTask(index, task)) {
+            runTask(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(_idleLock);
+        _idleCond.wait(lock, [this]() {
+            return _stopping || _queued != 0;
+        });
+    }
+}
+
+void ThreadPool::recordTime(std::atomic<int64_t> &total, std::atomic<int64_t> &max, Duration elapsed) {
+    int64_t count = elapsed.count();
+    total.fetch_add(count, std::memory_order_relaxed);
+    int64_t current = max.load(std::memory_order_relaxed);
+    while (count > current && !max.compare_exchange_weak(current, count, std::memory_order_relaxed)) {
+    }
+}
+
+NS_END
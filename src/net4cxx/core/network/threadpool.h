@@ -0,0 +1,193 @@
+//
+// Created by yuwenyong on 17-11-26.
+//
+
+#ifndef NET4CXX_CORE_NETWORK_THREADPOOL_H
+#define NET4CXX_CORE_NETWORK_THREADPOOL_H
+
+#include "net4cxx/common/common.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <boost/optional.hpp>
+#include "net4cxx/common/utilities/errors.h"
+
+NS_BEGIN
+
+
+NET4CXX_DECLARE_EXCEPTION(ThreadPoolFull, Exception);
+
+
+/// Type-erased callable used both for callFromThread and for pool tasks; the callable lives in the same allocation
+/// as the link.
+class NET4CXX_COMMON_API ThreadCallback {
+public:
+    virtual ~ThreadCallback() = default;
+
+    virtual void run() = 0;
+
+    ThreadCallback *_next{nullptr};
+};
+
+
+template <typename CallbackT>
+class ThreadCallbackImpl: public ThreadCallback {
+public:
+    template <typename ArgT>
+    explicit ThreadCallbackImpl(ArgT &&callback)
+            : _callback(std::forward<ArgT>(callback)) {
+
+    }
+
+    void run() override {
+        _callback();
+    }
+protected:
+    CallbackT _callback;
+};
+
+
+/// Outcome of a function run by deferToThread: either its return value or the exception it threw.
+template <typename ResultT>
+class ThreadResult {
+public:
+    template <typename FuncT>
+    void run(FuncT &func) {
+        try {
+            _value.emplace(func());
+        } catch (...) {
+            _error = std::current_exception();
+        }
+    }
+
+    bool failed() const {
+        return (bool)_error;
+    }
+
+    std::exception_ptr getError() const {
+        return _error;
+    }
+
+    ResultT& get() {
+        if (_error) {
+            std::rethrow_exception(_error);
+        }
+        return *_value;
+    }
+protected:
+    boost::optional<ResultT> _value;
+    std::exception_ptr _error;
+};
+
+
+template <>
+class ThreadResult<void> {
+public:
+    template <typename FuncT>
+    void run(FuncT &func) {
+        try {
+            func();
+        } catch (...) {
+            _error = std::current_exception();
+        }
+    }
+
+    bool failed() const {
+        return (bool)_error;
+    }
+
+    std::exception_ptr getError() const {
+        return _error;
+    }
+
+    void get() {
+        if (_error) {
+            std::rethrow_exception(_error);
+        }
+    }
+protected:
+    std::exception_ptr _error;
+};
+
+
+/// Work-stealing pool behind Reactor::deferToThread.
+///
+/// Each worker owns a deque; submissions are spread round-robin and a worker with nothing left takes from the back
+/// of its siblings' deques before going to sleep. The number of queued tasks is bounded, submit refuses work past
+/// the bound instead of letting the backlog grow without limit.
+class NET4CXX_COMMON_API ThreadPool: public boost::noncopyable {
+public:
+    struct Stats {
+        size_t size{0};
+        size_t queued{0};
+        size_t submitted{0};
+        size_t rejected{0};
+        size_t completed{0};
+        Duration totalQueueWait{0};
+        Duration maxQueueWait{0};
+        Duration totalRunTime{0};
+        Duration maxRunTime{0};
+    };
+
+    ThreadPool(size_t size, size_t maxQueued);
+
+    ~ThreadPool();
+
+    void start();
+
+    /// Waits for running tasks and drops the ones still queued.
+    void stop();
+
+    bool submit(std::unique_ptr<ThreadCallback> &&task);
+
+    size_t getSize() const {
+        return _workers.size();
+    }
+
+    size_t getMaxQueued() const {
+        return _maxQueued;
+    }
+
+    Stats getStats() const;
+protected:
+    struct Task {
+        std::unique_ptr<ThreadCallback> callback;
+        Timestamp enqueued;
+    };
+
+    struct Worker {
+        std::mutex lock;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    bool popTask(size_t index, Task &task);
+
+    void runTask(Task &task);
+
+    void runWorker(size_t index);
+
+    static void recordTime(std::atomic<int64_t> &total, std::atomic<int64_t> &max, Duration elapsed);
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    size_t _maxQueued;
+    bool _started{false};
+    std::atomic<bool> _stopping{false};
+    std::atomic<size_t> _queued{0};
+    std::atomic<size_t> _next{0};
+    std::mutex _idleLock;
+    std::condition_variable _idleCond;
+    std::atomic<size_t> _submitted{0};
+    std::atomic<size_t> _rejected{0};
+    std::atomic<size_t> _completed{0};
+    std::atomic<int64_t> _totalQueueWait{0};
+    std::atomic<int64_t> _maxQueueWait{0};
+    std::atomic<int64_t> _totalRunTime{0};
+    std::atomic<int64_t> _maxRunTime{0};
+};
+
+NS_END
+
+#endif //NET4CXX_CORE_NETWORK_THREADPOOL_H
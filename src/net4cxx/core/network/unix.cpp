@@ -6,6 +6,7 @@
 #include "net4cxx/common/debugging/assert.h"
 #include "net4cxx/core/network/protocol.h"
 #include "net4cxx/core/network/reactor.h"
+#include "net4cxx/core/network/uring.h"
 
 #ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
 
@@ -21,9 +22,20 @@ void UNIXConnection::write(const Byte *data, size_t length) {
     if (_disconnecting || _disconnected || !_connected) {
         return;
     }
+    if (!_writing && _writeQueue.empty() && !_reactor->getURing()) {
+        size_t bytesSent = writeSome(data, length);
+        if (_disconnecting || bytesSent == length) {
+            return;
+        }
+        data += bytesSent;
+        length -= bytesSent;
+    }
     MessageBuffer packet(length);
     packet.write(data, length);
     _writeQueue.emplace_back(std::move(packet));
+    if (_writeQueue.spilled()) {
+        trimLater(shared_from_this());
+    }
     startWriting();
 }
 
@@ -31,7 +43,7 @@ void UNIXConnection::loseConnection() {
     if (_disconnecting || _disconnected || !_connected) {
         return;
     }
-    _error = NET4CXX_EXCEPTION_PTR(ConnectionDone, "");
+    _error = DisconnectReason(DisconnectReason::kConnectionDone);
     _disconnecting = true;
     doClose();
 }
@@ -40,39 +52,88 @@ void UNIXConnection::abortConnection() {
     if (_disconnecting || _disconnected || !_connected) {
         return;
     }
-    _error = NET4CXX_EXCEPTION_PTR(ConnectionAbort, "");
+    _error = DisconnectReason(DisconnectReason::kConnectionAbort);
     _disconnecting = true;
     doAbort();
 }
 
+void UNIXConnection::pauseReading() {
+    if (_readPaused) {
+        return;
+    }
+    _readPaused = true;
+    if (_connected && !_disconnected) {
+        _pausedProtocol = _protocol.lock();
+    }
+#ifdef NET4CXX_HAS_URING
+    // The multishot recv would keep reading on its own; its cancellation ends in cbURingRead.
+    if (_readOperation) {
+        _reactor->getURing()->cancel(_readOperation);
+    }
+#endif
+}
+
+void UNIXConnection::resumeReading() {
+    if (!_readPaused) {
+        return;
+    }
+    _readPaused = false;
+    if (_connected && !_disconnecting && !_disconnected) {
+        startReading();
+    }
+    _pausedProtocol.reset();
+}
+
+bool UNIXConnection::waitForTokens() {
+    Duration delay = getRateLimitDelay();
+    if (delay == Duration::zero()) {
+        return false;
+    }
+    _readLimited = true;
+    _rateLimitCall = _reactor->callLater(delay, [this, protocol=_protocol.lock(), self=shared_from_this()]() {
+        _readLimited = false;
+        if (_connected && !_disconnecting && !_disconnected) {
+            startReading();
+        }
+    });
+    return true;
+}
+
 void UNIXConnection::doClose() {
     if (!_writing && !_reading) {
-        _reactor->addCallback([this, self=shared_from_this()]() {
+        _reactor->addCallback([this, self=shared_from_this(), protocol=_protocol.lock()]() {
             if (!_disconnected) {
                 closeSocket();
             }
         });
     } else if (!_writing) {
+        cancelOperations();
         _socket.close();
     }
 }
 
 void UNIXConnection::doAbort() {
     if (!_writing && !_reading) {
-        _reactor->addCallback([this, self=shared_from_this()]() {
+        _reactor->addCallback([this, self=shared_from_this(), protocol=_protocol.lock()]() {
             if (!_disconnected) {
                 closeSocket();
             }
         });
     } else {
+        cancelOperations();
         _socket.close();
     }
 }
 
 void UNIXConnection::closeSocket() {
+    auto pausedProtocol = std::move(_pausedProtocol);
     _connected = false;
     _disconnected = true;
     _disconnecting = false;
+    if (!_rateLimitCall.cancelled()) {
+        _rateLimitCall.cancel();
+    }
+    cancelOperations();
     if (_socket.is_open()) {
         _socket.close();
     }
@@ -82,14 +143,33 @@ void UNIXConnection::closeSocket() {
 void UNIXConnection::doRead() {
     auto protocol = _protocol.lock();
     BOOST_ASSERT(protocol);
-    _readBuffer.normalize();
-    _readBuffer.ensureFreeSpace();
     _reading = true;
-    _socket.async_read_some(boost::asio::buffer(_readBuffer.getWritePointer(), _readBuffer.getRemainingSpace()),
-                            [protocol, self = shared_from_this()](const boost::system::error_code &ec,
-                                                                  size_t transferredBytes) {
-                                self->cbRead(ec, transferredBytes);
-                            });
+#ifdef NET4CXX_HAS_URING
+    if (_reactor->getURing()) {
+        // Rate limited connections read one buffer at a time, a multishot recv would drain the socket regardless.
+        _readOperation = _reactor->getURing()->recv(_socket.native_handle(), _readMemory, [
+                protocol, self = shared_from_this()](int result, unsigned flags) {
+            self->cbURingRead(result, flags);
+        }, _rateLimiters.empty());
+        return;
+    }
+#endif
+    _socket.async_wait(SocketType::wait_read, makeCustomAllocHandler(_readMemory, [protocol, self = shared_from_this()](
+            const boost::system::error_code &ec) {
+        self->cbReadable(ec);
+    }));
+}
+
+void UNIXConnection::cbReadable(boost::system::error_code ec) {
+    size_t transferredBytes = 0;
+    if (!ec && !_readPaused) {
+        transferredBytes = _socket.read_some(boost::asio::buffer(_reactor->getReadScratch(),
+                                                                 _reactor->getReadScratchSize()), ec);
+        if (ec == boost::asio::error::would_block || ec == boost::asio::error::try_again) {
+            ec.clear();
+        }
+    }
+    cbRead(ec, transferredBytes);
 }
 
 void UNIXConnection::handleRead(const boost::system::error_code &ec, size_t transferredBytes) {
@@ -99,40 +179,55 @@ void UNIXConnection::handleRead(const boost::system::error_code &ec, size_t tran
         }
         if (!_disconnected) {
             if (ec != boost::asio::error::operation_aborted) {
-                _error = std::make_exception_ptr(boost::system::system_error(ec));
+                _error = DisconnectReason(ec);
             }
             closeSocket();
         }
     } else {
-        _readBuffer.writeCompleted(transferredBytes);
-        if (_disconnecting) {
+        if (_disconnecting || transferredBytes == 0) {
             return;
         }
-        dataReceived(_readBuffer.getReadPointer(), _readBuffer.getActiveSize());
-        _readBuffer.readCompleted(_readBuffer.getActiveSize());
+        dataReceived(_reactor->getReadScratch(), transferredBytes);
+    }
+}
+
+size_t UNIXConnection::writeSome(const Byte *data, size_t length) {
+    boost::system::error_code ec;
+    size_t bytesSent = _socket.write_some(boost::asio::buffer(data, length), ec);
+    if (ec) {
+        if (ec == boost::asio::error::would_block || ec == boost::asio::error::try_again) {
+            return 0;
+        }
+        NET4CXX_ERROR(gGenLog, "Write error %d :%s", ec.value(), ec.message().c_str());
+        _error = DisconnectReason(ec);
+        _disconnecting = true;
+        doClose();
+    } else if (bytesSent == 0) {
+        _disconnecting = true;
+        doClose();
     }
+    return bytesSent;
 }
 
 void UNIXConnection::doWrite() {
+#ifdef NET4CXX_HAS_URING
+    if (_reactor->getURing()) {
+        auto protocol = _protocol.lock();
+        BOOST_ASSERT(protocol);
+        _writing = true;
+        _writeOperation = _reactor->getURing()->send(_socket.native_handle(), _writeQueue, _writeMemory, [
+                protocol, self = shared_from_this()](int result, unsigned flags) {
+            self->cbURingWrite(result);
+        });
+        return;
+    }
+#endif
     size_t bytesToSend, bytesSent;
-    boost::system::error_code ec;
     for(;;) {
         MessageBuffer &buffer = _writeQueue.front();
         bytesToSend = buffer.getActiveSize();
-        bytesSent = _socket.write_some(boost::asio::buffer(buffer.getReadPointer(), bytesToSend), ec);
-        if (ec) {
-            if (ec == boost::asio::error::would_block || ec == boost::asio::error::try_again) {
-                break;
-            } else {
-                NET4CXX_ERROR(gGenLog, "Write error %d :%s", ec.value(), ec.message().c_str());
-            }
-            _error = std::make_exception_ptr(boost::system::system_error(ec));
-            _disconnecting = true;
-            doClose();
-            return;
-        } else if (bytesSent == 0){
-            _disconnecting = true;
-            doClose();
+        bytesSent = writeSome(buffer.getReadPointer(), bytesToSend);
+        if (_disconnecting) {
             return;
         } else if (bytesSent < bytesToSend) {
             buffer.readCompleted(bytesSent);
@@ -148,10 +243,10 @@ void UNIXConnection::doWrite() {
     BOOST_ASSERT(protocol);
     _writing = true;
     _socket.async_write_some(boost::asio::buffer(buffer.getReadPointer(), buffer.getActiveSize()),
-                             [protocol, self = shared_from_this()](const boost::system::error_code &ec,
-                                                                   size_t transferredBytes) {
+                             makeCustomAllocHandler(_writeMemory, [protocol, self = shared_from_this()](
+                                     const boost::system::error_code &ec, size_t transferredBytes) {
                                  self->cbWrite(ec, transferredBytes);
-                             });
+                             }));
 }
 
 void UNIXConnection::handleWrite(const boost::system::error_code &ec, size_t transferredBytes) {
@@ -161,7 +256,7 @@ void UNIXConnection::handleWrite(const boost::system::error_code &ec, size_t tra
         }
         if (!_disconnected) {
             if (ec != boost::asio::error::operation_aborted) {
-                _error = std::make_exception_ptr(boost::system::system_error(ec));
+                _error = DisconnectReason(ec);
             }
             closeSocket();
         }
@@ -178,6 +273,79 @@ void UNIXConnection::handleWrite(const boost::system::error_code &ec, size_t tra
     }
 }
 
+void UNIXConnection::cancelOperations() {
+#ifdef NET4CXX_HAS_URING
+    // Closing the descriptor does not end requests the ring holds a reference to.
+    URing *ring = _reactor->getURing();
+    if (_readOperation) {
+        ring->cancel(_readOperation);
+    }
+    if (_writeOperation) {
+        ring->cancel(_writeOperation);
+    }
+#endif
+}
+
+#ifdef NET4CXX_HAS_URING
+
+void UNIXConnection::cbURingRead(int result, unsigned flags) {
+    URing *ring = _reactor->getURing();
+    bool more = URing::hasMore(flags);
+    if (!more) {
+        _readOperation = nullptr;
+        _reading = false;
+    }
+    if (result > 0) {
+        if (!_disconnecting && !_disconnected) {
+            try {
+                dataReceived(ring->getBuffer(flags), (size_t)result);
+            } catch (...) {
+                ring->recycleBuffer(flags);
+                throw;
+            }
+        }
+        ring->recycleBuffer(flags);
+        if (!_disconnecting && !_disconnected) {
+            if (!more) {
+                startReading();
+            } else if (!_readPaused && !_rateLimiters.empty() && getRateLimitDelay() != Duration::zero()) {
+                // The multishot recv has to go for the connection to wait; its end re-arms through startReading.
+                ring->cancel(_readOperation);
+            }
+        }
+        return;
+    }
+    if (result == -ECANCELED && !_disconnecting && !_disconnected) {
+        // Cancelled by pauseReading, which resumeReading may have undone since.
+        startReading();
+        return;
+    }
+    boost::system::error_code ec;
+    if (result == 0) {
+        ec = boost::asio::error::eof;
+    } else if (result != -ENOBUFS) {
+        // -ENOBUFS only means the provided buffers ran dry for a moment, the read is simply re-armed.
+        ec.assign(-result, boost::system::system_category());
+    }
+    handleRead(ec, 0);
+    if (!_disconnecting && !_disconnected) {
+        startReading();
+    }
+}
+
+void UNIXConnection::cbURingWrite(int result) {
+    _writeOperation = nullptr;
+    boost::system::error_code ec;
+    if (result < 0) {
+        ec.assign(-result, boost::system::system_category());
+    } else {
+        _writeQueue.consume((size_t)result);
+    }
+    cbWrite(ec, 0);
+}
+
+#endif
+
 
 void UNIXServerConnection::cbAccept(const ProtocolPtr &protocol) {
     _protocol = protocol;
@@ -227,12 +395,25 @@ void UNIXListener::startListening() {
     NET4CXX_INFO(gGenLog, "UNIXListener starting on %s", _path.c_str());
     _factory->doStart();
     _connected = true;
+#ifdef NET4CXX_HAS_URING
+    if (_reactor->getURing()) {
+        doURingAccept();
+        return;
+    }
+#endif
     doAccept();
 }
 
 void UNIXListener::stopListening() {
     if (_connected) {
         _connected = false;
+#ifdef NET4CXX_HAS_URING
+        if (_acceptOperation) {
+            // Submitted right away, the accept holds the listening socket open until it is cancelled.
+            _reactor->getURing()->cancel(_acceptOperation);
+            _reactor->getURing()->flush();
+        }
+#endif
         _acceptor.close();
         _factory->doStop();
         NET4CXX_INFO(gGenLog, "UNIXListener closed on %s", _path.c_str());
@@ -262,6 +443,37 @@ void UNIXListener::handleAccept(const boost::system::error_code &ec) {
     _connection.reset();
 }
 
+#ifdef NET4CXX_HAS_URING
+
+void UNIXListener::doURingAccept() {
+    _acceptOperation = _reactor->getURing()->accept(_acceptor.native_handle(), _acceptMemory, [
+            self = shared_from_this()](int result, unsigned flags) {
+        self->cbURingAccept(result, flags);
+    });
+}
+
+void UNIXListener::cbURingAccept(int result, unsigned flags) {
+    if (!URing::hasMore(flags)) {
+        _acceptOperation = nullptr;
+    }
+    boost::system::error_code ec;
+    if (result >= 0) {
+        _connection = std::make_shared<UNIXServerConnection>(_reactor);
+        _connection->getSocket().assign(EndpointType::protocol_type(), result, ec);
+        if (ec) {
+            ::close(result);
+        }
+    } else {
+        ec.assign(-result, boost::system::system_category());
+    }
+    handleAccept(ec);
+    if (_connected && !_acceptOperation) {
+        doURingAccept();
+    }
+}
+
+#endif
+
 
 UNIXConnector::UNIXConnector(std::string path, std::unique_ptr<ClientFactory> &&factory, double timeout,
                              Reactor *reactor)
@@ -284,7 +496,8 @@ void UNIXConnector::startConnecting() {
         _factoryStarted = true;
     }
     doConnect();
-    if (_timeout != 0.0) {
+    // A connect submitted to the ring carries its own linked timeout.
+    if (_timeout != 0.0 && !_connectOperation) {
         _timeoutId = _reactor->callLater(_timeout, [this, self=shared_from_this()]() {
             cbTimeout();
         });
@@ -298,6 +511,11 @@ void UNIXConnector::stopConnecting() {
     }
     _error = NET4CXX_EXCEPTION_PTR(UserAbort, "");
     BOOST_ASSERT(_connection);
+#ifdef NET4CXX_HAS_URING
+    if (_connectOperation) {
+        _reactor->getURing()->cancel(_connectOperation);
+    }
+#endif
     _connection->getSocket().close();
     _connection.reset();
     _state = kDisconnected;
@@ -317,12 +535,9 @@ void UNIXConnector::connectionFailed(std::exception_ptr reason) {
     }
 }
 
-void UNIXConnector::connectionLost(std::exception_ptr reason) {
-    if (reason) {
-        _error = std::move(reason);
-    }
+void UNIXConnector::connectionLost(const DisconnectReason &reason) {
     _state = kDisconnected;
-    _factory->clientConnectionLost(shared_from_this(), _error);
+    _factory->clientConnectionLost(shared_from_this(), reason);
     if (_state == kDisconnected) {
         _factory->doStop();
         _factoryStarted = false;
@@ -338,10 +553,24 @@ ProtocolPtr UNIXConnector::buildProtocol(const Address &address) {
 void UNIXConnector::doConnect() {
     makeTransport();
     EndpointType endpoint{_path};
-    _connection->getSocket().async_connect(endpoint, [this, self=shared_from_this(), connection=_connection](
-            const boost::system::error_code &ec) {
+#ifdef NET4CXX_HAS_URING
+    if (_reactor->getURing()) {
+        SocketType &socket = _connection->getSocket();
+        socket.open(endpoint.protocol());
+        _connectEndpoint = endpoint;
+        _connectOperation = _reactor->getURing()->connect(
+                socket.native_handle(), _connectEndpoint.data(), (socklen_t)_connectEndpoint.size(), _timeout,
+                _connectMemory, [this, self=shared_from_this(), connection=_connection](int result, unsigned flags) {
+                    cbURingConnect(result);
+                });
+        return;
+    }
+#endif
+    _connection->getSocket().async_connect(endpoint, makeCustomAllocHandler(
+            _connectMemory, [this, self=shared_from_this(), connection=_connection](
+                    const boost::system::error_code &ec) {
         cbConnect(ec);
-    });
+    }));
 }
 
 void UNIXConnector::handleConnect(const boost::system::error_code &ec) {
@@ -364,6 +593,24 @@ void UNIXConnector::handleConnect(const boost::system::error_code &ec) {
     }
 }
 
+#ifdef NET4CXX_HAS_URING
+
+void UNIXConnector::cbURingConnect(int result) {
+    _connectOperation = nullptr;
+    if (result == -ECANCELED && _state == kConnecting) {
+        // Nobody stopped us, so it was the linked timeout that cancelled the connect.
+        handleTimeout();
+        return;
+    }
+    boost::system::error_code ec;
+    if (result < 0) {
+        ec.assign(-result, boost::system::system_category());
+    }
+    cbConnect(ec);
+}
+
+#endif
+
 void UNIXConnector::handleTimeout() {
     NET4CXX_ERROR(gGenLog, "Connect error : Timeout");
     _error = NET4CXX_EXCEPTION_PTR(TimeoutError, "");
@@ -36,6 +36,14 @@ public:
 
     void abortConnection() override;
 
+    void pauseReading() override;
+
+    void resumeReading() override;
+
+    bool canPauseReading() const override {
+        return true;
+    }
+
     bool getNoDelay() const override {
         return true;
     }
@@ -80,18 +88,23 @@ protected:
     virtual void closeSocket();
 
     void startReading() {
-        if (!_reading) {
+        if (!_reading && !_readPaused && !_readLimited && (_rateLimiters.empty() || !waitForTokens())) {
             doRead();
         }
     }
 
+    /// Schedules the read for when the rate limiters have refilled if any of them is dry.
+    bool waitForTokens();
+
     void doRead();
 
+    void cbReadable(boost::system::error_code ec);
+
     void cbRead(const boost::system::error_code &ec, size_t transferredBytes) {
         _reading = false;
         handleRead(ec, transferredBytes);
         if (!_disconnecting && !_disconnected) {
-            doRead();
+            startReading();
         }
     }
 
@@ -103,6 +116,8 @@ protected:
         }
     }
 
+    size_t writeSome(const Byte *data, size_t length);
+
     void doWrite();
 
     void cbWrite(const boost::system::error_code &ec, size_t transferredBytes) {
@@ -115,8 +130,24 @@ protected:
 
     void handleWrite(const boost::system::error_code &ec, size_t transferredBytes);
 
+    void cancelOperations();
+
+#ifdef NET4CXX_HAS_URING
+    void cbURingRead(int result, unsigned flags);
+
+    void cbURingWrite(int result);
+#endif
+
     SocketType _socket;
-    std::exception_ptr _error;
+    DisconnectReason _error;
+    HandlerMemory<160> _readMemory;
+    HandlerMemory<256> _writeMemory;
+    URingOperation *_readOperation{nullptr};
+    URingOperation *_writeOperation{nullptr};
+    // Stands in for the pending read while reading is paused, which would otherwise keep the protocol alive.
+    ProtocolPtr _pausedProtocol;
+    bool _readLimited{false};
+    DelayedCall _rateLimitCall;
 };
 
 
@@ -195,15 +226,25 @@ protected:
 
     void doAccept() {
         _connection = std::make_shared<UNIXServerConnection>(_reactor);
-        _acceptor.async_accept(_connection->getSocket(), std::bind(&UNIXListener::cbAccept, shared_from_this(),
-                                                                   std::placeholders::_1));
+        _acceptor.async_accept(_connection->getSocket(),
+                               makeCustomAllocHandler(_acceptMemory, std::bind(&UNIXListener::cbAccept,
+                                                                               shared_from_this(),
+                                                                               std::placeholders::_1)));
     }
 
+#ifdef NET4CXX_HAS_URING
+    void doURingAccept();
+
+    void cbURingAccept(int result, unsigned flags);
+#endif
+
     std::string _path;
     std::unique_ptr<Factory> _factory;
     AcceptorType _acceptor;
     bool _connected{false};
     std::shared_ptr<UNIXServerConnection> _connection;
+    HandlerMemory<> _acceptMemory;
+    URingOperation *_acceptOperation{nullptr};
 };
 
 
@@ -226,7 +267,7 @@ public:
 
     void connectionFailed(std::exception_ptr reason={});
 
-    void connectionLost(std::exception_ptr reason={});
+    void connectionLost(const DisconnectReason &reason={});
 protected:
     ProtocolPtr buildProtocol(const Address &address);
 
@@ -244,6 +285,10 @@ protected:
 
     void handleConnect(const boost::system::error_code &ec);
 
+#ifdef NET4CXX_HAS_URING
+    void cbURingConnect(int result);
+#endif
+
     void cbTimeout() {
         handleTimeout();
     }
@@ -266,6 +311,9 @@ protected:
     DelayedCall _timeoutId;
     bool _factoryStarted{false};
     std::exception_ptr _error;
+    HandlerMemory<> _connectMemory;
+    EndpointType _connectEndpoint;
+    URingOperation *_connectOperation{nullptr};
 };
 
 NS_END
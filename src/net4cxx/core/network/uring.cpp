@@ -0,0 +1,253 @@
+//
+// Created by yuwenyong on 17-11-30.
+//
+
+#include "net4cxx/core/network/uring.h"
+#include "net4cxx/common/global/loggers.h"
+
+#ifdef NET4CXX_HAS_URING
+
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+NS_BEGIN
+
+URing::URing(boost::asio::io_service &ioService, unsigned entries)
+        : _ioService(ioService)
+        , _descriptor(ioService) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CLAMP | IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL;
+    // Multishot recv and accept post several completions per submission.
+    params.cq_entries = entries * 8;
+    _fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (_fd < 0) {
+        NET4CXX_THROW_EXCEPTION(IOError, StrUtil::format("io_uring_setup failed: %s", strerror(errno)));
+    }
+    try {
+        if (!(params.features & IORING_FEAT_NODROP) || !(params.features & IORING_FEAT_SINGLE_MMAP)) {
+            NET4CXX_THROW_EXCEPTION(IOError, "io_uring lacks required features");
+        }
+        _entries = params.sq_entries;
+        _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        _sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+        _sqRing = mmap(nullptr, _sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd,
+                       IORING_OFF_SQ_RING);
+        if (_sqRing == MAP_FAILED) {
+            _sqRing = nullptr;
+            NET4CXX_THROW_EXCEPTION(IOError, "mmap of io_uring rings failed");
+        }
+        _cqRing = _sqRing;
+        _sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void *sqes = mmap(nullptr, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd,
+                          IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            NET4CXX_THROW_EXCEPTION(IOError, "mmap of io_uring sqes failed");
+        }
+        _sqes = (io_uring_sqe *)sqes;
+        auto sqRing = (char *)_sqRing;
+        _sqHead = (unsigned *)(sqRing + params.sq_off.head);
+        _sqTail = (unsigned *)(sqRing + params.sq_off.tail);
+        _sqFlags = (unsigned *)(sqRing + params.sq_off.flags);
+        _sqArray = (unsigned *)(sqRing + params.sq_off.array);
+        _sqMask = *(unsigned *)(sqRing + params.sq_off.ring_mask);
+        _sqLocalTail = _sqSubmitted = *_sqTail;
+        auto cqRing = (char *)_cqRing;
+        _cqHead = (unsigned *)(cqRing + params.cq_off.head);
+        _cqTail = (unsigned *)(cqRing + params.cq_off.tail);
+        _cqMask = *(unsigned *)(cqRing + params.cq_off.ring_mask);
+        _cqes = (io_uring_cqe *)(cqRing + params.cq_off.cqes);
+
+        _bufferRingSize = BufferCount * sizeof(io_uring_buf);
+        void *bufferRing = mmap(nullptr, _bufferRingSize, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+        if (bufferRing == MAP_FAILED) {
+            NET4CXX_THROW_EXCEPTION(IOError, "mmap of the provided buffer ring failed");
+        }
+        _bufferRing = (io_uring_buf *)bufferRing;
+        io_uring_buf_reg reg;
+        memset(&reg, 0, sizeof(reg));
+        reg.ring_addr = (uint64_t)_bufferRing;
+        reg.ring_entries = BufferCount;
+        reg.bgid = BufferGroup;
+        if (syscall(__NR_io_uring_register, _fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+            NET4CXX_THROW_EXCEPTION(IOError, StrUtil::format("Registering provided buffers failed: %s",
+                                                             strerror(errno)));
+        }
+        _buffers.reset(new Byte[(size_t)BufferCount * BufferSize]);
+        for (unsigned bid = 0; bid != BufferCount; ++bid) {
+            recycleBuffer(bid << IORING_CQE_BUFFER_SHIFT);
+        }
+        _descriptor.assign(_fd);
+    } catch (...) {
+        shutdown();
+        throw;
+    }
+    waitCompletions();
+}
+
+URing::~URing() {
+    if (_operations) {
+        // Buffers of requests still in flight belong to the kernel until they complete, so cancel everything and
+        // wait for the final completions before letting the owners go.
+        io_uring_sqe *sqe = getSqe(1);
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+        flush();
+        for (int attempt = 0; _operations && attempt != 50; ++attempt) {
+            pollfd pfd{_fd, POLLIN, 0};
+            ::poll(&pfd, 1, 20);
+            reap(true);
+        }
+        if (_operations) {
+            NET4CXX_ERROR(gGenLog, "io_uring requests still in flight at shutdown, leaking them");
+            _operations = nullptr;
+            _buffers.release();
+        }
+    }
+    _descriptor.release();
+    shutdown();
+}
+
+void URing::cancel(URingOperation *operation) {
+    io_uring_sqe *sqe = getSqe(1);
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = (uint64_t)operation;
+    sqe->user_data = 0;
+}
+
+void URing::recycleBuffer(unsigned flags) {
+    unsigned bid = getBufferId(flags);
+    io_uring_buf &buf = _bufferRing[_bufferTail & (BufferCount - 1)];
+    buf.addr = (uint64_t)(_buffers.get() + (size_t)bid * BufferSize);
+    buf.len = BufferSize;
+    buf.bid = (uint16_t)bid;
+    ++_bufferTail;
+    // The ring tail overlays resv of the first entry.
+    __atomic_store_n(&_bufferRing[0].resv, _bufferTail, __ATOMIC_RELEASE);
+}
+
+void URing::flush() {
+    _flushPending = false;
+    unsigned toSubmit = _sqLocalTail - _sqSubmitted;
+    if (!toSubmit) {
+        return;
+    }
+    __atomic_store_n(_sqTail, _sqLocalTail, __ATOMIC_RELEASE);
+    int result;
+    do {
+        result = enter(toSubmit, 0, 0);
+    } while (result < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY));
+    if (result < 0) {
+        NET4CXX_ERROR(gGenLog, "io_uring_enter failed: %s", strerror(errno));
+        return;
+    }
+    _sqSubmitted += (unsigned)result;
+    _stats.submitted += (size_t)result;
+}
+
+io_uring_sqe* URing::getSqe(unsigned count) {
+    if (_sqLocalTail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE) + count > _entries) {
+        flush();
+    }
+    if (!_flushPending) {
+        _flushPending = true;
+        _ioService.post([this]() {
+            if (_flushPending) {
+                flush();
+            }
+        });
+    }
+    unsigned index = _sqLocalTail & _sqMask;
+    io_uring_sqe *sqe = &_sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    _sqArray[index] = index;
+    ++_sqLocalTail;
+    return sqe;
+}
+
+int URing::enter(unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    ++_stats.enters;
+    return (int)syscall(__NR_io_uring_enter, _fd, toSubmit, minComplete, flags, nullptr, 0);
+}
+
+void URing::waitCompletions() {
+    _descriptor.async_wait(boost::asio::posix::stream_descriptor::wait_read, [this](
+            const boost::system::error_code &ec) {
+        if (ec) {
+            return;
+        }
+        // Re-arm before reaping: the descriptor is edge-triggered and completions can arrive while handlers run.
+        waitCompletions();
+        reap(false);
+    });
+}
+
+void URing::reap(bool abandon) {
+    unsigned head = *_cqHead;
+    for (;;) {
+        unsigned tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            if (__atomic_load_n(_sqFlags, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW) {
+                enter(0, 0, IORING_ENTER_GETEVENTS);
+                continue;
+            }
+            break;
+        }
+        io_uring_cqe &cqe = _cqes[head & _cqMask];
+        auto operation = (URingOperation *)cqe.user_data;
+        int result = cqe.res;
+        unsigned flags = cqe.flags;
+        __atomic_store_n(_cqHead, ++head, __ATOMIC_RELEASE);
+        ++_stats.completed;
+        if (!operation) {
+            continue;
+        }
+        if (!hasMore(flags)) {
+            detach(operation);
+        }
+        if (abandon) {
+            if (hasBuffer(flags)) {
+                recycleBuffer(flags);
+            }
+            if (!hasMore(flags)) {
+                operation->destroy();
+            }
+            continue;
+        }
+        try {
+            operation->complete(result, flags);
+        } catch (std::exception &e) {
+            NET4CXX_ERROR(gAppLog, "Unexpected Exception:%s", e.what());
+        } catch (...) {
+            NET4CXX_ERROR(gAppLog, "Unknown Exception");
+        }
+    }
+}
+
+void URing::shutdown() {
+    if (_bufferRing) {
+        munmap(_bufferRing, _bufferRingSize);
+        _bufferRing = nullptr;
+    }
+    if (_sqes) {
+        munmap(_sqes, _sqesSize);
+        _sqes = nullptr;
+    }
+    if (_sqRing) {
+        munmap(_sqRing, _sqRingSize);
+        _sqRing = _cqRing = nullptr;
+    }
+    if (_fd >= 0) {
+        ::close(_fd);
+        _fd = -1;
+    }
+}
+
+NS_END
+
+#endif //NET4CXX_HAS_URING
@@ -0,0 +1,306 @@
+//
+// Created by yuwenyong on 17-11-30.
+//
+
+#ifndef NET4CXX_CORE_NETWORK_URING_H
+#define NET4CXX_CORE_NETWORK_URING_H
+
+#include "net4cxx/common/common.h"
+#include <boost/asio.hpp>
+#include "net4cxx/core/network/base.h"
+
+#ifdef NET4CXX_HAS_URING
+
+#include <sys/socket.h>
+#include <linux/io_uring.h>
+
+NS_BEGIN
+
+
+/// A request in flight on a URing; its address is the user_data of its SQEs.
+class NET4CXX_COMMON_API URingOperation {
+public:
+    friend class URing;
+
+    URingOperation() = default;
+
+    URingOperation(const URingOperation&) = delete;
+
+    URingOperation& operator=(const URingOperation&) = delete;
+protected:
+    ~URingOperation() = default;
+
+    /// Delivers a completion; the final one must free the operation before running the handler.
+    virtual void complete(int result, unsigned flags) = 0;
+
+    /// Frees the operation without running its handler.
+    virtual void destroy() = 0;
+
+    URingOperation *_prev{nullptr};
+    URingOperation *_next{nullptr};
+};
+
+
+struct URingNoData {
+
+};
+
+
+struct URingMessageData {
+    static constexpr size_t MaxIovecs = 8;
+
+    msghdr header;
+    iovec iov[MaxIovecs];
+};
+
+
+struct URingTimeoutData {
+    __kernel_timespec timeout;
+};
+
+
+/// Operation allocated through its handler's memory, as makeCustomAllocHandler does; handler(result, flags).
+template <typename HandlerT, typename MemoryT, typename DataT=URingNoData>
+class URingHandler: public URingOperation {
+public:
+    template <typename ArgT>
+    static URingHandler* create(MemoryT &memory, ArgT &&handler) {
+        void *pointer = memory.allocate(sizeof(URingHandler));
+        return new (pointer) URingHandler(memory, std::forward<ArgT>(handler));
+    }
+
+    DataT& data() {
+        return _data;
+    }
+protected:
+    template <typename ArgT>
+    URingHandler(MemoryT &memory, ArgT &&handler)
+            : _memory(memory)
+            , _handler(std::forward<ArgT>(handler)) {
+
+    }
+
+    void complete(int result, unsigned flags) override {
+#ifdef NET4CXX_HAS_LOOP_STATS
+        LoopMonitor::HandlerScope scope(LoopMonitor::kIo, typeid(HandlerT));
+#endif
+        if (flags & IORING_CQE_F_MORE) {
+            _handler(result, flags);
+        } else {
+            HandlerT handler(std::move(_handler));
+            destroy();
+            handler(result, flags);
+        }
+    }
+
+    void destroy() override {
+        // The handler may hold the last reference to the owner of the memory, so it goes after the deallocation.
+        HandlerT handler(std::move(_handler));
+        MemoryT &memory = _memory;
+        this->~URingHandler();
+        memory.deallocate(this);
+    }
+
+    MemoryT &_memory;
+    HandlerT _handler;
+    DataT _data;
+};
+
+
+/// io_uring driven from the reactor's io_service; needs Linux 6.0 or later.
+class NET4CXX_COMMON_API URing: public boost::noncopyable {
+public:
+    /// Counters since the ring was created; enters is the number of io_uring_enter calls.
+    struct Stats {
+        size_t enters{0};
+        size_t submitted{0};
+        size_t completed{0};
+    };
+
+    static constexpr unsigned DefaultEntries = 256;
+    static constexpr unsigned BufferCount = 512;
+    static constexpr unsigned BufferSize = 16384;
+    static constexpr unsigned BufferGroup = 0;
+
+    /// Throws IOError when the kernel does not support what the backend needs.
+    explicit URing(boost::asio::io_service &ioService, unsigned entries=DefaultEntries);
+
+    ~URing();
+
+    /// Arms a recv on fd into provided buffers, which the handler hands back with recycleBuffer.
+    template <typename MemoryT, typename HandlerT>
+    URingOperation* recv(int fd, MemoryT &memory, HandlerT &&handler, bool multishot=true) {
+        auto operation = URingHandler<typename std::decay<HandlerT>::type, MemoryT>::create(
+                memory, std::forward<HandlerT>(handler));
+        io_uring_sqe *sqe = getSqe(1);
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = fd;
+        sqe->ioprio = multishot ? IORING_RECV_MULTISHOT : 0;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = BufferGroup;
+        attach(sqe, operation);
+        return operation;
+    }
+
+    /// Sends the leading buffers of queue in one sendmsg; they must stay untouched until the handler runs.
+    template <typename MemoryT, typename HandlerT>
+    URingOperation* send(int fd, WriteQueue &queue, MemoryT &memory, HandlerT &&handler) {
+        auto operation = URingHandler<typename std::decay<HandlerT>::type, MemoryT, URingMessageData>::create(
+                memory, std::forward<HandlerT>(handler));
+        URingMessageData &data = operation->data();
+        size_t count = 0;
+        for (auto iter = queue.begin(); iter != queue.end() && count != URingMessageData::MaxIovecs; ++iter) {
+            data.iov[count].iov_base = iter->getReadPointer();
+            data.iov[count].iov_len = iter->getActiveSize();
+            ++count;
+        }
+        memset(&data.header, 0, sizeof(data.header));
+        data.header.msg_iov = data.iov;
+        data.header.msg_iovlen = count;
+        io_uring_sqe *sqe = getSqe(1);
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = fd;
+        sqe->addr = (uint64_t)&data.header;
+        sqe->msg_flags = MSG_NOSIGNAL;
+        attach(sqe, operation);
+        return operation;
+    }
+
+    /// Arms a multishot accept on a listening fd; each completion carries a non-blocking, close-on-exec socket.
+    template <typename MemoryT, typename HandlerT>
+    URingOperation* accept(int fd, MemoryT &memory, HandlerT &&handler) {
+        auto operation = URingHandler<typename std::decay<HandlerT>::type, MemoryT>::create(
+                memory, std::forward<HandlerT>(handler));
+        io_uring_sqe *sqe = getSqe(1);
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = fd;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        attach(sqe, operation);
+        return operation;
+    }
+
+    /// A positive timeout cancels the connect with -ECANCELED.
+    template <typename MemoryT, typename HandlerT>
+    URingOperation* connect(int fd, const sockaddr *address, socklen_t length, double timeout, MemoryT &memory,
+                            HandlerT &&handler) {
+        auto operation = URingHandler<typename std::decay<HandlerT>::type, MemoryT, URingTimeoutData>::create(
+                memory, std::forward<HandlerT>(handler));
+        io_uring_sqe *sqe = getSqe(timeout > 0.0 ? 2 : 1);
+        sqe->opcode = IORING_OP_CONNECT;
+        sqe->fd = fd;
+        sqe->addr = (uint64_t)address;
+        sqe->off = length;
+        attach(sqe, operation);
+        if (timeout > 0.0) {
+            sqe->flags = IOSQE_IO_LINK;
+            auto &timespec = operation->data().timeout;
+            auto nanoseconds = (int64_t)(timeout * 1000000000.0);
+            timespec.tv_sec = nanoseconds / 1000000000;
+            timespec.tv_nsec = nanoseconds % 1000000000;
+            sqe = getSqe(1);
+            sqe->opcode = IORING_OP_LINK_TIMEOUT;
+            sqe->fd = -1;
+            sqe->addr = (uint64_t)&timespec;
+            sqe->len = 1;
+            sqe->user_data = 0;
+        }
+        return operation;
+    }
+
+    /// Asks the kernel to cancel operation; its handler still runs, with -ECANCELED unless it completed first.
+    void cancel(URingOperation *operation);
+
+    Byte* getBuffer(unsigned flags) const {
+        return _buffers.get() + (size_t)getBufferId(flags) * BufferSize;
+    }
+
+    void recycleBuffer(unsigned flags);
+
+    /// Submits the queued SQEs now instead of at the end of the batch.
+    void flush();
+
+    const Stats& getStats() const {
+        return _stats;
+    }
+
+    static bool hasMore(unsigned flags) {
+        return (flags & IORING_CQE_F_MORE) != 0;
+    }
+
+    static bool hasBuffer(unsigned flags) {
+        return (flags & IORING_CQE_F_BUFFER) != 0;
+    }
+protected:
+    static unsigned getBufferId(unsigned flags) {
+        return flags >> IORING_CQE_BUFFER_SHIFT;
+    }
+
+    /// Next free SQE, zeroed, with room for count linked ones.
+    io_uring_sqe* getSqe(unsigned count);
+
+    void attach(io_uring_sqe *sqe, URingOperation *operation) {
+        sqe->user_data = (uint64_t)operation;
+        operation->_prev = nullptr;
+        operation->_next = _operations;
+        if (_operations) {
+            _operations->_prev = operation;
+        }
+        _operations = operation;
+    }
+
+    void detach(URingOperation *operation) {
+        if (operation->_prev) {
+            operation->_prev->_next = operation->_next;
+        } else {
+            _operations = operation->_next;
+        }
+        if (operation->_next) {
+            operation->_next->_prev = operation->_prev;
+        }
+    }
+
+    int enter(unsigned toSubmit, unsigned minComplete, unsigned flags);
+
+    void waitCompletions();
+
+    void reap(bool abandon);
+
+    void shutdown();
+
+    int _fd{-1};
+    unsigned _entries{0};
+    void *_sqRing{nullptr};
+    size_t _sqRingSize{0};
+    void *_cqRing{nullptr};
+    size_t _cqRingSize{0};
+    io_uring_sqe *_sqes{nullptr};
+    size_t _sqesSize{0};
+    unsigned *_sqHead{nullptr};
+    unsigned *_sqTail{nullptr};
+    unsigned *_sqFlags{nullptr};
+    unsigned *_sqArray{nullptr};
+    unsigned _sqMask{0};
+    unsigned _sqLocalTail{0};
+    unsigned _sqSubmitted{0};
+    unsigned *_cqHead{nullptr};
+    unsigned *_cqTail{nullptr};
+    unsigned _cqMask{0};
+    io_uring_cqe *_cqes{nullptr};
+    // Indexed by hand: io_uring_buf_ring::bufs is laid out differently when the header is compiled as C++.
+    io_uring_buf *_bufferRing{nullptr};
+    size_t _bufferRingSize{0};
+    std::unique_ptr<Byte[]> _buffers;
+    uint16_t _bufferTail{0};
+    URingOperation *_operations{nullptr};
+    bool _flushPending{false};
+    Stats _stats;
+    boost::asio::io_service &_ioService;
+    boost::asio::posix::stream_descriptor _descriptor;
+};
+
+NS_END
+
+#endif //NET4CXX_HAS_URING
+
+#endif //NET4CXX_CORE_NETWORK_URING_H
@@ -18,19 +18,37 @@
 #include "net4cxx/common/global/loggers.h"
 #include "net4cxx/common/httputils/cookie.h"
 #include "net4cxx/common/httputils/httplib.h"
+#include "net4cxx/common/httputils/httpparser.h"
+#include "net4cxx/common/httputils/httpscan.h"
 #include "net4cxx/common/httputils/urlparse.h"
 #include "net4cxx/common/logging/logging.h"
 #include "net4cxx/common/serialization/oarchive.h"
+#include "net4cxx/common/utilities/histogram.h"
 #include "net4cxx/common/utilities/messagebuffer.h"
 #include "net4cxx/common/utilities/objectmanager.h"
 #include "net4cxx/common/utilities/random.h"
 #include "net4cxx/common/utilities/util.h"
 
+#include "net4cxx/core/network/admission.h"
+#include "net4cxx/core/network/affinity.h"
+#include "net4cxx/core/network/coroutine.h"
+#include "net4cxx/core/network/defer.h"
 #include "net4cxx/core/network/endpoints.h"
+#include "net4cxx/core/network/httpclient.h"
+#include "net4cxx/core/network/httpserver.h"
 #include "net4cxx/core/network/unix.h"
+#include "net4cxx/core/network/ktls.h"
+#include "net4cxx/core/network/loopback.h"
+#include "net4cxx/core/network/loopmonitor.h"
 #include "net4cxx/core/network/protocol.h"
+#include "net4cxx/core/network/ratelimit.h"
 #include "net4cxx/core/network/reactor.h"
+#include "net4cxx/core/network/shm.h"
 #include "net4cxx/core/network/ssl.h"
+#include "net4cxx/core/network/sslcache.h"
+#include "net4cxx/core/network/sslcerts.h"
 #include "net4cxx/core/network/tcp.h"
+#include "net4cxx/core/network/threadpool.h"
+#include "net4cxx/core/network/uring.h"
 
 #endif //NET4CXX_NET4CXX_H